@@ -0,0 +1,624 @@
+/**
+ * @file bench_cpp_pid.cpp
+ * @brief Performance benchmarks for the C++ PID controller
+ *
+ * Measures the time per step of PIDController, BasicPID,
+ * MeasurementFilter, zoh_Fy, the batch, bank, partitioned bank and
+ * shared bank paths, the array anti-windup and saturation, gain
+ * scheduling, the trace recorder, state checkpoints and controller
+ * reloads, using the Google Benchmark library. See
+ * benchmarks/README.md for build and JSON output instructions.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "../cpp_pid/anti_windup.h"
+#include "../cpp_pid/basic_pid.h"
+#include "../cpp_pid/fixed_rate_filter.h"
+#include "../cpp_pid/controller_arena.h"
+#include "../cpp_pid/event_driven.h"
+#include "../cpp_pid/gain_schedule.h"
+#include "../cpp_pid/measurement_filter.h"
+#include "../cpp_pid/partitioned_bank.h"
+#include "../cpp_pid/pid.h"
+#include "../cpp_pid/pid_bank.h"
+#include "../cpp_pid/shared_bank.h"
+#include "../cpp_pid/state_checkpoint.h"
+#include "../cpp_pid/trace_recorder.h"
+#include "../cpp_pid/zoh_cache.h"
+#include "../cpp_pid/zoh_pid.h"
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Length of the precomputed input signals, cycled through by the
+// single-loop benchmarks
+const size_t SIGNAL_LENGTH = 4096;
+
+/**
+ * @brief Precomputed random inputs for one or more loops
+ */
+struct Signals {
+    std::vector<double> r;
+    std::vector<double> y;
+    std::vector<double> uff;
+    std::vector<double> Tx;
+
+    /**
+     * @param n Number of values
+     * @param jitter Relative jitter of Tx around 1 (0 for fixed Tx)
+     */
+    Signals(size_t n, double jitter) : r(n), y(n), uff(n), Tx(n) {
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<double> signal(-1.0, 1.0);
+        for (size_t i = 0; i < n; ++i) {
+            r[i] = signal(rng);
+            y[i] = signal(rng);
+            uff[i] = 0.1 * signal(rng);
+            Tx[i] = 1.0 + jitter * signal(rng);
+        }
+    }
+};
+
+// Time per processed step, reported in seconds
+void set_time_per_step(benchmark::State& state, double steps) {
+    state.SetItemsProcessed(static_cast<int64_t>(steps));
+    state.counters["s_per_step"] = benchmark::Counter(
+        steps, benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+// Gains for the structure argument: 0 = P, 1 = PI, 2 = PID
+void structure_gains(int structure, double& kp, double& ki, double& kd) {
+    kp = 1.0;
+    ki = structure >= 1 ? 0.5 : 0.0;
+    kd = structure >= 2 ? 0.1 : 0.0;
+}
+
+} // namespace
+
+/**
+ * @brief PIDController::operator()
+ *
+ * Arguments: structure (0 = P, 1 = PI, 2 = PID), jittery Tx (0/1),
+ * saturation limits (0/1).
+ */
+static void BM_PIDController(benchmark::State& state) {
+    double kp, ki, kd;
+    structure_gains(static_cast<int>(state.range(0)), kp, ki, kd);
+    double jitter = state.range(1) ? 0.05 : 0.0;
+    double limit = state.range(2)
+        ? 0.5 : std::numeric_limits<double>::infinity();
+
+    Signals s(SIGNAL_LENGTH, jitter);
+    PIDController controller(kp, ki, kd, 10.0, -limit, limit);
+    size_t i = 0;
+    for (auto _ : state) {
+        double u = controller(s.r[i], s.y[i], s.uff[i], 0.0, 0.0, s.Tx[i]);
+        benchmark::DoNotOptimize(u);
+        i = (i + 1) % SIGNAL_LENGTH;
+    }
+    set_time_per_step(state, static_cast<double>(state.iterations()));
+}
+BENCHMARK(BM_PIDController)
+    ->ArgNames({"structure", "jitter", "limits"})
+    ->ArgsProduct({{0, 1, 2}, {0, 1}, {0, 1}});
+
+/**
+ * @brief BasicPID PI controller without feedforward or limits
+ */
+static void BM_BasicPID_PI(benchmark::State& state) {
+    Signals s(SIGNAL_LENGTH, 0.0);
+    BasicPID<PIDStructure::PI, false, false> controller(1.0, 0.5, 0.0);
+    size_t i = 0;
+    for (auto _ : state) {
+        double u = controller(s.r[i], s.y[i]);
+        benchmark::DoNotOptimize(u);
+        i = (i + 1) % SIGNAL_LENGTH;
+    }
+    set_time_per_step(state, static_cast<double>(state.iterations()));
+}
+BENCHMARK(BM_BasicPID_PI);
+
+/**
+ * @brief MeasurementFilter::operator()
+ *
+ * Arguments: jittery Tx (0/1), ZohMethod (0 = EXACT, 1 = POLYNOMIAL,
+ * 2 = INCREMENTAL), exact ZohCache (0/1).
+ */
+static void BM_MeasurementFilter(benchmark::State& state) {
+    Signals s(SIGNAL_LENGTH, state.range(0) ? 0.05 : 0.0);
+    MeasurementFilter filter(10.0, static_cast<ZohMethod>(state.range(1)));
+    ZohCache cache(1e-3);
+    if (state.range(2)) {
+        filter.set_cache(&cache);
+    }
+    size_t i = 0;
+    for (auto _ : state) {
+        FilterOutput out = filter(s.y[i], s.Tx[i]);
+        benchmark::DoNotOptimize(out);
+        i = (i + 1) % SIGNAL_LENGTH;
+    }
+    set_time_per_step(state, static_cast<double>(state.iterations()));
+}
+BENCHMARK(BM_MeasurementFilter)
+    ->ArgNames({"jitter", "method", "cache"})
+    ->Args({0, 0, 0})
+    ->Args({1, 0, 0})
+    ->Args({1, 1, 0})
+    ->Args({1, 2, 0})
+    ->Args({1, 0, 1});
+
+/**
+ * @brief FixedRateMeasurementFilter::operator()
+ */
+static void BM_FixedRateMeasurementFilter(benchmark::State& state) {
+    Signals s(SIGNAL_LENGTH, 0.0);
+    FixedRateMeasurementFilter<std::ratio<10> > filter;
+    size_t i = 0;
+    for (auto _ : state) {
+        FilterOutput out = filter(s.y[i]);
+        benchmark::DoNotOptimize(out);
+        i = (i + 1) % SIGNAL_LENGTH;
+    }
+    set_time_per_step(state, static_cast<double>(state.iterations()));
+}
+BENCHMARK(BM_FixedRateMeasurementFilter);
+
+/**
+ * @brief zoh_Fy
+ *
+ * Argument: ZohMethod (0 = EXACT, 1 = POLYNOMIAL).
+ */
+static void BM_zoh_Fy(benchmark::State& state) {
+    Signals s(SIGNAL_LENGTH, 0.05);
+    ZohMethod method = static_cast<ZohMethod>(state.range(0));
+    size_t i = 0;
+    for (auto _ : state) {
+        FilterParams params = zoh_Fy(10.0, s.Tx[i], method);
+        benchmark::DoNotOptimize(params);
+        i = (i + 1) % SIGNAL_LENGTH;
+    }
+    set_time_per_step(state, static_cast<double>(state.iterations()));
+}
+BENCHMARK(BM_zoh_Fy)->ArgName("method")->Arg(0)->Arg(1);
+
+/**
+ * @brief PIDController::run over a series
+ *
+ * Arguments: series length, jittery Tx (0/1).
+ */
+static void BM_PIDController_run(benchmark::State& state) {
+    size_t n = static_cast<size_t>(state.range(0));
+    Signals s(n, state.range(1) ? 0.05 : 0.0);
+    InputSeries inputs(n, s.r.data(), s.y.data());
+    inputs.uff = s.uff.data();
+    inputs.Tx = s.Tx.data();
+    std::vector<double> u(n);
+    PIDController controller(1.0, 0.5, 0.1, 10.0, -0.5, 0.5);
+    for (auto _ : state) {
+        controller.run(inputs, u.data());
+        benchmark::ClobberMemory();
+    }
+    set_time_per_step(
+        state, static_cast<double>(state.iterations()) * n);
+}
+BENCHMARK(BM_PIDController_run)
+    ->ArgNames({"n", "jitter"})
+    ->ArgsProduct({benchmark::CreateRange(1, 1 << 20, 32), {0, 1}});
+
+/**
+ * @brief Configuration reload: create and destroy n controllers
+ *
+ * Arguments: n (controllers), mode (0 = one new/delete per controller,
+ * 1 = ControllerArena). s_per_step gives the time per controller of a
+ * reload, creation and destruction included.
+ */
+static void BM_ControllerReload(benchmark::State& state) {
+    size_t n = static_cast<size_t>(state.range(0));
+    bool use_arena = state.range(1) != 0;
+    ControllerArena arena;
+    std::vector<PIDController*> controllers(n);
+    for (auto _ : state) {
+        for (size_t i = 0; i < n; ++i) {
+            double kp = 1.0 + 1e-3 * static_cast<double>(i);
+            controllers[i] = use_arena
+                ? arena.create<PIDController>(kp, 0.5, 0.1, 10.0)
+                : new PIDController(kp, 0.5, 0.1, 10.0);
+        }
+        benchmark::ClobberMemory();
+        if (use_arena) {
+            arena.release();
+        } else {
+            for (size_t i = 0; i < n; ++i) {
+                delete controllers[i];
+            }
+        }
+    }
+    set_time_per_step(
+        state, static_cast<double>(state.iterations()) * n);
+}
+BENCHMARK(BM_ControllerReload)
+    ->ArgNames({"n", "arena"})
+    ->ArgsProduct({{10000, 100000}, {0, 1}});
+
+/**
+ * @brief PIDBank::step
+ *
+ * Arguments: number of loops, kernel (PIDBankKernel value).
+ */
+static void BM_PIDBank(benchmark::State& state) {
+    size_t n = static_cast<size_t>(state.range(0));
+    PIDBankKernel kernel = static_cast<PIDBankKernel>(state.range(1));
+    if (!PIDBank::kernel_supported(kernel)) {
+        state.SkipWithError("Kernel not supported on this CPU");
+        return;
+    }
+
+    Signals s(n, 0.0);
+    std::vector<double> zeros(n, 0.0), u(n);
+    std::unique_ptr<bool[]> track(new bool[n]);
+    std::unique_ptr<bool[]> auto_mode(new bool[n]);
+    std::vector<WindupMode> windup(n, WindupMode::NONE);
+    for (size_t i = 0; i < n; ++i) {
+        track[i] = false;
+        auto_mode[i] = true;
+    }
+
+    PIDBank bank(n, 1.0, 0.5, 0.1, 10.0, -0.5, 0.5);
+    bank.set_kernel(kernel);
+    for (auto _ : state) {
+        bank.step(s.r.data(), s.y.data(), s.uff.data(), zeros.data(),
+                  zeros.data(), s.Tx.data(), track.get(), auto_mode.get(),
+                  windup.data(), u.data());
+        benchmark::ClobberMemory();
+    }
+    set_time_per_step(
+        state, static_cast<double>(state.iterations()) * n);
+}
+BENCHMARK(BM_PIDBank)
+    ->ArgNames({"n", "kernel"})
+    ->ArgsProduct({
+        benchmark::CreateRange(1, 1 << 20, 32),
+        {static_cast<int64_t>(PIDBankKernel::SCALAR),
+         static_cast<int64_t>(PIDBankKernel::SIMD128),
+         static_cast<int64_t>(PIDBankKernel::AVX2),
+         static_cast<int64_t>(PIDBankKernel::AVX512)}});
+
+/**
+ * @brief EventDrivenBank::tick
+ *
+ * Arguments: number of loops, percentage of loops whose measurement
+ * moves beyond the deadband on each tick (spread evenly over the bank,
+ * so the active controllers are not consecutive); the others stay
+ * constant. s_per_step is the time per controller of the bank,
+ * including the deadband checks of idle controllers. Compare with
+ * BM_PIDBank, which steps every controller.
+ */
+static void BM_EventDrivenBank(benchmark::State& state) {
+    size_t n = static_cast<size_t>(state.range(0));
+    size_t percent = static_cast<size_t>(state.range(1));
+
+    Signals s(n, 0.0);
+    std::vector<double> zeros(n, 0.0), Tx(n, 1.0), u(n);
+    std::unique_ptr<bool[]> track(new bool[n]);
+    std::unique_ptr<bool[]> auto_mode(new bool[n]);
+    std::vector<WindupMode> windup(n, WindupMode::NONE);
+    std::vector<size_t> moving;
+    for (size_t i = 0; i < n; ++i) {
+        track[i] = false;
+        auto_mode[i] = true;
+        if (i * percent / 100 != (i + 1) * percent / 100) {
+            moving.push_back(i);
+        }
+    }
+
+    PIDBank bank(n, 1.0, 0.5, 0.1, 10.0, -0.5, 0.5);
+    EventDrivenBank events(
+        bank, EventDeadband(0.01, 0.01, 0.01, 0.01, 1e9));
+    size_t stepped = 0;
+    for (auto _ : state) {
+        for (size_t k = 0; k < moving.size(); ++k) {
+            s.y[moving[k]] = -s.y[moving[k]];
+        }
+        stepped += events.tick(
+            s.r.data(), s.y.data(), s.uff.data(), zeros.data(),
+            zeros.data(), Tx.data(), track.get(), auto_mode.get(),
+            windup.data(), u.data());
+        benchmark::ClobberMemory();
+    }
+    state.counters["stepped"] = static_cast<double>(stepped)
+        / static_cast<double>(state.iterations()) / n;
+    set_time_per_step(
+        state, static_cast<double>(state.iterations()) * n);
+}
+BENCHMARK(BM_EventDrivenBank)
+    ->ArgNames({"n", "percent"})
+    ->ArgsProduct({{1000, 100000}, {0, 1, 10, 100}});
+
+/**
+ * @brief Array anti_windup and saturate_with_flags
+ *
+ * Arguments: number of elements, array form (0 = per-element calls,
+ * 1 = array functions). One step is one anti-windup and one clamp.
+ */
+static void BM_AntiWindupArray(benchmark::State& state) {
+    size_t n = static_cast<size_t>(state.range(0));
+    bool array = state.range(1) != 0;
+
+    Signals s(n, 0.0);
+    std::vector<double> umin(n, -0.5), umax(n, 0.5), Dui(n), u(n);
+    std::vector<unsigned char> windup(n), saturation(n);
+    for (size_t i = 0; i < n; ++i) {
+        windup[i] = static_cast<unsigned char>(i % 4);
+    }
+
+    for (auto _ : state) {
+        Dui = s.r;
+        u = s.y;
+        if (array) {
+            anti_windup(Dui.data(), windup.data(), n);
+            saturate_with_flags(u.data(), umin.data(), umax.data(),
+                                saturation.data(), n);
+        } else {
+            for (size_t i = 0; i < n; ++i) {
+                Dui[i] = anti_windup(
+                    Dui[i], static_cast<WindupMode>(windup[i]));
+                u[i] = saturate_with_flags(
+                    u[i], umin[i], umax[i], saturation[i]);
+            }
+        }
+        benchmark::ClobberMemory();
+    }
+    set_time_per_step(
+        state, static_cast<double>(state.iterations()) * n);
+}
+BENCHMARK(BM_AntiWindupArray)
+    ->ArgNames({"n", "array"})
+    ->ArgsProduct({{1000, 100000}, {0, 1}});
+
+/**
+ * @brief PartitionedBank::step over all NUMA nodes
+ *
+ * Arguments: number of loops, shards per node. The "shards" counter
+ * gives the total number of worker threads. Compare with BM_PIDBank
+ * for the scaling over one thread.
+ */
+static void BM_PartitionedBank(benchmark::State& state) {
+    size_t n = static_cast<size_t>(state.range(0));
+    Signals s(n, 0.0);
+    std::vector<double> zeros(n, 0.0), u(n);
+    std::unique_ptr<bool[]> track(new bool[n]);
+    std::unique_ptr<bool[]> auto_mode(new bool[n]);
+    std::vector<WindupMode> windup(n, WindupMode::NONE);
+    for (size_t i = 0; i < n; ++i) {
+        track[i] = false;
+        auto_mode[i] = true;
+    }
+
+    PartitionOptions options;
+    options.shards_per_node = static_cast<size_t>(state.range(1));
+    PartitionedBank bank(n, options, 1.0, 0.5, 0.1, 10.0, -0.5, 0.5);
+    for (auto _ : state) {
+        bank.step(s.r.data(), s.y.data(), s.uff.data(), zeros.data(),
+                  zeros.data(), s.Tx.data(), track.get(), auto_mode.get(),
+                  windup.data(), u.data());
+        benchmark::ClobberMemory();
+    }
+    state.counters["shards"] = static_cast<double>(bank.shards());
+    set_time_per_step(
+        state, static_cast<double>(state.iterations()) * n);
+}
+BENCHMARK(BM_PartitionedBank)
+    ->ArgNames({"n", "shards_per_node"})
+    ->ArgsProduct({{1 << 14, 1 << 20}, {1, 2, 4, 8}})
+    ->UseRealTime();
+
+/**
+ * @brief SharedPIDBank::step with a reader mapping the segment
+ *
+ * Arguments: number of loops. Compare with BM_PIDBank for the cost of
+ * placing the bank in shared memory.
+ */
+static void BM_SharedPIDBank(benchmark::State& state) {
+    size_t n = static_cast<size_t>(state.range(0));
+    Signals s(n, 0.0);
+    std::vector<double> zeros(n, 0.0), u(n);
+    std::vector<WindupMode> windup(n, WindupMode::NONE);
+
+    SharedPIDBank shared(
+        "/bench_cpp_pid_bank", n, 1.0, 0.5, 0.1, 10.0, -0.5, 0.5);
+    SharedBankReader reader(shared.name());
+    for (auto _ : state) {
+        shared.step(s.r.data(), s.y.data(), s.uff.data(), zeros.data(),
+                    zeros.data(), s.Tx.data(), windup.data(), u.data());
+        benchmark::ClobberMemory();
+    }
+    set_time_per_step(
+        state, static_cast<double>(state.iterations()) * n);
+}
+BENCHMARK(BM_SharedPIDBank)
+    ->ArgName("n")
+    ->RangeMultiplier(32)
+    ->Range(1, 1 << 20);
+
+/**
+ * @brief schedule_bank_gains followed by PIDBank::step
+ *
+ * Arguments: number of loops, evenly spaced breakpoints (0/1). Compare
+ * with BM_PIDBank for the cost of scheduling.
+ */
+static void BM_GainScheduledBank(benchmark::State& state) {
+    size_t n = static_cast<size_t>(state.range(0));
+    std::vector<double> x, kp, ki, kd;
+    for (int k = 0; k < 16; ++k) {
+        double spacing = state.range(1) ? 1.0 : 1.0 + 0.1 * k;
+        x.push_back(x.empty() ? 0.0 : x.back() + spacing);
+        kp.push_back(1.0 + 0.1 * k);
+        ki.push_back(0.5 - 0.01 * k);
+        kd.push_back(0.1);
+    }
+    GainSchedule schedule(x, kp, ki, kd);
+
+    Signals s(n, 0.0);
+    std::vector<double> op(n), zeros(n, 0.0), u(n);
+    std::unique_ptr<bool[]> track(new bool[n]);
+    std::unique_ptr<bool[]> auto_mode(new bool[n]);
+    std::vector<WindupMode> windup(n, WindupMode::NONE);
+    for (size_t i = 0; i < n; ++i) {
+        op[i] = x.back() * 0.5 * (s.r[i] + 1.0);
+        track[i] = false;
+        auto_mode[i] = true;
+    }
+
+    PIDBank bank(n, 1.0, 0.5, 0.1, 10.0, -0.5, 0.5);
+    for (auto _ : state) {
+        schedule_bank_gains(bank, schedule, op.data());
+        bank.step(s.r.data(), s.y.data(), s.uff.data(), zeros.data(),
+                  zeros.data(), s.Tx.data(), track.get(), auto_mode.get(),
+                  windup.data(), u.data());
+        benchmark::ClobberMemory();
+    }
+    set_time_per_step(
+        state, static_cast<double>(state.iterations()) * n);
+}
+BENCHMARK(BM_GainScheduledBank)
+    ->ArgNames({"n", "uniform"})
+    ->ArgsProduct({{1 << 10, 1 << 14}, {0, 1}});
+
+/**
+ * @brief GainSchedule batch lookup alone
+ *
+ * Arguments: n (operating points), uniform (1 for evenly spaced
+ * breakpoints, 0 for a binary search), breakpoints.
+ */
+static void BM_GainScheduleLookup(benchmark::State& state) {
+    size_t n = static_cast<size_t>(state.range(0));
+    std::vector<double> x, kp, ki, kd;
+    for (int k = 0; k < state.range(2); ++k) {
+        double spacing = state.range(1) ? 1.0 : 1.0 + 0.1 * k;
+        x.push_back(x.empty() ? 0.0 : x.back() + spacing);
+        kp.push_back(1.0 + 0.1 * k);
+        ki.push_back(0.5 - 0.01 * k);
+        kd.push_back(0.1);
+    }
+    GainSchedule schedule(x, kp, ki, kd);
+
+    Signals s(n, 0.0);
+    std::vector<double> op(n), kp_out(n), ki_out(n), kd_out(n);
+    for (size_t i = 0; i < n; ++i) {
+        op[i] = x.back() * 0.5 * (s.r[i] + 1.0);
+    }
+    for (auto _ : state) {
+        schedule.lookup(n, op.data(), kp_out.data(), ki_out.data(),
+                        kd_out.data());
+        benchmark::ClobberMemory();
+    }
+    set_time_per_step(
+        state, static_cast<double>(state.iterations()) * n);
+}
+BENCHMARK(BM_GainScheduleLookup)
+    ->ArgNames({"n", "uniform", "breakpoints"})
+    ->ArgsProduct({{1 << 14}, {0, 1}, {16, 256}});
+
+/**
+ * @brief TraceWriter::step, including the controller step
+ *
+ * Arguments: trigger (TraceTrigger value). Steps come much faster than
+ * the recorder writes them to disk, so most records of the ALWAYS
+ * trigger are dropped once the ring is full; the "dropped" counter
+ * gives the dropped fraction. The controller has no limits, so the
+ * SATURATION trigger measures the cost of keeping the pre-trigger
+ * history. Compare with BM_PIDController for the recording overhead.
+ */
+static void BM_TraceWriter(benchmark::State& state) {
+    TraceOptions options;
+    options.trigger = static_cast<TraceTrigger>(state.range(0));
+    options.capacity = 1 << 16;
+    std::string path = "bench_trace.pidtraj";
+    TraceRecorder recorder(path, TrajectoryConfig(), options);
+    TraceWriter& writer = recorder.writer();
+
+    Signals s(SIGNAL_LENGTH, 0.0);
+    PIDController controller(1.0, 0.5, 0.1);
+    size_t i = 0;
+    for (auto _ : state) {
+        PIDStepResult result = writer.step(
+            controller, 0, s.r[i], s.y[i], s.uff[i]);
+        benchmark::DoNotOptimize(result);
+        i = (i + 1) % SIGNAL_LENGTH;
+    }
+    state.counters["dropped"] = static_cast<double>(writer.dropped())
+        / static_cast<double>(state.iterations());
+    set_time_per_step(state, static_cast<double>(state.iterations()));
+
+    // Keep the file conversion out of the results
+    recorder.close();
+    std::remove(path.c_str());
+}
+BENCHMARK(BM_TraceWriter)
+    ->ArgName("trigger")
+    ->Arg(static_cast<int64_t>(TraceTrigger::ALWAYS))
+    ->Arg(static_cast<int64_t>(TraceTrigger::SATURATION));
+
+/**
+ * @brief Checkpointing the state of a bank every cycle
+ *
+ * Arguments: n (controllers), mode (0 = full checkpoint, 1 = delta
+ * checkpoint, 2 = decoding the delta checkpoint on the standby). The
+ * encoder reads the bank's state arrays directly. The bank steps
+ * between iterations outside the timed region, so every delta holds
+ * one cycle of changes. The "bytes" counter gives the checkpoint size
+ * and s_per_step the time per controller.
+ */
+static void BM_StateCheckpoint(benchmark::State& state) {
+    size_t n = static_cast<size_t>(state.range(0));
+    int mode = static_cast<int>(state.range(1));
+    Signals s(n, 0.0);
+    std::vector<double> zeros(n, 0.0), u(n);
+    std::unique_ptr<bool[]> track(new bool[n]);
+    std::unique_ptr<bool[]> auto_mode(new bool[n]);
+    std::vector<WindupMode> windup(n, WindupMode::NONE);
+    for (size_t i = 0; i < n; ++i) {
+        track[i] = false;
+        auto_mode[i] = true;
+    }
+
+    PIDBank bank(n, 1.0, 0.5, 0.1, 10.0, -0.5, 0.5);
+    StateEncoder encoder(n);
+    StateDecoder decoder(n);
+    encoder.encode_full(bank);
+    decoder.decode(encoder.data(), encoder.bytes());
+    for (auto _ : state) {
+        state.PauseTiming();
+        bank.step(s.r.data(), s.y.data(), s.uff.data(), zeros.data(),
+                  zeros.data(), s.Tx.data(), track.get(), auto_mode.get(),
+                  windup.data(), u.data());
+        if (mode == 2) {
+            encoder.encode_delta(bank);
+        }
+        state.ResumeTiming();
+
+        if (mode == 0) {
+            encoder.encode_full(bank);
+        } else if (mode == 1) {
+            encoder.encode_delta(bank);
+        } else {
+            decoder.decode(encoder.data(), encoder.bytes());
+        }
+        benchmark::ClobberMemory();
+    }
+    state.counters["bytes"] = static_cast<double>(encoder.bytes());
+    set_time_per_step(
+        state, static_cast<double>(state.iterations()) * n);
+}
+BENCHMARK(BM_StateCheckpoint)
+    ->ArgNames({"n", "mode"})
+    ->ArgsProduct({{100000}, {0, 1, 2}})
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,75 @@
+/**
+ * @file event_report.cpp
+ * @brief Tracking of event-driven controllers in a settling loop
+ *
+ * Records the measurement of a closed-loop FOPDT simulation (setpoint
+ * step, then a load disturbance step) at a few noise levels, replays it
+ * through an EventDrivenController at a few measurement deadbands and
+ * prints the share of ticks that stepped the controller and the error
+ * of the control signal against stepping on every tick (see
+ * event_tracking_report).
+ *
+ * Usage: event_report [ticks (default: 5000)]
+ *                     [max interval (default: 50)]
+ */
+
+#include "../cpp_pid/closed_loop.h"
+#include "../cpp_pid/event_driven.h"
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+const double noise_levels[] = {0.0, 0.002, 0.01};
+const double deadbands[] = {0.0, 0.001, 0.005, 0.02};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 5000;
+    double max_interval = argc > 2 ? std::strtod(argv[2], nullptr) : 50.0;
+    if (n == 0 || !(max_interval > 0.0)) {
+        std::fprintf(stderr,
+                     "Ticks and max interval must be positive\n");
+        return 1;
+    }
+
+    PIDController controller(2.0, 0.1, 5.0, 10.0, -10.0, 10.0);
+    PlantModel plant = PlantModel::fopdt(1.0, 20.0, 5.0);
+
+    std::printf("FOPDT K = 1, T = 20, L = 5; %zu ticks, max interval %g\n\n",
+                n, max_interval);
+    std::printf("%8s %9s %8s %12s %12s %12s\n", "noise", "deadband",
+                "steps", "max abs", "rms", "max rel");
+    for (size_t k = 0; k < sizeof(noise_levels) / sizeof(noise_levels[0]);
+         ++k) {
+        MonteCarloConfig config;
+        config.steps = n;
+        config.noise_std = noise_levels[k];
+        config.disturbance = 0.5;
+        config.disturbance_step = n / 2;
+
+        // Measurement of a loop stepped on every tick
+        std::vector<double> r(n, config.setpoint), y(n);
+        PIDController loop_controller = controller;
+        PlantModel loop_plant = plant;
+        simulate_closed_loop(loop_controller, loop_plant, config, 0,
+                             y.data());
+        InputSeries inputs(n, r.data(), y.data());
+
+        for (size_t j = 0; j < sizeof(deadbands) / sizeof(deadbands[0]);
+             ++j) {
+            EventDeadband deadband(0.0, deadbands[j], 0.0, 0.0,
+                                   max_interval);
+            EventTrackingReport report =
+                event_tracking_report(controller, deadband, inputs);
+            std::printf("%8g %9g %7.1f%% %12.3e %12.3e %12.3e\n",
+                        noise_levels[k], deadbands[j],
+                        100.0 * report.steps / report.ticks,
+                        report.max_error, report.rms_error,
+                        report.max_relative_error);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,128 @@
+/**
+ * @file precision_report.cpp
+ * @brief Accuracy of reduced-precision controllers on the test data
+ *
+ * Runs BasicPID with double, float, Q7_24 and Q16_15 scalars on each
+ * I/O data file in tests/data and prints the error of the control
+ * signal against the recorded double-precision reference.
+ *
+ * Usage: precision_report [data directory (default: tests/data)]
+ */
+
+#include "../cpp_pid/basic_pid.h"
+#include "../cpp_pid/fixed_point.h"
+#include "../cpp_pid/io_data.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <exception>
+#include <string>
+
+namespace {
+
+// Controller configuration of one data file (tests/test_cases.yaml)
+struct Case {
+    const char* file;
+    PIDStructure structure;
+    double kp;
+    double ki;
+    double kd;
+    double umin;
+    double umax;
+};
+
+const Case cases[] = {
+    {"P_step.csv", PIDStructure::P, 1.0, 0.0, 0.0, -10.0, 10.0},
+    {"PI_step.csv", PIDStructure::PI, 1.0, 0.5, 0.0, -10.0, 10.0},
+    {"PID_step.csv", PIDStructure::PID, 1.0, 0.5, 0.1, -10.0, 10.0},
+    {"PID_step_irregular_time.csv", PIDStructure::PID, 1.0, 0.5, 0.1,
+     -10.0, 10.0},
+    {"PID_antiwindup_step.csv", PIDStructure::PID, 2.0, 1.0, 0.2,
+     -3.0, 3.0},
+    {"PI_switch_manual.csv", PIDStructure::PI, 1.0, 0.5, 0.0,
+     -10.0, 10.0},
+    {"PI_switch_track.csv", PIDStructure::PI, 1.0, 0.5, 0.0,
+     -10.0, 10.0}
+};
+
+// Error of a control signal against the reference
+struct Error {
+    double max_abs;
+    double rms;
+    double max_rel;  // Relative to the largest reference magnitude
+};
+
+template <class Controller, class T>
+Error run(Controller& controller, const IOData& data) {
+    double max_abs = 0.0;
+    double sum_sq = 0.0;
+    double scale = 0.0;
+    for (size_t i = 0; i < data.n; ++i) {
+        T u = controller(T(data.r[i]), T(data.y[i]), T(data.uff[i]),
+                         T(data.uman[i]), T(data.utrack[i]), data.Tx[i],
+                         data.track[i], data.auto_mode[i]);
+        double e = std::fabs(static_cast<double>(u) - data.u[i]);
+        max_abs = std::max(max_abs, e);
+        sum_sq += e * e;
+        scale = std::max(scale, std::fabs(data.u[i]));
+    }
+    Error error;
+    error.max_abs = max_abs;
+    error.rms = data.n > 0 ? std::sqrt(sum_sq / data.n) : 0.0;
+    error.max_rel = scale > 0.0 ? max_abs / scale : 0.0;
+    return error;
+}
+
+template <PIDStructure S, class T>
+Error run_case(const Case& c, const IOData& data) {
+    BasicPID<S, true, true, T> controller(c.kp, c.ki, c.kd, 10.0,
+                                          c.umin, c.umax);
+    return run<BasicPID<S, true, true, T>, T>(controller, data);
+}
+
+template <class T>
+Error run_structure(const Case& c, const IOData& data) {
+    switch (c.structure) {
+    case PIDStructure::P:
+        return run_case<PIDStructure::P, T>(c, data);
+    case PIDStructure::PI:
+        return run_case<PIDStructure::PI, T>(c, data);
+    case PIDStructure::PD:
+        return run_case<PIDStructure::PD, T>(c, data);
+    default:
+        return run_case<PIDStructure::PID, T>(c, data);
+    }
+}
+
+void print(const char* file, const char* type, const Error& error) {
+    std::printf("%-28s %-7s %12.3e %12.3e %12.3e\n", file, type,
+                error.max_abs, error.rms, error.max_rel);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string directory = argc > 1 ? argv[1] : "tests/data";
+
+    std::printf("%-28s %-7s %12s %12s %12s\n", "file", "type",
+                "max abs", "rms", "max rel");
+    for (size_t k = 0; k < sizeof(cases) / sizeof(cases[0]); ++k) {
+        const Case& c = cases[k];
+        IOData data;
+        try {
+            data = load_io_data(directory + "/" + c.file);
+        } catch (const std::exception& e) {
+            std::fprintf(stderr, "%s\n", e.what());
+            return 1;
+        }
+        if (!data.has_u) {
+            std::fprintf(stderr, "%s has no u column\n", c.file);
+            return 1;
+        }
+        print(c.file, "double", run_structure<double>(c, data));
+        print(c.file, "float", run_structure<float>(c, data));
+        print(c.file, "Q7_24", run_structure<Q7_24>(c, data));
+        print(c.file, "Q16_15", run_structure<Q16_15>(c, data));
+    }
+    return 0;
+}
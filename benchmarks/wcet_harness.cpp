@@ -0,0 +1,215 @@
+/**
+ * @file wcet_harness.cpp
+ * @brief Worst-case step time of PIDController and RealTimePIDController
+ *
+ * Times single controller steps with a jittery execution period and
+ * random mode, tracking and windup inputs, with warm caches and with
+ * the caches evicted before every step, and prints the minimum,
+ * percentiles and the largest observed step time. The maximum is an
+ * observation, not a bound: it covers the paths taken by these inputs
+ * on this machine only, which is why RealTimePIDController takes the
+ * same path for every input.
+ *
+ * Usage: wcet_harness [steps (default: 20000)]
+ *                     [eviction buffer in MiB (default: 16)]
+ */
+
+#include "../cpp_pid/pid.h"
+#include "../cpp_pid/realtime_pid.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#define WCET_X86 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+namespace {
+
+// Timestamp in ticks, ordered with respect to the code around it
+inline uint64_t ticks() {
+#ifdef WCET_X86
+    _mm_lfence();
+    uint64_t t = __rdtsc();
+    _mm_lfence();
+    return t;
+#else
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+// Nanoseconds per tick, measured against steady_clock over about 50 ms
+double tick_nanoseconds() {
+    typedef std::chrono::steady_clock clock;
+    clock::time_point start = clock::now();
+    uint64_t start_ticks = ticks();
+    while (clock::now() - start < std::chrono::milliseconds(50)) {
+    }
+    uint64_t elapsed_ticks = ticks() - start_ticks;
+    double elapsed = std::chrono::duration<double, std::nano>(
+        clock::now() - start).count();
+    return elapsed_ticks > 0 ? elapsed / elapsed_ticks : 1.0;
+}
+
+// Inputs of one step
+struct Step {
+    double r;
+    double y;
+    double uff;
+    double uman;
+    double utrack;
+    double Tx;
+    bool track;
+    bool auto_mode;
+    WindupMode windup;
+};
+
+std::vector<Step> make_steps(size_t n) {
+    std::mt19937 rng(2024);
+    std::uniform_real_distribution<double> signal(-4.0, 4.0);
+    std::uniform_real_distribution<double> jitter(-0.2, 0.2);
+    std::uniform_int_distribution<int> event(0, 49);
+    std::vector<Step> steps(n);
+    for (size_t i = 0; i < n; ++i) {
+        Step& s = steps[i];
+        s.r = signal(rng);
+        s.y = signal(rng);
+        s.uff = signal(rng);
+        s.uman = signal(rng);
+        s.utrack = signal(rng);
+        s.Tx = 1.0 + jitter(rng);
+        s.track = event(rng) == 0;
+        s.auto_mode = event(rng) != 0;
+        s.windup = static_cast<WindupMode>(event(rng) % 4);
+    }
+    return steps;
+}
+
+// Evicts the caches by reading a buffer larger than the last-level
+// cache, and on x86 also flushes the controller to memory
+class Evictor {
+public:
+    explicit Evictor(size_t bytes) : buffer_(bytes / sizeof(uint64_t), 1) {}
+
+    void evict(const void* object, size_t size) {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < buffer_.size(); i += 64 / sizeof(uint64_t)) {
+            sum += buffer_[i];
+        }
+        buffer_[0] = sum;
+#ifdef WCET_X86
+        const char* p = static_cast<const char*>(object);
+        for (size_t offset = 0; offset < size; offset += 64) {
+            _mm_clflush(p + offset);
+        }
+        _mm_mfence();
+#else
+        (void)object;
+        (void)size;
+#endif
+    }
+
+private:
+    std::vector<uint64_t> buffer_;
+};
+
+// Step times in nanoseconds, sorted
+template <class Controller>
+std::vector<double> measure(
+    Controller& controller,
+    const std::vector<Step>& steps,
+    Evictor* evictor,
+    double ns_per_tick,
+    uint64_t overhead) {
+    std::vector<double> times(steps.size());
+    volatile double sink = 0.0;
+    for (size_t i = 0; i < steps.size(); ++i) {
+        const Step& s = steps[i];
+        if (evictor) {
+            evictor->evict(&controller, sizeof(controller));
+        }
+        uint64_t start = ticks();
+        double u = controller(s.r, s.y, s.uff, s.uman, s.utrack, s.Tx,
+                              s.track, s.auto_mode, s.windup);
+        uint64_t elapsed = ticks() - start;
+        sink = u;
+        elapsed = elapsed > overhead ? elapsed - overhead : 0;
+        times[i] = elapsed * ns_per_tick;
+    }
+    (void)sink;
+    std::sort(times.begin(), times.end());
+    return times;
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+    size_t k = static_cast<size_t>(p / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(k, sorted.size() - 1)];
+}
+
+void print(const char* name, const char* caches,
+           const std::vector<double>& t) {
+    std::printf("%-24s %-5s %8.1f %8.1f %8.1f %8.1f %8.1f %9.1f\n",
+                name, caches, t.front(), percentile(t, 50.0),
+                percentile(t, 99.0), percentile(t, 99.9),
+                percentile(t, 99.99), t.back());
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+    size_t mib = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 16;
+    if (n == 0) {
+        std::fprintf(stderr, "Number of steps must be positive\n");
+        return 1;
+    }
+
+    std::vector<Step> steps = make_steps(n);
+    Evictor evictor(mib << 20);
+    double ns_per_tick = tick_nanoseconds();
+
+    // Cost of an empty measurement, subtracted from every step
+    uint64_t overhead = UINT64_MAX;
+    for (int k = 0; k < 1000; ++k) {
+        uint64_t start = ticks();
+        overhead = std::min(overhead, ticks() - start);
+    }
+
+    // Periods within +-0.2 of nominal, interpolated at a spacing of
+    // 1/256
+    ZohTable table(10.0, 0.75, 1.25, 128);
+
+    std::printf("%zu steps, eviction buffer %zu MiB, times in ns\n", n, mib);
+    std::printf("ZohTable interpolation error %.2e\n\n", table.max_error());
+    std::printf("%-24s %-5s %8s %8s %8s %8s %8s %9s\n", "controller",
+                "cache", "min", "p50", "p99", "p99.9", "p99.99", "max");
+    for (int cold = 0; cold < 2; ++cold) {
+        const char* caches = cold ? "cold" : "warm";
+        Evictor* e = cold ? &evictor : nullptr;
+
+        PIDController exact(1.0, 0.5, 0.1, 10.0, -3.0, 3.0);
+        print("PIDController", caches,
+              measure(exact, steps, e, ns_per_tick, overhead));
+
+        PIDController polynomial(1.0, 0.5, 0.1, 10.0, -3.0, 3.0);
+        polynomial.filter().set_method(ZohMethod::POLYNOMIAL);
+        print("PIDController (poly)", caches,
+              measure(polynomial, steps, e, ns_per_tick, overhead));
+
+        RealTimePIDController realtime(1.0, 0.5, 0.1, table, -3.0, 3.0);
+        print("RealTimePIDController", caches,
+              measure(realtime, steps, e, ns_per_tick, overhead));
+    }
+    return 0;
+}
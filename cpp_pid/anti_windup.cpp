@@ -4,8 +4,39 @@
  */
 
 #include "anti_windup.h"
+#include "pid_bank_kernels.h"
 #include <algorithm>
 
+namespace {
+
+WindupKernelFunction best_windup_kernel() {
+    if (pid_bank_cpu_has_avx512() && pid_windup_kernel_avx512) {
+        return pid_windup_kernel_avx512;
+    }
+    if (pid_bank_cpu_has_avx2() && pid_windup_kernel_avx2) {
+        return pid_windup_kernel_avx2;
+    }
+    if (pid_windup_kernel_simd128) {
+        return pid_windup_kernel_simd128;
+    }
+    return pid_windup_kernel_scalar;
+}
+
+SaturationKernelFunction best_saturation_kernel() {
+    if (pid_bank_cpu_has_avx512() && pid_saturation_kernel_avx512) {
+        return pid_saturation_kernel_avx512;
+    }
+    if (pid_bank_cpu_has_avx2() && pid_saturation_kernel_avx2) {
+        return pid_saturation_kernel_avx2;
+    }
+    if (pid_saturation_kernel_simd128) {
+        return pid_saturation_kernel_simd128;
+    }
+    return pid_saturation_kernel_scalar;
+}
+
+} // namespace
+
 double anti_windup(double Dui, WindupMode windup) {
     // Prevent increase, decrease, or both
     if (windup == WindupMode::BOTH || windup == WindupMode::LOWER) {
@@ -18,3 +49,18 @@ double anti_windup(double Dui, WindupMode windup) {
 
     return Dui;
 }
+
+void anti_windup(double* Dui, const unsigned char* windup, size_t n) {
+    static const WindupKernelFunction kernel = best_windup_kernel();
+    kernel(Dui, windup, 0, n);
+}
+
+void saturate_with_flags(
+    double* u,
+    const double* umin,
+    const double* umax,
+    unsigned char* saturation,
+    size_t n) {
+    static const SaturationKernelFunction kernel = best_saturation_kernel();
+    kernel(u, umin, umax, saturation, 0, n);
+}
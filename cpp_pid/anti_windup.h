@@ -9,6 +9,9 @@
 #ifndef ANTI_WINDUP_H
 #define ANTI_WINDUP_H
 
+#include "host_device.h"
+#include <cstddef>
+
 /**
  * @brief Windup mode enumeration
  */
@@ -19,6 +22,33 @@ enum class WindupMode {
     BOTH
 };
 
+/**
+ * @brief Saturation flag for a control signal at its upper limit
+ *
+ * The saturation flags are the bits of the WindupMode that blocks
+ * integration in the saturated direction: SATURATED_HIGH is UPPER,
+ * SATURATED_LOW is LOWER and both together are BOTH.
+ */
+const unsigned char SATURATED_HIGH = 1;
+
+/**
+ * @brief Saturation flag for a control signal at its lower limit
+ */
+const unsigned char SATURATED_LOW = 2;
+
+/**
+ * @brief Combine a windup status with saturation flags
+ *
+ * @param windup Windup status
+ * @param saturation SATURATED_HIGH and SATURATED_LOW bits
+ * @return Windup status blocking the directions of both arguments
+ */
+PID_HOST_DEVICE inline WindupMode combine_windup(WindupMode windup,
+                                 unsigned char saturation) {
+    return static_cast<WindupMode>(
+        (static_cast<unsigned char>(windup) | saturation) & 3);
+}
+
 /**
  * @brief Apply anti-windup logic to the integral increment
  *
@@ -33,6 +63,30 @@ enum class WindupMode {
  */
 double anti_windup(double Dui, WindupMode windup);
 
+/**
+ * @brief Apply anti-windup logic to an integral increment of another
+ *        scalar type
+ *
+ * Same as anti_windup(double, WindupMode) for types such as float or
+ * FixedPoint. Called as anti_windup<double> it gives the same result
+ * as the non-template overload, and also compiles as device code.
+ *
+ * @tparam T Scalar type, constructible from double and ordered
+ */
+template <class T>
+PID_HOST_DEVICE inline T anti_windup(T Dui, WindupMode windup) {
+    const T zero(0.0);
+    if ((windup == WindupMode::BOTH || windup == WindupMode::LOWER) &&
+        Dui < zero) {
+        Dui = zero;
+    }
+    if ((windup == WindupMode::BOTH || windup == WindupMode::UPPER) &&
+        zero < Dui) {
+        Dui = zero;
+    }
+    return Dui;
+}
+
 /**
  * @brief Convenience function for no windup
  */
@@ -40,4 +94,60 @@ inline double anti_windup(double Dui) {
     return anti_windup(Dui, WindupMode::NONE);
 }
 
+/**
+ * @brief Apply anti-windup logic to an array of integral increments
+ *
+ * Same result as anti_windup(double, WindupMode) for every element,
+ * computed without branches by the widest SIMD kernel the CPU supports
+ * (see PIDBank). The windup bits are the WindupMode values, which are
+ * also the saturation flags: SATURATED_HIGH blocks increases and
+ * SATURATED_LOW decreases.
+ *
+ * @param Dui Integral increments, modified in place
+ * @param windup Windup bits of each increment (0 to 3)
+ * @param n Number of elements
+ */
+void anti_windup(double* Dui, const unsigned char* windup, size_t n);
+
+/**
+ * @brief Clamp a control signal to its limits and flag saturation
+ *
+ * The clamp and flags of one controller step, shared by the scalar
+ * controllers and the bank kernels.
+ *
+ * @param u Control signal
+ * @param umin Minimum control signal
+ * @param umax Maximum control signal
+ * @param saturation Output SATURATED_HIGH and SATURATED_LOW bits
+ * @return Clamped control signal
+ */
+template <class T>
+PID_HOST_DEVICE inline T saturate_with_flags(T u, T umin, T umax,
+                                             unsigned char& saturation) {
+    u = umax < u ? umax : u;
+    u = u < umin ? umin : u;
+    saturation = static_cast<unsigned char>(
+        (u >= umax ? SATURATED_HIGH : 0) | (u <= umin ? SATURATED_LOW : 0));
+    return u;
+}
+
+/**
+ * @brief Clamp an array of control signals and flag saturation
+ *
+ * Same result as saturate_with_flags() for every element, computed
+ * without branches by the widest SIMD kernel the CPU supports.
+ *
+ * @param u Control signals, clamped in place
+ * @param umin Minimum control signals
+ * @param umax Maximum control signals
+ * @param saturation Output SATURATED_HIGH and SATURATED_LOW bits
+ * @param n Number of elements
+ */
+void saturate_with_flags(
+    double* u,
+    const double* umin,
+    const double* umax,
+    unsigned char* saturation,
+    size_t n);
+
 #endif // ANTI_WINDUP_H
@@ -0,0 +1,74 @@
+/**
+ * @file async_runner.cpp
+ * @brief Implementation of the asynchronous controller runner
+ */
+
+#include "async_runner.h"
+#include <algorithm>
+#include <chrono>
+
+AsyncPIDRunner::AsyncPIDRunner(
+    PIDController& controller, double Ts, size_t capacity)
+    : controller_(controller),
+      Ts_(Ts),
+      r_(0.0),
+      measurements_(capacity),
+      outputs_(capacity),
+      t_last_(0.0),
+      started_(false),
+      dropped_measurements_(0),
+      dropped_outputs_(0),
+      rejected_(0) {}
+
+bool AsyncPIDRunner::push_measurement(double y, double t) {
+    TimedMeasurement sample = {t, y};
+    if (!measurements_.push(sample)) {
+        dropped_measurements_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+size_t AsyncPIDRunner::poll(double now) {
+    size_t processed = 0;
+    TimedMeasurement sample;
+    while (processed < measurements_.capacity() &&
+           measurements_.pop(sample)) {
+        ++processed;
+
+        // Execution period from the timestamps
+        double Tx = 1.0;
+        if (started_) {
+            if (!(sample.t > t_last_)) {
+                ++rejected_;
+                continue;
+            }
+            Tx = (sample.t - t_last_) / Ts_;
+        }
+        t_last_ = sample.t;
+        started_ = true;
+
+        TimedControl output = {sample.t, controller_(r_, sample.y, 0.0,
+                                                     0.0, 0.0, Tx)};
+        if (!outputs_.push(output)) {
+            ++dropped_outputs_;
+            continue;
+        }
+
+        double latency = now - sample.t;
+        latency_.count++;
+        latency_.min = std::min(latency_.min, latency);
+        latency_.max = std::max(latency_.max, latency);
+        latency_.sum += latency;
+    }
+    return processed;
+}
+
+bool AsyncPIDRunner::pop_output(TimedControl& output) {
+    return outputs_.pop(output);
+}
+
+double AsyncPIDRunner::clock() {
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
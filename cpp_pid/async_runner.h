@@ -0,0 +1,171 @@
+/**
+ * @file async_runner.h
+ * @brief Controller runner fed by an asynchronous measurement thread
+ *
+ * This file connects a PIDController to a producer thread (for example
+ * a fieldbus I/O thread) through lock-free rings: timestamped
+ * measurements come in through one ring, and control signals go out
+ * through another. The execution period of each step comes from the
+ * measurement timestamps, using the adaptive timing of the
+ * measurement filter. It requires std::atomic and std::chrono and is
+ * meant for hosted platforms.
+ */
+
+#ifndef ASYNC_RUNNER_H
+#define ASYNC_RUNNER_H
+
+#include "pid.h"
+#include "spsc_ring.h"
+#include <atomic>
+#include <cstddef>
+#include <limits>
+
+/**
+ * @brief Measurement with the time it was taken
+ */
+struct TimedMeasurement {
+    double t;  ///< Timestamp in seconds
+    double y;  ///< Process measurement
+};
+
+/**
+ * @brief Control signal computed from a timestamped measurement
+ */
+struct TimedControl {
+    double t;  ///< Timestamp of the measurement
+    double u;  ///< Control signal
+};
+
+/**
+ * @brief Summary of the delay from measurement to control signal
+ */
+struct LatencyStats {
+    size_t count;  ///< Number of control signals published
+    double min;    ///< Smallest latency in seconds
+    double max;    ///< Largest latency in seconds
+    double sum;    ///< Sum of latencies in seconds
+
+    LatencyStats()
+        : count(0),
+          min(std::numeric_limits<double>::infinity()),
+          max(0.0),
+          sum(0.0) {}
+
+    /**
+     * @brief Mean latency in seconds (zero before the first sample)
+     */
+    double mean() const { return count > 0 ? sum / count : 0.0; }
+};
+
+/**
+ * @brief Runs a controller on measurements from another thread
+ *
+ * A producer thread calls push_measurement() for each new sample and
+ * the control thread calls poll(), which steps the controller once per
+ * queued sample and publishes the control signals for pop_output().
+ * The execution period of a step is the time since the previous sample
+ * divided by the nominal sample time Ts, so jitter and missed samples
+ * are handled by the controller's rediscretization. The first sample
+ * uses Tx = 1. Samples whose timestamp does not increase are rejected.
+ *
+ * Each of push_measurement(), poll() and pop_output() may be called
+ * from one thread at a time, which may differ. All other members are
+ * for the thread calling poll(). No call allocates memory or takes a
+ * lock.
+ */
+class AsyncPIDRunner {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param controller Controller to run (not owned, must outlive the
+     *                   runner and only be used through it)
+     * @param Ts Nominal sample time in seconds
+     * @param capacity Minimum capacity of each ring (default: 1024)
+     */
+    AsyncPIDRunner(PIDController& controller, double Ts,
+                   size_t capacity = 1024);
+
+    /**
+     * @brief Queue a measurement (producer thread)
+     *
+     * @param y Process measurement
+     * @param t Timestamp in seconds, on the same clock as poll()
+     * @return false if the ring is full and the sample was dropped
+     */
+    bool push_measurement(double y, double t);
+
+    /**
+     * @brief Run the controller on the queued measurements
+     *
+     * Processes at most one ring capacity of measurements per call, so
+     * the work per call stays bounded while the producer keeps pushing.
+     *
+     * @param now Current time in seconds, used for the latency
+     *            statistics
+     * @return Number of measurements processed, including rejected ones
+     */
+    size_t poll(double now);
+
+    /**
+     * @brief Take the oldest published control signal
+     *
+     * @param output Set to the control signal
+     * @return false if no control signal is available
+     */
+    bool pop_output(TimedControl& output);
+
+    /**
+     * @brief Set the setpoint used from the next step on
+     */
+    void set_setpoint(double r) { r_ = r; }
+
+    /**
+     * @brief Delay from measurement timestamp to publication
+     */
+    const LatencyStats& latency() const { return latency_; }
+
+    /**
+     * @brief Number of measurements dropped because the input ring was
+     *        full
+     */
+    size_t dropped_measurements() const {
+        return dropped_measurements_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Number of control signals dropped because the output ring
+     *        was full
+     */
+    size_t dropped_outputs() const { return dropped_outputs_; }
+
+    /**
+     * @brief Number of measurements rejected for a timestamp that did
+     *        not increase
+     */
+    size_t rejected_measurements() const { return rejected_; }
+
+    /**
+     * @brief Seconds on a monotonic clock, for timestamps and poll()
+     */
+    static double clock();
+
+private:
+    PIDController& controller_;
+    double Ts_;
+    double r_;
+
+    SpscRing<TimedMeasurement> measurements_;
+    SpscRing<TimedControl> outputs_;
+
+    // Timestamp of the previous accepted measurement
+    double t_last_;
+    bool started_;
+
+    LatencyStats latency_;
+    std::atomic<size_t> dropped_measurements_;
+    size_t dropped_outputs_;
+    size_t rejected_;
+};
+
+#endif // ASYNC_RUNNER_H
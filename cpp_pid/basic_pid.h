@@ -0,0 +1,450 @@
+/**
+ * @file basic_pid.h
+ * @brief Compile-time specialized PID controller
+ *
+ * This file provides the PID control signal update as a template on
+ * the controller structure (P, PI, PD or PID) and on whether
+ * feedforward and saturation limits are used, so that unused terms are
+ * removed at compile time. PIDController is the runtime-configured
+ * facade built on the same update.
+ */
+
+#ifndef BASIC_PID_H
+#define BASIC_PID_H
+
+#include "anti_windup.h"
+#include "measurement_filter.h"
+#include <algorithm>
+#include <limits>
+
+/**
+ * @brief Controller structure
+ */
+enum class PIDStructure {
+    P,
+    PI,
+    PD,
+    PID
+};
+
+/**
+ * @brief PID controller parameters
+ *
+ * @tparam T Scalar type
+ */
+template <class T>
+struct BasicPIDParams {
+    T kp;    ///< Proportional gain
+    T ki;    ///< Integral gain
+    T kd;    ///< Derivative gain
+    T umin;  ///< Minimum control signal
+    T umax;  ///< Maximum control signal
+    T u0;    ///< Bias term for P or PD control
+    T b;     ///< Setpoint weight for proportional term
+};
+
+/**
+ * @brief PID controller parameters in double precision
+ */
+typedef BasicPIDParams<double> PIDParams;
+
+/**
+ * @brief PID controller signal states
+ *
+ * @tparam T Scalar type
+ */
+template <class T>
+struct BasicPIDState {
+    T u_old;    ///< Previous control signal
+    T up_old;   ///< Previous proportional term
+    T ud_old;   ///< Previous derivative term
+    T uff_old;  ///< Previous feedforward signal
+};
+
+/**
+ * @brief PID controller signal states in double precision
+ */
+typedef BasicPIDState<double> PIDState;
+
+/**
+ * @brief Result of a PID control signal update
+ *
+ * The increments are those added to the previous control signal in
+ * automatic mode, before saturation, and are zero in manual mode or
+ * for terms not in the controller structure.
+ *
+ * @tparam T Scalar type
+ */
+template <class T>
+struct BasicPIDStepResult {
+    T u;                       ///< Control signal
+    T Dup;                     ///< Proportional increment
+    T Dui;                     ///< Integral increment after anti-windup
+    T Dud;                     ///< Derivative increment
+    T Duff;                    ///< Feedforward increment
+    unsigned char saturation;  ///< SATURATED_HIGH / SATURATED_LOW bits
+
+    /**
+     * @brief Windup status blocking the saturated directions
+     */
+    WindupMode windup() const { return combine_windup(WindupMode::NONE,
+                                                       saturation); }
+};
+
+/**
+ * @brief Result of a PID control signal update in double precision
+ */
+typedef BasicPIDStepResult<double> PIDStepResult;
+
+/**
+ * @brief PID control signal update with increments and saturation
+ *
+ * Implements the incremental PID algorithm for a filtered measurement.
+ * Terms that are not part of the structure are not computed: P and PD
+ * controllers have no integral term and always reset their state to
+ * the bias u0 in automatic mode, and P and PI controllers have no
+ * derivative term. Without feedforward, uff is ignored; without
+ * limits, windup is ignored, the control signal is not saturated and
+ * the saturation flags are zero. With limits, a control signal at umax
+ * sets SATURATED_HIGH and one at umin sets SATURATED_LOW.
+ *
+ * The scalar type T is deduced from the parameters and states; all
+ * arithmetic is done in T.
+ *
+ * This is the one scalar update behind PIDController, the fixed
+ * structure controllers below and the GPU sweep lanes (sweep_lane.h),
+ * so it also compiles as CUDA device code.
+ *
+ * @tparam S Controller structure
+ * @tparam HasFeedforward Whether the feedforward signal is used
+ * @tparam HasLimits Whether saturation limits and anti-windup are used
+ * @param params Controller parameters (b is set to 1 for P and PD)
+ * @param state Signal states, updated in place
+ * @param r Reference (setpoint) signal
+ * @param yf Filtered measurement
+ * @param dyf Filtered derivative of measurement
+ * @param uff Feedforward control signal
+ * @param uman Manual mode control signal
+ * @param utrack Tracking signal for bumpless transfer
+ * @param Tx Execution period normalized
+ * @param track Tracking mode flag
+ * @param auto_mode Automatic mode flag
+ * @param windup Windup status
+ * @return Control signal, increments and saturation flags
+ */
+template <PIDStructure S, bool HasFeedforward = true, bool HasLimits = true,
+          class T>
+PID_HOST_DEVICE inline BasicPIDStepResult<T> pid_step(
+    BasicPIDParams<T>& params,
+    BasicPIDState<T>& state,
+    T r,
+    T yf,
+    T dyf,
+    T uff,
+    T uman,
+    T utrack,
+    T Tx,
+    bool track,
+    bool auto_mode,
+    WindupMode windup) {
+    const bool has_integral =
+        S == PIDStructure::PI || S == PIDStructure::PID;
+    const bool has_derivative =
+        S == PIDStructure::PD || S == PIDStructure::PID;
+
+    const T zero(0.0);
+    BasicPIDStepResult<T> result;
+    result.Dup = zero;
+    result.Dui = zero;
+    result.Dud = zero;
+    result.Duff = zero;
+    result.saturation = 0;
+    T u;
+
+    if (auto_mode) {
+        // Reset state if using P or PD control
+        if (!has_integral) {
+            state.u_old = params.u0;  // Bias term if P or PD control
+            state.up_old = zero;
+            state.ud_old = zero;
+            state.uff_old = zero;
+            params.b = T(1.0);
+        }
+
+        // Tracking mode for bumpless transfer
+        if (track) {
+            state.u_old = utrack;
+            state.up_old = zero;
+            state.ud_old = zero;
+            state.uff_old = zero;
+        }
+
+        // Control signal increments, added in the order P, I, D, FF
+        result.Dup = params.kp * (params.b * r - yf) - state.up_old;
+        T Du = result.Dup;
+        if (has_integral) {
+            T Dui = params.ki * (r - yf) * Tx;
+            if (HasLimits) {
+                Dui = anti_windup<T>(Dui, windup);
+            }
+            result.Dui = Dui;
+            Du += Dui;
+        }
+        if (has_derivative) {
+            result.Dud = (-params.kd * dyf - state.ud_old) / Tx;
+            Du += result.Dud;
+        }
+        if (HasFeedforward) {
+            result.Duff = uff - state.uff_old;
+            Du += result.Duff;
+        }
+
+        // Add control signal increment
+        u = state.u_old + Du;
+    } else {
+        // Manual control signal
+        u = uman;
+    }
+
+    // Saturate control signal
+    if (HasLimits) {
+        u = saturate_with_flags(
+            u, params.umin, params.umax, result.saturation);
+    }
+
+    // Update old signal states
+    state.u_old = u;
+    state.up_old = params.kp * (params.b * r - yf);
+    if (has_derivative) {
+        state.ud_old = -params.kd * dyf;
+    }
+    if (HasFeedforward) {
+        state.uff_old = uff;
+    }
+
+    result.u = u;
+    return result;
+}
+
+/**
+ * @brief PID control signal update
+ *
+ * Same as pid_step, returning only the control signal.
+ *
+ * @return Control signal u
+ */
+template <PIDStructure S, bool HasFeedforward = true, bool HasLimits = true,
+          class T>
+PID_HOST_DEVICE inline T pid_update(
+    BasicPIDParams<T>& params,
+    BasicPIDState<T>& state,
+    T r,
+    T yf,
+    T dyf,
+    T uff,
+    T uman,
+    T utrack,
+    T Tx,
+    bool track,
+    bool auto_mode,
+    WindupMode windup) {
+    return pid_step<S, HasFeedforward, HasLimits>(
+        params, state, r, yf, dyf, uff, uman, utrack, Tx, track,
+        auto_mode, windup).u;
+}
+
+/**
+ * @brief Change the gains of a controller without a bump
+ *
+ * The stored proportional and derivative terms are rescaled to the new
+ * gains, so the next increments contain only the change of the error
+ * and of the filtered derivative, not the change of the gains. The
+ * integral term needs no adjustment in the incremental form. If the
+ * old kp is zero the stored proportional term is zero, and the new
+ * proportional term enters the next step like a setpoint step.
+ *
+ * Unchanged gains leave the state bit for bit as it was.
+ *
+ * @param params Controller parameters, updated in place
+ * @param state Signal states, updated in place
+ * @param kp New proportional gain
+ * @param ki New integral gain
+ * @param kd New derivative gain
+ * @param dyf Filtered derivative of the last step
+ */
+template <class T>
+PID_HOST_DEVICE inline void pid_set_gains(
+    BasicPIDParams<T>& params,
+    BasicPIDState<T>& state,
+    T kp,
+    T ki,
+    T kd,
+    T dyf) {
+    const T zero(0.0);
+    if (kp != params.kp) {
+        state.up_old = params.kp != zero
+            ? state.up_old / params.kp * kp : zero;
+        params.kp = kp;
+    }
+    if (kd != params.kd) {
+        state.ud_old = -kd * dyf;
+        params.kd = kd;
+    }
+    params.ki = ki;
+}
+
+/**
+ * @brief PID controller specialized at compile time
+ *
+ * Same algorithm and interface as PIDController, with the structure,
+ * feedforward and limits fixed by template parameters. For example,
+ * BasicPID<PIDStructure::PI, false, false> is a PI controller without
+ * feedforward or saturation, which skips the derivative, feedforward
+ * and anti-windup computations and the ki == 0 check. The measurement
+ * filter always runs because the filtered measurement feeds the P and
+ * I terms.
+ *
+ * The scalar type T sets the precision of the signals, gains, states
+ * and filter, for example BasicPID<PIDStructure::PI, true, true, float>
+ * for targets with a single-precision FPU, or a FixedPoint type for
+ * targets without one. Gains are given as double and rounded to T. For
+ * types other than double, the filter is a BasicMeasurementFilter. Tx
+ * stays double because it only drives the filter rediscretization and
+ * the I and D scaling; a fixed execution period never rediscretizes.
+ *
+ * @tparam S Controller structure
+ * @tparam HasFeedforward Whether the feedforward signal is used
+ * @tparam HasLimits Whether saturation limits and anti-windup are used
+ * @tparam T Scalar type (default: double)
+ */
+template <PIDStructure S, bool HasFeedforward = true, bool HasLimits = true,
+          class T = double>
+class BasicPID {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param kp Proportional gain
+     * @param ki Integral gain (unused for P and PD)
+     * @param kd Derivative gain (unused for P and PI)
+     * @param TfTs Filter time constant as multiple of nominal sample
+     *             time (default: 10.0)
+     * @param umin Minimum control signal (default: -infinity)
+     * @param umax Maximum control signal (default: +infinity)
+     * @param u0 Bias term for P or PD control (default: 0.0)
+     * @param b Setpoint weight for proportional term (default: 1.0)
+     */
+    BasicPID(
+        double kp,
+        double ki,
+        double kd,
+        double TfTs = 10.0,
+        double umin = -std::numeric_limits<double>::infinity(),
+        double umax = std::numeric_limits<double>::infinity(),
+        double u0 = 0.0,
+        double b = 1.0)
+        : filter_(TfTs),
+          saturation_(0),
+          auto_windup_(false) {
+        params_.kp = T(kp);
+        params_.ki = T(ki);
+        params_.kd = T(kd);
+        params_.umin = T(umin);
+        params_.umax = T(umax);
+        params_.u0 = T(u0);
+        params_.b = T(b);
+        reset();
+    }
+
+    /**
+     * @brief Compute the PID control signal
+     *
+     * Arguments as for PIDController::operator(). uff is ignored
+     * without feedforward and windup is ignored without limits.
+     */
+    T operator()(
+        T r,
+        T y,
+        T uff = T(0.0),
+        T uman = T(0.0),
+        T utrack = T(0.0),
+        double Tx = 1.0,
+        bool track = false,
+        bool auto_mode = true,
+        WindupMode windup = WindupMode::NONE) {
+        return step(r, y, uff, uman, utrack, Tx, track, auto_mode,
+                    windup).u;
+    }
+
+    /**
+     * @brief Compute the PID control signal with increments and
+     *        saturation flags
+     *
+     * Arguments as for PIDController::step().
+     */
+    BasicPIDStepResult<T> step(
+        T r,
+        T y,
+        T uff = T(0.0),
+        T uman = T(0.0),
+        T utrack = T(0.0),
+        double Tx = 1.0,
+        bool track = false,
+        bool auto_mode = true,
+        WindupMode windup = WindupMode::NONE) {
+        BasicFilterOutput<T> filtered = filter_(y, Tx);
+        if (auto_windup_) {
+            windup = combine_windup(windup, saturation_);
+        }
+        BasicPIDStepResult<T> result = pid_step<S, HasFeedforward, HasLimits>(
+            params_, state_, r, filtered.yf, filtered.dyf, uff, uman,
+            utrack, T(Tx), track, auto_mode, windup);
+        saturation_ = result.saturation;
+        return result;
+    }
+
+    /**
+     * @brief Feed the saturation of each step into the next one
+     *
+     * Works like PIDController::set_auto_windup(). Has no effect
+     * without limits.
+     */
+    void set_auto_windup(bool enabled) { auto_windup_ = enabled; }
+
+    /**
+     * @brief Saturation flags of the last step (zero after reset)
+     */
+    unsigned char saturation() const { return saturation_; }
+
+    /**
+     * @brief Reset the controller state to zero
+     */
+    void reset() {
+        state_.u_old = T(0.0);
+        state_.up_old = T(0.0);
+        state_.ud_old = T(0.0);
+        state_.uff_old = T(0.0);
+        saturation_ = 0;
+        filter_.reset();
+    }
+
+    /**
+     * @brief Measurement filter type
+     */
+    typedef typename MeasurementFilterFor<T>::type Filter;
+
+    /**
+     * @brief Access the measurement filter
+     */
+    Filter& filter() { return filter_; }
+    const Filter& filter() const { return filter_; }
+
+private:
+    BasicPIDParams<T> params_;
+    BasicPIDState<T> state_;
+    Filter filter_;
+    unsigned char saturation_;
+    bool auto_windup_;
+};
+
+#endif // BASIC_PID_H
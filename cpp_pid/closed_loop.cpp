@@ -0,0 +1,83 @@
+/**
+ * @file closed_loop.cpp
+ * @brief Implementation of closed-loop simulation and Monte Carlo runs
+ */
+
+#include "closed_loop.h"
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <random>
+
+ClosedLoopResult simulate_closed_loop(
+    PIDController& controller,
+    PlantModel& plant,
+    const MonteCarloConfig& config,
+    size_t scenario,
+    double* y_out,
+    double* u_out) {
+    // Independent random stream for each scenario
+    std::seed_seq seq{
+        static_cast<uint32_t>(config.seed),
+        static_cast<uint32_t>(config.seed >> 32),
+        static_cast<uint32_t>(scenario),
+        static_cast<uint32_t>(static_cast<uint64_t>(scenario) >> 32)};
+    std::mt19937_64 rng(seq);
+    std::uniform_real_distribution<double> amplitude(
+        -config.disturbance, config.disturbance);
+    std::normal_distribution<double> noise(0.0, 1.0);
+
+    ClosedLoopResult result;
+    result.scenario = scenario;
+    result.disturbance = config.disturbance > 0.0 ? amplitude(rng) : 0.0;
+    result.iae = 0.0;
+    result.ise = 0.0;
+    result.max_abs_error = 0.0;
+    result.saturation_time = 0.0;
+
+    const double Ts = plant.Ts();
+    for (size_t k = 0; k < config.steps; ++k) {
+        double y = plant.output();
+        double e = config.setpoint - y;
+        result.iae += std::abs(e) * Ts;
+        result.ise += e * e * Ts;
+        result.max_abs_error = std::max(result.max_abs_error, std::abs(e));
+
+        // Measure, control and apply the input with the load
+        double y_meas = y + config.noise_std * noise(rng);
+        double u = controller(config.setpoint, y_meas);
+        if (u <= controller.params().umin
+                || u >= controller.params().umax) {
+            result.saturation_time += Ts;
+        }
+        double d = k >= config.disturbance_step ? result.disturbance : 0.0;
+        plant(u + d);
+
+        if (y_out) {
+            y_out[k] = y_meas;
+        }
+        if (u_out) {
+            u_out[k] = u;
+        }
+    }
+    return result;
+}
+
+void monte_carlo(
+    const PIDController& controller,
+    const PlantModel& plant,
+    const MonteCarloConfig& config,
+    const ClosedLoopCallback& callback,
+    ThreadPool& pool) {
+    std::mutex callback_mutex;
+
+    pool.parallel_for(config.scenarios, [&](size_t scenario, size_t) {
+        PIDController scenario_controller(controller);
+        PlantModel scenario_plant(plant);
+        ClosedLoopResult result = simulate_closed_loop(
+            scenario_controller, scenario_plant, config, scenario);
+
+        std::lock_guard<std::mutex> lock(callback_mutex);
+        callback(result);
+    });
+}
@@ -0,0 +1,201 @@
+/**
+ * @file control_graph.cpp
+ * @brief Implementation of the control graph
+ */
+
+#include "control_graph.h"
+#include <stdexcept>
+
+namespace {
+
+// Saturation directions seen through a connection with negative gain
+unsigned char swap_directions(unsigned char bits) {
+    return static_cast<unsigned char>(
+        ((bits & SATURATED_HIGH) << 1) | ((bits & SATURATED_LOW) >> 1));
+}
+
+} // namespace
+
+ControlGraph::ControlGraph()
+    : compiled_(false),
+      parallel_threshold_(64),
+      level_start_(0) {
+    level_begin_.push_back(0);
+    level_task_ = [this](size_t index, size_t) {
+        step_node(order_[level_start_ + index]);
+    };
+}
+
+size_t ControlGraph::add(const PIDController& controller) {
+    controllers_.push_back(controller);
+    inputs_.push_back(ControlInputs());
+    compiled_ = false;
+    return controllers_.size() - 1;
+}
+
+void ControlGraph::connect(size_t from, size_t to, ControlPort port,
+                           double gain, double offset) {
+    add_connection(from, to, port, gain, offset, false);
+}
+
+void ControlGraph::connect_previous(size_t from, size_t to,
+                                    ControlPort port, double gain,
+                                    double offset) {
+    add_connection(from, to, port, gain, offset, true);
+}
+
+void ControlGraph::add_connection(size_t from, size_t to, ControlPort port,
+                                  double gain, double offset,
+                                  bool previous) {
+    if (from >= size() || to >= size()) {
+        throw std::invalid_argument("Control graph node out of range");
+    }
+    Connection connection = {from, to, port, gain, offset, previous};
+    connections_.push_back(connection);
+    compiled_ = false;
+}
+
+void ControlGraph::compile() {
+    size_t n = size();
+
+    // Group connections by target and cascade connections by source
+    incoming_begin_.assign(n + 1, 0);
+    cascades_begin_.assign(n + 1, 0);
+    for (size_t c = 0; c < connections_.size(); ++c) {
+        const Connection& connection = connections_[c];
+        incoming_begin_[connection.to + 1]++;
+        if (connection.port == ControlPort::R && !connection.previous) {
+            cascades_begin_[connection.from + 1]++;
+        }
+    }
+    for (size_t i = 0; i < n; ++i) {
+        incoming_begin_[i + 1] += incoming_begin_[i];
+        cascades_begin_[i + 1] += cascades_begin_[i];
+    }
+    incoming_.resize(incoming_begin_[n]);
+    cascades_.resize(cascades_begin_[n]);
+    std::vector<size_t> next_in(incoming_begin_.begin(),
+                                incoming_begin_.end() - 1);
+    std::vector<size_t> next_cascade(cascades_begin_.begin(),
+                                     cascades_begin_.end() - 1);
+    for (size_t c = 0; c < connections_.size(); ++c) {
+        const Connection& connection = connections_[c];
+        incoming_[next_in[connection.to]++] = connection;
+        if (connection.port == ControlPort::R && !connection.previous) {
+            cascades_[next_cascade[connection.from]++] = connection;
+        }
+    }
+
+    // Levels by Kahn's algorithm over same-step connections
+    std::vector<size_t> pending(n, 0);
+    std::vector<std::vector<size_t> > outgoing(n);
+    for (size_t c = 0; c < connections_.size(); ++c) {
+        if (!connections_[c].previous) {
+            pending[connections_[c].to]++;
+            outgoing[connections_[c].from].push_back(connections_[c].to);
+        }
+    }
+    order_.clear();
+    level_begin_.assign(1, 0);
+    level_of_.assign(n, 0);
+    for (size_t i = 0; i < n; ++i) {
+        if (pending[i] == 0) {
+            order_.push_back(i);
+        }
+    }
+    size_t begin = 0;
+    while (begin < order_.size()) {
+        size_t end = order_.size();
+        for (size_t k = begin; k < end; ++k) {
+            size_t node = order_[k];
+            for (size_t j = 0; j < outgoing[node].size(); ++j) {
+                size_t target = outgoing[node][j];
+                if (--pending[target] == 0) {
+                    level_of_[target] = level_begin_.size();
+                    order_.push_back(target);
+                }
+            }
+        }
+        level_begin_.push_back(end);
+        begin = end;
+    }
+    if (order_.size() != n) {
+        throw std::invalid_argument("Control graph connections form a cycle");
+    }
+
+    u_.resize(n, 0.0);
+    u_previous_.resize(n, 0.0);
+    windup_in_.resize(n, 0);
+    blocked_.resize(n, 0);
+    windup_used_.resize(n, WindupMode::NONE);
+    compiled_ = true;
+}
+
+void ControlGraph::step(ThreadPool* pool) {
+    if (!compiled_) {
+        compile();
+    }
+    u_previous_ = u_;
+
+    for (size_t l = 0; l + 1 < level_begin_.size(); ++l) {
+        size_t begin = level_begin_[l];
+        size_t end = level_begin_[l + 1];
+        if (pool && pool->size() > 1 && end - begin >= parallel_threshold_) {
+            level_start_ = begin;
+            pool->parallel_for(end - begin, level_task_);
+        } else {
+            for (size_t k = begin; k < end; ++k) {
+                step_node(order_[k]);
+            }
+        }
+    }
+
+    propagate_windup();
+}
+
+void ControlGraph::step_node(size_t node) {
+    ControlInputs in = inputs_[node];
+    for (size_t c = incoming_begin_[node]; c < incoming_begin_[node + 1];
+         ++c) {
+        const Connection& connection = incoming_[c];
+        double source = connection.previous ? u_previous_[connection.from]
+                                            : u_[connection.from];
+        double value = connection.gain * source + connection.offset;
+        switch (connection.port) {
+        case ControlPort::R:
+            in.r = value;
+            break;
+        case ControlPort::UFF:
+            in.uff = value;
+            break;
+        case ControlPort::UMAN:
+            in.uman = value;
+            break;
+        case ControlPort::UTRACK:
+            in.utrack = value;
+            break;
+        }
+    }
+
+    WindupMode windup = combine_windup(in.windup, windup_in_[node]);
+    windup_used_[node] = windup;
+    u_[node] = controllers_[node](in.r, in.y, in.uff, in.uman, in.utrack,
+                                  in.Tx, in.track, in.auto_mode, windup);
+}
+
+void ControlGraph::propagate_windup() {
+    // Inner loops come after their outer loops, so visit in reverse
+    for (size_t k = order_.size(); k-- > 0;) {
+        size_t node = order_[k];
+        unsigned char inner = 0;
+        for (size_t c = cascades_begin_[node]; c < cascades_begin_[node + 1];
+             ++c) {
+            const Connection& connection = cascades_[c];
+            unsigned char bits = blocked_[connection.to];
+            inner |= connection.gain < 0.0 ? swap_directions(bits) : bits;
+        }
+
+        windup_in_[node] = inner;
+        blocked_[node] = controllers_[node].saturation() | inner;
+    }
+}
@@ -0,0 +1,228 @@
+/**
+ * @file control_graph.h
+ * @brief Graph of connected controllers for cascade and ratio control
+ *
+ * This file provides a container for controllers whose inputs are
+ * driven by the outputs of other controllers, such as cascades (the
+ * outer control signal is the inner setpoint) and ratio loops (a
+ * scaled control signal is another loop's setpoint). The graph is
+ * sorted into levels of independent controllers, which can be stepped
+ * in parallel on host platforms.
+ */
+
+#ifndef CONTROL_GRAPH_H
+#define CONTROL_GRAPH_H
+
+#include "pid.h"
+#include "thread_pool.h"
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Controller input driven by a connection
+ */
+enum class ControlPort {
+    R,       ///< Reference (setpoint) signal
+    UFF,     ///< Feedforward control signal
+    UMAN,    ///< Manual mode control signal
+    UTRACK   ///< Tracking signal
+};
+
+/**
+ * @brief Inputs of a controller in a control graph
+ *
+ * Inputs that are not driven by a connection keep the values set
+ * here. windup is combined with the windup status propagated from
+ * inner loops.
+ */
+struct ControlInputs {
+    double r;            ///< Reference (setpoint) signal
+    double y;            ///< Process measurement
+    double uff;          ///< Feedforward control signal
+    double uman;         ///< Manual mode control signal
+    double utrack;       ///< Tracking signal
+    double Tx;           ///< Execution period normalized
+    bool track;          ///< Tracking mode flag
+    bool auto_mode;      ///< Automatic mode flag
+    WindupMode windup;   ///< External windup status
+
+    ControlInputs()
+        : r(0.0),
+          y(0.0),
+          uff(0.0),
+          uman(0.0),
+          utrack(0.0),
+          Tx(1.0),
+          track(false),
+          auto_mode(true),
+          windup(WindupMode::NONE) {}
+};
+
+/**
+ * @brief Controllers connected by their control signals
+ *
+ * A connection sets an input of one controller to gain * u + offset,
+ * where u is the control signal of another controller. Connections
+ * made with connect() use the control signal of the same step and
+ * order the controllers; the graph must be acyclic in them.
+ * Connections made with connect_previous() use the control signal of
+ * the previous step (zero before the first), for feedback such as
+ * tracking an inner loop, and do not constrain the order.
+ *
+ * compile() sorts the controllers into levels: every controller
+ * depends only on controllers in earlier levels, so the controllers of
+ * one level are independent and may be stepped in parallel.
+ *
+ * Saturation is propagated up cascades. A controller is blocked
+ * upwards when its control signal is at umax, or when an inner loop
+ * it drives through a connection to R with positive gain is blocked
+ * upwards (with negative gain, directions swap); likewise downwards.
+ * On the next step, the windup status of an outer loop includes the
+ * blocked directions of the inner loops it drives, so its integral
+ * stops winding when an inner loop cannot follow its setpoint.
+ */
+class ControlGraph {
+public:
+    ControlGraph();
+
+    ControlGraph(const ControlGraph&) = delete;
+    ControlGraph& operator=(const ControlGraph&) = delete;
+
+    /**
+     * @brief Add a controller
+     *
+     * @param controller Controller to copy into the graph
+     * @return Node index of the controller
+     */
+    size_t add(const PIDController& controller);
+
+    /**
+     * @brief Drive an input from a control signal of the same step
+     *
+     * @param from Node whose control signal is used
+     * @param to Node whose input is set
+     * @param port Input that is set
+     * @param gain Factor applied to the control signal (default: 1.0)
+     * @param offset Offset added after scaling (default: 0.0)
+     */
+    void connect(size_t from, size_t to, ControlPort port,
+                 double gain = 1.0, double offset = 0.0);
+
+    /**
+     * @brief Drive an input from a control signal of the previous step
+     *
+     * Arguments as for connect().
+     */
+    void connect_previous(size_t from, size_t to, ControlPort port,
+                          double gain = 1.0, double offset = 0.0);
+
+    /**
+     * @brief Sort the controllers into levels
+     *
+     * Called by step() if the graph changed since the last call.
+     *
+     * @throws std::invalid_argument If connect() connections form a
+     *         cycle
+     */
+    void compile();
+
+    /**
+     * @brief Step every controller once, level by level
+     *
+     * @param pool Worker threads for levels with at least
+     *             parallel_threshold() controllers, or nullptr to step
+     *             serially (default)
+     */
+    void step(ThreadPool* pool = nullptr);
+
+    /**
+     * @brief Number of controllers
+     */
+    size_t size() const { return controllers_.size(); }
+
+    /**
+     * @brief Number of levels (valid after compile())
+     */
+    size_t levels() const { return level_begin_.size() - 1; }
+
+    /**
+     * @brief Level of a node (valid after compile())
+     */
+    size_t level(size_t node) const { return level_of_[node]; }
+
+    /**
+     * @brief Inputs of a node
+     */
+    ControlInputs& inputs(size_t node) { return inputs_[node]; }
+
+    /**
+     * @brief Controller of a node
+     */
+    PIDController& controller(size_t node) { return controllers_[node]; }
+
+    /**
+     * @brief Control signal of a node from the last step
+     */
+    double u(size_t node) const { return u_[node]; }
+
+    /**
+     * @brief Windup status used by a node in the last step
+     */
+    WindupMode windup(size_t node) const { return windup_used_[node]; }
+
+    /**
+     * @brief Smallest level size stepped in parallel (default: 64)
+     */
+    size_t parallel_threshold() const { return parallel_threshold_; }
+    void set_parallel_threshold(size_t n) { parallel_threshold_ = n; }
+
+private:
+    struct Connection {
+        size_t from;
+        size_t to;
+        ControlPort port;
+        double gain;
+        double offset;
+        bool previous;
+    };
+
+    void add_connection(size_t from, size_t to, ControlPort port,
+                        double gain, double offset, bool previous);
+
+    // Step one node with its connected inputs
+    void step_node(size_t node);
+
+    // Windup status for the next step from this step's saturation
+    void propagate_windup();
+
+    std::vector<PIDController> controllers_;
+    std::vector<ControlInputs> inputs_;
+    std::vector<Connection> connections_;
+    bool compiled_;
+
+    // Nodes in level order and the start of each level in order_
+    std::vector<size_t> order_;
+    std::vector<size_t> level_begin_;
+    std::vector<size_t> level_of_;
+
+    // Connections grouped by target node, and R connections grouped
+    // by source node (outer to inner)
+    std::vector<Connection> incoming_;
+    std::vector<size_t> incoming_begin_;
+    std::vector<Connection> cascades_;
+    std::vector<size_t> cascades_begin_;
+
+    // Signals of the current and previous step
+    std::vector<double> u_;
+    std::vector<double> u_previous_;
+    std::vector<unsigned char> windup_in_;
+    std::vector<unsigned char> blocked_;
+    std::vector<WindupMode> windup_used_;
+
+    // Parallel stepping of one level
+    size_t parallel_threshold_;
+    size_t level_start_;
+    ThreadPool::Task level_task_;
+};
+
+#endif // CONTROL_GRAPH_H
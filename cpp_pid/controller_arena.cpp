@@ -0,0 +1,90 @@
+/**
+ * @file controller_arena.cpp
+ * @brief Implementation of the controller arena
+ */
+
+#include "controller_arena.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+
+namespace {
+
+char* align_up(char* p, size_t alignment) {
+    uintptr_t address = reinterpret_cast<uintptr_t>(p);
+    return p + ((alignment - address % alignment) % alignment);
+}
+
+} // namespace
+
+ControllerArena::ControllerArena(size_t block_size)
+    : block_size_(block_size),
+      current_(0),
+      offset_(0),
+      used_(0),
+      reserved_(0) {}
+
+ControllerArena::~ControllerArena() {
+    release();
+    for (size_t k = 0; k < blocks_.size(); ++k) {
+        std::free(blocks_[k].memory);
+    }
+}
+
+void* ControllerArena::allocate(size_t bytes, size_t alignment) {
+    // Sizes that would wrap around in the block size computation
+    if (bytes > std::numeric_limits<size_t>::max() - alignment
+                    - ARENA_ALIGNMENT) {
+        throw std::bad_alloc();
+    }
+
+    // Look for room in the current block and the blocks kept from
+    // before the last release()
+    for (; current_ < blocks_.size(); ++current_, offset_ = 0) {
+        const Block& block = blocks_[current_];
+        char* start = align_up(block.data + offset_, alignment);
+        size_t end = static_cast<size_t>(start - block.data) + bytes;
+        if (end <= block.size) {
+            used_ += end - offset_;
+            offset_ = end;
+            return start;
+        }
+    }
+
+    // A new block, with room for the alignment beyond its own
+    size_t size = std::max(block_size_, bytes + alignment);
+    Block block;
+    block.memory =
+        static_cast<char*>(std::malloc(size + ARENA_ALIGNMENT - 1));
+    if (!block.memory) {
+        throw std::bad_alloc();
+    }
+    block.data = align_up(block.memory, ARENA_ALIGNMENT);
+    block.size = size;
+    blocks_.push_back(block);
+    reserved_ += size;
+    current_ = blocks_.size() - 1;
+    offset_ = 0;
+    return allocate(bytes, alignment);
+}
+
+void ControllerArena::release() {
+    for (size_t k = destructors_.size(); k > 0; --k) {
+        const Destructor& destructor = destructors_[k - 1];
+        destructor.destroy(destructor.objects, destructor.count);
+    }
+    destructors_.clear();
+    current_ = 0;
+    offset_ = 0;
+    used_ = 0;
+}
+
+void ControllerArena::add_destructor(
+    void* objects, size_t count, void (*destroy)(void*, size_t)) {
+    Destructor destructor;
+    destructor.objects = objects;
+    destructor.count = count;
+    destructor.destroy = destroy;
+    destructors_.push_back(destructor);
+}
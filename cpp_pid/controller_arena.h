@@ -0,0 +1,287 @@
+/**
+ * @file controller_arena.h
+ * @brief Arena for bulk allocation of controllers and filters
+ *
+ * This file provides an arena that hands out cache-line-aligned memory
+ * from large blocks and frees all of it in one operation, for
+ * configuration reloads that create and destroy many PIDController
+ * and MeasurementFilter objects. Objects are never freed one by one,
+ * so reloads do not fragment the heap, and the blocks are reused by
+ * the next reload without calling the system allocator.
+ *
+ * ArenaAllocator adapts the arena to standard containers. With C++17,
+ * ArenaResource also provides it as a std::pmr::memory_resource.
+ */
+
+#ifndef CONTROLLER_ARENA_H
+#define CONTROLLER_ARENA_H
+
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#define CONTROLLER_ARENA_PMR 1
+#endif
+#endif
+
+/**
+ * @brief Alignment of arena objects and container buffers (one cache
+ *        line)
+ */
+const size_t ARENA_ALIGNMENT = 64;
+
+/**
+ * @brief Bump allocator releasing all its objects at once
+ *
+ * Objects made by create() start on their own cache line, so
+ * controllers stepped by different threads never share a line. Arrays
+ * made by create_array() are contiguous. release() destroys every
+ * object and keeps the blocks for the next allocations; the destructor
+ * returns them to the system.
+ *
+ * An arena is not thread safe. Build a new configuration in a second
+ * arena on another thread, switch the control loop over to it, and
+ * release the old arena there.
+ */
+class ControllerArena {
+public:
+    /**
+     * @brief Constructor; no memory is allocated until first use
+     *
+     * @param block_size Bytes per block (default: 1 MiB); larger
+     *                   allocations get a block of their own
+     */
+    explicit ControllerArena(size_t block_size = 1 << 20);
+
+    /**
+     * @brief Destroy all objects and free the blocks
+     */
+    ~ControllerArena();
+
+    ControllerArena(const ControllerArena&) = delete;
+    ControllerArena& operator=(const ControllerArena&) = delete;
+
+    /**
+     * @brief Allocate uninitialized memory
+     *
+     * @param bytes Size in bytes
+     * @param alignment Power of two alignment (default: one cache line)
+     * @return Memory valid until release()
+     * @throws std::bad_alloc If a block cannot be allocated
+     */
+    void* allocate(size_t bytes, size_t alignment = ARENA_ALIGNMENT);
+
+    /**
+     * @brief Construct an object in the arena
+     *
+     * @param args Constructor arguments
+     * @return Object destroyed by release()
+     */
+    template <class T, class... Args>
+    T* create(Args&&... args) {
+        void* memory = allocate(sizeof(T), alignment_of<T>());
+        T* object = new (memory) T(std::forward<Args>(args)...);
+        if (!std::is_trivially_destructible<T>::value) {
+            add_destructor(object, 1, &destroy<T>);
+        }
+        return object;
+    }
+
+    /**
+     * @brief Construct a contiguous array of copies of an object
+     *
+     * If a copy throws, the copies already made are destroyed before
+     * the exception propagates; their memory stays in use until
+     * release().
+     *
+     * @param n Number of elements
+     * @param value Object to copy
+     * @return First element; the array is destroyed by release()
+     * @throws std::bad_array_new_length If n * sizeof(T) overflows
+     */
+    template <class T>
+    T* create_array(size_t n, const T& value) {
+        T* array = static_cast<T*>(
+            allocate(array_bytes<T>(n), alignment_of<T>()));
+        size_t i = 0;
+        try {
+            for (; i < n; ++i) {
+                new (array + i) T(value);
+            }
+            if (!std::is_trivially_destructible<T>::value) {
+                add_destructor(array, n, &destroy<T>);
+            }
+        } catch (...) {
+            destroy<T>(array, i);
+            throw;
+        }
+        return array;
+    }
+
+    /**
+     * @brief Destroy all objects and make the memory reusable
+     *
+     * Objects are destroyed in the reverse order of creation. The
+     * blocks are kept, so an arena that is refilled to the same size
+     * does not allocate again.
+     */
+    void release();
+
+    /**
+     * @brief Bytes handed out since the last release(), including
+     *        alignment padding
+     */
+    size_t used() const { return used_; }
+
+    /**
+     * @brief Bytes held in blocks
+     */
+    size_t reserved() const { return reserved_; }
+
+private:
+    struct Block {
+        char* memory;  // As returned by the system allocator
+        char* data;    // Aligned start
+        size_t size;
+    };
+
+    struct Destructor {
+        void* objects;
+        size_t count;
+        void (*destroy)(void*, size_t);
+    };
+
+    template <class T>
+    static size_t alignment_of() {
+        return alignof(T) > ARENA_ALIGNMENT ? alignof(T) : ARENA_ALIGNMENT;
+    }
+
+    template <class T>
+    static size_t array_bytes(size_t n) {
+        if (n > std::numeric_limits<size_t>::max() / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        return n * sizeof(T);
+    }
+
+    template <class T>
+    static void destroy(void* objects, size_t count) {
+        T* array = static_cast<T*>(objects);
+        for (size_t i = count; i > 0; --i) {
+            array[i - 1].~T();
+        }
+    }
+
+    void add_destructor(void* objects, size_t count,
+                        void (*destroy)(void*, size_t));
+
+    size_t block_size_;
+    std::vector<Block> blocks_;
+
+    // Block being filled and its first free byte
+    size_t current_;
+    size_t offset_;
+
+    size_t used_;
+    size_t reserved_;
+
+    // Objects that need their destructor run
+    std::vector<Destructor> destructors_;
+};
+
+/**
+ * @brief Standard allocator drawing from a ControllerArena
+ *
+ * Buffers are cache-line aligned and only freed by
+ * ControllerArena::release(), so reserve() containers to their final
+ * size instead of letting them grow.
+ */
+template <class T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+
+    /**
+     * @param arena Arena to allocate from (not owned)
+     */
+    explicit ArenaAllocator(ControllerArena& arena) : arena_(&arena) {}
+
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena_(&other.arena()) {}
+
+    T* allocate(size_t n) {
+        if (n > std::numeric_limits<size_t>::max() / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        return static_cast<T*>(arena_->allocate(
+            n * sizeof(T),
+            alignof(T) > ARENA_ALIGNMENT ? alignof(T) : ARENA_ALIGNMENT));
+    }
+
+    void deallocate(T*, size_t) {}
+
+    /**
+     * @brief Arena the memory comes from
+     */
+    ControllerArena& arena() const { return *arena_; }
+
+private:
+    ControllerArena* arena_;
+};
+
+template <class T, class U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+    return &a.arena() == &b.arena();
+}
+
+template <class T, class U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+    return !(a == b);
+}
+
+#ifdef CONTROLLER_ARENA_PMR
+/**
+ * @brief ControllerArena as a polymorphic memory resource (C++17)
+ *
+ * For std::pmr containers of controllers, such as
+ * std::pmr::vector<PIDController>. Deallocation is a no-op; the
+ * memory returns to the arena on ControllerArena::release().
+ */
+class ArenaResource : public std::pmr::memory_resource {
+public:
+    /**
+     * @param arena Arena to allocate from (not owned)
+     */
+    explicit ArenaResource(ControllerArena& arena) : arena_(&arena) {}
+
+    /**
+     * @brief Arena the memory comes from
+     */
+    ControllerArena& arena() const { return *arena_; }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        return arena_->allocate(
+            bytes, alignment > ARENA_ALIGNMENT ? alignment : ARENA_ALIGNMENT);
+    }
+
+    void do_deallocate(void*, size_t, size_t) override {}
+
+    bool do_is_equal(
+        const std::pmr::memory_resource& other) const noexcept override {
+        const ArenaResource* resource =
+            dynamic_cast<const ArenaResource*>(&other);
+        return resource && resource->arena_ == arena_;
+    }
+
+    ControllerArena* arena_;
+};
+#endif
+
+#endif // CONTROLLER_ARENA_H
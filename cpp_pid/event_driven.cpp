@@ -0,0 +1,272 @@
+/**
+ * @file event_driven.cpp
+ * @brief Implementation of event-driven controller execution
+ */
+
+#include "event_driven.h"
+#include "pid_bank_kernels.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+EventDrivenController::EventDrivenController(
+    PIDController& controller, const EventDeadband& deadband)
+    : controller_(controller),
+      deadband_(deadband),
+      last_(),
+      u_(0.0),
+      elapsed_(0.0),
+      force_(true),
+      stepped_(false),
+      ticks_(0),
+      steps_(0) {}
+
+double EventDrivenController::operator()(
+    double r,
+    double y,
+    double uff,
+    double uman,
+    double utrack,
+    double Tx,
+    bool track,
+    bool auto_mode,
+    WindupMode windup) {
+    EventInputs now = {r, y, uff, uman, utrack, track, auto_mode, windup};
+    elapsed_ += Tx;
+    ++ticks_;
+    stepped_ = force_ || event_due(deadband_, last_, now, elapsed_);
+    if (stepped_) {
+        // Catch up over the skipped ticks, where the inputs were held at
+        // those of the last step, then step this tick
+        double held = elapsed_ - Tx;
+        if (!force_ && held > 0.0) {
+            controller_(last_.r, last_.y, last_.uff, last_.uman,
+                        last_.utrack, held, last_.track, last_.auto_mode,
+                        last_.windup);
+        }
+        u_ = controller_(r, y, uff, uman, utrack, Tx, track, auto_mode,
+                         windup);
+        last_ = now;
+        elapsed_ = 0.0;
+        force_ = false;
+        ++steps_;
+    }
+    return u_;
+}
+
+void EventDrivenController::reset() {
+    elapsed_ = 0.0;
+    force_ = true;
+}
+
+namespace {
+
+// Mode flags of a controller packed into one byte, for comparison
+inline unsigned char pack_modes(bool track, bool auto_mode,
+                                WindupMode windup) {
+    return static_cast<unsigned char>(
+        track | auto_mode << 1 | static_cast<unsigned char>(windup) << 2);
+}
+
+EventKernelFunction best_event_kernel() {
+    if (pid_event_kernel_avx512 && pid_bank_cpu_has_avx512()) {
+        return pid_event_kernel_avx512;
+    }
+    if (pid_event_kernel_avx2 && pid_bank_cpu_has_avx2()) {
+        return pid_event_kernel_avx2;
+    }
+    if (pid_event_kernel_simd128) {
+        return pid_event_kernel_simd128;
+    }
+    return pid_event_kernel_scalar;
+}
+
+} // namespace
+
+void pid_event_kernel_scalar(
+    const EventKernelArgs& a, size_t begin, size_t end) {
+    // Written as !(change <= deadband) so that NaN steps
+    for (size_t i = begin; i < end; ++i) {
+        a.elapsed[i] += a.Tx[i];
+        a.due[i] = static_cast<unsigned char>(
+            a.force[i]
+            | !(std::abs(a.r[i] - a.last_r[i]) <= a.deadband_r[i])
+            | !(std::abs(a.y[i] - a.last_y[i]) <= a.deadband_y[i])
+            | !(std::abs(a.uff[i] - a.last_uff[i]) <= a.deadband_uff[i])
+            | !(std::abs(a.uman[i] - a.last_uman[i]) <= a.deadband_u[i])
+            | !(std::abs(a.utrack[i] - a.last_utrack[i])
+                <= a.deadband_u[i])
+            | (pack_modes(a.track[i], a.auto_mode[i], a.windup[i])
+               != a.last_modes[i])
+            | (a.elapsed[i] >= a.max_interval[i]));
+    }
+}
+
+EventDrivenBank::EventDrivenBank(
+    PIDBank& bank, const EventDeadband& deadband)
+    : bank_(bank),
+      deadband_r_(bank.size(), deadband.r),
+      deadband_y_(bank.size(), deadband.y),
+      deadband_uff_(bank.size(), deadband.uff),
+      deadband_u_(bank.size(), deadband.u),
+      max_interval_(bank.size(), deadband.max_interval),
+      last_r_(bank.size(), 0.0),
+      last_y_(bank.size(), 0.0),
+      last_uff_(bank.size(), 0.0),
+      last_uman_(bank.size(), 0.0),
+      last_utrack_(bank.size(), 0.0),
+      last_track_(new bool[bank.size()]()),
+      last_auto_mode_(new bool[bank.size()]()),
+      last_windup_(bank.size(), WindupMode::NONE),
+      last_modes_(bank.size(), 0),
+      elapsed_(bank.size(), 0.0),
+      force_(bank.size(), 1),
+      due_(bank.size() + sizeof(uint64_t), 0),
+      Tx_(bank.size(), 1.0),
+      ticks_(0),
+      steps_(0) {
+    active_.reserve(bank.size());
+    held_.reserve(bank.size());
+}
+
+size_t EventDrivenBank::tick(
+    const double* r,
+    const double* y,
+    const double* uff,
+    const double* uman,
+    const double* utrack,
+    const double* Tx,
+    const bool* track,
+    const bool* auto_mode,
+    const WindupMode* windup,
+    double* u) {
+    const size_t n = bank_.size();
+
+    // Check every controller with the SIMD kernel
+    static const EventKernelFunction kernel = best_event_kernel();
+    EventKernelArgs args = {
+        r, y, uff, uman, utrack, Tx, track, auto_mode, windup,
+        deadband_r_.data(), deadband_y_.data(), deadband_uff_.data(),
+        deadband_u_.data(), max_interval_.data(),
+        last_r_.data(), last_y_.data(), last_uff_.data(), last_uman_.data(),
+        last_utrack_.data(), last_modes_.data(),
+        elapsed_.data(), force_.data(), due_.data()
+    };
+    kernel(args, 0, n);
+
+    // Collect the due controllers, skipping eight idle ones at a time,
+    // and those of them that skipped ticks since their last step
+    active_.clear();
+    held_.clear();
+    for (size_t i = 0; i < n; ) {
+        uint64_t word;
+        std::memcpy(&word, &due_[i], sizeof(word));
+        if (word == 0) {
+            i += sizeof(word);
+            continue;
+        }
+        if (due_[i]) {
+            active_.push_back(i);
+            double held = elapsed_[i] - Tx[i];
+            if (!force_[i] && held > 0.0) {
+                held_.push_back(i);
+                Tx_[i] = held;
+            }
+        }
+        ++i;
+    }
+
+    // Catch up over the skipped ticks, where the inputs were held at
+    // those of the last step
+    if (!held_.empty()) {
+        bank_.step_active(held_.data(), held_.size(), last_r_.data(),
+                          last_y_.data(), last_uff_.data(),
+                          last_uman_.data(), last_utrack_.data(),
+                          Tx_.data(), last_track_.get(),
+                          last_auto_mode_.get(), last_windup_.data(), u);
+    }
+
+    for (size_t k = 0; k < active_.size(); ++k) {
+        size_t i = active_[k];
+        elapsed_[i] = 0.0;
+        force_[i] = 0;
+        last_r_[i] = r[i];
+        last_y_[i] = y[i];
+        last_uff_[i] = uff[i];
+        last_uman_[i] = uman[i];
+        last_utrack_[i] = utrack[i];
+        last_track_[i] = track[i];
+        last_auto_mode_[i] = auto_mode[i];
+        last_windup_[i] = windup[i];
+        last_modes_[i] = pack_modes(track[i], auto_mode[i], windup[i]);
+    }
+
+    bank_.step_active(active_.data(), active_.size(), r, y, uff, uman,
+                      utrack, Tx, track, auto_mode, windup, u);
+    ++ticks_;
+    steps_ += active_.size();
+    return active_.size();
+}
+
+void EventDrivenBank::set_deadband(
+    size_t i, const EventDeadband& deadband) {
+    deadband_r_[i] = deadband.r;
+    deadband_y_[i] = deadband.y;
+    deadband_uff_[i] = deadband.uff;
+    deadband_u_[i] = deadband.u;
+    max_interval_[i] = deadband.max_interval;
+}
+
+EventDeadband EventDrivenBank::deadband(size_t i) const {
+    return EventDeadband(deadband_r_[i], deadband_y_[i], deadband_uff_[i],
+                         deadband_u_[i], max_interval_[i]);
+}
+
+void EventDrivenBank::reset(size_t i) {
+    elapsed_[i] = 0.0;
+    force_[i] = 1;
+}
+
+void EventDrivenBank::reset() {
+    for (size_t i = 0; i < bank_.size(); ++i) {
+        reset(i);
+    }
+}
+
+EventTrackingReport event_tracking_report(
+    const PIDController& controller,
+    const EventDeadband& deadband,
+    const InputSeries& in) {
+    PIDController reference = controller;
+    std::vector<double> u_ref(in.n);
+    reference.run(in, u_ref.data());
+
+    PIDController copy = controller;
+    EventDrivenController event(copy, deadband);
+    double max_error = 0.0;
+    double sum_sq = 0.0;
+    double scale = 0.0;
+    for (size_t i = 0; i < in.n; ++i) {
+        double u = event(
+            in.r[i], in.y[i],
+            in.uff ? in.uff[i] : 0.0,
+            in.uman ? in.uman[i] : 0.0,
+            in.utrack ? in.utrack[i] : 0.0,
+            in.Tx ? in.Tx[i] : 1.0,
+            in.track ? in.track[i] : false,
+            in.auto_mode ? in.auto_mode[i] : true,
+            in.windup ? in.windup[i] : WindupMode::NONE);
+        double e = std::abs(u - u_ref[i]);
+        max_error = std::max(max_error, e);
+        sum_sq += e * e;
+        scale = std::max(scale, std::abs(u_ref[i]));
+    }
+
+    EventTrackingReport report;
+    report.ticks = in.n;
+    report.steps = event.steps();
+    report.max_error = max_error;
+    report.rms_error = in.n > 0 ? std::sqrt(sum_sq / in.n) : 0.0;
+    report.max_relative_error = scale > 0.0 ? max_error / scale : 0.0;
+    return report;
+}
@@ -0,0 +1,351 @@
+/**
+ * @file event_driven.h
+ * @brief Event-driven (send-on-delta) execution of controllers
+ *
+ * This file provides wrappers that are called on every tick but step
+ * their controllers only when an input moves by more than a deadband
+ * or a maximum interval has passed. Between steps the control signal
+ * is held. A step that follows skipped ticks first advances the
+ * controller over them with the inputs of the previous step, which
+ * held over those ticks, and then steps the current tick with its own
+ * Tx, so the integral and the filters do not carry the new inputs back
+ * over the skipped time.
+ */
+
+#ifndef EVENT_DRIVEN_H
+#define EVENT_DRIVEN_H
+
+#include "pid_bank.h"
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Conditions for stepping an event-driven controller
+ *
+ * A tick steps the controller when r, y or uff differ from their
+ * values at the previous step by more than their deadband, when uman
+ * or utrack differ by more than the u deadband, when track, auto_mode
+ * or windup changed, or when the time since the previous step reached
+ * max_interval. NaN inputs always step. The defaults step on every
+ * input change and at least once per nominal sample period, which
+ * gives the same outputs as stepping on every tick when Tx = 1.
+ */
+struct EventDeadband {
+    double r;             ///< Deadband of the reference
+    double y;             ///< Deadband of the measurement
+    double uff;           ///< Deadband of the feedforward signal
+    double u;             ///< Deadband of the manual and tracking signals
+    double max_interval;  ///< Longest time between steps (normalized)
+
+    /**
+     * @brief Constructor
+     *
+     * @param r Deadband of the reference (default: 0.0)
+     * @param y Deadband of the measurement (default: 0.0)
+     * @param uff Deadband of the feedforward signal (default: 0.0)
+     * @param u Deadband of the manual and tracking signals (default:
+     *          0.0)
+     * @param max_interval Longest time between steps (normalized,
+     *                     default: 1.0)
+     */
+    EventDeadband(double r = 0.0, double y = 0.0, double uff = 0.0,
+                  double u = 0.0, double max_interval = 1.0)
+        : r(r), y(y), uff(uff), u(u), max_interval(max_interval) {}
+};
+
+/**
+ * @brief Inputs of one controller at one tick
+ */
+struct EventInputs {
+    double r;              ///< Reference (setpoint) signal
+    double y;              ///< Process measurement
+    double uff;            ///< Feedforward control signal
+    double uman;           ///< Manual mode control signal
+    double utrack;         ///< Tracking signal
+    bool track;            ///< Tracking mode flag
+    bool auto_mode;        ///< Automatic mode flag
+    WindupMode windup;     ///< Windup status
+};
+
+/**
+ * @brief Whether a tick calls for a step
+ *
+ * @param deadband Step conditions
+ * @param last Inputs of the previous step
+ * @param now Inputs of this tick
+ * @param elapsed Time since the previous step, including this tick
+ *                (normalized)
+ * @return true if the controller should be stepped
+ */
+inline bool event_due(const EventDeadband& deadband,
+                      const EventInputs& last,
+                      const EventInputs& now,
+                      double elapsed) {
+    // Written as !(change <= deadband) so that NaN steps
+    return !(std::abs(now.r - last.r) <= deadband.r)
+        | !(std::abs(now.y - last.y) <= deadband.y)
+        | !(std::abs(now.uff - last.uff) <= deadband.uff)
+        | !(std::abs(now.uman - last.uman) <= deadband.u)
+        | !(std::abs(now.utrack - last.utrack) <= deadband.u)
+        | (now.track != last.track)
+        | (now.auto_mode != last.auto_mode)
+        | (now.windup != last.windup)
+        | (elapsed >= deadband.max_interval);
+}
+
+/**
+ * @brief PIDController stepped on input changes
+ *
+ * Called on every tick with the same arguments as
+ * PIDController::operator(), where Tx is the length of this tick. The
+ * first call always steps. A step after skipped ticks runs the
+ * controller twice: once over the skipped time with the inputs of the
+ * previous step, and once over this tick.
+ */
+class EventDrivenController {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param controller Controller to step (not owned, must outlive
+     *                   this object)
+     * @param deadband Step conditions
+     */
+    EventDrivenController(PIDController& controller,
+                          const EventDeadband& deadband);
+
+    /**
+     * @brief Process one tick
+     *
+     * Arguments as for PIDController::operator().
+     *
+     * @return Control signal of the last step
+     */
+    double operator()(
+        double r,
+        double y,
+        double uff = 0.0,
+        double uman = 0.0,
+        double utrack = 0.0,
+        double Tx = 1.0,
+        bool track = false,
+        bool auto_mode = true,
+        WindupMode windup = WindupMode::NONE);
+
+    /**
+     * @brief Whether the last tick stepped the controller
+     */
+    bool stepped() const { return stepped_; }
+
+    /**
+     * @brief Number of ticks processed
+     */
+    size_t ticks() const { return ticks_; }
+
+    /**
+     * @brief Number of controller steps
+     */
+    size_t steps() const { return steps_; }
+
+    /**
+     * @brief Step on the next tick and restart the time since the last
+     *        step
+     *
+     * Call after resetting or reconfiguring the controller.
+     */
+    void reset();
+
+    /**
+     * @brief Change the step conditions
+     */
+    void set_deadband(const EventDeadband& deadband) {
+        deadband_ = deadband;
+    }
+
+    /**
+     * @brief Step conditions
+     */
+    const EventDeadband& deadband() const { return deadband_; }
+
+    /**
+     * @brief The controller
+     */
+    PIDController& controller() { return controller_; }
+
+private:
+    PIDController& controller_;
+    EventDeadband deadband_;
+
+    // Inputs and output of the last step, time since then, and whether
+    // the next tick must step
+    EventInputs last_;
+    double u_;
+    double elapsed_;
+    bool force_;
+
+    bool stepped_;
+    size_t ticks_;
+    size_t steps_;
+};
+
+/**
+ * @brief PIDBank whose controllers are stepped on input changes
+ *
+ * tick() checks every controller of the bank against its step
+ * conditions and steps only the due ones with PIDBank::step_active().
+ * Due controllers that skipped ticks are first stepped over the skipped
+ * time with the inputs of their previous step, by a second
+ * step_active() pass, as in EventDrivenController. The control
+ * signals of the others are not written, so u should be the same array
+ * on every tick, which then holds the last control signal of every
+ * controller. Writing only the controllers in active() to the
+ * actuators sends only the changed values. The first tick steps every
+ * controller.
+ *
+ * A gain table published to the bank is swapped in at the next tick
+ * and changes each controller's output at its next step.
+ */
+class EventDrivenBank {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param bank Controllers (not owned, must outlive this object)
+     * @param deadband Step conditions of every controller
+     */
+    EventDrivenBank(PIDBank& bank, const EventDeadband& deadband);
+
+    /**
+     * @brief Process one tick
+     *
+     * The arrays hold bank.size() elements with the same meaning as
+     * for PIDBank::step(), where Tx is the length of this tick.
+     *
+     * @return Number of controllers stepped
+     */
+    size_t tick(
+        const double* r,
+        const double* y,
+        const double* uff,
+        const double* uman,
+        const double* utrack,
+        const double* Tx,
+        const bool* track,
+        const bool* auto_mode,
+        const WindupMode* windup,
+        double* u);
+
+    /**
+     * @brief Indices of the controllers stepped by the last tick, in
+     *        increasing order
+     */
+    const std::vector<size_t>& active() const { return active_; }
+
+    /**
+     * @brief Number of ticks processed
+     */
+    size_t ticks() const { return ticks_; }
+
+    /**
+     * @brief Number of controller steps over all ticks
+     */
+    size_t steps() const { return steps_; }
+
+    /**
+     * @brief Set the step conditions of one controller
+     *
+     * @param i Controller index
+     * @param deadband Step conditions
+     */
+    void set_deadband(size_t i, const EventDeadband& deadband);
+
+    /**
+     * @brief Step conditions of one controller
+     */
+    EventDeadband deadband(size_t i) const;
+
+    /**
+     * @brief Step one controller on the next tick and restart its time
+     *        since the last step
+     *
+     * @param i Controller index
+     */
+    void reset(size_t i);
+
+    /**
+     * @brief Step every controller on the next tick
+     */
+    void reset();
+
+private:
+    PIDBank& bank_;
+
+    // Step conditions, one array per field, so that the checks of all
+    // controllers run as one SIMD kernel (see EventKernelArgs)
+    std::vector<double> deadband_r_;
+    std::vector<double> deadband_y_;
+    std::vector<double> deadband_uff_;
+    std::vector<double> deadband_u_;
+    std::vector<double> max_interval_;
+
+    // Inputs of the last step of each controller
+    std::vector<double> last_r_;
+    std::vector<double> last_y_;
+    std::vector<double> last_uff_;
+    std::vector<double> last_uman_;
+    std::vector<double> last_utrack_;
+    std::unique_ptr<bool[]> last_track_;
+    std::unique_ptr<bool[]> last_auto_mode_;
+    std::vector<WindupMode> last_windup_;
+    std::vector<unsigned char> last_modes_;
+
+    // Time since the last step, whether the next tick must step, and
+    // whether this tick steps each controller
+    std::vector<double> elapsed_;
+    std::vector<unsigned char> force_;
+    std::vector<unsigned char> due_;
+
+    // Skipped time of the controllers that catch up, the stepped
+    // controllers, and those of them that catch up first
+    std::vector<double> Tx_;
+    std::vector<size_t> active_;
+    std::vector<size_t> held_;
+
+    size_t ticks_;
+    size_t steps_;
+};
+
+/**
+ * @brief Deviation of an event-driven controller from every-tick
+ *        stepping
+ */
+struct EventTrackingReport {
+    size_t ticks;        ///< Number of ticks
+    size_t steps;        ///< Steps of the event-driven controller
+    double max_error;    ///< Largest |u - u_ref|
+    double rms_error;    ///< RMS of u - u_ref
+    double max_relative_error;  ///< max_error over the largest |u_ref|
+};
+
+/**
+ * @brief Compare an event-driven controller with every-tick stepping
+ *
+ * Runs two copies of the controller over the inputs: one stepped on
+ * every tick, which gives the reference u_ref, and one stepped by an
+ * EventDrivenController. The inputs are the same for both (open loop),
+ * so the report measures how much the held and less frequently updated
+ * control signal differs from the reference.
+ *
+ * @param controller Controller to copy
+ * @param deadband Step conditions
+ * @param inputs Inputs of every tick
+ * @return Step count and control signal errors
+ */
+EventTrackingReport event_tracking_report(
+    const PIDController& controller,
+    const EventDeadband& deadband,
+    const InputSeries& inputs);
+
+#endif // EVENT_DRIVEN_H
@@ -0,0 +1,64 @@
+/**
+ * @file file_view.cpp
+ * @brief Implementation of the read-only file view
+ */
+
+#include "file_view.h"
+#include <cstdio>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define FILE_VIEW_MMAP 1
+#endif
+
+FileView::FileView(const std::string& path)
+    : data_(nullptr), size_(0), mapped_(false) {
+#ifdef FILE_VIEW_MMAP
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open file: " + path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw std::runtime_error("Could not read file: " + path);
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ > 0) {
+        void* map = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("Could not map file: " + path);
+        }
+        madvise(map, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(map);
+        mapped_ = true;
+    }
+    close(fd);
+#else
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        throw std::runtime_error("Could not open file: " + path);
+    }
+    char buf[1 << 16];
+    size_t count;
+    while ((count = std::fread(buf, 1, sizeof(buf), file)) > 0) {
+        contents_.insert(contents_.end(), buf, buf + count);
+    }
+    std::fclose(file);
+    data_ = contents_.empty() ? nullptr : contents_.data();
+    size_ = contents_.size();
+#endif
+}
+
+FileView::~FileView() {
+#ifdef FILE_VIEW_MMAP
+    if (mapped_) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+}
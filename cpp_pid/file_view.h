@@ -0,0 +1,55 @@
+/**
+ * @file file_view.h
+ * @brief Read-only view of a whole file (internal)
+ *
+ * Shared by the I/O data and trajectory file readers.
+ */
+
+#ifndef FILE_VIEW_H
+#define FILE_VIEW_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Read-only view of the contents of a file
+ *
+ * The file is memory mapped on POSIX systems and read into a buffer
+ * elsewhere. The contents stay valid for the lifetime of the view.
+ */
+class FileView {
+public:
+    /**
+     * @brief Open and map a file
+     *
+     * @param path Path to the file
+     * @throws std::runtime_error If the file cannot be read
+     */
+    explicit FileView(const std::string& path);
+
+    ~FileView();
+
+    FileView(const FileView&) = delete;
+    FileView& operator=(const FileView&) = delete;
+
+    /**
+     * @brief File contents (nullptr for an empty file)
+     */
+    const char* data() const { return data_; }
+
+    /**
+     * @brief File size in bytes
+     */
+    size_t size() const { return size_; }
+
+private:
+    const char* data_;
+    size_t size_;
+    bool mapped_;
+
+    // Contents when the file is not memory mapped
+    std::vector<char> contents_;
+};
+
+#endif // FILE_VIEW_H
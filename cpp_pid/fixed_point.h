@@ -0,0 +1,202 @@
+/**
+ * @file fixed_point.h
+ * @brief Saturating fixed-point scalar type
+ *
+ * This file provides a fixed-point number stored in a 32-bit integer,
+ * for running the controller on microcontrollers without a
+ * floating-point unit. Arithmetic uses 64-bit intermediates and
+ * saturates at the limits of the format instead of wrapping, so an
+ * overflow behaves like a control signal limit rather than a sign
+ * flip.
+ */
+
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <stdint.h>
+
+/**
+ * @brief Signed fixed-point number with FracBits fractional bits
+ *
+ * The value is raw() / 2^FracBits, with raw() a 32-bit integer, so the
+ * range is about +/- 2^(31 - FracBits) and the resolution 2^-FracBits.
+ * Products and quotients are rounded to nearest. Conversion from
+ * double rounds to nearest, saturates out-of-range values (including
+ * infinities) and maps NaN to zero. Division by zero saturates towards
+ * the sign of the dividend.
+ *
+ * Conversions to and from double are explicit, so mixed expressions do
+ * not silently fall back to floating point.
+ *
+ * @tparam FracBits Number of fractional bits (1 to 30)
+ */
+template <int FracBits>
+class FixedPoint {
+    static_assert(FracBits > 0 && FracBits < 31,
+                  "FracBits must be between 1 and 30");
+
+public:
+    /**
+     * @brief Zero
+     */
+    FixedPoint() : raw_(0) {}
+
+    /**
+     * @brief Convert from double, rounding to nearest and saturating
+     */
+    explicit FixedPoint(double value) : raw_(from_double(value)) {}
+
+    /**
+     * @brief Construct from the raw integer representation
+     */
+    static FixedPoint from_raw(int32_t raw) {
+        FixedPoint result;
+        result.raw_ = raw;
+        return result;
+    }
+
+    /**
+     * @brief Raw integer representation
+     */
+    int32_t raw() const { return raw_; }
+
+    /**
+     * @brief Convert to double (exact)
+     */
+    explicit operator double() const {
+        return static_cast<double>(raw_) / one();
+    }
+
+    /**
+     * @brief Largest representable value
+     */
+    static FixedPoint max() { return from_raw(INT32_MAX); }
+
+    /**
+     * @brief Smallest (most negative) representable value
+     */
+    static FixedPoint min() { return from_raw(INT32_MIN); }
+
+    /**
+     * @brief Smallest positive value
+     */
+    static FixedPoint epsilon() { return from_raw(1); }
+
+    FixedPoint operator-() const {
+        return from_raw(saturate(-static_cast<int64_t>(raw_)));
+    }
+
+    FixedPoint& operator+=(FixedPoint other) {
+        raw_ = saturate(static_cast<int64_t>(raw_) + other.raw_);
+        return *this;
+    }
+
+    FixedPoint& operator-=(FixedPoint other) {
+        raw_ = saturate(static_cast<int64_t>(raw_) - other.raw_);
+        return *this;
+    }
+
+    FixedPoint& operator*=(FixedPoint other) {
+        // Round to nearest, ties away from zero
+        int64_t product = static_cast<int64_t>(raw_) * other.raw_;
+        int64_t half = INT64_C(1) << (FracBits - 1);
+        product = product >= 0 ? (product + half) >> FracBits
+                               : -((-product + half) >> FracBits);
+        raw_ = saturate(product);
+        return *this;
+    }
+
+    FixedPoint& operator/=(FixedPoint other) {
+        if (other.raw_ == 0) {
+            raw_ = raw_ > 0 ? INT32_MAX : (raw_ < 0 ? INT32_MIN : 0);
+            return *this;
+        }
+        int64_t dividend = static_cast<int64_t>(raw_) * one();
+        // Round to nearest, ties away from zero
+        int64_t divisor = other.raw_;
+        int64_t half = (divisor >= 0 ? divisor : -divisor) / 2;
+        dividend += dividend >= 0 ? half : -half;
+        raw_ = saturate(dividend / divisor);
+        return *this;
+    }
+
+    friend FixedPoint operator+(FixedPoint a, FixedPoint b) {
+        return a += b;
+    }
+    friend FixedPoint operator-(FixedPoint a, FixedPoint b) {
+        return a -= b;
+    }
+    friend FixedPoint operator*(FixedPoint a, FixedPoint b) {
+        return a *= b;
+    }
+    friend FixedPoint operator/(FixedPoint a, FixedPoint b) {
+        return a /= b;
+    }
+
+    friend bool operator==(FixedPoint a, FixedPoint b) {
+        return a.raw_ == b.raw_;
+    }
+    friend bool operator!=(FixedPoint a, FixedPoint b) {
+        return a.raw_ != b.raw_;
+    }
+    friend bool operator<(FixedPoint a, FixedPoint b) {
+        return a.raw_ < b.raw_;
+    }
+    friend bool operator>(FixedPoint a, FixedPoint b) {
+        return a.raw_ > b.raw_;
+    }
+    friend bool operator<=(FixedPoint a, FixedPoint b) {
+        return a.raw_ <= b.raw_;
+    }
+    friend bool operator>=(FixedPoint a, FixedPoint b) {
+        return a.raw_ >= b.raw_;
+    }
+
+private:
+    static int64_t one() { return INT64_C(1) << FracBits; }
+
+    static int32_t saturate(int64_t value) {
+        if (value > INT32_MAX) {
+            return INT32_MAX;
+        }
+        if (value < INT32_MIN) {
+            return INT32_MIN;
+        }
+        return static_cast<int32_t>(value);
+    }
+
+    static int32_t from_double(double value) {
+        if (value != value) {
+            return 0;  // NaN
+        }
+        double scaled = value * static_cast<double>(one());
+        if (scaled >= 2147483647.0) {
+            return INT32_MAX;
+        }
+        if (scaled <= -2147483648.0) {
+            return INT32_MIN;
+        }
+        return static_cast<int32_t>(scaled >= 0.0 ? scaled + 0.5
+                                                  : scaled - 0.5);
+    }
+
+    int32_t raw_;
+};
+
+/**
+ * @brief Q16.15 format: range +/- 65536, resolution 3.1e-5
+ *
+ * For signals in engineering units with a modest dynamic range. This is
+ * a 32-bit format, not the 16-bit Q1.15 often called Q15.
+ */
+typedef FixedPoint<15> Q16_15;
+
+/**
+ * @brief Q7.24 format: range +/- 128, resolution 6.0e-8
+ *
+ * For signals and gains normalized to a few units, such as percent of
+ * range divided by 100.
+ */
+typedef FixedPoint<24> Q7_24;
+
+#endif // FIXED_POINT_H
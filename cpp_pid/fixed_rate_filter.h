@@ -0,0 +1,81 @@
+/**
+ * @file fixed_rate_filter.h
+ * @brief Measurement filter for a fixed execution period
+ *
+ * This file provides a second-order measurement filter whose
+ * parameters are computed at compile time from a filter time constant
+ * and execution period known when the program is built.
+ */
+
+#ifndef FIXED_RATE_FILTER_H
+#define FIXED_RATE_FILTER_H
+
+#include "measurement_filter.h"
+#include "zoh_pid.h"
+#include <ratio>
+
+/**
+ * @brief Second-order measurement filter with a fixed execution period
+ *
+ * Same filter as MeasurementFilter for a constant Tx, with the ZOH
+ * parameters computed by zoh_Fy_constexpr when the program is
+ * compiled. There is no rediscretization check and no Tx_old_ state,
+ * and construction only zeroes the filter state. For example,
+ * FixedRateMeasurementFilter<std::ratio<10> > corresponds to
+ * MeasurementFilter(10.0) stepped with Tx = 1.0, and
+ * FixedRateMeasurementFilter<std::ratio<10>, std::ratio<1, 2> > to a
+ * loop executing at twice the nominal rate.
+ *
+ * @tparam TfTs std::ratio for the filter time constant as a multiple
+ *              of nominal sample time
+ * @tparam Tx std::ratio for the execution period (normalized, default:
+ *            1)
+ */
+template <class TfTs, class Tx = std::ratio<1> >
+class FixedRateMeasurementFilter {
+public:
+    /**
+     * @brief Filter parameters for TfTs and Tx
+     */
+    static constexpr FilterParams params = zoh_Fy_constexpr(
+        static_cast<double>(TfTs::num) / TfTs::den,
+        static_cast<double>(Tx::num) / Tx::den);
+
+    constexpr FixedRateMeasurementFilter() : yf_(0.0), dyf_(0.0) {}
+
+    /**
+     * @brief Apply the filter to a measurement
+     *
+     * @param y Process measurement
+     * @return FilterOutput containing filtered output and derivative
+     */
+    FilterOutput operator()(double y) {
+        // State update
+        double yf_prev = yf_;
+        yf_ = params.a11 * yf_prev + params.a12 * dyf_ + params.b1 * y;
+        dyf_ = params.a21 * yf_prev + params.a22 * dyf_ + params.b2 * y;
+
+        FilterOutput output;
+        output.yf = yf_;
+        output.dyf = dyf_;
+        return output;
+    }
+
+    /**
+     * @brief Reset the filter state to zero
+     */
+    void reset() {
+        yf_ = 0.0;
+        dyf_ = 0.0;
+    }
+
+private:
+    // Filter state
+    double yf_;
+    double dyf_;
+};
+
+template <class TfTs, class Tx>
+constexpr FilterParams FixedRateMeasurementFilter<TfTs, Tx>::params;
+
+#endif // FIXED_RATE_FILTER_H
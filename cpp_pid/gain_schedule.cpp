@@ -0,0 +1,196 @@
+/**
+ * @file gain_schedule.cpp
+ * @brief Implementation of gain scheduling
+ */
+
+#include "gain_schedule.h"
+#include "pid_bank_kernels.h"
+#include <climits>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+// Pad each column to a whole number of 64-byte cache lines
+size_t padded_length(size_t n) {
+    const size_t doubles_per_line = 8;
+    return (n + doubles_per_line - 1) / doubles_per_line * doubles_per_line;
+}
+
+// Breakpoints closer than this fraction of the range to an even grid
+// count as evenly spaced
+const double UNIFORM_TOLERANCE = 1e-9;
+
+GainLookupKernelFunction best_gain_lookup_kernel() {
+    if (pid_gain_lookup_kernel_avx512 && pid_bank_cpu_has_avx512()) {
+        return pid_gain_lookup_kernel_avx512;
+    }
+    if (pid_gain_lookup_kernel_avx2 && pid_bank_cpu_has_avx2()) {
+        return pid_gain_lookup_kernel_avx2;
+    }
+    if (pid_gain_lookup_kernel_simd128) {
+        return pid_gain_lookup_kernel_simd128;
+    }
+    return pid_gain_lookup_kernel_scalar;
+}
+
+} // namespace
+
+void pid_gain_lookup_kernel_scalar(
+    const GainLookupArgs& a, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+        a.schedule->lookup(a.x[i], a.kp[i], a.ki[i], a.kd[i]);
+    }
+}
+
+GainSchedule::GainSchedule(
+    const std::vector<double>& x,
+    const std::vector<double>& kp,
+    const std::vector<double>& ki,
+    const std::vector<double>& kd)
+    : n_(x.size()),
+      stride_(padded_length(x.size())),
+      storage_(NUM_COLUMNS * padded_length(x.size()), 0.0),
+      x_first_(0.0),
+      x_last_(0.0),
+      uniform_(true),
+      inverse_spacing_(0.0) {
+    if (n_ == 0 || kp.size() != n_ || ki.size() != n_
+        || kd.size() != n_) {
+        throw std::invalid_argument(
+            "Gain schedule needs the same number of breakpoints and gains");
+    }
+    for (size_t k = 0; k < n_; ++k) {
+        if (!std::isfinite(x[k]) || (k > 0 && !(x[k] > x[k - 1]))) {
+            throw std::invalid_argument(
+                "Gain schedule breakpoints must be finite and increasing");
+        }
+    }
+
+    double* xs = storage_.data() + X * stride_;
+    double* kps = storage_.data() + KP * stride_;
+    double* kis = storage_.data() + KI * stride_;
+    double* kds = storage_.data() + KD * stride_;
+    double* kp_slopes = storage_.data() + KP_SLOPE * stride_;
+    double* ki_slopes = storage_.data() + KI_SLOPE * stride_;
+    double* kd_slopes = storage_.data() + KD_SLOPE * stride_;
+    for (size_t k = 0; k < n_; ++k) {
+        xs[k] = x[k];
+        kps[k] = kp[k];
+        kis[k] = ki[k];
+        kds[k] = kd[k];
+        if (k + 1 < n_) {
+            double width = x[k + 1] - x[k];
+            kp_slopes[k] = (kp[k + 1] - kp[k]) / width;
+            ki_slopes[k] = (ki[k + 1] - ki[k]) / width;
+            kd_slopes[k] = (kd[k + 1] - kd[k]) / width;
+        }
+    }
+    x_first_ = x.front();
+    x_last_ = x.back();
+
+    if (n_ > 1) {
+        double range = x_last_ - x_first_;
+        double spacing = range / (n_ - 1);
+        for (size_t k = 0; k < n_; ++k) {
+            if (std::abs(x[k] - (x_first_ + k * spacing))
+                    > UNIFORM_TOLERANCE * range) {
+                uniform_ = false;
+            }
+        }
+        inverse_spacing_ = 1.0 / spacing;
+    }
+}
+
+size_t GainSchedule::segment(double x) const {
+    if (uniform_) {
+        // A neighbouring segment found by rounding gives the same gains
+        // to within rounding, since the interpolation is continuous
+        double t = (x - x_first_) * inverse_spacing_;
+        if (!(t > 0.0)) {
+            return 0;
+        }
+        return t < static_cast<double>(n_ - 1)
+            ? static_cast<size_t>(t) : n_ - 1;
+    }
+    // Binary search for the last breakpoint at or below x, with a
+    // conditional move instead of a branch per halving
+    const double* xs = column(X);
+    const double* base = xs;
+    size_t length = n_;
+    while (length > 1) {
+        size_t half = length / 2;
+        base = base[half] <= x ? base + half : base;
+        length -= half;
+    }
+    return static_cast<size_t>(base - xs);
+}
+
+void GainSchedule::lookup(size_t n, const double* x, double* kp,
+                          double* ki, double* kd) const {
+    static const GainLookupKernelFunction best = best_gain_lookup_kernel();
+
+    GainLookupArgs args;
+    args.schedule = this;
+    args.x_break = column(X);
+    args.kp_break = column(KP);
+    args.ki_break = column(KI);
+    args.kd_break = column(KD);
+    args.kp_slope = column(KP_SLOPE);
+    args.ki_slope = column(KI_SLOPE);
+    args.kd_slope = column(KD_SLOPE);
+    args.breakpoints = static_cast<int>(std::min<size_t>(n_, INT_MAX));
+    args.uniform = uniform_;
+    args.inverse_spacing = inverse_spacing_;
+    args.x_first = x_first_;
+    args.x_last = x_last_;
+    args.x = x;
+    args.kp = kp;
+    args.ki = ki;
+    args.kd = kd;
+
+    // The vector kernels index the breakpoints with 32-bit lanes
+    GainLookupKernelFunction kernel =
+        n_ <= static_cast<size_t>(INT_MAX) ? best
+                                           : pid_gain_lookup_kernel_scalar;
+    kernel(args, 0, n);
+}
+
+GainScheduledPID::GainScheduledPID(
+    const GainSchedule& schedule,
+    double TfTs,
+    double umin,
+    double umax,
+    double u0,
+    double b)
+    : schedule_(schedule),
+      controller_(0.0, 0.0, 0.0, TfTs, umin, umax, u0, b) {
+    double kp, ki, kd;
+    schedule_.lookup(-std::numeric_limits<double>::infinity(), kp, ki, kd);
+    controller_.set_gains(kp, ki, kd);
+}
+
+PIDStepResult GainScheduledPID::step(
+    double x,
+    double r,
+    double y,
+    double uff,
+    double uman,
+    double utrack,
+    double Tx,
+    bool track,
+    bool auto_mode,
+    WindupMode windup) {
+    double kp, ki, kd;
+    schedule_.lookup(x, kp, ki, kd);
+    controller_.set_gains(kp, ki, kd);
+    return controller_.step(r, y, uff, uman, utrack, Tx, track, auto_mode,
+                            windup);
+}
+
+void schedule_bank_gains(PIDBank& bank, const GainSchedule& schedule,
+                         const double* x) {
+    PIDGainTable& gains = bank.edit_gains();
+    schedule.lookup(bank.size(), x, gains.kp(), gains.ki(), gains.kd());
+    bank.publish_gains();
+}
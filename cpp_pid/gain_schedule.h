@@ -0,0 +1,230 @@
+/**
+ * @file gain_schedule.h
+ * @brief Gain scheduling with interpolated lookup tables
+ *
+ * This file provides a table of controller gains over an operating
+ * point variable, interpolated linearly between breakpoints, and a
+ * PID controller whose gains follow the table. Gain changes go through
+ * PIDController::set_gains, so scheduling does not bump the control
+ * signal. schedule_bank_gains() schedules every controller of a
+ * PIDBank at once through its gain tables.
+ */
+
+#ifndef GAIN_SCHEDULE_H
+#define GAIN_SCHEDULE_H
+
+#include "pid.h"
+#include "pid_bank.h"
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+/**
+ * @brief Gains kp, ki and kd as piecewise linear functions of an
+ *        operating point
+ *
+ * Between breakpoints the gains are interpolated linearly; below the
+ * first and above the last breakpoint they are held at the end values.
+ * When the breakpoints are evenly spaced the segment is found by
+ * scaling, otherwise by binary search. The breakpoints, gains and
+ * segment slopes are stored as separate arrays padded to whole cache
+ * lines, so the batch lookup streams through them.
+ */
+class GainSchedule {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param x Breakpoints of the operating point, strictly increasing
+     * @param kp Proportional gain at each breakpoint
+     * @param ki Integral gain at each breakpoint
+     * @param kd Derivative gain at each breakpoint
+     * @throws std::invalid_argument If the arrays are empty, differ in
+     *         length, or x is not strictly increasing and finite
+     */
+    GainSchedule(
+        const std::vector<double>& x,
+        const std::vector<double>& kp,
+        const std::vector<double>& ki,
+        const std::vector<double>& kd);
+
+    /**
+     * @brief Number of breakpoints
+     */
+    size_t size() const { return n_; }
+
+    /**
+     * @brief Whether the breakpoints are evenly spaced
+     */
+    bool uniform() const { return uniform_; }
+
+    /**
+     * @brief Gains at an operating point
+     *
+     * @param x Operating point (a NaN gives NaN gains)
+     * @param kp Interpolated proportional gain
+     * @param ki Interpolated integral gain
+     * @param kd Interpolated derivative gain
+     */
+    void lookup(double x, double& kp, double& ki, double& kd) const {
+        size_t k = segment(x);
+        double dx = clamp(x) - column(X)[k];
+        kp = column(KP)[k] + column(KP_SLOPE)[k] * dx;
+        ki = column(KI)[k] + column(KI_SLOPE)[k] * dx;
+        kd = column(KD)[k] + column(KD_SLOPE)[k] * dx;
+    }
+
+    /**
+     * @brief Gains at n operating points
+     *
+     * Same results as calling lookup() for each point, computed by the
+     * widest SIMD kernel the CPU supports (see PIDBank).
+     *
+     * @param n Number of operating points
+     * @param x Operating points
+     * @param kp Output proportional gains
+     * @param ki Output integral gains
+     * @param kd Output derivative gains
+     */
+    void lookup(size_t n, const double* x, double* kp, double* ki,
+                double* kd) const;
+
+private:
+    // Per-breakpoint arrays; the slopes are those of the segment that
+    // starts at the breakpoint, zero for the last one
+    enum Column {
+        X, KP, KI, KD, KP_SLOPE, KI_SLOPE, KD_SLOPE, NUM_COLUMNS
+    };
+
+    const double* column(Column c) const {
+        return storage_.data() + c * stride_;
+    }
+
+    // Operating point held to the breakpoint range
+    double clamp(double x) const {
+        return std::min(std::max(x, x_first_), x_last_);
+    }
+
+    // Index of the segment holding x
+    size_t segment(double x) const;
+
+    size_t n_;
+    size_t stride_;
+    std::vector<double> storage_;
+    double x_first_;
+    double x_last_;
+    bool uniform_;
+    double inverse_spacing_;
+};
+
+/**
+ * @brief PID controller with gains scheduled on an operating point
+ *
+ * Before each step, the gains are looked up at the operating point of
+ * the step and passed to PIDController::set_gains, which rescales the
+ * stored P and D terms. The control signal therefore follows the gain
+ * changes without bumps, and with a constant operating point the
+ * controller gives exactly the outputs of a PIDController with the
+ * gains at that point.
+ */
+class GainScheduledPID {
+public:
+    /**
+     * @brief Constructor
+     *
+     * The controller starts with the gains at the first breakpoint.
+     *
+     * @param schedule Gain schedule, copied into the controller
+     * @param TfTs Filter time constant as multiple of nominal sample
+     *             time (default: 10.0)
+     * @param umin Minimum control signal (default: -infinity)
+     * @param umax Maximum control signal (default: +infinity)
+     * @param u0 Bias term for P or PD control (default: 0.0)
+     * @param b Setpoint weight for proportional term (default: 1.0)
+     */
+    GainScheduledPID(
+        const GainSchedule& schedule,
+        double TfTs = 10.0,
+        double umin = -std::numeric_limits<double>::infinity(),
+        double umax = std::numeric_limits<double>::infinity(),
+        double u0 = 0.0,
+        double b = 1.0);
+
+    /**
+     * @brief Compute the control signal at an operating point
+     *
+     * @param x Operating point of this step
+     *
+     * Other arguments as for PIDController::operator().
+     *
+     * @return Control signal u
+     */
+    double operator()(
+        double x,
+        double r,
+        double y,
+        double uff = 0.0,
+        double uman = 0.0,
+        double utrack = 0.0,
+        double Tx = 1.0,
+        bool track = false,
+        bool auto_mode = true,
+        WindupMode windup = WindupMode::NONE) {
+        return step(x, r, y, uff, uman, utrack, Tx, track, auto_mode,
+                    windup).u;
+    }
+
+    /**
+     * @brief Compute the control signal with increments and saturation
+     *        flags at an operating point
+     *
+     * Arguments as for operator().
+     */
+    PIDStepResult step(
+        double x,
+        double r,
+        double y,
+        double uff = 0.0,
+        double uman = 0.0,
+        double utrack = 0.0,
+        double Tx = 1.0,
+        bool track = false,
+        bool auto_mode = true,
+        WindupMode windup = WindupMode::NONE);
+
+    /**
+     * @brief Gain schedule
+     */
+    const GainSchedule& schedule() const { return schedule_; }
+
+    /**
+     * @brief Scheduled controller, for options, limits and reset
+     */
+    PIDController& controller() { return controller_; }
+    const PIDController& controller() const { return controller_; }
+
+private:
+    GainSchedule schedule_;
+    PIDController controller_;
+};
+
+/**
+ * @brief Schedule the gains of every controller of a bank
+ *
+ * Looks up the gains at each controller's operating point, writes them
+ * into the bank's inactive gain table and publishes it, so the next
+ * PIDBank::step() uses them without bumps. Limits and filter time
+ * constants are kept. Call it from the thread that steps the bank,
+ * before each step; it gives the same outputs as one GainScheduledPID
+ * per controller.
+ *
+ * @param bank Bank to schedule
+ * @param schedule Gain schedule shared by all controllers
+ * @param x Operating point of each controller, bank.size() values
+ * @throws std::runtime_error If a gain table is already pending
+ */
+void schedule_bank_gains(PIDBank& bank, const GainSchedule& schedule,
+                         const double* x);
+
+#endif // GAIN_SCHEDULE_H
@@ -0,0 +1,19 @@
+/**
+ * @file host_device.h
+ * @brief Marker for functions compiled both as host and as device code
+ *
+ * Functions marked PID_HOST_DEVICE are plain inline functions in host
+ * builds and are also compiled for the GPU when the file is included
+ * from CUDA sources (see pid_sweep_gpu.cu).
+ */
+
+#ifndef HOST_DEVICE_H
+#define HOST_DEVICE_H
+
+#ifdef __CUDACC__
+#define PID_HOST_DEVICE __host__ __device__
+#else
+#define PID_HOST_DEVICE
+#endif
+
+#endif // HOST_DEVICE_H
@@ -0,0 +1,53 @@
+/**
+ * @file input_series.h
+ * @brief Column arrays of controller inputs for batch runs
+ */
+
+#ifndef INPUT_SERIES_H
+#define INPUT_SERIES_H
+
+#include "anti_windup.h"
+#include <cstddef>
+
+/**
+ * @brief Controller inputs for a series of time steps
+ *
+ * Each input is a column array with one element per time step. r and y
+ * are required. Any other column may be nullptr, in which case every
+ * step uses the default value of the corresponding PIDController
+ * argument (uff = uman = utrack = 0, Tx = 1, auto_mode = true,
+ * track = false, windup = NONE).
+ */
+struct InputSeries {
+    size_t n;                   ///< Number of time steps
+    const double* r;            ///< Reference (setpoint) signal
+    const double* y;            ///< Process measurement
+    const double* uff;          ///< Feedforward control signal
+    const double* uman;         ///< Manual mode control signal
+    const double* utrack;       ///< Tracking signal
+    const double* Tx;           ///< Execution period normalized
+    const bool* auto_mode;      ///< Automatic mode flag
+    const bool* track;          ///< Tracking mode flag
+    const WindupMode* windup;   ///< Windup status
+
+    /**
+     * @brief Constructor with optional columns set to nullptr
+     *
+     * @param n Number of time steps
+     * @param r Reference signal
+     * @param y Process measurement
+     */
+    InputSeries(size_t n, const double* r, const double* y)
+        : n(n),
+          r(r),
+          y(y),
+          uff(nullptr),
+          uman(nullptr),
+          utrack(nullptr),
+          Tx(nullptr),
+          auto_mode(nullptr),
+          track(nullptr),
+          windup(nullptr) {}
+};
+
+#endif // INPUT_SERIES_H
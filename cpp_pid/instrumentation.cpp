@@ -0,0 +1,292 @@
+/**
+ * @file instrumentation.cpp
+ * @brief Implementation of the controller probes
+ */
+
+#include "instrumentation.h"
+
+#ifdef PID_ENABLE_INSTRUMENTATION
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+const size_t EVENTS = static_cast<size_t>(PIDEvent::COUNT);
+
+// Probes per page of thread counters, allocated when first used
+const size_t PAGE_PROBES = 64;
+const size_t PAGES = PID_MAX_PROBES / PAGE_PROBES;
+
+// Counters of one probe in one thread
+struct Slot {
+    std::atomic<uint64_t> events[EVENTS];
+    std::atomic<uint64_t> latency[PID_LATENCY_BUCKETS];
+    std::atomic<uint64_t> cycles;
+};
+
+struct Page {
+    Slot slots[PAGE_PROBES];
+};
+
+// Counters of one thread, kept after the thread exits so that its
+// counts stay in the totals
+struct ThreadCounters {
+    std::atomic<Page*> pages[PAGES];
+    ThreadCounters* next;
+};
+
+std::atomic<ThreadCounters*> thread_list(nullptr);
+
+void clear(Slot& slot) {
+    for (size_t e = 0; e < EVENTS; ++e) {
+        slot.events[e].store(0, std::memory_order_relaxed);
+    }
+    for (size_t k = 0; k < PID_LATENCY_BUCKETS; ++k) {
+        slot.latency[k].store(0, std::memory_order_relaxed);
+    }
+    slot.cycles.store(0, std::memory_order_relaxed);
+}
+
+ThreadCounters& thread_counters() {
+    thread_local ThreadCounters* counters = nullptr;
+    if (!counters) {
+        counters = new ThreadCounters;
+        for (size_t p = 0; p < PAGES; ++p) {
+            counters->pages[p].store(nullptr, std::memory_order_relaxed);
+        }
+        counters->next = thread_list.load(std::memory_order_relaxed);
+        while (!thread_list.compare_exchange_weak(
+                   counters->next, counters, std::memory_order_release,
+                   std::memory_order_relaxed)) {
+        }
+    }
+    return *counters;
+}
+
+// Slot of a probe in the calling thread
+Slot& thread_slot(size_t id) {
+    std::atomic<Page*>& entry = thread_counters().pages[id / PAGE_PROBES];
+    Page* page = entry.load(std::memory_order_relaxed);
+    if (!page) {
+        page = new Page;
+        for (size_t i = 0; i < PAGE_PROBES; ++i) {
+            clear(page->slots[i]);
+        }
+        entry.store(page, std::memory_order_release);
+    }
+    return page->slots[id % PAGE_PROBES];
+}
+
+// Increment a counter written only by the calling thread
+inline void add(std::atomic<uint64_t>& counter, uint64_t value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value,
+                  std::memory_order_relaxed);
+}
+
+inline void add(Slot& slot, PIDEvent event) {
+    add(slot.events[static_cast<size_t>(event)], 1);
+}
+
+// Histogram bucket of a step time, floor(log2(cycles))
+size_t latency_bucket(uint64_t cycles) {
+    size_t k = 0;
+#if defined(__GNUC__)
+    k = cycles > 1 ? 63 - __builtin_clzll(cycles) : 0;
+#else
+    while (cycles > 1) {
+        cycles >>= 1;
+        ++k;
+    }
+#endif
+    return k < PID_LATENCY_BUCKETS ? k : PID_LATENCY_BUCKETS - 1;
+}
+
+// Probe indices, reused after their probe is destroyed. Function
+// statics so that probes of static controllers can be created during
+// static initialization.
+std::mutex& id_mutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+std::vector<size_t>& free_ids() {
+    static std::vector<size_t> ids;
+    return ids;
+}
+
+size_t next_id = 0;
+
+size_t allocate_id() {
+    std::lock_guard<std::mutex> lock(id_mutex());
+    size_t id;
+    if (!free_ids().empty()) {
+        id = free_ids().back();
+        free_ids().pop_back();
+    } else if (next_id < PID_MAX_PROBES) {
+        id = next_id++;
+    } else {
+        return PID_MAX_PROBES;
+    }
+
+    // Counts of the previous probe with this index
+    for (ThreadCounters* counters =
+             thread_list.load(std::memory_order_acquire);
+         counters; counters = counters->next) {
+        Page* page = counters->pages[id / PAGE_PROBES].load(
+            std::memory_order_acquire);
+        if (page) {
+            clear(page->slots[id % PAGE_PROBES]);
+        }
+    }
+    return id;
+}
+
+void release_id(size_t id) {
+    if (id < PID_MAX_PROBES) {
+        std::lock_guard<std::mutex> lock(id_mutex());
+        free_ids().push_back(id);
+    }
+}
+
+} // namespace
+
+uint64_t pid_clock_nanoseconds() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+double pid_cycle_seconds() {
+    static const double seconds = [] {
+        typedef std::chrono::steady_clock clock;
+        clock::time_point start = clock::now();
+        uint64_t start_cycles = pid_cycles();
+        clock::time_point end;
+        do {
+            end = clock::now();
+        } while (end - start < std::chrono::milliseconds(10));
+        uint64_t cycles = pid_cycles() - start_cycles;
+        double elapsed = std::chrono::duration<double>(end - start).count();
+        return cycles > 0 ? elapsed / cycles : 0.0;
+    }();
+    return seconds;
+}
+
+uint64_t PIDProbeStats::quantile_cycles(double q) const {
+    uint64_t total = 0;
+    for (size_t k = 0; k < PID_LATENCY_BUCKETS; ++k) {
+        total += latency[k];
+    }
+    if (total == 0) {
+        return 0;
+    }
+    double target = q * static_cast<double>(total);
+    uint64_t cumulative = 0;
+    for (size_t k = 0; k < PID_LATENCY_BUCKETS; ++k) {
+        cumulative += latency[k];
+        if (static_cast<double>(cumulative) >= target && latency[k] > 0) {
+            return uint64_t(2) << k;
+        }
+    }
+    return uint64_t(2) << (PID_LATENCY_BUCKETS - 1);
+}
+
+PIDProbe::PIDProbe()
+    : id_(allocate_id()),
+      has_last_(false),
+      last_auto_(true),
+      last_track_(false) {}
+
+PIDProbe::PIDProbe(const PIDProbe& other)
+    : id_(allocate_id()),
+      has_last_(other.has_last_),
+      last_auto_(other.last_auto_),
+      last_track_(other.last_track_) {}
+
+PIDProbe& PIDProbe::operator=(const PIDProbe& other) {
+    // Keep this probe's index and counters
+    has_last_ = other.has_last_;
+    last_auto_ = other.last_auto_;
+    last_track_ = other.last_track_;
+    return *this;
+}
+
+PIDProbe::~PIDProbe() {
+    release_id(id_);
+}
+
+void PIDProbe::record(const PIDStepResult& result, double Dui_unclamped,
+                      bool rediscretized, bool track, bool auto_mode,
+                      uint64_t cycles) {
+    if (id_ >= PID_MAX_PROBES) {
+        return;
+    }
+    Slot& slot = thread_slot(id_);
+
+    // Tracking only takes effect in automatic mode
+    bool tracking = track && auto_mode;
+    add(slot, PIDEvent::STEP);
+    if (rediscretized) {
+        add(slot, PIDEvent::REDISCRETIZATION);
+    }
+    if (result.saturation & SATURATED_HIGH) {
+        add(slot, PIDEvent::SATURATION_HIGH);
+    }
+    if (result.saturation & SATURATED_LOW) {
+        add(slot, PIDEvent::SATURATION_LOW);
+    }
+    if (has_last_ && auto_mode != last_auto_) {
+        add(slot, PIDEvent::MODE_CHANGE);
+    }
+    if (tracking && !(has_last_ && last_track_)) {
+        add(slot, PIDEvent::TRACK_ENTRY);
+    }
+    if (result.Dui != Dui_unclamped) {
+        add(slot, PIDEvent::WINDUP_CLAMP);
+    }
+    add(slot.latency[latency_bucket(cycles)], 1);
+    add(slot.cycles, cycles);
+
+    has_last_ = true;
+    last_auto_ = auto_mode;
+    last_track_ = tracking;
+}
+
+PIDProbeStats PIDProbe::stats() const {
+    PIDProbeStats stats;
+    for (size_t e = 0; e < EVENTS; ++e) {
+        stats.events[e] = 0;
+    }
+    for (size_t k = 0; k < PID_LATENCY_BUCKETS; ++k) {
+        stats.latency[k] = 0;
+    }
+    stats.cycles = 0;
+    if (id_ >= PID_MAX_PROBES) {
+        return stats;
+    }
+
+    for (ThreadCounters* counters =
+             thread_list.load(std::memory_order_acquire);
+         counters; counters = counters->next) {
+        Page* page = counters->pages[id_ / PAGE_PROBES].load(
+            std::memory_order_acquire);
+        if (!page) {
+            continue;
+        }
+        const Slot& slot = page->slots[id_ % PAGE_PROBES];
+        for (size_t e = 0; e < EVENTS; ++e) {
+            stats.events[e] += slot.events[e].load(std::memory_order_relaxed);
+        }
+        for (size_t k = 0; k < PID_LATENCY_BUCKETS; ++k) {
+            stats.latency[k] +=
+                slot.latency[k].load(std::memory_order_relaxed);
+        }
+        stats.cycles += slot.cycles.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+#endif // PID_ENABLE_INSTRUMENTATION
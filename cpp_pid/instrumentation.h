@@ -0,0 +1,183 @@
+/**
+ * @file instrumentation.h
+ * @brief Event counters and step timing for controllers
+ *
+ * This file provides probes that count controller events (saturated
+ * samples, rediscretizations, mode changes, windup clamps) and record a
+ * histogram of step times in CPU timestamp counter cycles. It is only
+ * compiled when PID_ENABLE_INSTRUMENTATION is defined; without it the
+ * controllers contain no instrumentation code or members. It requires
+ * thread_local and std::atomic and is meant for hosted platforms.
+ */
+
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#ifdef PID_ENABLE_INSTRUMENTATION
+
+#include "basic_pid.h"
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+/**
+ * @brief Controller event counted by a probe
+ */
+enum class PIDEvent {
+    STEP,                ///< Controller steps
+    REDISCRETIZATION,    ///< Filter rediscretizations
+    SATURATION_HIGH,     ///< Steps with u at umax
+    SATURATION_LOW,      ///< Steps with u at umin
+    MODE_CHANGE,         ///< Switches between automatic and manual
+    TRACK_ENTRY,         ///< Steps entering tracking mode
+    WINDUP_CLAMP,        ///< Steps where anti-windup changed Dui
+    COUNT                ///< Number of events
+};
+
+/**
+ * @brief Number of buckets of the step time histogram
+ *
+ * Bucket k counts steps of 2^k to 2^(k+1) - 1 cycles (bucket 0 also
+ * counts 0 cycles), and the last bucket counts everything longer.
+ */
+const size_t PID_LATENCY_BUCKETS = 32;
+
+/**
+ * @brief Largest number of probes alive at the same time
+ *
+ * Probes beyond this count record nothing.
+ */
+const size_t PID_MAX_PROBES = 65536;
+
+/**
+ * @brief Monotonic clock in nanoseconds, the fallback of pid_cycles()
+ */
+uint64_t pid_clock_nanoseconds();
+
+/**
+ * @brief Read the CPU timestamp counter
+ *
+ * Uses rdtsc on x86, the virtual counter on AArch64 and a monotonic
+ * clock in nanoseconds elsewhere.
+ */
+inline uint64_t pid_cycles() {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t value;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+    return value;
+#else
+    return pid_clock_nanoseconds();
+#endif
+}
+
+/**
+ * @brief Seconds per pid_cycles() tick
+ *
+ * Measured once against a monotonic clock over about 10 ms, on the
+ * first call.
+ */
+double pid_cycle_seconds();
+
+/**
+ * @brief Counters of one probe summed over all threads
+ */
+struct PIDProbeStats {
+    uint64_t events[static_cast<size_t>(PIDEvent::COUNT)];
+    uint64_t latency[PID_LATENCY_BUCKETS];  ///< Step time histogram
+    uint64_t cycles;                        ///< Total step cycles
+
+    /**
+     * @brief Count of one event
+     */
+    uint64_t count(PIDEvent event) const {
+        return events[static_cast<size_t>(event)];
+    }
+
+    /**
+     * @brief Mean step time in cycles (zero before the first step)
+     */
+    double mean_cycles() const {
+        uint64_t steps = count(PIDEvent::STEP);
+        return steps > 0 ? static_cast<double>(cycles) / steps : 0.0;
+    }
+
+    /**
+     * @brief Upper bound in cycles of a quantile of the step time
+     *
+     * @param q Quantile in [0, 1], for example 0.99
+     * @return 2^(k+1) for the histogram bucket k holding the quantile
+     */
+    uint64_t quantile_cycles(double q) const;
+};
+
+/**
+ * @brief Event counters and step timing of one controller
+ *
+ * Each thread that records into a probe writes its own copy of the
+ * counters, with plain relaxed loads and stores, so recording takes no
+ * lock and no read-modify-write instruction. stats() sums the copies
+ * of all threads, including threads that have exited, and may be
+ * called from any thread while others record.
+ *
+ * A probe also remembers the mode and tracking flags of the last step
+ * to detect transitions, so one controller's steps should come from
+ * one thread at a time. Copies of a probe start with zero counters.
+ */
+class PIDProbe {
+public:
+    PIDProbe();
+    PIDProbe(const PIDProbe& other);
+    PIDProbe& operator=(const PIDProbe& other);
+    ~PIDProbe();
+
+    /**
+     * @brief Record one controller step
+     *
+     * @param result Result of the step
+     * @param Dui_unclamped Integral increment before anti-windup
+     * @param rediscretized Whether the filter was rediscretized
+     * @param track Tracking mode flag of the step
+     * @param auto_mode Automatic mode flag of the step
+     * @param cycles Duration of the step in pid_cycles() ticks
+     */
+    void record(const PIDStepResult& result, double Dui_unclamped,
+                bool rediscretized, bool track, bool auto_mode,
+                uint64_t cycles);
+
+    /**
+     * @brief Counters summed over all threads
+     */
+    PIDProbeStats stats() const;
+
+    /**
+     * @brief Forget the mode of the last step
+     *
+     * Called when the controller is reset, so the next step is not
+     * counted as a transition.
+     */
+    void reset_transitions() { has_last_ = false; }
+
+    /**
+     * @brief Probe index, or PID_MAX_PROBES if no index was free
+     */
+    size_t id() const { return id_; }
+
+private:
+    size_t id_;
+    bool has_last_;
+    bool last_auto_;
+    bool last_track_;
+};
+
+#endif // PID_ENABLE_INSTRUMENTATION
+
+#endif // INSTRUMENTATION_H
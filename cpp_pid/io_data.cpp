@@ -0,0 +1,318 @@
+/**
+ * @file io_data.cpp
+ * @brief Implementation of the I/O data file readers
+ */
+
+#include "io_data.h"
+#include "file_view.h"
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+#endif
+
+#if defined(__cpp_lib_to_chars)
+#define IO_DATA_FROM_CHARS 1
+#endif
+
+namespace {
+
+const char* const INPUT_COLUMNS[] = {
+    "r", "y", "uff", "uman", "utrack", "Tx", "auto", "track"
+};
+const size_t NUM_INPUT_COLUMNS = 8;
+
+// Size of the IODataReader buffer, which bounds the line length
+const size_t READER_BUFFER_SIZE = 1 << 20;
+
+[[noreturn]] void fail(
+    const std::string& path, size_t line, const std::string& message) {
+    throw std::runtime_error(
+        path + ":" + std::to_string(line) + ": " + message);
+}
+
+// End of a line excluding a trailing carriage return
+const char* content_end(const char* p, const char* line_end) {
+    return line_end > p && line_end[-1] == '\r' ? line_end - 1 : line_end;
+}
+
+const char* find_line_end(const char* p, const char* end) {
+    const char* le = static_cast<const char*>(std::memchr(p, '\n', end - p));
+    return le ? le : end;
+}
+
+const char* find_field_end(const char* p, const char* end) {
+    const char* fe = static_cast<const char*>(std::memchr(p, ',', end - p));
+    return fe ? fe : end;
+}
+
+// Parse a double occupying all of [p, end)
+bool parse_double(const char* p, const char* end, double& x) {
+#ifdef IO_DATA_FROM_CHARS
+    std::from_chars_result result = std::from_chars(p, end, x);
+    return result.ec == std::errc() && result.ptr == end;
+#else
+    // strtod needs a terminated string; numbers are short
+    char buf[64];
+    size_t len = static_cast<size_t>(end - p);
+    if (len == 0 || len >= sizeof(buf)) {
+        return false;
+    }
+    std::memcpy(buf, p, len);
+    buf[len] = '\0';
+    char* parsed;
+    x = std::strtod(buf, &parsed);
+    return parsed == buf + len;
+#endif
+}
+
+// Parse true/false in any case, or 1/0, occupying all of [p, end)
+bool parse_bool(const char* p, const char* end, bool& b) {
+    size_t len = static_cast<size_t>(end - p);
+    const char* words[] = {"true", "false"};
+    for (int w = 0; w < 2; ++w) {
+        if (len != std::strlen(words[w])) {
+            continue;
+        }
+        bool match = true;
+        for (size_t k = 0; k < len && match; ++k) {
+            char c = p[k];
+            match = (c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c) == words[w][k];
+        }
+        if (match) {
+            b = w == 0;
+            return true;
+        }
+    }
+    if (len == 1 && (*p == '0' || *p == '1')) {
+        b = *p == '1';
+        return true;
+    }
+    return false;
+}
+
+// Parse the header line [p, line_end) and return whether it has u
+bool parse_header(
+    const char* p, const char* line_end, const std::string& path) {
+    const char* end = content_end(p, line_end);
+    size_t column = 0;
+    bool has_u = false;
+    while (p <= end) {
+        const char* fe = find_field_end(p, end);
+        std::string name(p, fe);
+        if (column < NUM_INPUT_COLUMNS && name == INPUT_COLUMNS[column]) {
+            ++column;
+        } else if (column == NUM_INPUT_COLUMNS && !has_u && name == "u") {
+            has_u = true;
+        } else {
+            fail(path, 1, "unexpected column '" + name + "' in header");
+        }
+        p = fe + 1;
+    }
+    if (column < NUM_INPUT_COLUMNS) {
+        fail(path, 1, "missing columns in header");
+    }
+    return has_u;
+}
+
+// Parse one row [p, line_end) into row i of data; false for blank lines
+bool parse_row(
+    const char* p,
+    const char* line_end,
+    IOData& data,
+    size_t i,
+    const std::string& path,
+    size_t line) {
+    const char* end = content_end(p, line_end);
+    if (p == end) {
+        return false;
+    }
+
+    double* doubles[] = {
+        &data.r[i], &data.y[i], &data.uff[i], &data.uman[i],
+        &data.utrack[i], &data.Tx[i]
+    };
+    bool* bools[] = {&data.auto_mode[i], &data.track[i]};
+    size_t columns = data.has_u ? NUM_INPUT_COLUMNS + 1 : NUM_INPUT_COLUMNS;
+
+    for (size_t column = 0; column < columns; ++column) {
+        const char* fe = find_field_end(p, end);
+        bool last = column + 1 == columns;
+        if ((fe == end) != last) {
+            fail(path, line, last ? "too many columns" : "too few columns");
+        }
+        bool ok;
+        if (column < 6) {
+            ok = parse_double(p, fe, *doubles[column]);
+        } else if (column < 8) {
+            ok = parse_bool(p, fe, *bools[column - 6]);
+        } else {
+            ok = parse_double(p, fe, data.u[i]);
+        }
+        if (!ok) {
+            const char* name = column < NUM_INPUT_COLUMNS
+                ? INPUT_COLUMNS[column] : "u";
+            fail(path, line, std::string("invalid value for ") + name
+                 + ": '" + std::string(p, fe) + "'");
+        }
+        p = fe + 1;
+    }
+    return true;
+}
+
+} // namespace
+
+void IOData::allocate(size_t rows) {
+    n = rows;
+    r.resize(rows);
+    y.resize(rows);
+    uff.resize(rows);
+    uman.resize(rows);
+    utrack.resize(rows);
+    Tx.resize(rows);
+    auto_mode.reset(new bool[rows]);
+    track.reset(new bool[rows]);
+    u.resize(has_u ? rows : 0);
+}
+
+InputSeries IOData::inputs() const {
+    InputSeries inputs(n, r.data(), y.data());
+    inputs.uff = uff.data();
+    inputs.uman = uman.data();
+    inputs.utrack = utrack.data();
+    inputs.Tx = Tx.data();
+    inputs.auto_mode = auto_mode.get();
+    inputs.track = track.get();
+    return inputs;
+}
+
+IOData load_io_data(const std::string& path) {
+    FileView file(path);
+    const char* p = file.data();
+    const char* end = p + file.size();
+    if (p == end) {
+        fail(path, 1, "missing header");
+    }
+
+    IOData data;
+    const char* le = find_line_end(p, end);
+    data.has_u = parse_header(p, le, path);
+    p = le < end ? le + 1 : end;
+
+    // Allocate for the number of lines, then trim blank lines
+    size_t lines = 0;
+    for (const char* q = p; q < end; q = find_line_end(q, end) + 1) {
+        ++lines;
+    }
+    data.allocate(lines);
+
+    size_t i = 0;
+    size_t line = 1;
+    while (p < end) {
+        le = find_line_end(p, end);
+        ++line;
+        if (parse_row(p, le, data, i, path, line)) {
+            ++i;
+        }
+        p = le < end ? le + 1 : end;
+    }
+    data.n = i;
+    return data;
+}
+
+IODataReader::IODataReader(const std::string& path, size_t chunk_rows)
+    : path_(path),
+      file_(std::fopen(path.c_str(), "rb")),
+      buffer_(READER_BUFFER_SIZE),
+      begin_(0),
+      end_(0),
+      eof_(false),
+      line_(1),
+      rows_read_(0) {
+    if (!file_) {
+        throw std::runtime_error("Could not open file: " + path);
+    }
+
+    try {
+        // Read until the header line is complete
+        const char* le;
+        for (;;) {
+            const char* p = buffer_.data() + begin_;
+            const char* end = buffer_.data() + end_;
+            le = find_line_end(p, end);
+            if (le < end || (eof_ && p < end)) {
+                break;
+            }
+            if (eof_) {
+                fail(path, 1, "missing header");
+            }
+            fill();
+        }
+        chunk_.has_u = parse_header(buffer_.data() + begin_, le, path);
+        begin_ = static_cast<size_t>(le - buffer_.data())
+            + (le < buffer_.data() + end_ ? 1 : 0);
+    } catch (...) {
+        std::fclose(file_);
+        throw;
+    }
+    chunk_.allocate(chunk_rows);
+    chunk_.n = 0;
+}
+
+IODataReader::~IODataReader() {
+    if (file_) {
+        std::fclose(file_);
+    }
+}
+
+bool IODataReader::fill() {
+    // Move the partial line to the front of the buffer
+    size_t remaining = end_ - begin_;
+    if (remaining == buffer_.size()) {
+        fail(path_, line_ + 1, "line too long");
+    }
+    std::memmove(buffer_.data(), buffer_.data() + begin_, remaining);
+    begin_ = 0;
+    end_ = remaining;
+
+    size_t count = std::fread(
+        buffer_.data() + end_, 1, buffer_.size() - end_, file_);
+    end_ += count;
+    if (count == 0) {
+        eof_ = true;
+    }
+    return count > 0;
+}
+
+bool IODataReader::next() {
+    size_t capacity = chunk_.r.size();
+    size_t i = 0;
+    while (i < capacity) {
+        const char* p = buffer_.data() + begin_;
+        const char* end = buffer_.data() + end_;
+        const char* le = find_line_end(p, end);
+        if (le == end) {
+            // Incomplete line: read more, or take it as the last line
+            if (!eof_) {
+                fill();
+                continue;
+            }
+            if (p == end) {
+                break;
+            }
+        }
+        ++line_;
+        if (parse_row(p, le, chunk_, i, path_, line_)) {
+            ++i;
+        }
+        begin_ = static_cast<size_t>(le - buffer_.data())
+            + (le < end ? 1 : 0);
+    }
+    chunk_.n = i;
+    rows_read_ += i;
+    return i > 0;
+}
@@ -0,0 +1,137 @@
+/**
+ * @file io_data.h
+ * @brief Reader for controller I/O data files
+ *
+ * This file provides readers for the CSV files of controller inputs
+ * and outputs used by the tests and for replaying recorded data, with
+ * the columns r, y, uff, uman, utrack, Tx, auto, track and optionally
+ * u. Files are parsed straight into column arrays that can be passed
+ * to PIDController::run.
+ */
+
+#ifndef IO_DATA_H
+#define IO_DATA_H
+
+#include "input_series.h"
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Controller I/O data in column arrays
+ */
+struct IOData {
+    size_t n;      ///< Number of rows
+    bool has_u;    ///< Whether the file has the u column
+
+    std::vector<double> r;
+    std::vector<double> y;
+    std::vector<double> uff;
+    std::vector<double> uman;
+    std::vector<double> utrack;
+    std::vector<double> Tx;
+    std::unique_ptr<bool[]> auto_mode;
+    std::unique_ptr<bool[]> track;
+    std::vector<double> u;  ///< Recorded control signal (if has_u)
+
+    IOData() : n(0), has_u(false) {}
+
+    /**
+     * @brief Allocate all columns for a number of rows
+     *
+     * @param rows Number of rows to allocate
+     */
+    void allocate(size_t rows);
+
+    /**
+     * @brief Input columns for PIDController::run
+     *
+     * @return InputSeries pointing into this object's columns
+     */
+    InputSeries inputs() const;
+};
+
+/**
+ * @brief Load a complete I/O data file
+ *
+ * The file is memory mapped (read into one buffer on platforms without
+ * mmap), its rows are counted, and the values are parsed directly into
+ * columns allocated once. The header must start with
+ * r,y,uff,uman,utrack,Tx,auto,track and may end with u. Booleans are
+ * true or false in any case, or 1 or 0.
+ *
+ * @param path Path to the CSV file
+ * @return Parsed data
+ * @throws std::runtime_error If the file cannot be read or is malformed
+ */
+IOData load_io_data(const std::string& path);
+
+/**
+ * @brief Chunked reader for large I/O data files
+ *
+ * Reads a file through a fixed-size buffer and parses it into a chunk
+ * of at most chunk_rows rows, which next() overwrites each time, so
+ * memory use does not depend on the file size:
+ *
+ * @code
+ * IODataReader reader("replay.csv");
+ * while (reader.next()) {
+ *     controller.run(reader.chunk().inputs(), u);
+ * }
+ * @endcode
+ */
+class IODataReader {
+public:
+    /**
+     * @brief Open a file and read its header
+     *
+     * @param path Path to the CSV file
+     * @param chunk_rows Maximum number of rows per chunk (default:
+     *                   65536)
+     * @throws std::runtime_error If the file cannot be opened or the
+     *         header is invalid
+     */
+    explicit IODataReader(const std::string& path,
+                          size_t chunk_rows = 65536);
+
+    ~IODataReader();
+
+    IODataReader(const IODataReader&) = delete;
+    IODataReader& operator=(const IODataReader&) = delete;
+
+    /**
+     * @brief Parse the next chunk of rows
+     *
+     * @return false when the end of the file has been reached
+     * @throws std::runtime_error If a row is malformed
+     */
+    bool next();
+
+    /**
+     * @brief Rows parsed by the last call to next()
+     */
+    const IOData& chunk() const { return chunk_; }
+
+    /**
+     * @brief Total number of rows parsed so far
+     */
+    size_t rows_read() const { return rows_read_; }
+
+private:
+    // Refill the buffer, keeping unparsed bytes; false if no new data
+    bool fill();
+
+    std::string path_;
+    std::FILE* file_;
+    std::vector<char> buffer_;
+    size_t begin_;
+    size_t end_;
+    bool eof_;
+    size_t line_;
+    size_t rows_read_;
+    IOData chunk_;
+};
+
+#endif // IO_DATA_H
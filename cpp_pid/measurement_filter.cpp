@@ -4,8 +4,10 @@
  */
 
 #include "measurement_filter.h"
+#include "zoh_cache.h"
+#include <cmath>
 
-MeasurementFilter::MeasurementFilter(double TfTs)
+MeasurementFilter::MeasurementFilter(double TfTs, ZohMethod method)
     : TfTs_(TfTs),
       a11_(0.0),
       a12_(0.0),
@@ -16,12 +18,16 @@ MeasurementFilter::MeasurementFilter(double TfTs)
       yf_(0.0),
       dyf_(0.0),
       Tx_old_(std::numeric_limits<double>::quiet_NaN()),
-      initialized_(false) {}
+      initialized_(false),
+      cache_(nullptr),
+      method_(method),
+      Tx_ref_(std::numeric_limits<double>::quiet_NaN()),
+      h2_ref_(0.0) {}
 
 FilterOutput MeasurementFilter::operator()(double y, double Tx) {
     // Rediscretize to match execution period
     if (!initialized_ || Tx != Tx_old_) {
-        FilterParams params = zoh_Fy(TfTs_, Tx);
+        FilterParams params = discretize(Tx);
         a11_ = params.a11;
         a12_ = params.a12;
         a21_ = params.a21;
@@ -43,6 +49,82 @@ FilterOutput MeasurementFilter::operator()(double y, double Tx) {
     return output;
 }
 
+FilterParams MeasurementFilter::discretize(double Tx) {
+    if (cache_) {
+        return cache_->lookup(TfTs_, Tx);
+    }
+
+    if (method_ == ZohMethod::INCREMENTAL) {
+        // Rescale from the reference period while it is close enough,
+        // otherwise make Tx the new reference
+        if (std::abs(Tx - Tx_ref_) <= ZOH_INCREMENTAL_RANGE * TfTs_) {
+            return zoh_Fy_incremental(TfTs_, Tx, Tx_ref_, h2_ref_);
+        }
+        FilterParams params = zoh_Fy(TfTs_, Tx, ZohMethod::POLYNOMIAL);
+        Tx_ref_ = Tx;
+        h2_ref_ = params.a12;
+        return params;
+    }
+
+    return zoh_Fy(TfTs_, Tx, method_);
+}
+
+void MeasurementFilter::set_method(ZohMethod method) {
+    method_ = method;
+    Tx_ref_ = std::numeric_limits<double>::quiet_NaN();
+    initialized_ = false;
+}
+
+void MeasurementFilter::set_TfTs(double TfTs) {
+    if (TfTs != TfTs_) {
+        TfTs_ = TfTs;
+        Tx_ref_ = std::numeric_limits<double>::quiet_NaN();
+        initialized_ = false;
+    }
+}
+
+FilterParams MeasurementFilter::params() const {
+    FilterParams params;
+    params.a11 = a11_;
+    params.a12 = a12_;
+    params.a21 = a21_;
+    params.a22 = a22_;
+    params.b1 = b1_;
+    params.b2 = b2_;
+    return params;
+}
+
+void MeasurementFilter::set_state(const FilterOutput& state) {
+    yf_ = state.yf;
+    dyf_ = state.dyf;
+}
+
+FilterState MeasurementFilter::snapshot() const {
+    FilterState state;
+    state.yf = yf_;
+    state.dyf = dyf_;
+    state.Tx_old = Tx_old_;
+    state.initialized = initialized_;
+    return state;
+}
+
+void MeasurementFilter::restore(const FilterState& state) {
+    yf_ = state.yf;
+    dyf_ = state.dyf;
+    Tx_old_ = state.Tx_old;
+    initialized_ = false;
+    if (state.initialized) {
+        FilterParams params = discretize(Tx_old_);
+        a11_ = params.a11;
+        a12_ = params.a12;
+        a21_ = params.a21;
+        a22_ = params.a22;
+        b1_ = params.b1;
+        b2_ = params.b2;
+        initialized_ = true;
+    }
+}
+
 void MeasurementFilter::reset() {
     yf_ = 0.0;
     dyf_ = 0.0;
@@ -13,12 +13,32 @@
 #include "zoh_pid.h"
 #include <limits>
 
+class ZohCache;
+
 /**
  * @brief Measurement filter output structure
+ *
+ * @tparam T Scalar type of the filter
+ */
+template <class T>
+struct BasicFilterOutput {
+    T yf;   ///< Filtered output
+    T dyf;  ///< Filtered derivative
+};
+
+/**
+ * @brief Measurement filter output in double precision
  */
-struct FilterOutput {
-    double yf;   ///< Filtered output
-    double dyf;  ///< Filtered derivative
+typedef BasicFilterOutput<double> FilterOutput;
+
+/**
+ * @brief State of a MeasurementFilter, for snapshot and restore
+ */
+struct FilterState {
+    double yf;         ///< Filtered output
+    double dyf;        ///< Filtered derivative
+    double Tx_old;     ///< Last execution period (NaN before the first call)
+    bool initialized;  ///< Whether the parameters are those of Tx_old
 };
 
 /**
@@ -36,8 +56,11 @@ public:
      *
      * @param TfTs Filter time constant as a multiple of nominal sample
      *             time (default: 10.0)
+     * @param method Method used to evaluate exp during
+     *               rediscretization (default: EXACT)
      */
-    explicit MeasurementFilter(double TfTs = 10.0);
+    explicit MeasurementFilter(
+        double TfTs = 10.0, ZohMethod method = ZohMethod::EXACT);
 
     /**
      * @brief Apply the filter to a measurement
@@ -53,7 +76,101 @@ public:
      */
     void reset();
 
+    /**
+     * @brief Use a cache for rediscretization
+     *
+     * The cache is not owned by the filter and must outlive it. Several
+     * filters may share one cache.
+     *
+     * @param cache Discretization cache, or nullptr to call zoh_Fy
+     *              directly (default)
+     */
+    void set_cache(ZohCache* cache) { cache_ = cache; }
+
+    /**
+     * @brief Select the rediscretization method
+     *
+     * With INCREMENTAL, the filter computes exp(-Tx/TfTs) once with
+     * zoh_exp for a reference period and rescales it with
+     * zoh_Fy_incremental while Tx stays within ZOH_INCREMENTAL_RANGE *
+     * TfTs of the reference. A cache, if set, takes precedence.
+     *
+     * @param method Method used to evaluate exp
+     */
+    void set_method(ZohMethod method);
+
+    /**
+     * @brief Change the filter time constant
+     *
+     * The filter state is kept. The filter is rediscretized on the next
+     * call, and only if TfTs differs from the current value.
+     *
+     * @param TfTs Filter time constant as a multiple of nominal sample
+     *             time
+     */
+    void set_TfTs(double TfTs);
+
+    /**
+     * @brief Filter time constant as a multiple of nominal sample time
+     */
+    double TfTs() const { return TfTs_; }
+
+    /**
+     * @brief Whether a call with Tx rediscretizes the filter
+     */
+    bool needs_discretization(double Tx) const {
+        return !initialized_ || Tx != Tx_old_;
+    }
+
+    /**
+     * @brief Current filter parameters (zero before the first call)
+     */
+    FilterParams params() const;
+
+    /**
+     * @brief Current filtered output and derivative
+     */
+    FilterOutput state() const {
+        FilterOutput output;
+        output.yf = yf_;
+        output.dyf = dyf_;
+        return output;
+    }
+
+    /**
+     * @brief Set the filtered output and derivative
+     *
+     * The filter parameters and the last execution period are kept, so
+     * the filter continues from the given state without
+     * rediscretizing.
+     *
+     * @param state Filtered output and derivative
+     */
+    void set_state(const FilterOutput& state);
+
+    /**
+     * @brief Complete filter state, for restore() on another filter
+     */
+    FilterState snapshot() const;
+
+    /**
+     * @brief Continue from a snapshot
+     *
+     * The filter must have the same TfTs, method and cache as the one
+     * the snapshot was taken from. The parameters for Tx_old are
+     * recomputed here, so the next steps give the same outputs bit for
+     * bit with the EXACT and POLYNOMIAL methods or a cache. With
+     * INCREMENTAL they can differ by rounding, since the parameters
+     * depend on the reference period of each filter.
+     *
+     * @param state Snapshot of a filter
+     */
+    void restore(const FilterState& state);
+
 private:
+    // Filter parameters for an execution period
+    FilterParams discretize(double Tx);
+
     // Filter time constant parameter
     double TfTs_;
 
@@ -72,6 +189,100 @@ private:
 
     // Flag to track if filter has been initialized
     bool initialized_;
+
+    // Optional discretization cache (not owned)
+    ZohCache* cache_;
+
+    // Rediscretization method and reference point for INCREMENTAL
+    ZohMethod method_;
+    double Tx_ref_;
+    double h2_ref_;
+};
+
+/**
+ * @brief Measurement filter with a selectable scalar type
+ *
+ * Same filter as MeasurementFilter with the state and coefficients
+ * stored in T, for example float or a FixedPoint type. Rediscretization
+ * is computed in double precision by zoh_Fy and rounded to T, so it
+ * needs floating-point support but runs only when Tx changes; at a
+ * fixed execution period every step uses T arithmetic only. There is
+ * no cache or method selection.
+ *
+ * @tparam T Scalar type, constructible from double
+ */
+template <class T>
+class BasicMeasurementFilter {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param TfTs Filter time constant as a multiple of nominal sample
+     *             time (default: 10.0)
+     */
+    explicit BasicMeasurementFilter(double TfTs = 10.0)
+        : TfTs_(TfTs),
+          Tx_old_(1.0),
+          params_(convert_filter_params<T>(zoh_Fy(TfTs, 1.0))) {
+        reset();
+    }
+
+    /**
+     * @brief Apply the filter to a measurement
+     *
+     * @param y Process measurement
+     * @param Tx Execution period (normalized, default: 1.0)
+     * @return Filtered output and derivative
+     */
+    BasicFilterOutput<T> operator()(T y, double Tx = 1.0) {
+        if (Tx != Tx_old_) {
+            params_ = convert_filter_params<T>(zoh_Fy(TfTs_, Tx));
+            Tx_old_ = Tx;
+        }
+
+        // State update
+        T yf_prev = yf_;
+        yf_ = params_.a11 * yf_prev + params_.a12 * dyf_ + params_.b1 * y;
+        dyf_ = params_.a21 * yf_prev + params_.a22 * dyf_ + params_.b2 * y;
+
+        BasicFilterOutput<T> output = {yf_, dyf_};
+        return output;
+    }
+
+    /**
+     * @brief Reset the filter state to zero
+     */
+    void reset() {
+        yf_ = T(0.0);
+        dyf_ = T(0.0);
+    }
+
+    /**
+     * @brief Current filter parameters
+     */
+    const BasicFilterParams<T>& params() const { return params_; }
+
+private:
+    double TfTs_;
+    double Tx_old_;
+    BasicFilterParams<T> params_;
+    T yf_;
+    T dyf_;
+};
+
+/**
+ * @brief Measurement filter class used for a scalar type
+ *
+ * MeasurementFilter for double, BasicMeasurementFilter otherwise.
+ */
+template <class T>
+struct MeasurementFilterFor {
+    typedef BasicMeasurementFilter<T> type;
+};
+
+template <>
+struct MeasurementFilterFor<double> {
+    typedef MeasurementFilter type;
 };
 
 #endif // MEASUREMENT_FILTER_H
@@ -0,0 +1,293 @@
+/**
+ * @file partitioned_bank.cpp
+ * @brief Implementation of the NUMA-partitioned controller bank
+ */
+
+#include "partitioned_bank.h"
+#include "rate_scheduler.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+// Shards hold whole 64-byte lines of the signal arrays
+const size_t LINE_DOUBLES = 8;
+
+size_t parse_cpu(const std::string& list, size_t& pos) {
+    size_t begin = pos;
+    while (pos < list.size() && list[pos] >= '0' && list[pos] <= '9') {
+        ++pos;
+    }
+    if (pos == begin) {
+        throw std::invalid_argument("Invalid CPU list: " + list);
+    }
+    return static_cast<size_t>(
+        std::strtoul(list.substr(begin, pos - begin).c_str(), nullptr, 10));
+}
+
+} // namespace
+
+std::vector<size_t> parse_cpu_list(const std::string& list) {
+    std::vector<size_t> cpus;
+    size_t end = list.find_last_not_of(" \t\r\n");
+    std::string trimmed = end == std::string::npos
+        ? std::string() : list.substr(0, end + 1);
+    size_t pos = 0;
+    while (pos < trimmed.size()) {
+        size_t first = parse_cpu(trimmed, pos);
+        size_t last = first;
+        if (pos < trimmed.size() && trimmed[pos] == '-') {
+            ++pos;
+            last = parse_cpu(trimmed, pos);
+            if (last < first) {
+                throw std::invalid_argument("Invalid CPU list: " + list);
+            }
+        }
+        for (size_t cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+        if (pos < trimmed.size()) {
+            if (trimmed[pos] != ',' || pos + 1 == trimmed.size()) {
+                throw std::invalid_argument("Invalid CPU list: " + list);
+            }
+            ++pos;
+        }
+    }
+    return cpus;
+}
+
+std::vector<NumaNode> numa_nodes() {
+    std::vector<NumaNode> nodes;
+#ifdef __linux__
+    std::ifstream online("/sys/devices/system/node/online");
+    std::string list;
+    if (online && std::getline(online, list)) {
+        try {
+            std::vector<size_t> ids = parse_cpu_list(list);
+            for (size_t k = 0; k < ids.size(); ++k) {
+                std::ifstream file("/sys/devices/system/node/node"
+                                   + std::to_string(ids[k]) + "/cpulist");
+                std::string cpus;
+                if (!file || !std::getline(file, cpus)) {
+                    continue;
+                }
+                NumaNode node;
+                node.id = ids[k];
+                node.cpus = parse_cpu_list(cpus);
+                // Memory-only nodes get no shards
+                if (!node.cpus.empty()) {
+                    nodes.push_back(node);
+                }
+            }
+        } catch (const std::invalid_argument&) {
+            nodes.clear();
+        }
+    }
+#endif
+    if (nodes.empty()) {
+        NumaNode node;
+        node.id = 0;
+        size_t threads = std::max<size_t>(
+            std::thread::hardware_concurrency(), 1);
+        for (size_t cpu = 0; cpu < threads; ++cpu) {
+            node.cpus.push_back(cpu);
+        }
+        nodes.push_back(node);
+    }
+    return nodes;
+}
+
+PartitionedBank::PartitionedBank(
+    size_t n,
+    const PartitionOptions& options,
+    double kp,
+    double ki,
+    double kd,
+    double TfTs,
+    double umin,
+    double umax,
+    double u0,
+    double b)
+    : n_(n),
+      shard_size_(LINE_DOUBLES),
+      spin_(options.spin),
+      args_(),
+      generation_(0),
+      stop_(false),
+      remaining_(0) {
+    std::vector<NumaNode> nodes =
+        options.nodes.empty() ? numa_nodes() : options.nodes;
+    if (nodes.empty() || options.shards_per_node == 0) {
+        throw std::invalid_argument("PartitionedBank needs shards");
+    }
+    for (size_t k = 0; k < nodes.size(); ++k) {
+        if (nodes[k].cpus.empty()) {
+            throw std::invalid_argument("PartitionedBank node without CPUs");
+        }
+    }
+
+    size_t shards = nodes.size() * options.shards_per_node;
+    size_t lines = (n + LINE_DOUBLES - 1) / LINE_DOUBLES;
+    shard_size_ = std::max<size_t>((lines + shards - 1) / shards, 1)
+        * LINE_DOUBLES;
+    for (size_t k = 0; k < shards; ++k) {
+        const NumaNode& node = nodes[k / options.shards_per_node];
+        std::unique_ptr<Shard> shard(new Shard);
+        shard->begin = std::min(k * shard_size_, n);
+        shard->count = std::min(shard_size_, n - shard->begin);
+        shard->node = node.id;
+        shard->cpu =
+            node.cpus[(k % options.shards_per_node) % node.cpus.size()];
+        shard->pinned = options.pin;
+        shards_.push_back(std::move(shard));
+    }
+
+    // Each worker allocates its shard on its node and counts itself off
+    remaining_.store(shards);
+    for (size_t k = 0; k < shards; ++k) {
+        shards_[k]->thread = std::thread(
+            &PartitionedBank::worker_main, this, k,
+            kp, ki, kd, TfTs, umin, umax, u0, b);
+    }
+    wait_finished();
+}
+
+PartitionedBank::~PartitionedBank() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_.store(true);
+    }
+    start_.notify_all();
+    for (size_t k = 0; k < shards_.size(); ++k) {
+        shards_[k]->thread.join();
+    }
+}
+
+void PartitionedBank::configure(
+    size_t i,
+    double kp,
+    double ki,
+    double kd,
+    double TfTs,
+    double umin,
+    double umax,
+    double u0,
+    double b) {
+    Shard& shard = *shards_[shard_of(i)];
+    shard.bank->configure(
+        i - shard.begin, kp, ki, kd, TfTs, umin, umax, u0, b);
+}
+
+void PartitionedBank::step(
+    const double* r,
+    const double* y,
+    const double* uff,
+    const double* uman,
+    const double* utrack,
+    const double* Tx,
+    const bool* track,
+    const bool* auto_mode,
+    const WindupMode* windup,
+    double* u) {
+    args_.r = r;
+    args_.y = y;
+    args_.uff = uff;
+    args_.uman = uman;
+    args_.utrack = utrack;
+    args_.Tx = Tx;
+    args_.track = track;
+    args_.auto_mode = auto_mode;
+    args_.windup = windup;
+    args_.u = u;
+    remaining_.store(shards_.size(), std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        generation_.fetch_add(1, std::memory_order_release);
+    }
+    start_.notify_all();
+    wait_finished();
+}
+
+void PartitionedBank::set_kernel(PIDBankKernel kernel) {
+    for (size_t k = 0; k < shards_.size(); ++k) {
+        shards_[k]->bank->set_kernel(kernel);
+    }
+}
+
+void PartitionedBank::set_auto_windup(bool enabled) {
+    for (size_t k = 0; k < shards_.size(); ++k) {
+        shards_[k]->bank->set_auto_windup(enabled);
+    }
+}
+
+void PartitionedBank::snapshot(PIDControllerState* states) const {
+    for (size_t k = 0; k < shards_.size(); ++k) {
+        shards_[k]->bank->snapshot(states + shards_[k]->begin);
+    }
+}
+
+void PartitionedBank::restore(const PIDControllerState* states) {
+    for (size_t k = 0; k < shards_.size(); ++k) {
+        shards_[k]->bank->restore(states + shards_[k]->begin);
+    }
+}
+
+void PartitionedBank::worker_main(
+    size_t k, double kp, double ki, double kd, double TfTs, double umin,
+    double umax, double u0, double b) {
+    Shard& shard = *shards_[k];
+    if (shard.pinned) {
+        shard.pinned = MultiRateScheduler::pin_current_thread(shard.cpu);
+    }
+    // First touch from the pinned thread places the arrays on its node
+    shard.bank.reset(
+        new PIDBank(shard.count, kp, ki, kd, TfTs, umin, umax, u0, b));
+    finish();
+
+    uint64_t generation = 0;
+    for (;;) {
+        uint64_t current = generation_.load(std::memory_order_acquire);
+        for (size_t polls = 0; current == generation && polls < spin_
+                && !stop_.load(std::memory_order_relaxed); ++polls) {
+            std::this_thread::yield();
+            current = generation_.load(std::memory_order_acquire);
+        }
+        if (current == generation) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            start_.wait(lock, [this, generation] {
+                return stop_.load() || generation_.load() != generation;
+            });
+        }
+        if (stop_.load()) {
+            return;
+        }
+        generation = generation_.load(std::memory_order_acquire);
+
+        const StepArgs& a = args_;
+        size_t i = shard.begin;
+        shard.bank->step(a.r + i, a.y + i, a.uff + i, a.uman + i,
+                         a.utrack + i, a.Tx + i, a.track + i,
+                         a.auto_mode + i, a.windup + i, a.u + i);
+        finish();
+    }
+}
+
+void PartitionedBank::finish() {
+    if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        done_.notify_one();
+    }
+}
+
+void PartitionedBank::wait_finished() {
+    for (size_t polls = 0; polls < spin_; ++polls) {
+        if (remaining_.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+        std::this_thread::yield();
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return remaining_.load() == 0; });
+}
@@ -0,0 +1,302 @@
+/**
+ * @file partitioned_bank.h
+ * @brief Controller bank split into NUMA-local shards (host only)
+ *
+ * This file provides a bank of controllers split into contiguous
+ * shards, one or more per NUMA node. Each shard is a PIDBank that is
+ * allocated and stepped by a worker thread pinned to a CPU of its
+ * node, so that the controller states stay in that node's memory and
+ * every step streams through local memory only. All shards step in
+ * parallel, and step() returns when every shard has finished.
+ *
+ * The workers of a node are pinned to its CPUs in turn. Waiting
+ * threads (the workers between steps and the caller during a step)
+ * yield up to PartitionOptions::spin times before they block, which
+ * avoids a wake-up delay per step when steps follow closely.
+ */
+
+#ifndef PARTITIONED_BANK_H
+#define PARTITIONED_BANK_H
+
+#include "pid_bank.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief A NUMA node and its CPUs
+ */
+struct NumaNode {
+    size_t id;                  ///< Node number
+    std::vector<size_t> cpus;   ///< CPU indices of the node
+};
+
+/**
+ * @brief NUMA nodes of the machine
+ *
+ * Read from /sys/devices/system/node on Linux. Elsewhere, or if the
+ * nodes cannot be read, one node 0 with all hardware threads.
+ */
+std::vector<NumaNode> numa_nodes();
+
+/**
+ * @brief Parse a Linux CPU list such as "0-3,8,10-11"
+ *
+ * @param list CPU list
+ * @return CPU indices in the order listed
+ * @throws std::invalid_argument If the list is malformed
+ */
+std::vector<size_t> parse_cpu_list(const std::string& list);
+
+/**
+ * @brief Options of a PartitionedBank
+ */
+struct PartitionOptions {
+    std::vector<NumaNode> nodes;  ///< Nodes to use (empty: numa_nodes())
+    size_t shards_per_node;       ///< Shards and workers per node
+    bool pin;                     ///< Pin each worker to its CPU
+    size_t spin;                  ///< Yields before a waiting thread blocks
+
+    PartitionOptions()
+        : shards_per_node(1),
+          pin(true),
+          spin(1000) {}
+};
+
+/**
+ * @brief Bank of PID controllers split into per-node shards
+ *
+ * Controller i is controller i - shard_begin(k) of the shard k that
+ * holds it. Shards hold whole cache lines of the caller's arrays
+ * (multiples of 8 controllers), so no two workers write to the same
+ * line of u. The outputs are the same as those of one PIDBank.
+ *
+ * Each worker constructs its shard after pinning itself, so the shard's
+ * memory is first touched, and placed, on the worker's node. The
+ * signal arrays passed to step() stay where the caller allocated them;
+ * each worker only reads and writes its own range of them.
+ */
+class PartitionedBank {
+public:
+    /**
+     * @brief Constructor
+     *
+     * Starts the workers and waits until every shard is allocated.
+     *
+     * @param n Number of controllers in the bank
+     * @param options Placement options
+     * @param kp Proportional gain
+     * @param ki Integral gain
+     * @param kd Derivative gain
+     * @param TfTs Filter time constant as multiple of nominal sample
+     *             time (default: 10.0)
+     * @param umin Minimum control signal (default: -infinity)
+     * @param umax Maximum control signal (default: +infinity)
+     * @param u0 Bias term for P or PD control (default: 0.0)
+     * @param b Setpoint weight for proportional term (default: 1.0)
+     * @throws std::invalid_argument If there are no nodes, a node has
+     *         no CPUs or shards_per_node is zero
+     */
+    PartitionedBank(
+        size_t n,
+        const PartitionOptions& options,
+        double kp,
+        double ki,
+        double kd,
+        double TfTs = 10.0,
+        double umin = -std::numeric_limits<double>::infinity(),
+        double umax = std::numeric_limits<double>::infinity(),
+        double u0 = 0.0,
+        double b = 1.0);
+
+    /**
+     * @brief Stop and join the workers
+     */
+    ~PartitionedBank();
+
+    PartitionedBank(const PartitionedBank&) = delete;
+    PartitionedBank& operator=(const PartitionedBank&) = delete;
+
+    /**
+     * @brief Number of controllers in the bank
+     */
+    size_t size() const { return n_; }
+
+    /**
+     * @brief Number of shards
+     */
+    size_t shards() const { return shards_.size(); }
+
+    /**
+     * @brief Controllers of a shard, for configuring and retuning
+     *
+     * Only between steps, from the thread that calls step().
+     */
+    PIDBank& shard(size_t k) { return *shards_[k]->bank; }
+    const PIDBank& shard(size_t k) const { return *shards_[k]->bank; }
+
+    /**
+     * @brief Index of the first controller of a shard
+     */
+    size_t shard_begin(size_t k) const { return shards_[k]->begin; }
+
+    /**
+     * @brief NUMA node of a shard
+     */
+    size_t shard_node(size_t k) const { return shards_[k]->node; }
+
+    /**
+     * @brief CPU of a shard's worker
+     */
+    size_t shard_cpu(size_t k) const { return shards_[k]->cpu; }
+
+    /**
+     * @brief Whether a shard's worker is pinned to its CPU
+     */
+    bool shard_pinned(size_t k) const { return shards_[k]->pinned; }
+
+    /**
+     * @brief Shard holding a controller
+     *
+     * @param i Controller index
+     */
+    size_t shard_of(size_t i) const { return i / shard_size_; }
+
+    /**
+     * @brief Set the parameters of one controller and reset its state
+     *
+     * Works like PIDBank::configure().
+     *
+     * @param i Controller index
+     * @param kp Proportional gain
+     * @param ki Integral gain
+     * @param kd Derivative gain
+     * @param TfTs Filter time constant as multiple of nominal sample
+     *             time (default: 10.0)
+     * @param umin Minimum control signal (default: -infinity)
+     * @param umax Maximum control signal (default: +infinity)
+     * @param u0 Bias term for P or PD control (default: 0.0)
+     * @param b Setpoint weight for proportional term (default: 1.0)
+     */
+    void configure(
+        size_t i,
+        double kp,
+        double ki,
+        double kd,
+        double TfTs = 10.0,
+        double umin = -std::numeric_limits<double>::infinity(),
+        double umax = std::numeric_limits<double>::infinity(),
+        double u0 = 0.0,
+        double b = 1.0);
+
+    /**
+     * @brief Compute the control signals of all controllers
+     *
+     * Same arguments as PIDBank::step(). Every worker steps its shard,
+     * and the call returns when all are done.
+     */
+    void step(
+        const double* r,
+        const double* y,
+        const double* uff,
+        const double* uman,
+        const double* utrack,
+        const double* Tx,
+        const bool* track,
+        const bool* auto_mode,
+        const WindupMode* windup,
+        double* u);
+
+    /**
+     * @brief Select the update kernel of every shard
+     *
+     * @param kernel Kernel to use
+     * @throws std::invalid_argument if the kernel is not supported
+     */
+    void set_kernel(PIDBankKernel kernel);
+
+    /**
+     * @brief Feed each controller's saturation into its next step
+     *
+     * @param enabled Whether to use the internal saturation
+     */
+    void set_auto_windup(bool enabled);
+
+    /**
+     * @brief Copy the state of every controller
+     *
+     * @param states Output array of size() states
+     */
+    void snapshot(PIDControllerState* states) const;
+
+    /**
+     * @brief Continue from the states of a snapshot
+     *
+     * @param states Array of size() states
+     */
+    void restore(const PIDControllerState* states);
+
+private:
+    struct Shard {
+        size_t begin;
+        size_t count;
+        size_t node;
+        size_t cpu;
+        bool pinned;
+        std::unique_ptr<PIDBank> bank;
+        std::thread thread;
+    };
+
+    // Arguments of the current step
+    struct StepArgs {
+        const double* r;
+        const double* y;
+        const double* uff;
+        const double* uman;
+        const double* utrack;
+        const double* Tx;
+        const bool* track;
+        const bool* auto_mode;
+        const WindupMode* windup;
+        double* u;
+    };
+
+    // Worker main loop: allocate the shard, then step it every
+    // generation
+    void worker_main(size_t k, double kp, double ki, double kd,
+                     double TfTs, double umin, double umax, double u0,
+                     double b);
+
+    // Count a finished worker
+    void finish();
+
+    // Wait until every worker has finished
+    void wait_finished();
+
+    size_t n_;
+    size_t shard_size_;
+    size_t spin_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+
+    StepArgs args_;
+
+    std::mutex mutex_;
+    std::condition_variable start_;
+    std::condition_variable done_;
+
+    // Step number, published under mutex_
+    std::atomic<uint64_t> generation_;
+    std::atomic<bool> stop_;
+
+    // Workers still running the current step
+    std::atomic<size_t> remaining_;
+};
+
+#endif // PARTITIONED_BANK_H
@@ -4,7 +4,59 @@
  */
 
 #include "pid.h"
-#include <algorithm>
+
+namespace {
+
+/**
+ * @brief Run steps begin to end in automatic mode with constant Tx
+ *
+ * The filter parameters are those for Tx, so the filter is stepped
+ * without rediscretization checks. Parameters and states are copied to
+ * locals so that stores to u_out cannot alias them.
+ */
+template <PIDStructure S>
+void run_fixed_period(
+    PIDParams& params_out,
+    PIDState& state_out,
+    unsigned char& saturation_out,
+    bool auto_windup,
+    const FilterParams f,
+    FilterOutput& filtered,
+    const InputSeries& in,
+    size_t begin,
+    size_t end,
+    double Tx,
+    double* u_out) {
+    PIDParams params = params_out;
+    PIDState state = state_out;
+    unsigned char saturation = saturation_out;
+    unsigned char feedback_mask =
+        auto_windup ? SATURATED_HIGH | SATURATED_LOW : 0;
+    double yf = filtered.yf;
+    double dyf = filtered.dyf;
+    for (size_t i = begin; i < end; ++i) {
+        // Filter updates
+        double yf_prev = yf;
+        yf = f.a11 * yf_prev + f.a12 * dyf + f.b1 * in.y[i];
+        dyf = f.a21 * yf_prev + f.a22 * dyf + f.b2 * in.y[i];
+
+        WindupMode windup = combine_windup(
+            in.windup ? in.windup[i] : WindupMode::NONE,
+            static_cast<unsigned char>(saturation & feedback_mask));
+        PIDStepResult result = pid_step<S>(
+            params, state, in.r[i], yf, dyf,
+            in.uff ? in.uff[i] : 0.0, 0.0, 0.0, Tx, false, true, windup);
+        u_out[i] = result.u;
+        saturation = result.saturation;
+    }
+    params_out = params;
+    state_out = state;
+    saturation_out = saturation;
+    filtered.yf = yf;
+    filtered.dyf = dyf;
+}
+
+} // namespace
 
 PIDController::PIDController(
     double kp,
@@ -15,18 +67,21 @@ PIDController::PIDController(
     double umax,
     double u0,
     double b)
-    : kp_(kp),
-      ki_(ki),
-      kd_(kd),
-      umin_(umin),
-      umax_(umax),
-      u0_(u0),
-      b_(b),
-      u_old_(0.0),
-      up_old_(0.0),
-      ud_old_(0.0),
-      uff_old_(0.0),
-      filter_(TfTs) {}
+    : filter_(TfTs),
+      saturation_(0),
+      auto_windup_(false) {
+    params_.kp = kp;
+    params_.ki = ki;
+    params_.kd = kd;
+    params_.umin = umin;
+    params_.umax = umax;
+    params_.u0 = u0;
+    params_.b = b;
+    state_.u_old = 0.0;
+    state_.up_old = 0.0;
+    state_.ud_old = 0.0;
+    state_.uff_old = 0.0;
+}
 
 double PIDController::operator()(
     double r,
@@ -38,63 +93,168 @@ double PIDController::operator()(
     bool track,
     bool auto_mode,
     WindupMode windup) {
+    return step(r, y, uff, uman, utrack, Tx, track, auto_mode, windup).u;
+}
+
+PIDStepResult PIDController::step(
+    double r,
+    double y,
+    double uff,
+    double uman,
+    double utrack,
+    double Tx,
+    bool track,
+    bool auto_mode,
+    WindupMode windup) {
+#ifdef PID_ENABLE_INSTRUMENTATION
+    uint64_t start_cycles = pid_cycles();
+    bool rediscretized = filter_.needs_discretization(Tx);
+#endif
 
     // Filter updates
     FilterOutput filtered = filter_(y, Tx);
-    double yf = filtered.yf;
-    double dyf = filtered.dyf;
 
-    double u;
+    // Saturation of the previous step
+    if (auto_windup_) {
+        windup = combine_windup(windup, saturation_);
+    }
 
-    if (auto_mode) {
-        // Reset state if using P or PD control (ki == 0)
-        if (ki_ == 0.0) {
-            u_old_ = u0_;  // Bias term if P or PD control
-            up_old_ = 0.0;
-            ud_old_ = 0.0;
-            uff_old_ = 0.0;
-            b_ = 1.0;
-        }
+    // Reset state if using P or PD control (ki == 0)
+    PIDStepResult result;
+    if (params_.ki == 0.0) {
+        result = pid_step<PIDStructure::PD>(
+            params_, state_, r, filtered.yf, filtered.dyf, uff, uman,
+            utrack, Tx, track, auto_mode, windup);
+    } else {
+        result = pid_step<PIDStructure::PID>(
+            params_, state_, r, filtered.yf, filtered.dyf, uff, uman,
+            utrack, Tx, track, auto_mode, windup);
+    }
+    saturation_ = result.saturation;
+
+#ifdef PID_ENABLE_INSTRUMENTATION
+    // Integral increment the step would have used without anti-windup
+    double Dui_unclamped = result.Dui;
+    if (auto_mode && params_.ki != 0.0) {
+        Dui_unclamped = params_.ki * (r - filtered.yf) * Tx;
+    }
+    probe_.record(result, Dui_unclamped, rediscretized, track, auto_mode,
+                  pid_cycles() - start_cycles);
+#endif
+    return result;
+}
+
+void PIDController::run(const InputSeries& in, double* u_out) {
+#ifndef PID_ENABLE_INSTRUMENTATION
+    size_t i = 0;
+    while (i < in.n) {
+        double Tx = in.Tx ? in.Tx[i] : 1.0;
+        bool auto_mode = in.auto_mode ? in.auto_mode[i] : true;
+        bool track = in.track ? in.track[i] : false;
 
-        // Tracking mode for bumpless transfer
-        if (track) {
-            u_old_ = utrack;
-            up_old_ = 0.0;
-            ud_old_ = 0.0;
-            uff_old_ = 0.0;
+        // First step of a run rediscretizes the filter if needed
+        u_out[i] = (*this)(
+            in.r[i], in.y[i],
+            in.uff ? in.uff[i] : 0.0,
+            in.uman ? in.uman[i] : 0.0,
+            in.utrack ? in.utrack[i] : 0.0,
+            Tx, track, auto_mode,
+            in.windup ? in.windup[i] : WindupMode::NONE);
+        ++i;
+        if (!auto_mode || track) {
+            continue;
         }
 
-        // Control signal increments
-        double Dup = kp_ * (b_ * r - yf) - up_old_;
-        double Dui = ki_ * (r - yf) * Tx;
-        Dui = anti_windup(Dui, windup);
-        double Dud = (-kd_ * dyf - ud_old_) / Tx;
-        double Duff = uff - uff_old_;
+        // Extend the run while the mode and Tx stay the same
+        size_t end = i;
+        while (end < in.n
+               && (!in.Tx || in.Tx[end] == Tx)
+               && (!in.auto_mode || in.auto_mode[end])
+               && !(in.track && in.track[end])) {
+            ++end;
+        }
+        if (end == i) {
+            continue;
+        }
 
-        // Add control signal increment
-        double Du = Dup + Dui + Dud + Duff;
-        u = u_old_ + Du;
-    } else {
-        // Manual control signal
-        u = uman;
+        FilterOutput filtered = filter_.state();
+        if (params_.ki == 0.0) {
+            run_fixed_period<PIDStructure::PD>(
+                params_, state_, saturation_, auto_windup_,
+                filter_.params(), filtered, in, i, end, Tx, u_out);
+        } else {
+            run_fixed_period<PIDStructure::PID>(
+                params_, state_, saturation_, auto_windup_,
+                filter_.params(), filtered, in, i, end, Tx, u_out);
+        }
+        filter_.set_state(filtered);
+        i = end;
+    }
+#else
+    // Every step goes through step() so that the probe records it
+    for (size_t i = 0; i < in.n; ++i) {
+        u_out[i] = (*this)(
+            in.r[i], in.y[i],
+            in.uff ? in.uff[i] : 0.0,
+            in.uman ? in.uman[i] : 0.0,
+            in.utrack ? in.utrack[i] : 0.0,
+            in.Tx ? in.Tx[i] : 1.0,
+            in.track ? in.track[i] : false,
+            in.auto_mode ? in.auto_mode[i] : true,
+            in.windup ? in.windup[i] : WindupMode::NONE);
     }
+#endif
+}
 
-    // Saturate control signal
-    u = std::max(std::min(u, umax_), umin_);
+void PIDController::reset() {
+    state_.u_old = 0.0;
+    state_.up_old = 0.0;
+    state_.ud_old = 0.0;
+    state_.uff_old = 0.0;
+    saturation_ = 0;
+    filter_.reset();
+#ifdef PID_ENABLE_INSTRUMENTATION
+    probe_.reset_transitions();
+#endif
+}
 
-    // Update old signal states
-    u_old_ = u;
-    up_old_ = kp_ * (b_ * r - yf);
-    ud_old_ = -kd_ * dyf;
-    uff_old_ = uff;
+PIDControllerState PIDController::snapshot() const {
+    FilterState filter = filter_.snapshot();
+    PIDControllerState state;
+    state.u_old = state_.u_old;
+    state.up_old = state_.up_old;
+    state.ud_old = state_.ud_old;
+    state.uff_old = state_.uff_old;
+    state.yf = filter.yf;
+    state.dyf = filter.dyf;
+    state.Tx_old = filter.Tx_old;
+    state.saturation = saturation_;
+    state.initialized = filter.initialized;
+    return state;
+}
 
-    return u;
+void PIDController::restore(const PIDControllerState& state) {
+    state_.u_old = state.u_old;
+    state_.up_old = state.up_old;
+    state_.ud_old = state.ud_old;
+    state_.uff_old = state.uff_old;
+    saturation_ = state.saturation;
+    FilterState filter;
+    filter.yf = state.yf;
+    filter.dyf = state.dyf;
+    filter.Tx_old = state.Tx_old;
+    filter.initialized = state.initialized;
+    filter_.restore(filter);
+#ifdef PID_ENABLE_INSTRUMENTATION
+    probe_.reset_transitions();
+#endif
 }
 
-void PIDController::reset() {
-    u_old_ = 0.0;
-    up_old_ = 0.0;
-    ud_old_ = 0.0;
-    uff_old_ = 0.0;
-    filter_.reset();
+void PIDController::set_gains(double kp, double ki, double kd) {
+    pid_set_gains(params_, state_, kp, ki, kd, filter_.state().dyf);
+}
+
+void PIDController::set_limits(double umin, double umax) {
+    params_.umin = umin;
+    params_.umax = umax;
 }
@@ -10,16 +10,45 @@
 #ifndef PID_H
 #define PID_H
 
-#include "anti_windup.h"
-#include "measurement_filter.h"
+#include "basic_pid.h"
+#include "input_series.h"
 #include <limits>
 
+#ifdef PID_ENABLE_INSTRUMENTATION
+#include "instrumentation.h"
+#endif
+
+/**
+ * @brief Complete state of a PIDController or a PIDBank controller
+ *
+ * Plain data of one 64-byte cache line, for checkpointing a controller
+ * and continuing on a standby (see state_checkpoint.h). The signal
+ * states are those of PIDState and the filter states those of
+ * FilterState; parameters and options are not included.
+ */
+struct PIDControllerState {
+    double u_old;              ///< Previous control signal
+    double up_old;             ///< Previous proportional term
+    double ud_old;             ///< Previous derivative term
+    double uff_old;            ///< Previous feedforward signal
+    double yf;                 ///< Filtered output
+    double dyf;                ///< Filtered derivative
+    double Tx_old;             ///< Last execution period of the filter
+    unsigned char saturation;  ///< Saturation flags of the last step
+    bool initialized;          ///< Whether the filter is discretized
+};
+
 /**
  * @brief PID controller using incremental (velocity) form
  *
  * Implements the reference PID controller algorithm from Sundström et
  * al. (2024) with incremental form, measurement filtering, and
  * automatic/manual mode switching.
+ *
+ * The structure is chosen at runtime: the controller computes the
+ * full PID update, or the PD update with state reset when ki == 0.
+ * For a structure known at compile time, BasicPID avoids the runtime
+ * check and unused terms.
  */
 class PIDController {
 public:
@@ -71,29 +100,157 @@ public:
         bool auto_mode = true,
         WindupMode windup = WindupMode::NONE);
 
+    /**
+     * @brief Compute the PID control signal with increments and
+     *        saturation flags
+     *
+     * Arguments as for operator(), which returns the u of this result.
+     *
+     * @return Control signal, P, I, D and FF increments and saturation
+     *         flags (see pid_step)
+     */
+    PIDStepResult step(
+        double r,
+        double y,
+        double uff = 0.0,
+        double uman = 0.0,
+        double utrack = 0.0,
+        double Tx = 1.0,
+        bool track = false,
+        bool auto_mode = true,
+        WindupMode windup = WindupMode::NONE);
+
+    /**
+     * @brief Feed the saturation of each step into the next one
+     *
+     * When enabled, the windup argument of every step (and the windup
+     * column of run()) is combined with the saturation flags of the
+     * previous step, so integration stops in the saturated direction
+     * without the caller passing the windup status back in.
+     *
+     * @param enabled Whether to use the internal saturation (default
+     *                off)
+     */
+    void set_auto_windup(bool enabled) { auto_windup_ = enabled; }
+
+    /**
+     * @brief Whether the internal saturation is fed back
+     */
+    bool auto_windup() const { return auto_windup_; }
+
+    /**
+     * @brief Saturation flags of the last step (zero after reset)
+     */
+    unsigned char saturation() const { return saturation_; }
+
+    /**
+     * @brief Run the controller over a series of inputs
+     *
+     * Gives the same outputs as calling operator() once per time step.
+     * Runs of steps in automatic mode without tracking and with a
+     * constant Tx are processed by a loop that keeps the controller
+     * and filter state in local variables, with no rediscretization or
+     * mode checks. With PID_ENABLE_INSTRUMENTATION, every step goes
+     * through step() instead, so that the probe sees all of them.
+     *
+     * @param inputs Column arrays of inputs, inputs.n steps long
+     * @param u_out Output array for the control signal, inputs.n long
+     */
+    void run(const InputSeries& inputs, double* u_out);
+
     /**
      * @brief Reset the controller state to zero
      */
     void reset();
 
+    /**
+     * @brief Change the gains between steps without a bump
+     *
+     * The controller state is kept and the stored P and D terms are
+     * rescaled (see pid_set_gains), so the control signal continues
+     * smoothly from its last value.
+     *
+     * @param kp Proportional gain
+     * @param ki Integral gain
+     * @param kd Derivative gain
+     */
+    void set_gains(double kp, double ki, double kd);
+
+    /**
+     * @brief Change the saturation limits between steps
+     *
+     * The next step saturates its control signal with the new limits.
+     *
+     * @param umin Minimum control signal
+     * @param umax Maximum control signal
+     */
+    void set_limits(double umin, double umax);
+
+    /**
+     * @brief Change the filter time constant between steps
+     *
+     * The filter state is kept. The filter is rediscretized on the next
+     * step only if TfTs changed.
+     *
+     * @param TfTs Filter time constant as multiple of nominal sample
+     *             time
+     */
+    void set_TfTs(double TfTs) { filter_.set_TfTs(TfTs); }
+
+    /**
+     * @brief Complete controller state, for restore() on a standby
+     */
+    PIDControllerState snapshot() const;
+
+    /**
+     * @brief Continue from a snapshot
+     *
+     * The controller must have the same parameters and options as the
+     * one the snapshot was taken from; then the next steps give the
+     * same outputs, bit for bit except as noted for
+     * MeasurementFilter::restore().
+     *
+     * @param state Snapshot of a controller
+     */
+    void restore(const PIDControllerState& state);
+
+    /**
+     * @brief Controller parameters
+     */
+    const PIDParams& params() const { return params_; }
+
+    /**
+     * @brief Access the measurement filter
+     *
+     * Allows filter options such as a discretization cache to be set.
+     */
+    MeasurementFilter& filter() { return filter_; }
+    const MeasurementFilter& filter() const { return filter_; }
+
+#ifdef PID_ENABLE_INSTRUMENTATION
+    /**
+     * @brief Event counters and step times of this controller
+     */
+    const PIDProbe& probe() const { return probe_; }
+#endif
+
 private:
     // Controller parameters
-    double kp_;
-    double ki_;
-    double kd_;
-    double umin_;
-    double umax_;
-    double u0_;
-    double b_;
+    PIDParams params_;
 
     // Signal states
-    double u_old_;
-    double up_old_;
-    double ud_old_;
-    double uff_old_;
+    PIDState state_;
 
     // Measurement filter
     MeasurementFilter filter_;
+
+    // Saturation flags of the last step and automatic windup option
+    unsigned char saturation_;
+    bool auto_windup_;
+
+#ifdef PID_ENABLE_INSTRUMENTATION
+    PIDProbe probe_;
+#endif
 };
 
 #endif // PID_H
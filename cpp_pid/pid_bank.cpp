@@ -0,0 +1,507 @@
+/**
+ * @file pid_bank.cpp
+ * @brief Implementation of PID controller bank
+ */
+
+#include "pid_bank.h"
+#include "pid_bank_kernels.h"
+#include "zoh_cache.h"
+#include "zoh_pid.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+// Pad each field array to a whole number of 64-byte cache lines
+size_t padded_length(size_t n) {
+    const size_t doubles_per_line = 8;
+    return (n + doubles_per_line - 1) / doubles_per_line * doubles_per_line;
+}
+
+BankKernelFunction kernel_function(PIDBankKernel kernel) {
+    switch (kernel) {
+    case PIDBankKernel::SIMD128:
+        return pid_bank_kernel_simd128;
+    case PIDBankKernel::AVX2:
+        return pid_bank_cpu_has_avx2() ? pid_bank_kernel_avx2 : 0;
+    case PIDBankKernel::AVX512:
+        return pid_bank_cpu_has_avx512() ? pid_bank_kernel_avx512 : 0;
+    default:
+        return pid_bank_kernel_scalar;
+    }
+}
+
+PIDBankKernel best_kernel() {
+    const PIDBankKernel candidates[] = {
+        PIDBankKernel::AVX512,
+        PIDBankKernel::AVX2,
+        PIDBankKernel::SIMD128
+    };
+    for (size_t k = 0; k < sizeof(candidates) / sizeof(candidates[0]); ++k) {
+        if (kernel_function(candidates[k])) {
+            return candidates[k];
+        }
+    }
+    return PIDBankKernel::SCALAR;
+}
+
+} // namespace
+
+PIDGainTable::PIDGainTable(size_t n)
+    : n_(n),
+      stride_(padded_length(n)),
+      storage_(NUM_COLUMNS * padded_length(n), 0.0) {
+    for (size_t i = 0; i < n_; ++i) {
+        set(i, 0.0, 0.0, 0.0);
+    }
+}
+
+void PIDGainTable::set(
+    size_t i,
+    double kp,
+    double ki,
+    double kd,
+    double TfTs,
+    double umin,
+    double umax) {
+    column(KP)[i] = kp;
+    column(KI)[i] = ki;
+    column(KD)[i] = kd;
+    column(TFTS)[i] = TfTs;
+    column(UMIN)[i] = umin;
+    column(UMAX)[i] = umax;
+}
+
+PIDBank::PIDBank(
+    size_t n,
+    double kp,
+    double ki,
+    double kd,
+    double TfTs,
+    double umin,
+    double umax,
+    double u0,
+    double b)
+    : n_(n),
+      stride_(padded_length(n)),
+      storage_(NUM_FIELDS * padded_length(n), 0.0),
+      fields_(storage_.data()),
+      tables_{PIDGainTable(n), PIDGainTable(n)},
+      active_(0),
+      pending_(false),
+      saturation_storage_(padded_length(n), 0),
+      saturation_(saturation_storage_.data()),
+      auto_windup_(false),
+      kernel_(best_kernel()),
+      cache_(nullptr),
+      method_(ZohMethod::EXACT) {
+    for (size_t i = 0; i < n_; ++i) {
+        configure(i, kp, ki, kd, TfTs, umin, umax, u0, b);
+    }
+}
+
+void PIDBank::configure(
+    size_t i,
+    double kp,
+    double ki,
+    double kd,
+    double TfTs,
+    double umin,
+    double umax,
+    double u0,
+    double b) {
+    tables_[active_].set(i, kp, ki, kd, TfTs, umin, umax);
+    field(U0)[i] = u0;
+    field(B)[i] = b;
+    field(A11)[i] = 0.0;
+    field(A12)[i] = 0.0;
+    field(A21)[i] = 0.0;
+    field(A22)[i] = 0.0;
+    field(B1)[i] = 0.0;
+    field(B2)[i] = 0.0;
+    field(TX_REF)[i] = std::numeric_limits<double>::quiet_NaN();
+    field(H2_REF)[i] = 0.0;
+    reset(i);
+}
+
+PIDGainTable& PIDBank::edit_gains() {
+    if (gains_pending()) {
+        throw std::runtime_error("PIDBank gain table not swapped in yet");
+    }
+    PIDGainTable& table = tables_[1 - active_];
+    table = tables_[active_];
+    return table;
+}
+
+void PIDBank::swap_gains() {
+    const PIDGainTable& old_gains = tables_[active_];
+    const PIDGainTable& new_gains = tables_[1 - active_];
+    const double* kp_old = old_gains.kp();
+    const double* kd_old = old_gains.kd();
+    const double* TfTs_old = old_gains.TfTs();
+    const double* kp = new_gains.kp();
+    const double* kd = new_gains.kd();
+    const double* TfTs = new_gains.TfTs();
+    const double* dyf = field(DYF);
+    double* up_old = field(UP_OLD);
+    double* ud_old = field(UD_OLD);
+    double* Tx_old = field(TX_OLD);
+    double* Tx_ref = field(TX_REF);
+
+    // Same rescaling as pid_set_gains
+    for (size_t i = 0; i < n_; ++i) {
+        if (kp[i] != kp_old[i]) {
+            up_old[i] = kp_old[i] != 0.0
+                ? up_old[i] / kp_old[i] * kp[i] : 0.0;
+        }
+        if (kd[i] != kd_old[i]) {
+            ud_old[i] = -kd[i] * dyf[i];
+        }
+
+        // Rediscretize on the next step
+        if (TfTs[i] != TfTs_old[i]) {
+            Tx_old[i] = std::numeric_limits<double>::quiet_NaN();
+            Tx_ref[i] = std::numeric_limits<double>::quiet_NaN();
+        }
+    }
+    active_ = 1 - active_;
+    pending_.store(false, std::memory_order_release);
+}
+
+void PIDBank::rediscretize(const double* Tx, size_t begin, size_t end) {
+    const double* TfTs = tables_[active_].TfTs();
+    double* a11 = field(A11);
+    double* a12 = field(A12);
+    double* a21 = field(A21);
+    double* a22 = field(A22);
+    double* b1 = field(B1);
+    double* b2 = field(B2);
+    const double* Tx_old = field(TX_OLD);
+    double* Tx_ref = field(TX_REF);
+    double* h2_ref = field(H2_REF);
+
+    // Tx_old is NaN until the first step, so this also covers
+    // uninitialized filters
+    for (size_t i = begin; i < end; ++i) {
+        if (Tx[i] != Tx_old[i]) {
+            FilterParams params;
+            if (cache_) {
+                params = cache_->lookup(TfTs[i], Tx[i]);
+            } else if (method_ == ZohMethod::INCREMENTAL) {
+                if (std::abs(Tx[i] - Tx_ref[i])
+                        <= ZOH_INCREMENTAL_RANGE * TfTs[i]) {
+                    params = zoh_Fy_incremental(
+                        TfTs[i], Tx[i], Tx_ref[i], h2_ref[i]);
+                } else {
+                    params = zoh_Fy(TfTs[i], Tx[i], ZohMethod::POLYNOMIAL);
+                    Tx_ref[i] = Tx[i];
+                    h2_ref[i] = params.a12;
+                }
+            } else {
+                params = zoh_Fy(TfTs[i], Tx[i], method_);
+            }
+            a11[i] = params.a11;
+            a12[i] = params.a12;
+            a21[i] = params.a21;
+            a22[i] = params.a22;
+            b1[i] = params.b1;
+            b2[i] = params.b2;
+        }
+    }
+}
+
+void PIDBank::step(
+    const double* r,
+    const double* y,
+    const double* uff,
+    const double* uman,
+    const double* utrack,
+    const double* Tx,
+    const bool* track,
+    const bool* auto_mode,
+    const WindupMode* windup,
+    double* u) {
+    if (pending_.load(std::memory_order_acquire)) {
+        swap_gains();
+    }
+
+    // Rediscretize to match execution periods
+    rediscretize(Tx, 0, n_);
+
+    BankKernelArgs args = kernel_args(
+        r, y, uff, uman, utrack, Tx, track, auto_mode, windup, u);
+    kernel_function(kernel_)(args, 0, n_);
+}
+
+void PIDBank::step_active(
+    const size_t* active,
+    size_t count,
+    const double* r,
+    const double* y,
+    const double* uff,
+    const double* uman,
+    const double* utrack,
+    const double* Tx,
+    const bool* track,
+    const bool* auto_mode,
+    const WindupMode* windup,
+    double* u) {
+    if (pending_.load(std::memory_order_acquire)) {
+        swap_gains();
+    }
+
+    BankKernelArgs args = kernel_args(
+        r, y, uff, uman, utrack, Tx, track, auto_mode, windup, u);
+    BankKernelFunction kernel = kernel_function(kernel_);
+
+    // Runs of consecutive indices are stepped as one range
+    size_t k = 0;
+    while (k < count) {
+        size_t begin = active[k];
+        size_t end = begin + 1;
+        for (++k; k < count && active[k] == end; ++k) {
+            ++end;
+        }
+        rediscretize(Tx, begin, end);
+        kernel(args, begin, end);
+    }
+}
+
+BankKernelArgs PIDBank::kernel_args(
+    const double* r,
+    const double* y,
+    const double* uff,
+    const double* uman,
+    const double* utrack,
+    const double* Tx,
+    const bool* track,
+    const bool* auto_mode,
+    const WindupMode* windup,
+    double* u) {
+    const PIDGainTable& gains = tables_[active_];
+    BankKernelArgs args;
+    args.kp = gains.kp();
+    args.ki = gains.ki();
+    args.kd = gains.kd();
+    args.umin = gains.umin();
+    args.umax = gains.umax();
+    args.u0 = field(U0);
+    args.b = field(B);
+    args.u_old = field(U_OLD);
+    args.up_old = field(UP_OLD);
+    args.ud_old = field(UD_OLD);
+    args.uff_old = field(UFF_OLD);
+    args.a11 = field(A11);
+    args.a12 = field(A12);
+    args.a21 = field(A21);
+    args.a22 = field(A22);
+    args.b1 = field(B1);
+    args.b2 = field(B2);
+    args.yf = field(YF);
+    args.dyf = field(DYF);
+    args.Tx_old = field(TX_OLD);
+    args.r = r;
+    args.y = y;
+    args.uff = uff;
+    args.uman = uman;
+    args.utrack = utrack;
+    args.Tx = Tx;
+    args.track = track;
+    args.auto_mode = auto_mode;
+    args.windup = windup;
+    args.saturation = saturation_;
+    args.feedback = auto_windup_ ? SATURATED_HIGH | SATURATED_LOW : 0;
+    args.u = u;
+    return args;
+}
+
+void PIDBank::set_kernel(PIDBankKernel kernel) {
+    if (kernel == PIDBankKernel::AUTO) {
+        kernel = best_kernel();
+    }
+    if (!kernel_supported(kernel)) {
+        throw std::invalid_argument("PIDBank kernel not supported");
+    }
+    kernel_ = kernel;
+}
+
+void PIDBank::set_zoh_method(ZohMethod method) {
+    method_ = method;
+    double* Tx_ref = field(TX_REF);
+    double* Tx_old = field(TX_OLD);
+    for (size_t i = 0; i < n_; ++i) {
+        // Force rediscretization with the new method on the next step
+        Tx_ref[i] = std::numeric_limits<double>::quiet_NaN();
+        Tx_old[i] = std::numeric_limits<double>::quiet_NaN();
+    }
+}
+
+bool PIDBank::kernel_supported(PIDBankKernel kernel) {
+    return kernel == PIDBankKernel::AUTO || kernel_function(kernel) != 0;
+}
+
+void PIDBank::snapshot(PIDControllerState* states) const {
+    const double* u_old = field(U_OLD);
+    const double* up_old = field(UP_OLD);
+    const double* ud_old = field(UD_OLD);
+    const double* uff_old = field(UFF_OLD);
+    const double* yf = field(YF);
+    const double* dyf = field(DYF);
+    const double* Tx_old = field(TX_OLD);
+    for (size_t i = 0; i < n_; ++i) {
+        PIDControllerState& state = states[i];
+        state.u_old = u_old[i];
+        state.up_old = up_old[i];
+        state.ud_old = ud_old[i];
+        state.uff_old = uff_old[i];
+        state.yf = yf[i];
+        state.dyf = dyf[i];
+        state.Tx_old = Tx_old[i];
+        state.saturation = saturation_[i];
+        state.initialized = !std::isnan(Tx_old[i]);
+    }
+}
+
+void PIDBank::restore(const PIDControllerState* states) {
+    // Discretize the initialized filters at their last execution period
+    // (any period for the others, which rediscretize on their next step)
+    std::vector<double> Tx(n_);
+    double* Tx_old = field(TX_OLD);
+    for (size_t i = 0; i < n_; ++i) {
+        Tx[i] = states[i].initialized ? states[i].Tx_old : 1.0;
+        Tx_old[i] = std::numeric_limits<double>::quiet_NaN();
+    }
+    rediscretize(Tx.data(), 0, n_);
+
+    double* u_old = field(U_OLD);
+    double* up_old = field(UP_OLD);
+    double* ud_old = field(UD_OLD);
+    double* uff_old = field(UFF_OLD);
+    double* yf = field(YF);
+    double* dyf = field(DYF);
+    for (size_t i = 0; i < n_; ++i) {
+        const PIDControllerState& state = states[i];
+        u_old[i] = state.u_old;
+        up_old[i] = state.up_old;
+        ud_old[i] = state.ud_old;
+        uff_old[i] = state.uff_old;
+        yf[i] = state.yf;
+        dyf[i] = state.dyf;
+        Tx_old[i] = state.initialized
+            ? state.Tx_old : std::numeric_limits<double>::quiet_NaN();
+        saturation_[i] = state.saturation;
+    }
+}
+
+void PIDBank::place(double* fields, unsigned char* saturation) {
+    std::copy(fields_, fields_ + NUM_FIELDS * stride_, fields);
+    std::copy(saturation_, saturation_ + stride_, saturation);
+    fields_ = fields;
+    saturation_ = saturation;
+    std::vector<double>().swap(storage_);
+    std::vector<unsigned char>().swap(saturation_storage_);
+}
+
+void PIDBank::reset() {
+    for (size_t i = 0; i < n_; ++i) {
+        reset(i);
+    }
+}
+
+void PIDBank::reset(size_t i) {
+    field(U_OLD)[i] = 0.0;
+    field(UP_OLD)[i] = 0.0;
+    field(UD_OLD)[i] = 0.0;
+    field(UFF_OLD)[i] = 0.0;
+    field(YF)[i] = 0.0;
+    field(DYF)[i] = 0.0;
+    field(TX_OLD)[i] = std::numeric_limits<double>::quiet_NaN();
+    saturation_[i] = 0;
+}
+
+void pid_bank_kernel_scalar(
+    const BankKernelArgs& a, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+        // Filter updates
+        double yf_prev = a.yf[i];
+        a.Tx_old[i] = a.Tx[i];
+        a.yf[i] =
+            a.a11[i] * yf_prev + a.a12[i] * a.dyf[i] + a.b1[i] * a.y[i];
+        a.dyf[i] =
+            a.a21[i] * yf_prev + a.a22[i] * a.dyf[i] + a.b2[i] * a.y[i];
+        double yf = a.yf[i];
+        double dyf = a.dyf[i];
+
+        double u;
+
+        if (a.auto_mode[i]) {
+            // Reset state if using P or PD control (ki == 0)
+            if (a.ki[i] == 0.0) {
+                a.u_old[i] = a.u0[i];  // Bias term if P or PD control
+                a.up_old[i] = 0.0;
+                a.ud_old[i] = 0.0;
+                a.uff_old[i] = 0.0;
+                a.b[i] = 1.0;
+            }
+
+            // Tracking mode for bumpless transfer
+            if (a.track[i]) {
+                a.u_old[i] = a.utrack[i];
+                a.up_old[i] = 0.0;
+                a.ud_old[i] = 0.0;
+                a.uff_old[i] = 0.0;
+            }
+
+            // Control signal increments
+            double Dup = a.kp[i] * (a.b[i] * a.r[i] - yf) - a.up_old[i];
+            double Dui = a.ki[i] * (a.r[i] - yf) * a.Tx[i];
+            Dui = anti_windup(Dui, combine_windup(
+                a.windup[i],
+                static_cast<unsigned char>(a.saturation[i] & a.feedback)));
+            double Dud = (-a.kd[i] * dyf - a.ud_old[i]) / a.Tx[i];
+            double Duff = a.uff[i] - a.uff_old[i];
+
+            // Add control signal increment
+            double Du = Dup + Dui + Dud + Duff;
+            u = a.u_old[i] + Du;
+        } else {
+            // Manual control signal
+            u = a.uman[i];
+        }
+
+        // Saturate control signal
+        u = saturate_with_flags(u, a.umin[i], a.umax[i], a.saturation[i]);
+
+        // Update old signal states
+        a.u_old[i] = u;
+        a.up_old[i] = a.kp[i] * (a.b[i] * a.r[i] - yf);
+        a.ud_old[i] = -a.kd[i] * dyf;
+        a.uff_old[i] = a.uff[i];
+
+        a.u[i] = u;
+    }
+}
+
+void pid_windup_kernel_scalar(
+    double* Dui, const unsigned char* windup, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+        double d = Dui[i];
+        bool lower = ((windup[i] & SATURATED_LOW) != 0) & (d < 0.0);
+        d = lower ? 0.0 : d;
+        bool upper = ((windup[i] & SATURATED_HIGH) != 0) & (0.0 < d);
+        Dui[i] = upper ? 0.0 : d;
+    }
+}
+
+void pid_saturation_kernel_scalar(
+    double* u,
+    const double* umin,
+    const double* umax,
+    unsigned char* saturation,
+    size_t begin,
+    size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+        u[i] = saturate_with_flags(u[i], umin[i], umax[i], saturation[i]);
+    }
+}
@@ -0,0 +1,471 @@
+/**
+ * @file pid_bank.h
+ * @brief Bank of independent PID controllers in structure-of-arrays form
+ *
+ * This file provides a container for stepping many independent PID
+ * controllers with a single call. Parameters, controller states and
+ * measurement filter states are stored in contiguous per-field arrays
+ * so that one step streams through memory sequentially.
+ */
+
+#ifndef PID_BANK_H
+#define PID_BANK_H
+
+#include "anti_windup.h"
+#include "pid.h"
+#include "zoh_pid.h"
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+class ZohCache;
+struct BankKernelArgs;
+
+/**
+ * @brief Update kernel used by PIDBank::step()
+ */
+enum class PIDBankKernel {
+    AUTO,     ///< Fastest kernel supported by the running CPU
+    SCALAR,   ///< One controller at a time
+    SIMD128,  ///< 2 controllers per instruction (SSE2 or NEON)
+    AVX2,     ///< 4 controllers per instruction
+    AVX512    ///< 8 controllers per instruction
+};
+
+/**
+ * @brief Gains, limits and filter time constants of a bank
+ *
+ * One array per parameter, one element per controller, with the same
+ * meaning as the PIDBank::configure() arguments.
+ */
+class PIDGainTable {
+public:
+    /**
+     * @brief Constructor, with zero gains, no limits and TfTs = 10
+     *
+     * @param n Number of controllers
+     */
+    explicit PIDGainTable(size_t n);
+
+    /**
+     * @brief Number of controllers
+     */
+    size_t size() const { return n_; }
+
+    /**
+     * @brief Set the parameters of one controller
+     *
+     * @param i Controller index
+     * @param kp Proportional gain
+     * @param ki Integral gain
+     * @param kd Derivative gain
+     * @param TfTs Filter time constant as multiple of nominal sample
+     *             time (default: 10.0)
+     * @param umin Minimum control signal (default: -infinity)
+     * @param umax Maximum control signal (default: +infinity)
+     */
+    void set(
+        size_t i,
+        double kp,
+        double ki,
+        double kd,
+        double TfTs = 10.0,
+        double umin = -std::numeric_limits<double>::infinity(),
+        double umax = std::numeric_limits<double>::infinity());
+
+    double* kp() { return column(KP); }
+    double* ki() { return column(KI); }
+    double* kd() { return column(KD); }
+    double* TfTs() { return column(TFTS); }
+    double* umin() { return column(UMIN); }
+    double* umax() { return column(UMAX); }
+    const double* kp() const { return column(KP); }
+    const double* ki() const { return column(KI); }
+    const double* kd() const { return column(KD); }
+    const double* TfTs() const { return column(TFTS); }
+    const double* umin() const { return column(UMIN); }
+    const double* umax() const { return column(UMAX); }
+
+private:
+    enum Column { KP, KI, KD, TFTS, UMIN, UMAX, NUM_COLUMNS };
+
+    double* column(Column c) { return storage_.data() + c * stride_; }
+    const double* column(Column c) const {
+        return storage_.data() + c * stride_;
+    }
+
+    size_t n_;
+    size_t stride_;
+    std::vector<double> storage_;
+};
+
+/**
+ * @brief Bank of PID controllers stored as structure of arrays
+ *
+ * Each controller in the bank behaves exactly like a separate
+ * PIDController (including its MeasurementFilter), and step() gives
+ * the same results as calling PIDController::operator() once for
+ * every controller.
+ *
+ * The update is computed by a SIMD kernel chosen at runtime from the
+ * instruction sets supported by the CPU. Filter rediscretization stays
+ * scalar and only runs for controllers whose execution period changed.
+ * The SIMD kernels never contract multiply-add pairs, so they are
+ * bit-identical to PIDController as long as the scalar code is not
+ * compiled with floating-point contraction into FMA instructions.
+ *
+ * The gains, limits and filter time constants are held in two
+ * PIDGainTable buffers. A tuning thread fills the inactive one with
+ * edit_gains() and publish_gains(), and the next step() swaps the
+ * buffers and retunes every controller without a bump, as
+ * PIDController::set_gains() does.
+ */
+class PIDBank {
+public:
+    /**
+     * @brief Constructor
+     *
+     * All controllers start with the same parameters. Use configure()
+     * to change the parameters of individual controllers.
+     *
+     * @param n Number of controllers in the bank
+     * @param kp Proportional gain
+     * @param ki Integral gain
+     * @param kd Derivative gain
+     * @param TfTs Filter time constant as multiple of nominal sample
+     *             time (default: 10.0)
+     * @param umin Minimum control signal (default: -infinity)
+     * @param umax Maximum control signal (default: +infinity)
+     * @param u0 Bias term for P or PD control (default: 0.0)
+     * @param b Setpoint weight for proportional term (default: 1.0)
+     */
+    PIDBank(
+        size_t n,
+        double kp,
+        double ki,
+        double kd,
+        double TfTs = 10.0,
+        double umin = -std::numeric_limits<double>::infinity(),
+        double umax = std::numeric_limits<double>::infinity(),
+        double u0 = 0.0,
+        double b = 1.0);
+
+    /**
+     * @brief Set the parameters of one controller and reset its state
+     *
+     * Changes the gain table in use; a table published afterwards
+     * replaces these gains.
+     *
+     * @param i Controller index
+     * @param kp Proportional gain
+     * @param ki Integral gain
+     * @param kd Derivative gain
+     * @param TfTs Filter time constant as multiple of nominal sample
+     *             time (default: 10.0)
+     * @param umin Minimum control signal (default: -infinity)
+     * @param umax Maximum control signal (default: +infinity)
+     * @param u0 Bias term for P or PD control (default: 0.0)
+     * @param b Setpoint weight for proportional term (default: 1.0)
+     */
+    void configure(
+        size_t i,
+        double kp,
+        double ki,
+        double kd,
+        double TfTs = 10.0,
+        double umin = -std::numeric_limits<double>::infinity(),
+        double umax = std::numeric_limits<double>::infinity(),
+        double u0 = 0.0,
+        double b = 1.0);
+
+    /**
+     * @brief Number of controllers in the bank
+     */
+    size_t size() const { return n_; }
+
+    /**
+     * @brief Gains, limits and filter time constants in use
+     *
+     * Only for the thread that calls step().
+     */
+    const PIDGainTable& gains() const { return tables_[active_]; }
+
+    /**
+     * @brief Start a bank-wide gain update
+     *
+     * Copies the gains in use into the inactive table and returns it.
+     * Change any entries of the table, then call publish_gains(). May be
+     * called from another thread than step(), but not concurrently with
+     * configure().
+     *
+     * @return Inactive gain table, valid until publish_gains()
+     * @throws std::runtime_error If a published table has not been
+     *         swapped in by step() yet
+     */
+    PIDGainTable& edit_gains();
+
+    /**
+     * @brief Make the table returned by edit_gains() take effect
+     *
+     * The next step() swaps the tables before updating any controller,
+     * so every controller of that step uses the new gains. Controller
+     * states are kept: P and D terms are rescaled as in pid_set_gains,
+     * and filters whose TfTs changed are rediscretized.
+     */
+    void publish_gains() { pending_.store(true, std::memory_order_release); }
+
+    /**
+     * @brief Whether a published table waits for the next step
+     */
+    bool gains_pending() const {
+        return pending_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Compute the control signals of all controllers
+     *
+     * Every array holds size() elements, one per controller, with the
+     * same meaning as the corresponding PIDController::operator()
+     * argument.
+     *
+     * @param r Reference (setpoint) signals
+     * @param y Process measurements
+     * @param uff Feedforward control signals
+     * @param uman Manual mode control signals
+     * @param utrack Tracking signals for bumpless transfer
+     * @param Tx Execution periods (normalized)
+     * @param track Tracking mode flags
+     * @param auto_mode Automatic mode flags
+     * @param windup Windup status of each controller
+     * @param u Output control signals
+     */
+    void step(
+        const double* r,
+        const double* y,
+        const double* uff,
+        const double* uman,
+        const double* utrack,
+        const double* Tx,
+        const bool* track,
+        const bool* auto_mode,
+        const WindupMode* windup,
+        double* u);
+
+    /**
+     * @brief Compute the control signals of some of the controllers
+     *
+     * Same as step() for the controllers listed in active, which must
+     * be in increasing order; the other controllers keep their state
+     * and their elements of u are not written. The arrays hold size()
+     * elements as for step(), and only the elements of the listed
+     * controllers are read. Runs of consecutive indices are updated by
+     * the SIMD kernel as one range.
+     *
+     * @param active Indices of the controllers to step
+     * @param count Number of indices in active
+     * @param r Reference (setpoint) signals
+     * @param y Process measurements
+     * @param uff Feedforward control signals
+     * @param uman Manual mode control signals
+     * @param utrack Tracking signals for bumpless transfer
+     * @param Tx Execution periods (normalized)
+     * @param track Tracking mode flags
+     * @param auto_mode Automatic mode flags
+     * @param windup Windup status of each controller
+     * @param u Output control signals
+     */
+    void step_active(
+        const size_t* active,
+        size_t count,
+        const double* r,
+        const double* y,
+        const double* uff,
+        const double* uman,
+        const double* utrack,
+        const double* Tx,
+        const bool* track,
+        const bool* auto_mode,
+        const WindupMode* windup,
+        double* u);
+
+    /**
+     * @brief Saturation flags of the last step, one per controller
+     *
+     * SATURATED_HIGH and SATURATED_LOW bits as in PIDStepResult, zero
+     * after reset.
+     */
+    const unsigned char* saturation() const { return saturation_; }
+
+    /**
+     * @brief Feed each controller's saturation into its next step
+     *
+     * Works like PIDController::set_auto_windup(): the windup status of
+     * every controller is combined with its saturation flags from the
+     * previous step inside the update kernel.
+     *
+     * @param enabled Whether to use the internal saturation (default
+     *                off)
+     */
+    void set_auto_windup(bool enabled) { auto_windup_ = enabled; }
+
+    /**
+     * @brief Whether the internal saturation is fed back
+     */
+    bool auto_windup() const { return auto_windup_; }
+
+    /**
+     * @brief Select the update kernel
+     *
+     * @param kernel Kernel to use; AUTO picks the fastest one supported
+     *               by the running CPU
+     * @throws std::invalid_argument if the kernel is not supported
+     */
+    void set_kernel(PIDBankKernel kernel);
+
+    /**
+     * @brief Update kernel in use (never AUTO)
+     */
+    PIDBankKernel kernel() const { return kernel_; }
+
+    /**
+     * @brief Check whether a kernel is compiled in and supported by the
+     *        running CPU
+     *
+     * @param kernel Kernel to check
+     */
+    static bool kernel_supported(PIDBankKernel kernel);
+
+    /**
+     * @brief Use a cache for filter rediscretization
+     *
+     * The cache is not owned by the bank and must outlive it.
+     *
+     * @param cache Discretization cache, or nullptr to call zoh_Fy
+     *              directly (default)
+     */
+    void set_cache(ZohCache* cache) { cache_ = cache; }
+
+    /**
+     * @brief Select the filter rediscretization method
+     *
+     * Works like MeasurementFilter::set_method() for every controller.
+     *
+     * @param method Method used to evaluate exp
+     */
+    void set_zoh_method(ZohMethod method);
+
+    /**
+     * @brief Copy the state of every controller
+     *
+     * Filters that must rediscretize on their next step are reported
+     * as not initialized, with a NaN Tx_old.
+     *
+     * @param states Output array of size() states
+     */
+    void snapshot(PIDControllerState* states) const;
+
+    /**
+     * @brief Continue from the states of a snapshot
+     *
+     * The states may come from a bank or from PIDController objects
+     * with the same parameters, options and method. Filter parameters
+     * are recomputed as in MeasurementFilter::restore().
+     *
+     * @param states Array of size() states
+     */
+    void restore(const PIDControllerState* states);
+
+    /**
+     * @brief Reset the state of all controllers to zero
+     */
+    void reset();
+
+    /**
+     * @brief Reset the state of one controller to zero
+     *
+     * @param i Controller index
+     */
+    void reset(size_t i);
+
+private:
+    // Reads the state arrays
+    friend class StateEncoder;
+
+    // Places the field arrays in a shared-memory segment
+    friend class SharedPIDBank;
+
+    // Per-controller fields, each stored as one contiguous array
+    enum Field {
+        // Controller parameters not in the gain tables
+        U0, B,
+        // Signal states
+        U_OLD, UP_OLD, UD_OLD, UFF_OLD,
+        // Filter parameters
+        A11, A12, A21, A22, B1, B2,
+        // Filter states
+        YF, DYF, TX_OLD,
+        // Reference point for incremental rediscretization
+        TX_REF, H2_REF,
+        NUM_FIELDS
+    };
+
+    double* field(Field f) { return fields_ + f * stride_; }
+    const double* field(Field f) const { return fields_ + f * stride_; }
+
+    // Move the field arrays and saturation flags to external memory of
+    // NUM_FIELDS * stride_ doubles and stride_ bytes, which must outlive
+    // the bank
+    void place(double* fields, unsigned char* saturation);
+
+    // Rediscretize the filters begin to end whose execution period
+    // changed
+    void rediscretize(const double* Tx, size_t begin, size_t end);
+
+    // Kernel arguments for the given inputs and outputs
+    BankKernelArgs kernel_args(
+        const double* r,
+        const double* y,
+        const double* uff,
+        const double* uman,
+        const double* utrack,
+        const double* Tx,
+        const bool* track,
+        const bool* auto_mode,
+        const WindupMode* windup,
+        double* u);
+
+    // Switch to the published gain table and rescale the states
+    void swap_gains();
+
+    // Number of controllers and padded length of each field array
+    size_t n_;
+    size_t stride_;
+
+    // Backing storage for all field arrays, unless placed elsewhere
+    std::vector<double> storage_;
+    double* fields_;
+
+    // Double-buffered gain tables, the index of the one in use and
+    // whether the other one has been published
+    PIDGainTable tables_[2];
+    size_t active_;
+    std::atomic<bool> pending_;
+
+    // Saturation flags, their backing storage unless placed elsewhere,
+    // and automatic windup option
+    std::vector<unsigned char> saturation_storage_;
+    unsigned char* saturation_;
+    bool auto_windup_;
+
+    // Update kernel
+    PIDBankKernel kernel_;
+
+    // Optional discretization cache (not owned)
+    ZohCache* cache_;
+
+    // Rediscretization method
+    ZohMethod method_;
+};
+
+#endif // PID_BANK_H
@@ -0,0 +1,621 @@
+/**
+ * @file pid_bank_kernels.cpp
+ * @brief SIMD update kernels for the PID controller bank
+ *
+ * All kernels share one generic implementation written with GCC/Clang
+ * vector extensions and compiled for 2, 4 and 8 lanes. The branches of
+ * the scalar algorithm (auto/manual mode, tracking, P/PD reset and the
+ * windup modes) become lane masks, and std::min/std::max become
+ * selects with exactly the same comparison semantics, so every kernel
+ * gives bit-identical results to the scalar one. The array anti-windup
+ * and saturation kernels reuse the bank kernel's windup and clamp
+ * steps, and the event check kernels of EventDrivenBank the byte flag
+ * loads.
+ */
+
+#include "pid_bank_kernels.h"
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__clang__) || __GNUC__ >= 9)
+#if (defined(__x86_64__) || defined(__aarch64__)) \
+    && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define PID_BANK_SIMD 1
+#endif
+#if defined(__x86_64__)
+#define PID_BANK_X86 1
+#endif
+#endif
+
+#ifdef PID_BANK_SIMD
+
+#ifdef PID_BANK_X86
+#include <immintrin.h>
+#endif
+
+// The scalar kernel evaluates a * b + c as a rounded multiply followed
+// by a rounded add. Targets with FMA (AVX-512 implies it) would
+// otherwise contract these into fused operations and change results.
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#else
+#pragma GCC optimize("fp-contract=off")
+// The vector helpers are always inlined into the kernels below, so the
+// ABI for passing vectors to out-of-line functions never applies
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+#define PID_BANK_INLINE inline __attribute__((always_inline))
+
+// Bit tests below rely on UPPER and LOWER being separate bits
+static_assert(static_cast<int>(WindupMode::NONE) == 0 &&
+              static_cast<int>(WindupMode::UPPER) == 1 &&
+              static_cast<int>(WindupMode::LOWER) == 2 &&
+              static_cast<int>(WindupMode::BOTH) == 3,
+              "WindupMode values must encode UPPER and LOWER as bits");
+static_assert(sizeof(WindupMode) == sizeof(int),
+              "WindupMode must have the size of int");
+static_assert(sizeof(bool) == 1, "bool must be one byte");
+
+namespace {
+
+/**
+ * @brief Vector types for W double-precision lanes
+ */
+template <int W>
+struct Lanes {
+    typedef double vd __attribute__((vector_size(W * sizeof(double))));
+    typedef long long vm __attribute__((vector_size(W * sizeof(double))));
+    typedef int vi __attribute__((vector_size(W * sizeof(int))));
+    typedef unsigned char vb __attribute__((vector_size(W)));
+};
+
+template <class V, class T>
+PID_BANK_INLINE V load(const T* p) {
+    V v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+template <class V, class T>
+PID_BANK_INLINE void store(T* p, const V& v) {
+    std::memcpy(p, &v, sizeof(v));
+}
+
+// Lane-wise m ? a : b
+template <class VM, class VD>
+PID_BANK_INLINE VD select(const VM& m, const VD& a, const VD& b) {
+    return (VD)(((VM)a & m) | ((VM)b & ~m));
+}
+
+// Zero-extend W flag bytes to one lane each. Compilers split
+// __builtin_convertvector of a byte vector into scalar byte moves, so
+// the bytes are broadcast as one little-endian word and shifted into
+// place instead.
+template <int W>
+PID_BANK_INLINE typename Lanes<W>::vm load_bytes(const unsigned char* p) {
+    typedef typename Lanes<W>::vm vm;
+    unsigned long long word = 0;
+    std::memcpy(&word, p, W);
+    vm shift;
+    for (int k = 0; k < W; ++k) {
+        shift[k] = 8 * k;
+    }
+    return (((vm){} + static_cast<long long>(word)) >> shift) & 0xff;
+}
+
+// Windup masks of the UPPER and LOWER bits of each lane
+template <class VM>
+PID_BANK_INLINE void windup_masks(const VM& windup, VM& upper, VM& lower) {
+    const VM none = {};
+    upper = (windup & 1) != none;
+    lower = (windup & 2) != none;
+}
+
+// anti_windup() for each lane, as a clamp to bounds of zero in the
+// blocked directions and infinity in the others (comparisons with a
+// constant zero vector are split into scalar ones by GCC)
+template <class VM, class VD>
+PID_BANK_INLINE VD windup_lanes(
+    const VD& Dui, const VM& upper, const VM& lower) {
+    const VD zero = {};
+    const VD inf = zero + __builtin_inf();
+    VD lowest = select(lower, zero, -inf);
+    VD highest = select(upper, zero, inf);
+    VD result = select(Dui < lowest, lowest, Dui);
+    return select(highest < result, highest, result);
+}
+
+// saturate_with_flags() for each lane
+template <class VM, class VD>
+PID_BANK_INLINE VD saturate_lanes(
+    const VD& u, const VD& umin, const VD& umax, VM& saturation) {
+    VD result = select(umax < u, umax, u);
+    result = select(result < umin, umin, result);
+    saturation = ((result >= umax) & SATURATED_HIGH)
+        | ((result <= umin) & SATURATED_LOW);
+    return result;
+}
+
+/**
+ * @brief Vector kernel for W controllers per iteration
+ *
+ * @return Index of the first controller not processed
+ */
+template <int W>
+PID_BANK_INLINE size_t bank_kernel_lanes(
+    const BankKernelArgs& a, size_t begin, size_t end) {
+    typedef typename Lanes<W>::vd vd;
+    typedef typename Lanes<W>::vm vm;
+    typedef typename Lanes<W>::vi vi;
+    typedef typename Lanes<W>::vb vb;
+
+    const vd zero = {};
+    const vd one = zero + 1.0;
+    const vm none = {};
+    const vm feedback = (vm){} + a.feedback;
+
+    size_t i = begin;
+    for (; i + W <= end; i += W) {
+        // Filter updates
+        vd yf_prev = load<vd>(a.yf + i);
+        vd dyf_prev = load<vd>(a.dyf + i);
+        vd y = load<vd>(a.y + i);
+        vd Tx = load<vd>(a.Tx + i);
+        vd yf = load<vd>(a.a11 + i) * yf_prev
+            + load<vd>(a.a12 + i) * dyf_prev + load<vd>(a.b1 + i) * y;
+        vd dyf = load<vd>(a.a21 + i) * yf_prev
+            + load<vd>(a.a22 + i) * dyf_prev + load<vd>(a.b2 + i) * y;
+        store(a.Tx_old + i, Tx);
+        store(a.yf + i, yf);
+        store(a.dyf + i, dyf);
+
+        // Mode masks
+        vm auto_mode = load_bytes<W>(
+            reinterpret_cast<const unsigned char*>(a.auto_mode + i)) != none;
+        vm track = load_bytes<W>(
+            reinterpret_cast<const unsigned char*>(a.track + i)) != none;
+        vm windup = __builtin_convertvector(load<vi>(a.windup + i), vm)
+            | (load_bytes<W>(a.saturation + i) & feedback);
+        vm upper, lower;
+        windup_masks(windup, upper, lower);
+
+        vd kp = load<vd>(a.kp + i);
+        vd ki = load<vd>(a.ki + i);
+        vd kd = load<vd>(a.kd + i);
+        vd b = load<vd>(a.b + i);
+        vd u_old = load<vd>(a.u_old + i);
+        vd up_old = load<vd>(a.up_old + i);
+        vd ud_old = load<vd>(a.ud_old + i);
+        vd uff_old = load<vd>(a.uff_old + i);
+
+        // Reset state if using P or PD control (ki == 0)
+        vm reset = auto_mode & (ki == zero);
+        u_old = select(reset, load<vd>(a.u0 + i), u_old);
+        up_old = select(reset, zero, up_old);
+        ud_old = select(reset, zero, ud_old);
+        uff_old = select(reset, zero, uff_old);
+        b = select(reset, one, b);
+
+        // Tracking mode for bumpless transfer
+        vm tracking = auto_mode & track;
+        u_old = select(tracking, load<vd>(a.utrack + i), u_old);
+        up_old = select(tracking, zero, up_old);
+        ud_old = select(tracking, zero, ud_old);
+        uff_old = select(tracking, zero, uff_old);
+
+        // Control signal increments
+        vd r = load<vd>(a.r + i);
+        vd uff = load<vd>(a.uff + i);
+        vd up = kp * (b * r - yf);
+        vd ud = -kd * dyf;
+        vd Dup = up - up_old;
+        vd Dui = ki * (r - yf) * Tx;
+        Dui = windup_lanes(Dui, upper, lower);
+        vd Dud = (ud - ud_old) / Tx;
+        vd Duff = uff - uff_old;
+
+        // Add control signal increment, or use manual control signal
+        vd Du = Dup + Dui + Dud + Duff;
+        vd u = select(auto_mode, u_old + Du, load<vd>(a.uman + i));
+
+        // Saturate control signal
+        vm saturation;
+        u = saturate_lanes(
+            u, load<vd>(a.umin + i), load<vd>(a.umax + i), saturation);
+        store(a.saturation + i, __builtin_convertvector(saturation, vb));
+
+        // Update old signal states
+        store(a.b + i, b);
+        store(a.u_old + i, u);
+        store(a.up_old + i, up);
+        store(a.ud_old + i, ud);
+        store(a.uff_old + i, uff);
+        store(a.u + i, u);
+    }
+    return i;
+}
+
+/**
+ * @brief Array anti-windup for W elements per iteration
+ *
+ * @return Index of the first element not processed
+ */
+template <int W>
+PID_BANK_INLINE size_t windup_kernel_lanes(
+    double* Dui, const unsigned char* windup, size_t begin, size_t end) {
+    typedef typename Lanes<W>::vd vd;
+    typedef typename Lanes<W>::vm vm;
+
+    size_t i = begin;
+    for (; i + W <= end; i += W) {
+        vm upper, lower;
+        windup_masks(load_bytes<W>(windup + i), upper, lower);
+        store(Dui + i, windup_lanes(load<vd>(Dui + i), upper, lower));
+    }
+    return i;
+}
+
+/**
+ * @brief Array clamp and saturation flags for W elements per iteration
+ *
+ * @return Index of the first element not processed
+ */
+template <int W>
+PID_BANK_INLINE size_t saturation_kernel_lanes(
+    double* u,
+    const double* umin,
+    const double* umax,
+    unsigned char* saturation,
+    size_t begin,
+    size_t end) {
+    typedef typename Lanes<W>::vd vd;
+    typedef typename Lanes<W>::vm vm;
+    typedef typename Lanes<W>::vb vb;
+
+    size_t i = begin;
+    for (; i + W <= end; i += W) {
+        vm flags;
+        store(u + i, saturate_lanes(load<vd>(u + i), load<vd>(umin + i),
+                                    load<vd>(umax + i), flags));
+        store(saturation + i, __builtin_convertvector(flags, vb));
+    }
+    return i;
+}
+
+/**
+ * @brief Event checks for W controllers per iteration
+ *
+ * @return Index of the first controller not processed
+ */
+template <int W>
+PID_BANK_INLINE size_t event_kernel_lanes(
+    const EventKernelArgs& a, size_t begin, size_t end) {
+    typedef typename Lanes<W>::vd vd;
+    typedef typename Lanes<W>::vm vm;
+    typedef typename Lanes<W>::vi vi;
+    typedef typename Lanes<W>::vb vb;
+
+    const vm magnitude = (vm){} + 0x7fffffffffffffffLL;
+
+    size_t i = begin;
+    for (; i + W <= end; i += W) {
+        vd elapsed = load<vd>(a.elapsed + i) + load<vd>(a.Tx + i);
+        store(a.elapsed + i, elapsed);
+
+        // Changes beyond the deadbands, as !(|change| <= deadband) so
+        // that NaN is due
+        vd dr = (vd)((vm)(load<vd>(a.r + i) - load<vd>(a.last_r + i))
+                     & magnitude);
+        vd dy = (vd)((vm)(load<vd>(a.y + i) - load<vd>(a.last_y + i))
+                     & magnitude);
+        vd duff = (vd)((vm)(load<vd>(a.uff + i)
+                            - load<vd>(a.last_uff + i)) & magnitude);
+        vd duman = (vd)((vm)(load<vd>(a.uman + i)
+                             - load<vd>(a.last_uman + i)) & magnitude);
+        vd dutrack = (vd)((vm)(load<vd>(a.utrack + i)
+                               - load<vd>(a.last_utrack + i)) & magnitude);
+
+        // Each condition as a 0 or 1 lane: GCC splits the & of two
+        // AVX-512 comparisons into scalar ones, but not a comparison &
+        // a constant
+        vd deadband_u = load<vd>(a.deadband_u + i);
+        vm within = ((dr <= load<vd>(a.deadband_r + i)) & 1)
+            & ((dy <= load<vd>(a.deadband_y + i)) & 1)
+            & ((duff <= load<vd>(a.deadband_uff + i)) & 1)
+            & ((duman <= deadband_u) & 1)
+            & ((dutrack <= deadband_u) & 1);
+
+        // Mode changes, timeout and forced steps
+        vm modes = load_bytes<W>(
+                reinterpret_cast<const unsigned char*>(a.track + i))
+            | load_bytes<W>(
+                reinterpret_cast<const unsigned char*>(a.auto_mode + i)) << 1
+            | __builtin_convertvector(load<vi>(a.windup + i), vm) << 2;
+        vm due = (within ^ 1)
+            | ((modes != load_bytes<W>(a.last_modes + i)) & 1)
+            | ((elapsed >= load<vd>(a.max_interval + i)) & 1)
+            | load_bytes<W>(a.force + i);
+        store(a.due + i, __builtin_convertvector(due, vb));
+    }
+    return i;
+}
+
+// Lane k of p[index[k]]
+template <class VD, class VM>
+PID_BANK_INLINE VD gather(const double* p, const VM& index) {
+    VD v;
+    for (int k = 0; k < static_cast<int>(sizeof(VD) / sizeof(double));
+         ++k) {
+        v[k] = p[index[k]];
+    }
+    return v;
+}
+
+#ifdef PID_BANK_X86
+// Gather instructions for 4 and 8 lanes, which compilers do not make
+// of the lane loop above. Not always inlined: they can only be inlined
+// once the calling kernel has been inlined into a function of the same
+// target.
+template <>
+__attribute__((target("avx2")))
+inline Lanes<4>::vd gather(const double* p, const Lanes<4>::vm& index) {
+    // The masked forms leave no lane undefined, which GCC 12 would
+    // warn about
+    __m256d zero = _mm256_setzero_pd();
+    return (Lanes<4>::vd)_mm256_mask_i64gather_pd(
+        zero, p, (__m256i)index, (__m256d)(zero == zero), 8);
+}
+
+template <>
+__attribute__((target("avx512f")))
+inline Lanes<8>::vd gather(const double* p, const Lanes<8>::vm& index) {
+    return (Lanes<8>::vd)_mm512_mask_i64gather_pd(
+        _mm512_setzero_pd(), 0xff, (__m512i)index, p, 8);
+}
+#endif
+
+// Breakpoint tables up to this size are searched by counting the
+// breakpoints at or below each point, without gathers
+const int GAIN_COUNT_BREAKPOINTS = 32;
+
+/**
+ * @brief Gain schedule lookup for W operating points per iteration
+ *
+ * Same segment and interpolation as GainSchedule::lookup. Without even
+ * spacing, the segment of small tables is the number of breakpoints
+ * after the first at or below the point, counted on all lanes at once.
+ * Larger tables are searched lane by lane: a binary search with a
+ * gather per halving was no faster, as each gather waits on the last.
+ *
+ * @return Index of the first operating point not processed
+ */
+template <int W>
+PID_BANK_INLINE size_t gain_lookup_kernel_lanes(
+    const GainLookupArgs& a, size_t begin, size_t end) {
+    typedef typename Lanes<W>::vd vd;
+    typedef typename Lanes<W>::vm vm;
+    typedef typename Lanes<W>::vi vi;
+
+    const vd zero = {};
+    const vd x_first = zero + a.x_first;
+    const vd x_last = zero + a.x_last;
+    const vd inverse_spacing = zero + a.inverse_spacing;
+    const vd last_segment = zero + static_cast<double>(a.breakpoints - 1);
+
+    size_t i = begin;
+    for (; i + W <= end; i += W) {
+        vd x = load<vd>(a.x + i);
+
+        // Segment index
+        vm k = {};
+        if (a.uniform) {
+            // !(t > 0) gives segment 0, also for NaN
+            vd t = (x - x_first) * inverse_spacing;
+            t = select(t > zero, t, zero);
+            t = select(t < last_segment, t, last_segment);
+            k = __builtin_convertvector(__builtin_convertvector(t, vi), vm);
+        } else if (a.breakpoints <= GAIN_COUNT_BREAKPOINTS) {
+            for (int j = 1; j < a.breakpoints; ++j) {
+                k += (a.x_break[j] <= x) & 1;
+            }
+        } else {
+            for (int lane = 0; lane < W; ++lane) {
+                const double* base = a.x_break;
+                for (int length = a.breakpoints; length > 1;) {
+                    int half = length / 2;
+                    base = base[half] <= x[lane] ? base + half : base;
+                    length -= half;
+                }
+                k[lane] = base - a.x_break;
+            }
+        }
+
+        // Interpolation at the operating point held to the range
+        vd held = select(x < x_first, x_first, x);
+        held = select(x_last < held, x_last, held);
+        vd dx = held - gather<vd>(a.x_break, k);
+        store(a.kp + i, gather<vd>(a.kp_break, k)
+                            + gather<vd>(a.kp_slope, k) * dx);
+        store(a.ki + i, gather<vd>(a.ki_break, k)
+                            + gather<vd>(a.ki_slope, k) * dx);
+        store(a.kd + i, gather<vd>(a.kd_break, k)
+                            + gather<vd>(a.kd_slope, k) * dx);
+    }
+    return i;
+}
+
+void kernel_simd128(const BankKernelArgs& args, size_t begin, size_t end) {
+    size_t i = bank_kernel_lanes<2>(args, begin, end);
+    pid_bank_kernel_scalar(args, i, end);
+}
+
+// Array kernels finish the elements after the last whole vector with
+// the scalar kernels
+void windup_simd128(
+    double* Dui, const unsigned char* windup, size_t begin, size_t end) {
+    size_t i = windup_kernel_lanes<2>(Dui, windup, begin, end);
+    pid_windup_kernel_scalar(Dui, windup, i, end);
+}
+
+void saturation_simd128(
+    double* u, const double* umin, const double* umax,
+    unsigned char* saturation, size_t begin, size_t end) {
+    size_t i = saturation_kernel_lanes<2>(
+        u, umin, umax, saturation, begin, end);
+    pid_saturation_kernel_scalar(u, umin, umax, saturation, i, end);
+}
+
+void event_simd128(
+    const EventKernelArgs& args, size_t begin, size_t end) {
+    size_t i = event_kernel_lanes<2>(args, begin, end);
+    pid_event_kernel_scalar(args, i, end);
+}
+
+void gain_lookup_simd128(
+    const GainLookupArgs& args, size_t begin, size_t end) {
+    size_t i = gain_lookup_kernel_lanes<2>(args, begin, end);
+    pid_gain_lookup_kernel_scalar(args, i, end);
+}
+
+#ifdef PID_BANK_X86
+__attribute__((target("avx2")))
+void kernel_avx2(const BankKernelArgs& args, size_t begin, size_t end) {
+    size_t i = bank_kernel_lanes<4>(args, begin, end);
+    pid_bank_kernel_scalar(args, i, end);
+}
+
+__attribute__((target("avx2")))
+void windup_avx2(
+    double* Dui, const unsigned char* windup, size_t begin, size_t end) {
+    size_t i = windup_kernel_lanes<4>(Dui, windup, begin, end);
+    pid_windup_kernel_scalar(Dui, windup, i, end);
+}
+
+__attribute__((target("avx2")))
+void saturation_avx2(
+    double* u, const double* umin, const double* umax,
+    unsigned char* saturation, size_t begin, size_t end) {
+    size_t i = saturation_kernel_lanes<4>(
+        u, umin, umax, saturation, begin, end);
+    pid_saturation_kernel_scalar(u, umin, umax, saturation, i, end);
+}
+
+__attribute__((target("avx2")))
+void event_avx2(const EventKernelArgs& args, size_t begin, size_t end) {
+    size_t i = event_kernel_lanes<4>(args, begin, end);
+    pid_event_kernel_scalar(args, i, end);
+}
+
+__attribute__((target("avx2")))
+void gain_lookup_avx2(
+    const GainLookupArgs& args, size_t begin, size_t end) {
+    size_t i = gain_lookup_kernel_lanes<4>(args, begin, end);
+    pid_gain_lookup_kernel_scalar(args, i, end);
+}
+
+__attribute__((target("avx512f")))
+void kernel_avx512(const BankKernelArgs& args, size_t begin, size_t end) {
+    size_t i = bank_kernel_lanes<8>(args, begin, end);
+    pid_bank_kernel_scalar(args, i, end);
+}
+
+__attribute__((target("avx512f")))
+void windup_avx512(
+    double* Dui, const unsigned char* windup, size_t begin, size_t end) {
+    size_t i = windup_kernel_lanes<8>(Dui, windup, begin, end);
+    pid_windup_kernel_scalar(Dui, windup, i, end);
+}
+
+__attribute__((target("avx512f")))
+void saturation_avx512(
+    double* u, const double* umin, const double* umax,
+    unsigned char* saturation, size_t begin, size_t end) {
+    size_t i = saturation_kernel_lanes<8>(
+        u, umin, umax, saturation, begin, end);
+    pid_saturation_kernel_scalar(u, umin, umax, saturation, i, end);
+}
+
+__attribute__((target("avx512f")))
+void event_avx512(const EventKernelArgs& args, size_t begin, size_t end) {
+    size_t i = event_kernel_lanes<8>(args, begin, end);
+    pid_event_kernel_scalar(args, i, end);
+}
+
+__attribute__((target("avx512f")))
+void gain_lookup_avx512(
+    const GainLookupArgs& args, size_t begin, size_t end) {
+    size_t i = gain_lookup_kernel_lanes<8>(args, begin, end);
+    pid_gain_lookup_kernel_scalar(args, i, end);
+}
+#endif
+
+} // namespace
+
+const BankKernelFunction pid_bank_kernel_simd128 = kernel_simd128;
+const WindupKernelFunction pid_windup_kernel_simd128 = windup_simd128;
+const SaturationKernelFunction pid_saturation_kernel_simd128 =
+    saturation_simd128;
+const EventKernelFunction pid_event_kernel_simd128 = event_simd128;
+const GainLookupKernelFunction pid_gain_lookup_kernel_simd128 =
+    gain_lookup_simd128;
+
+#ifdef PID_BANK_X86
+const BankKernelFunction pid_bank_kernel_avx2 = kernel_avx2;
+const BankKernelFunction pid_bank_kernel_avx512 = kernel_avx512;
+const WindupKernelFunction pid_windup_kernel_avx2 = windup_avx2;
+const WindupKernelFunction pid_windup_kernel_avx512 = windup_avx512;
+const SaturationKernelFunction pid_saturation_kernel_avx2 = saturation_avx2;
+const SaturationKernelFunction pid_saturation_kernel_avx512 =
+    saturation_avx512;
+const EventKernelFunction pid_event_kernel_avx2 = event_avx2;
+const EventKernelFunction pid_event_kernel_avx512 = event_avx512;
+const GainLookupKernelFunction pid_gain_lookup_kernel_avx2 =
+    gain_lookup_avx2;
+const GainLookupKernelFunction pid_gain_lookup_kernel_avx512 =
+    gain_lookup_avx512;
+
+bool pid_bank_cpu_has_avx2() {
+    return __builtin_cpu_supports("avx2");
+}
+
+bool pid_bank_cpu_has_avx512() {
+    return __builtin_cpu_supports("avx512f");
+}
+#else
+const BankKernelFunction pid_bank_kernel_avx2 = 0;
+const BankKernelFunction pid_bank_kernel_avx512 = 0;
+const WindupKernelFunction pid_windup_kernel_avx2 = 0;
+const WindupKernelFunction pid_windup_kernel_avx512 = 0;
+const SaturationKernelFunction pid_saturation_kernel_avx2 = 0;
+const SaturationKernelFunction pid_saturation_kernel_avx512 = 0;
+const EventKernelFunction pid_event_kernel_avx2 = 0;
+const EventKernelFunction pid_event_kernel_avx512 = 0;
+const GainLookupKernelFunction pid_gain_lookup_kernel_avx2 = 0;
+const GainLookupKernelFunction pid_gain_lookup_kernel_avx512 = 0;
+
+bool pid_bank_cpu_has_avx2() { return false; }
+bool pid_bank_cpu_has_avx512() { return false; }
+#endif
+
+#else // PID_BANK_SIMD
+
+const BankKernelFunction pid_bank_kernel_simd128 = 0;
+const BankKernelFunction pid_bank_kernel_avx2 = 0;
+const BankKernelFunction pid_bank_kernel_avx512 = 0;
+const WindupKernelFunction pid_windup_kernel_simd128 = 0;
+const WindupKernelFunction pid_windup_kernel_avx2 = 0;
+const WindupKernelFunction pid_windup_kernel_avx512 = 0;
+const SaturationKernelFunction pid_saturation_kernel_simd128 = 0;
+const SaturationKernelFunction pid_saturation_kernel_avx2 = 0;
+const SaturationKernelFunction pid_saturation_kernel_avx512 = 0;
+const EventKernelFunction pid_event_kernel_simd128 = 0;
+const EventKernelFunction pid_event_kernel_avx2 = 0;
+const EventKernelFunction pid_event_kernel_avx512 = 0;
+const GainLookupKernelFunction pid_gain_lookup_kernel_simd128 = 0;
+const GainLookupKernelFunction pid_gain_lookup_kernel_avx2 = 0;
+const GainLookupKernelFunction pid_gain_lookup_kernel_avx512 = 0;
+
+bool pid_bank_cpu_has_avx2() { return false; }
+bool pid_bank_cpu_has_avx512() { return false; }
+
+#endif // PID_BANK_SIMD
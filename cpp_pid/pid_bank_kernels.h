@@ -0,0 +1,246 @@
+/**
+ * @file pid_bank_kernels.h
+ * @brief Update kernels used internally by PIDBank
+ *
+ * This file declares the per-instruction-set kernels that compute the
+ * measurement filter state update and the PID control signal for a
+ * range of controllers in a PIDBank, the array anti-windup and
+ * saturation kernels behind anti_windup.h, and the batch lookup kernels
+ * behind GainSchedule. It is an internal header and is not needed by
+ * users of PIDBank.
+ */
+
+#ifndef PID_BANK_KERNELS_H
+#define PID_BANK_KERNELS_H
+
+#include "anti_windup.h"
+#include <cstddef>
+
+/**
+ * @brief Arrays accessed by a bank update kernel
+ *
+ * Filter parameters must already match the execution periods Tx; the
+ * kernels never rediscretize.
+ */
+struct BankKernelArgs {
+    // Controller parameters
+    const double* kp;
+    const double* ki;
+    const double* kd;
+    const double* umin;
+    const double* umax;
+    const double* u0;
+    double* b;
+
+    // Signal states
+    double* u_old;
+    double* up_old;
+    double* ud_old;
+    double* uff_old;
+
+    // Filter parameters
+    const double* a11;
+    const double* a12;
+    const double* a21;
+    const double* a22;
+    const double* b1;
+    const double* b2;
+
+    // Filter states
+    double* yf;
+    double* dyf;
+    double* Tx_old;
+
+    // Inputs
+    const double* r;
+    const double* y;
+    const double* uff;
+    const double* uman;
+    const double* utrack;
+    const double* Tx;
+    const bool* track;
+    const bool* auto_mode;
+    const WindupMode* windup;
+
+    // Saturation flags of the previous step, replaced by those of this
+    // step, and the mask of previous flags added to windup (0 or 3)
+    unsigned char* saturation;
+    unsigned char feedback;
+
+    // Output
+    double* u;
+};
+
+/**
+ * @brief Bank update kernel for controllers in [begin, end)
+ */
+typedef void (*BankKernelFunction)(
+    const BankKernelArgs& args, size_t begin, size_t end);
+
+void pid_bank_kernel_scalar(
+    const BankKernelArgs& args, size_t begin, size_t end);
+
+/**
+ * @brief SIMD kernels, null when not compiled for this target
+ */
+extern const BankKernelFunction pid_bank_kernel_simd128;
+extern const BankKernelFunction pid_bank_kernel_avx2;
+extern const BankKernelFunction pid_bank_kernel_avx512;
+
+/**
+ * @brief Array anti-windup kernel for elements [begin, end)
+ */
+typedef void (*WindupKernelFunction)(
+    double* Dui, const unsigned char* windup, size_t begin, size_t end);
+
+/**
+ * @brief Array clamp and saturation flag kernel for elements
+ *        [begin, end)
+ */
+typedef void (*SaturationKernelFunction)(
+    double* u,
+    const double* umin,
+    const double* umax,
+    unsigned char* saturation,
+    size_t begin,
+    size_t end);
+
+void pid_windup_kernel_scalar(
+    double* Dui, const unsigned char* windup, size_t begin, size_t end);
+void pid_saturation_kernel_scalar(
+    double* u,
+    const double* umin,
+    const double* umax,
+    unsigned char* saturation,
+    size_t begin,
+    size_t end);
+
+/**
+ * @brief SIMD array kernels, null when not compiled for this target
+ */
+extern const WindupKernelFunction pid_windup_kernel_simd128;
+extern const WindupKernelFunction pid_windup_kernel_avx2;
+extern const WindupKernelFunction pid_windup_kernel_avx512;
+extern const SaturationKernelFunction pid_saturation_kernel_simd128;
+extern const SaturationKernelFunction pid_saturation_kernel_avx2;
+extern const SaturationKernelFunction pid_saturation_kernel_avx512;
+
+/**
+ * @brief Arrays read and written by the event check kernels
+ *
+ * For controllers i in [begin, end), the kernel adds Tx[i] to
+ * elapsed[i] and sets due[i] to 1 if the inputs moved beyond the
+ * deadbands since the last step, the packed mode byte (track |
+ * auto_mode << 1 | windup << 2) differs from last_modes[i], elapsed[i]
+ * reached max_interval[i] or force[i] is set, and to 0 otherwise.
+ */
+struct EventKernelArgs {
+    // Inputs of this tick
+    const double* r;
+    const double* y;
+    const double* uff;
+    const double* uman;
+    const double* utrack;
+    const double* Tx;
+    const bool* track;
+    const bool* auto_mode;
+    const WindupMode* windup;
+
+    // Step conditions
+    const double* deadband_r;
+    const double* deadband_y;
+    const double* deadband_uff;
+    const double* deadband_u;
+    const double* max_interval;
+
+    // Inputs of the last step
+    const double* last_r;
+    const double* last_y;
+    const double* last_uff;
+    const double* last_uman;
+    const double* last_utrack;
+    const unsigned char* last_modes;
+
+    // Time since the last step, forced steps and the result
+    double* elapsed;
+    const unsigned char* force;
+    unsigned char* due;
+};
+
+/**
+ * @brief Event check kernel for controllers [begin, end)
+ */
+typedef void (*EventKernelFunction)(
+    const EventKernelArgs& args, size_t begin, size_t end);
+
+void pid_event_kernel_scalar(
+    const EventKernelArgs& args, size_t begin, size_t end);
+
+/**
+ * @brief SIMD event check kernels, null when not compiled for this
+ *        target
+ */
+extern const EventKernelFunction pid_event_kernel_simd128;
+extern const EventKernelFunction pid_event_kernel_avx2;
+extern const EventKernelFunction pid_event_kernel_avx512;
+
+class GainSchedule;
+
+/**
+ * @brief Arrays read and written by the gain schedule lookup kernels
+ *
+ * For operating points i in [begin, end), the kernel writes the gains
+ * GainSchedule::lookup(x[i], kp[i], ki[i], kd[i]) would give. The
+ * breakpoint columns and segment search parameters are those of the
+ * schedule, which the scalar kernel looks up through directly.
+ */
+struct GainLookupArgs {
+    // Schedule and its per-breakpoint columns
+    const GainSchedule* schedule;
+    const double* x_break;
+    const double* kp_break;
+    const double* ki_break;
+    const double* kd_break;
+    const double* kp_slope;
+    const double* ki_slope;
+    const double* kd_slope;
+
+    // Segment search: scaling for evenly spaced breakpoints, binary
+    // search otherwise
+    int breakpoints;
+    bool uniform;
+    double inverse_spacing;
+    double x_first;
+    double x_last;
+
+    // Operating points and output gains
+    const double* x;
+    double* kp;
+    double* ki;
+    double* kd;
+};
+
+/**
+ * @brief Gain schedule lookup kernel for operating points [begin, end)
+ */
+typedef void (*GainLookupKernelFunction)(
+    const GainLookupArgs& args, size_t begin, size_t end);
+
+void pid_gain_lookup_kernel_scalar(
+    const GainLookupArgs& args, size_t begin, size_t end);
+
+/**
+ * @brief SIMD gain schedule lookup kernels, null when not compiled for
+ *        this target
+ */
+extern const GainLookupKernelFunction pid_gain_lookup_kernel_simd128;
+extern const GainLookupKernelFunction pid_gain_lookup_kernel_avx2;
+extern const GainLookupKernelFunction pid_gain_lookup_kernel_avx512;
+
+/**
+ * @brief Check whether the running CPU supports AVX2 / AVX-512F
+ */
+bool pid_bank_cpu_has_avx2();
+bool pid_bank_cpu_has_avx512();
+
+#endif // PID_BANK_KERNELS_H
@@ -0,0 +1,79 @@
+/**
+ * @file pid_sweep.cpp
+ * @brief Implementation of the parallel parameter sweep
+ */
+
+#include "pid_sweep.h"
+#include "pid.h"
+#include <cmath>
+#include <mutex>
+
+SweepConfig sweep_config(const SweepGrid& grid, size_t index) {
+    SweepConfig config;
+    config.TfTs = grid.TfTs[index % grid.TfTs.size()];
+    index /= grid.TfTs.size();
+    config.kd = grid.kd[index % grid.kd.size()];
+    index /= grid.kd.size();
+    config.ki = grid.ki[index % grid.ki.size()];
+    index /= grid.ki.size();
+    config.kp = grid.kp[index];
+    return config;
+}
+
+SweepMetrics sweep_metrics(
+    const InputSeries& inputs,
+    const double* u,
+    const double* u_ref,
+    double umin,
+    double umax) {
+    SweepMetrics metrics;
+    metrics.u_iae = 0.0;
+    metrics.u_ise = 0.0;
+    metrics.saturation_time = 0.0;
+    for (size_t i = 0; i < inputs.n; ++i) {
+        double Tx = inputs.Tx ? inputs.Tx[i] : 1.0;
+        double e = u_ref ? u[i] - u_ref[i] : u[i];
+        metrics.u_iae += std::abs(e) * Tx;
+        metrics.u_ise += e * e * Tx;
+        if (u[i] <= umin || u[i] >= umax) {
+            metrics.saturation_time += Tx;
+        }
+    }
+    return metrics;
+}
+
+void pid_sweep(
+    const SweepGrid& grid,
+    const InputSeries& inputs,
+    const SweepCallback& callback,
+    ThreadPool& pool,
+    const double* u_ref) {
+    // One output buffer per worker
+    std::vector<std::vector<double> > buffers(pool.size());
+    std::mutex callback_mutex;
+
+    pool.parallel_for(grid.size(), [&](size_t index, size_t worker) {
+        std::vector<double>& u = buffers[worker];
+        u.resize(inputs.n);
+
+        SweepResult result;
+        result.index = index;
+        result.config = sweep_config(grid, index);
+        PIDController controller(
+            result.config.kp,
+            result.config.ki,
+            result.config.kd,
+            result.config.TfTs,
+            grid.umin,
+            grid.umax,
+            grid.u0,
+            grid.b);
+        controller.run(inputs, u.data());
+        result.metrics =
+            sweep_metrics(inputs, u.data(), u_ref, grid.umin, grid.umax);
+        result.u = u.data();
+
+        std::lock_guard<std::mutex> lock(callback_mutex);
+        callback(result);
+    });
+}
@@ -0,0 +1,141 @@
+/**
+ * @file pid_sweep.h
+ * @brief Parallel sweep of PID controller parameters over a trajectory
+ *
+ * This file provides a tuning tool that runs one PIDController per
+ * point of a parameter grid over the same recorded input series, on
+ * all cores, and reports cost metrics for each configuration.
+ */
+
+#ifndef PID_SWEEP_H
+#define PID_SWEEP_H
+
+#include "input_series.h"
+#include "thread_pool.h"
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <vector>
+
+/**
+ * @brief Grid of controller parameters
+ *
+ * The grid is the Cartesian product of the parameter lists, with the
+ * last list (TfTs) varying fastest. The limits, bias and setpoint
+ * weight are shared by all configurations.
+ */
+struct SweepGrid {
+    std::vector<double> kp;    ///< Proportional gains
+    std::vector<double> ki;    ///< Integral gains
+    std::vector<double> kd;    ///< Derivative gains
+    std::vector<double> TfTs;  ///< Filter time constants
+    double umin;               ///< Minimum control signal
+    double umax;               ///< Maximum control signal
+    double u0;                 ///< Bias term for P or PD control
+    double b;                  ///< Setpoint weight for proportional term
+
+    SweepGrid()
+        : TfTs(1, 10.0),
+          umin(-std::numeric_limits<double>::infinity()),
+          umax(std::numeric_limits<double>::infinity()),
+          u0(0.0),
+          b(1.0) {}
+
+    /**
+     * @brief Number of configurations
+     */
+    size_t size() const {
+        return kp.size() * ki.size() * kd.size() * TfTs.size();
+    }
+};
+
+/**
+ * @brief One controller configuration of a grid
+ */
+struct SweepConfig {
+    double kp;
+    double ki;
+    double kd;
+    double TfTs;
+};
+
+/**
+ * @brief Cost metrics of one run
+ *
+ * The sweep replays a recorded trajectory open loop, so it has no
+ * control error r - y of its own. The integrals are instead over the
+ * control signal deviation u - u_ref when a reference control signal
+ * is given, and over u otherwise; all sums are weighted by the
+ * execution period Tx.
+ */
+struct SweepMetrics {
+    double u_iae;            ///< Integral of |u - u_ref|
+    double u_ise;            ///< Integral of (u - u_ref)^2
+    double saturation_time;  ///< Time with u at umin or umax
+};
+
+/**
+ * @brief Result of one configuration
+ */
+struct SweepResult {
+    size_t index;          ///< Configuration index in the grid
+    SweepConfig config;    ///< Controller parameters
+    SweepMetrics metrics;  ///< Cost metrics
+    const double* u;       ///< Control signal, valid during the callback
+};
+
+/**
+ * @brief Function receiving each result as soon as it is computed
+ */
+typedef std::function<void(const SweepResult&)> SweepCallback;
+
+/**
+ * @brief Get a configuration of a grid
+ *
+ * @param grid Parameter grid
+ * @param index Configuration index in [0, grid.size())
+ * @return Controller parameters at index
+ */
+SweepConfig sweep_config(const SweepGrid& grid, size_t index);
+
+/**
+ * @brief Compute the cost metrics of a control signal
+ *
+ * @param inputs Inputs of the run (for Tx)
+ * @param u Control signal, inputs.n values
+ * @param u_ref Reference control signal, or nullptr
+ * @param umin Minimum control signal
+ * @param umax Maximum control signal
+ * @return Cost metrics
+ */
+SweepMetrics sweep_metrics(
+    const InputSeries& inputs,
+    const double* u,
+    const double* u_ref,
+    double umin,
+    double umax);
+
+/**
+ * @brief Run every configuration of a grid over an input series
+ *
+ * Each configuration runs a fresh PIDController with
+ * PIDController::run. Configurations are spread over the workers of
+ * the pool, and each worker reuses one output buffer, so memory use
+ * does not grow with the size of the grid. Calls to the callback are
+ * serialized, in no particular order.
+ *
+ * @param grid Parameter grid
+ * @param inputs Input series shared by all runs
+ * @param callback Function receiving each result
+ * @param pool Worker threads to use
+ * @param u_ref Reference control signal for the metrics (default:
+ *              nullptr)
+ */
+void pid_sweep(
+    const SweepGrid& grid,
+    const InputSeries& inputs,
+    const SweepCallback& callback,
+    ThreadPool& pool,
+    const double* u_ref = nullptr);
+
+#endif // PID_SWEEP_H
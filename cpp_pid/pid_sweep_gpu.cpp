@@ -0,0 +1,29 @@
+/**
+ * @file pid_sweep_gpu.cpp
+ * @brief GPU sweep entry points for builds without CUDA
+ *
+ * Builds with PID_ENABLE_CUDA compile pid_sweep_gpu.cu with nvcc
+ * instead, which defines the same functions.
+ */
+
+#include "pid_sweep_gpu.h"
+
+#ifndef PID_ENABLE_CUDA
+
+#include <stdexcept>
+
+bool pid_sweep_gpu_available() {
+    return false;
+}
+
+void pid_sweep_gpu(
+    const SweepGrid&,
+    const InputSeries&,
+    const SweepCallback&,
+    const double*,
+    const GpuSweepOptions&) {
+    throw std::runtime_error(
+        "pid_sweep_gpu requires a build with PID_ENABLE_CUDA");
+}
+
+#endif // PID_ENABLE_CUDA
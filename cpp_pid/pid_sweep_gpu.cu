@@ -0,0 +1,347 @@
+/**
+ * @file pid_sweep_gpu.cu
+ * @brief CUDA implementation of the GPU parameter sweep
+ *
+ * Compile with nvcc and PID_ENABLE_CUDA, and define PID_ENABLE_CUDA
+ * for the C++ files too so that pid_sweep_gpu.cpp leaves these
+ * functions to this file.
+ */
+
+#include "pid_sweep_gpu.h"
+#include "sweep_lane.h"
+#include <cuda_runtime.h>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Input flags packed into one byte per step
+const unsigned char FLAG_AUTO = 1;
+const unsigned char FLAG_TRACK = 2;
+const int WINDUP_SHIFT = 2;
+
+// Number of double columns in a shared memory tile
+const size_t TILE_COLUMNS = 7;
+
+// Shared memory every device provides to a block without opting in
+const size_t MAX_SHARED_BYTES = 48 * 1024;
+
+// Throw on a failed CUDA call
+void check(cudaError_t status, const char* what) {
+    if (status != cudaSuccess) {
+        throw std::runtime_error(std::string(what) + ": "
+                                 + cudaGetErrorString(status));
+    }
+}
+
+// Device array freed on scope exit
+template <class T>
+class DeviceBuffer {
+public:
+    explicit DeviceBuffer(size_t n) : data_(nullptr) {
+        if (n > 0) {
+            check(cudaMalloc(reinterpret_cast<void**>(&data_),
+                             n * sizeof(T)),
+                  "cudaMalloc");
+        }
+    }
+
+    ~DeviceBuffer() { cudaFree(data_); }
+
+    DeviceBuffer(const DeviceBuffer&) = delete;
+    DeviceBuffer& operator=(const DeviceBuffer&) = delete;
+
+    T* get() const { return data_; }
+
+    void upload(const T* host, size_t n) {
+        check(cudaMemcpy(data_, host, n * sizeof(T),
+                         cudaMemcpyHostToDevice),
+              "cudaMemcpy to device");
+    }
+
+    void download(T* host, size_t n) const {
+        check(cudaMemcpy(host, data_, n * sizeof(T),
+                         cudaMemcpyDeviceToHost),
+              "cudaMemcpy to host");
+    }
+
+private:
+    T* data_;
+};
+
+// Input columns on the device, with defaults filled in
+struct DeviceInputs {
+    size_t n;
+    const double* r;
+    const double* y;
+    const double* uff;
+    const double* uman;
+    const double* utrack;
+    const double* Tx;
+    const double* u_ref;          // nullptr without reference
+    const unsigned char* flags;   // FLAG_AUTO, FLAG_TRACK and windup
+};
+
+// Configurations of one batch
+struct DeviceConfigs {
+    size_t count;
+    const double* kp;
+    const double* ki;
+    const double* kd;
+    const double* TfTs;
+    double umin;
+    double umax;
+    double u0;
+    double b;
+};
+
+// Metrics and optional control signals of one batch
+struct DeviceOutputs {
+    double* u_iae;
+    double* u_ise;
+    double* saturation_time;
+    double* u;  // Time-major, u[i * count + lane], or nullptr
+};
+
+// One thread per configuration; the block shares each tile of inputs
+__global__ void sweep_kernel(
+    DeviceInputs in, DeviceConfigs configs, DeviceOutputs out,
+    size_t tile_steps) {
+    extern __shared__ double tile[];
+    double* r = tile;
+    double* y = r + tile_steps;
+    double* uff = y + tile_steps;
+    double* uman = uff + tile_steps;
+    double* utrack = uman + tile_steps;
+    double* Tx = utrack + tile_steps;
+    double* u_ref = Tx + tile_steps;
+    unsigned char* flags =
+        reinterpret_cast<unsigned char*>(u_ref + tile_steps);
+
+    size_t index = blockIdx.x * static_cast<size_t>(blockDim.x)
+        + threadIdx.x;
+    bool active = index < configs.count;
+    SweepLane lane;
+    sweep_lane_init(lane,
+                    active ? configs.kp[index] : 0.0,
+                    active ? configs.ki[index] : 0.0,
+                    active ? configs.kd[index] : 0.0,
+                    active ? configs.TfTs[index] : 1.0,
+                    configs.umin, configs.umax, configs.u0, configs.b);
+    double u_iae = 0.0;
+    double u_ise = 0.0;
+    double saturation_time = 0.0;
+
+    for (size_t begin = 0; begin < in.n; begin += tile_steps) {
+        size_t steps = in.n - begin < tile_steps ? in.n - begin
+                                                 : tile_steps;
+
+        // Load the tile, one step per thread
+        for (size_t k = threadIdx.x; k < steps; k += blockDim.x) {
+            size_t i = begin + k;
+            r[k] = in.r[i];
+            y[k] = in.y[i];
+            uff[k] = in.uff[i];
+            uman[k] = in.uman[i];
+            utrack[k] = in.utrack[i];
+            Tx[k] = in.Tx[i];
+            u_ref[k] = in.u_ref ? in.u_ref[i] : 0.0;
+            flags[k] = in.flags[i];
+        }
+        __syncthreads();
+
+        // All threads read the same step, so shared loads broadcast
+        if (active) {
+            for (size_t k = 0; k < steps; ++k) {
+                unsigned char f = flags[k];
+                bool saturated;
+                double u = sweep_lane_step(
+                    lane, r[k], y[k], uff[k], uman[k], utrack[k], Tx[k],
+                    (f & FLAG_TRACK) != 0, (f & FLAG_AUTO) != 0,
+                    static_cast<WindupMode>(f >> WINDUP_SHIFT), saturated);
+                if (out.u) {
+                    out.u[(begin + k) * configs.count + index] = u;
+                }
+
+                // Same sums as sweep_metrics
+                double e = in.u_ref ? u - u_ref[k] : u;
+                u_iae += fabs(e) * Tx[k];
+                u_ise += e * e * Tx[k];
+                if (saturated) {
+                    saturation_time += Tx[k];
+                }
+            }
+        }
+        __syncthreads();
+    }
+
+    if (active) {
+        out.u_iae[index] = u_iae;
+        out.u_ise[index] = u_ise;
+        out.saturation_time[index] = saturation_time;
+    }
+}
+
+// Copy a column to the device, or fill it with a default value
+void upload_column(DeviceBuffer<double>& buffer, const double* column,
+                   size_t n, double value) {
+    if (column) {
+        buffer.upload(column, n);
+    } else {
+        std::vector<double> filled(n, value);
+        buffer.upload(filled.data(), n);
+    }
+}
+
+} // namespace
+
+bool pid_sweep_gpu_available() {
+    int count = 0;
+    return cudaGetDeviceCount(&count) == cudaSuccess && count > 0;
+}
+
+void pid_sweep_gpu(
+    const SweepGrid& grid,
+    const InputSeries& inputs,
+    const SweepCallback& callback,
+    const double* u_ref,
+    const GpuSweepOptions& options) {
+    if (!pid_sweep_gpu_available()) {
+        throw std::runtime_error("No CUDA device available");
+    }
+    check(cudaSetDevice(options.device), "cudaSetDevice");
+
+    size_t total = grid.size();
+    size_t n = inputs.n;
+    size_t batch = std::max<size_t>(
+        std::min(options.batch_size, total), 1);
+    size_t tile_steps = std::max<size_t>(options.tile_steps, 1);
+    unsigned block_size = std::max(options.block_size, 1u);
+    size_t shared_bytes =
+        tile_steps * (TILE_COLUMNS * sizeof(double) + 1);
+    if (shared_bytes > MAX_SHARED_BYTES) {
+        throw std::invalid_argument(
+            "tile_steps needs more shared memory than a block has");
+    }
+
+    // Shared inputs, uploaded once
+    DeviceBuffer<double> r(n), y(n), uff(n), uman(n), utrack(n), Tx(n);
+    DeviceBuffer<double> reference(u_ref ? n : 0);
+    DeviceBuffer<unsigned char> flags(n);
+    r.upload(inputs.r, n);
+    y.upload(inputs.y, n);
+    upload_column(uff, inputs.uff, n, 0.0);
+    upload_column(uman, inputs.uman, n, 0.0);
+    upload_column(utrack, inputs.utrack, n, 0.0);
+    upload_column(Tx, inputs.Tx, n, 1.0);
+    if (u_ref) {
+        reference.upload(u_ref, n);
+    }
+    std::vector<unsigned char> packed(n);
+    for (size_t i = 0; i < n; ++i) {
+        bool auto_mode = inputs.auto_mode ? inputs.auto_mode[i] : true;
+        bool track = inputs.track ? inputs.track[i] : false;
+        WindupMode windup =
+            inputs.windup ? inputs.windup[i] : WindupMode::NONE;
+        packed[i] = static_cast<unsigned char>(
+            (auto_mode ? FLAG_AUTO : 0) | (track ? FLAG_TRACK : 0)
+            | (static_cast<unsigned char>(windup) << WINDUP_SHIFT));
+    }
+    flags.upload(packed.data(), n);
+
+    DeviceInputs in;
+    in.n = n;
+    in.r = r.get();
+    in.y = y.get();
+    in.uff = uff.get();
+    in.uman = uman.get();
+    in.utrack = utrack.get();
+    in.Tx = Tx.get();
+    in.u_ref = reference.get();
+    in.flags = flags.get();
+
+    // Per-batch configurations and results, reused for every batch
+    DeviceBuffer<double> kp(batch), ki(batch), kd(batch), TfTs(batch);
+    DeviceBuffer<double> u_iae(batch), u_ise(batch), saturation_time(batch);
+    DeviceBuffer<double> u(options.keep_outputs ? n * batch : 0);
+    std::vector<SweepConfig> host_configs(batch);
+    std::vector<double> column(batch);
+    std::vector<double> host_u_iae(batch);
+    std::vector<double> host_u_ise(batch);
+    std::vector<double> host_saturation(batch);
+    std::vector<double> host_u(options.keep_outputs ? n * batch : 0);
+    std::vector<double> u_run(options.keep_outputs ? n : 0);
+
+    for (size_t first = 0; first < total; first += batch) {
+        size_t count = std::min(batch, total - first);
+        for (size_t j = 0; j < count; ++j) {
+            host_configs[j] = sweep_config(grid, first + j);
+        }
+        for (size_t j = 0; j < count; ++j) {
+            column[j] = host_configs[j].kp;
+        }
+        kp.upload(column.data(), count);
+        for (size_t j = 0; j < count; ++j) {
+            column[j] = host_configs[j].ki;
+        }
+        ki.upload(column.data(), count);
+        for (size_t j = 0; j < count; ++j) {
+            column[j] = host_configs[j].kd;
+        }
+        kd.upload(column.data(), count);
+        for (size_t j = 0; j < count; ++j) {
+            column[j] = host_configs[j].TfTs;
+        }
+        TfTs.upload(column.data(), count);
+
+        DeviceConfigs configs;
+        configs.count = count;
+        configs.kp = kp.get();
+        configs.ki = ki.get();
+        configs.kd = kd.get();
+        configs.TfTs = TfTs.get();
+        configs.umin = grid.umin;
+        configs.umax = grid.umax;
+        configs.u0 = grid.u0;
+        configs.b = grid.b;
+
+        DeviceOutputs out;
+        out.u_iae = u_iae.get();
+        out.u_ise = u_ise.get();
+        out.saturation_time = saturation_time.get();
+        out.u = u.get();
+
+        unsigned blocks =
+            static_cast<unsigned>((count + block_size - 1) / block_size);
+        sweep_kernel<<<blocks, block_size, shared_bytes>>>(
+            in, configs, out, tile_steps);
+        check(cudaGetLastError(), "sweep_kernel launch");
+        check(cudaDeviceSynchronize(), "sweep_kernel");
+
+        u_iae.download(host_u_iae.data(), count);
+        u_ise.download(host_u_ise.data(), count);
+        saturation_time.download(host_saturation.data(), count);
+        if (options.keep_outputs) {
+            u.download(host_u.data(), n * count);
+        }
+
+        for (size_t j = 0; j < count; ++j) {
+            SweepResult result;
+            result.index = first + j;
+            result.config = host_configs[j];
+            result.metrics.u_iae = host_u_iae[j];
+            result.metrics.u_ise = host_u_ise[j];
+            result.metrics.saturation_time = host_saturation[j];
+            result.u = nullptr;
+            if (options.keep_outputs) {
+                for (size_t i = 0; i < n; ++i) {
+                    u_run[i] = host_u[i * count + j];
+                }
+                result.u = u_run.data();
+            }
+            callback(result);
+        }
+    }
+}
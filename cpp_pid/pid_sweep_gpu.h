@@ -0,0 +1,81 @@
+/**
+ * @file pid_sweep_gpu.h
+ * @brief Parameter sweep on a CUDA GPU
+ *
+ * This file provides a GPU version of pid_sweep for grids with many
+ * more configurations than CPU cores. Each GPU thread runs one
+ * configuration over the whole input series with its states in
+ * registers, while the threads of a block load the shared inputs into
+ * shared memory one tile of time steps at a time. It is only available
+ * when the library is built with PID_ENABLE_CUDA and the CUDA
+ * implementation in pid_sweep_gpu.cu; otherwise the functions report
+ * that no GPU is available.
+ */
+
+#ifndef PID_SWEEP_GPU_H
+#define PID_SWEEP_GPU_H
+
+#include "pid_sweep.h"
+#include <cstddef>
+
+/**
+ * @brief Options of a GPU sweep
+ */
+struct GpuSweepOptions {
+    int device;              ///< CUDA device index
+    unsigned block_size;     ///< Threads (configurations) per block
+    size_t tile_steps;       ///< Time steps loaded per shared memory tile
+    size_t batch_size;       ///< Largest number of configurations per launch
+    bool keep_outputs;       ///< Copy the control signals back
+
+    GpuSweepOptions()
+        : device(0),
+          block_size(128),
+          tile_steps(256),
+          batch_size(size_t(1) << 20),
+          keep_outputs(false) {}
+};
+
+/**
+ * @brief Whether a CUDA device can run pid_sweep_gpu
+ *
+ * @return false if the library was built without PID_ENABLE_CUDA or no
+ *         device is present
+ */
+bool pid_sweep_gpu_available();
+
+/**
+ * @brief Run every configuration of a grid over an input series on a
+ *        GPU
+ *
+ * Same results as pid_sweep within rounding: the GPU evaluates exp and
+ * may contract multiply-adds, so control signals agree with
+ * PIDController to about 1e-12 relative rather than bit for bit. Build
+ * with nvcc --fmad=false to remove the contractions.
+ *
+ * Configurations are run in batches of at most options.batch_size.
+ * The callback is called from the calling thread, in index order,
+ * after each batch. SweepResult::u is only set when
+ * options.keep_outputs is true, since copying the control signals of
+ * millions of runs usually costs more than computing them; otherwise
+ * it is nullptr.
+ *
+ * @param grid Parameter grid
+ * @param inputs Input series shared by all runs
+ * @param callback Function receiving each result
+ * @param u_ref Reference control signal for the metrics (default:
+ *              nullptr)
+ * @param options Device and launch options
+ * @throws std::runtime_error If no GPU is available or a CUDA call
+ *         fails
+ * @throws std::invalid_argument If options.tile_steps is over 862, the
+ *         largest tile that fits in 48 KiB of shared memory
+ */
+void pid_sweep_gpu(
+    const SweepGrid& grid,
+    const InputSeries& inputs,
+    const SweepCallback& callback,
+    const double* u_ref = nullptr,
+    const GpuSweepOptions& options = GpuSweepOptions());
+
+#endif // PID_SWEEP_GPU_H
@@ -0,0 +1,83 @@
+/**
+ * @file plant_model.cpp
+ * @brief Implementation of process models with dead time
+ */
+
+#include "plant_model.h"
+#include <cmath>
+
+DeadTime::DeadTime(size_t steps) : buffer_(steps, 0.0), pos_(0) {}
+
+double DeadTime::operator()(double u) {
+    if (buffer_.empty()) {
+        return u;
+    }
+    double out = buffer_[pos_];
+    buffer_[pos_] = u;
+    pos_ = pos_ + 1 == buffer_.size() ? 0 : pos_ + 1;
+    return out;
+}
+
+void DeadTime::reset(double value) {
+    for (size_t i = 0; i < buffer_.size(); ++i) {
+        buffer_[i] = value;
+    }
+    pos_ = 0;
+}
+
+PlantModel::PlantModel(
+    PlantType type, double K, double T1, double T2, double L, double Ts)
+    : type_(type),
+      K_(K),
+      Ts_(Ts),
+      a1_(T1 > 0.0 ? std::exp(-Ts / T1) : 0.0),
+      a2_(T2 > 0.0 ? std::exp(-Ts / T2) : 0.0),
+      c_(T1 == T2 ? (T1 > 0.0 ? Ts / T1 * a1_ : 0.0)
+                  : T1 / (T1 - T2) * (a1_ - a2_)),
+      x1_(0.0),
+      x2_(0.0),
+      delay_(static_cast<size_t>(std::floor(L / Ts + 0.5))) {}
+
+PlantModel PlantModel::fopdt(double K, double T, double L, double Ts) {
+    return PlantModel(PlantType::FOPDT, K, T, 0.0, L, Ts);
+}
+
+PlantModel PlantModel::sopdt(
+    double K, double T1, double T2, double L, double Ts) {
+    return PlantModel(PlantType::SOPDT, K, T1, T2, L, Ts);
+}
+
+PlantModel PlantModel::integrating(double K, double L, double Ts) {
+    return PlantModel(PlantType::INTEGRATING, K, 0.0, 0.0, L, Ts);
+}
+
+double PlantModel::operator()(double u) {
+    double v = delay_(u);
+    switch (type_) {
+    case PlantType::FOPDT:
+        x1_ = a1_ * x1_ + (1.0 - a1_) * K_ * v;
+        x2_ = x1_;
+        break;
+    case PlantType::SOPDT:
+        // Exact for the two sections in series, using the first
+        // section state at the start of the sample
+        x2_ = a2_ * x2_ + (1.0 - a2_) * K_ * v + c_ * (x1_ - K_ * v);
+        x1_ = a1_ * x1_ + (1.0 - a1_) * K_ * v;
+        break;
+    case PlantType::INTEGRATING:
+        x2_ += K_ * Ts_ * v;
+        break;
+    }
+    return x2_;
+}
+
+void PlantModel::reset(double u0) {
+    delay_.reset(u0);
+    if (type_ == PlantType::INTEGRATING) {
+        x1_ = 0.0;
+        x2_ = 0.0;
+    } else {
+        x1_ = K_ * u0;
+        x2_ = K_ * u0;
+    }
+}
@@ -0,0 +1,163 @@
+/**
+ * @file plant_model.h
+ * @brief Linear process models with dead time for closed-loop
+ *        simulation
+ *
+ * This file provides first-order-plus-dead-time (FOPDT),
+ * second-order-plus-dead-time (SOPDT) and integrating process models,
+ * discretized exactly with zero-order hold at a fixed sample time.
+ */
+
+#ifndef PLANT_MODEL_H
+#define PLANT_MODEL_H
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Delay of a whole number of samples using a ring buffer
+ */
+class DeadTime {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param steps Delay in samples (default: 0, no delay)
+     */
+    explicit DeadTime(size_t steps = 0);
+
+    /**
+     * @brief Push a sample and return the sample from steps ago
+     *
+     * @param u Input sample
+     * @return Delayed sample (the reset value for the first steps
+     *         calls)
+     */
+    double operator()(double u);
+
+    /**
+     * @brief Fill the delay line with a value
+     *
+     * @param value Value returned until the first input emerges
+     *              (default: 0.0)
+     */
+    void reset(double value = 0.0);
+
+    /**
+     * @brief Delay in samples
+     */
+    size_t steps() const { return buffer_.size(); }
+
+private:
+    std::vector<double> buffer_;
+    size_t pos_;
+};
+
+/**
+ * @brief Process model type
+ */
+enum class PlantType {
+    FOPDT,       ///< K e^(-Ls) / (T1 s + 1)
+    SOPDT,       ///< K e^(-Ls) / ((T1 s + 1)(T2 s + 1))
+    INTEGRATING  ///< K e^(-Ls) / s
+};
+
+/**
+ * @brief Linear process model with dead time
+ *
+ * The model is stepped once per sample time Ts with the control signal
+ * held constant over the sample. The lags and the integrator are
+ * discretized exactly for a held input, and the dead time L is rounded
+ * to a whole number of samples.
+ */
+class PlantModel {
+public:
+    /**
+     * @brief First-order-plus-dead-time model
+     *
+     * @param K Static gain
+     * @param T Time constant
+     * @param L Dead time
+     * @param Ts Sample time (default: 1.0)
+     */
+    static PlantModel fopdt(double K, double T, double L, double Ts = 1.0);
+
+    /**
+     * @brief Second-order-plus-dead-time model with two real poles
+     *
+     * @param K Static gain
+     * @param T1 First time constant
+     * @param T2 Second time constant
+     * @param L Dead time
+     * @param Ts Sample time (default: 1.0)
+     */
+    static PlantModel sopdt(
+        double K, double T1, double T2, double L, double Ts = 1.0);
+
+    /**
+     * @brief Integrating process with dead time
+     *
+     * @param K Velocity gain
+     * @param L Dead time
+     * @param Ts Sample time (default: 1.0)
+     */
+    static PlantModel integrating(double K, double L, double Ts = 1.0);
+
+    /**
+     * @brief Advance the model by one sample
+     *
+     * @param u Process input held over the sample
+     * @return Process output at the end of the sample
+     */
+    double operator()(double u);
+
+    /**
+     * @brief Current process output
+     */
+    double output() const { return x2_; }
+
+    /**
+     * @brief Reset to steady state at an input
+     *
+     * @param u0 Steady-state input; ignored for integrating models,
+     *           whose output is set to 0 (default: 0.0)
+     */
+    void reset(double u0 = 0.0);
+
+    /**
+     * @brief Model type
+     */
+    PlantType type() const { return type_; }
+
+    /**
+     * @brief Sample time
+     */
+    double Ts() const { return Ts_; }
+
+    /**
+     * @brief Dead time in samples
+     */
+    size_t delay_steps() const { return delay_.steps(); }
+
+private:
+    PlantModel(PlantType type, double K, double T1, double T2, double L,
+               double Ts);
+
+    PlantType type_;
+    double K_;
+    double Ts_;
+
+    // Lag section coefficients, a = exp(-Ts/T), and coupling of the
+    // first section into the second over one sample
+    double a1_;
+    double a2_;
+    double c_;
+
+    // Lag section states (x2_ is the output)
+    double x1_;
+    double x2_;
+
+    DeadTime delay_;
+};
+
+#endif // PLANT_MODEL_H
@@ -0,0 +1,172 @@
+/**
+ * @file rate_scheduler.cpp
+ * @brief Implementation of the multi-rate scheduler
+ */
+
+#include "rate_scheduler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+RateGroup::RateGroup(PIDBank& bank, double period)
+    : bank(bank),
+      period(period),
+      r(bank.size(), 0.0),
+      y(bank.size(), 0.0),
+      uff(bank.size(), 0.0),
+      uman(bank.size(), 0.0),
+      utrack(bank.size(), 0.0),
+      Tx(bank.size(), 1.0),
+      track(new bool[bank.size()]),
+      auto_mode(new bool[bank.size()]),
+      windup(bank.size(), WindupMode::NONE),
+      u(bank.size(), 0.0),
+      period_ticks_(0),
+      due_tick_(0),
+      last_run_(0.0) {
+    std::fill(track.get(), track.get() + bank.size(), false);
+    std::fill(auto_mode.get(), auto_mode.get() + bank.size(), true);
+}
+
+MultiRateScheduler::MultiRateScheduler(double tick, size_t slots)
+    : tick_(tick),
+      wheel_(std::max<size_t>(slots, 1)),
+      start_(0.0),
+      current_(0),
+      started_(false) {}
+
+RateGroup& MultiRateScheduler::add_group(PIDBank& bank, double period) {
+    // Period as a whole number of ticks
+    double ticks = std::round(period / tick_);
+    if (!(ticks >= 1.0) || std::fabs(ticks * tick_ - period) > 1e-9 * period) {
+        throw std::invalid_argument(
+            "Group period must be a positive multiple of the tick");
+    }
+
+    std::unique_ptr<RateGroup> group(new RateGroup(bank, period));
+    group->period_ticks_ = static_cast<uint64_t>(ticks);
+    group->due_tick_ = started_ ? current_ + 1 : 0;
+    wheel_[group->due_tick_ % wheel_.size()].push_back(group.get());
+    groups_.push_back(std::move(group));
+    return *groups_.back();
+}
+
+size_t MultiRateScheduler::tick(double now) {
+    if (!started_) {
+        start_ = now;
+    }
+
+    // Ticks from the first unprocessed one up to now, rounding so that
+    // times at exact multiples of the tick are not lost to rounding
+    uint64_t first = started_ ? current_ + 1 : 0;
+    double elapsed = std::floor((now - start_) / tick_ + 1e-9);
+    if (elapsed < static_cast<double>(first)) {
+        return 0;
+    }
+    uint64_t target = static_cast<uint64_t>(elapsed);
+    current_ = target;
+    started_ = true;
+
+    // Visiting every slot once finds all due groups, however many ticks
+    // have passed
+    uint64_t count = std::min<uint64_t>(target - first + 1, wheel_.size());
+    size_t runs = 0;
+    for (uint64_t k = 0; k < count; ++k) {
+        std::vector<RateGroup*>& slot = wheel_[(first + k) % wheel_.size()];
+        size_t i = 0;
+        while (i < slot.size()) {
+            RateGroup* group = slot[i];
+            if (group->due_tick_ > target) {
+                ++i;
+                continue;
+            }
+            slot[i] = slot.back();
+            slot.pop_back();
+            run_group(*group, now);
+            wheel_[group->due_tick_ % wheel_.size()].push_back(group);
+            ++runs;
+        }
+    }
+    return runs;
+}
+
+void MultiRateScheduler::run_group(RateGroup& group, double now) {
+    // Deadline accounting against the due time
+    uint64_t late_periods = (current_ - group.due_tick_) / group.period_ticks_;
+    double lateness = now - (start_ + group.due_tick_ * tick_);
+    RateGroupStats& stats = group.stats;
+    stats.max_lateness = std::max(stats.max_lateness, lateness);
+    if (late_periods > 0) {
+        stats.deadline_misses++;
+        stats.skipped_periods += late_periods;
+    }
+
+    // Execution period from the actual time since the previous run
+    double Tx = stats.runs > 0 ? (now - group.last_run_) / group.period : 1.0;
+    std::fill(group.Tx.begin(), group.Tx.end(), Tx);
+
+    if (group.read) {
+        group.read(group, now);
+    }
+    group.bank.step(
+        group.r.data(), group.y.data(), group.uff.data(),
+        group.uman.data(), group.utrack.data(), group.Tx.data(),
+        group.track.get(), group.auto_mode.get(), group.windup.data(),
+        group.u.data());
+    if (group.write) {
+        group.write(group, now);
+    }
+
+    stats.runs++;
+    group.last_run_ = now;
+    group.due_tick_ += (late_periods + 1) * group.period_ticks_;
+}
+
+double MultiRateScheduler::next_due() const {
+    uint64_t due = std::numeric_limits<uint64_t>::max();
+    for (size_t g = 0; g < groups_.size(); ++g) {
+        due = std::min(due, groups_[g]->due_tick_);
+    }
+    if (groups_.empty()) {
+        due = current_ + 1;
+    }
+    return start_ + due * tick_;
+}
+
+void MultiRateScheduler::run(const std::atomic<bool>& stop) {
+    while (!stop.load()) {
+        tick(clock());
+        double wait = next_due() - clock();
+        if (wait > 0.0) {
+            std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+        }
+    }
+}
+
+double MultiRateScheduler::clock() {
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool MultiRateScheduler::pin_current_thread(size_t cpu) {
+#ifdef __linux__
+    if (cpu >= CPU_SETSIZE) {
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
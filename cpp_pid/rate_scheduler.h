@@ -0,0 +1,193 @@
+/**
+ * @file rate_scheduler.h
+ * @brief Multi-rate scheduler for banks of controllers
+ *
+ * This file provides a scheduler that runs groups of controllers with
+ * different nominal sample periods from one thread. Each group is a
+ * PIDBank stepped as one batch, and due groups are found with a timing
+ * wheel. It requires a hosted platform with std::thread and is not part
+ * of the embedded controller code.
+ */
+
+#ifndef RATE_SCHEDULER_H
+#define RATE_SCHEDULER_H
+
+#include "pid_bank.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Timing statistics of a rate group
+ */
+struct RateGroupStats {
+    size_t runs;             ///< Number of bank steps
+    size_t deadline_misses;  ///< Runs that started a period or more late
+    size_t skipped_periods;  ///< Periods without a run because of overruns
+    double max_lateness;     ///< Largest delay after the due time (s)
+
+    RateGroupStats()
+        : runs(0),
+          deadline_misses(0),
+          skipped_periods(0),
+          max_lateness(0.0) {}
+};
+
+/**
+ * @brief Controllers sharing a nominal sample period
+ *
+ * The input and output arrays hold one element per controller of the
+ * bank and start at the PIDController defaults (uff = uman = utrack =
+ * 0, auto_mode = true, track = false, windup = NONE). The read
+ * function is called before each step to fill in the measurements, and
+ * the write function after each step to apply u. The scheduler sets Tx.
+ */
+struct RateGroup {
+    /**
+     * @brief Function called with the group and the current time
+     */
+    typedef std::function<void(RateGroup& group, double now)> IOFunction;
+
+    /**
+     * @brief Constructor
+     *
+     * @param bank Controllers of the group (not owned)
+     * @param period Nominal sample period in seconds
+     */
+    RateGroup(PIDBank& bank, double period);
+
+    PIDBank& bank;  ///< Controllers of the group
+    double period;  ///< Nominal sample period in seconds
+
+    std::vector<double> r;
+    std::vector<double> y;
+    std::vector<double> uff;
+    std::vector<double> uman;
+    std::vector<double> utrack;
+    std::vector<double> Tx;
+    std::unique_ptr<bool[]> track;
+    std::unique_ptr<bool[]> auto_mode;
+    std::vector<WindupMode> windup;
+    std::vector<double> u;
+
+    IOFunction read;   ///< Called before each step (optional)
+    IOFunction write;  ///< Called after each step (optional)
+
+    RateGroupStats stats;  ///< Timing statistics
+
+private:
+    friend class MultiRateScheduler;
+
+    // Scheduling state
+    uint64_t period_ticks_;
+    uint64_t due_tick_;
+    double last_run_;
+};
+
+/**
+ * @brief Runs rate groups on a timing wheel
+ *
+ * Time is divided into ticks of a fixed length, and every group period
+ * must be a whole number of ticks. Groups are kept in a wheel of slots
+ * indexed by due tick, so each tick only looks at the groups in one
+ * slot. All groups are due at the first tick.
+ *
+ * tick() runs each due group once with Tx = elapsed time since its
+ * previous run / period, so an overrun is handled by the filter's
+ * rediscretization rather than by running extra steps. A run that
+ * starts one or more whole periods after its due time counts as a
+ * deadline miss, and the periods it spans are counted as skipped.
+ *
+ * A scheduler is used from one thread. To spread groups over cores,
+ * give each core its own scheduler and call pin_current_thread() from
+ * its thread.
+ */
+class MultiRateScheduler {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param tick Tick length in seconds
+     * @param slots Number of wheel slots (default: 256)
+     */
+    explicit MultiRateScheduler(double tick, size_t slots = 256);
+
+    /**
+     * @brief Add a group of controllers
+     *
+     * @param bank Controllers of the group (not owned, must outlive the
+     *             scheduler)
+     * @param period Nominal sample period in seconds
+     * @return The new group, valid for the lifetime of the scheduler
+     * @throws std::invalid_argument If period is not a positive whole
+     *         number of ticks
+     */
+    RateGroup& add_group(PIDBank& bank, double period);
+
+    /**
+     * @brief Number of groups
+     */
+    size_t size() const { return groups_.size(); }
+
+    /**
+     * @brief Access a group
+     */
+    RateGroup& group(size_t g) { return *groups_[g]; }
+
+    /**
+     * @brief Run the groups that are due
+     *
+     * The first call sets time zero of the schedule.
+     *
+     * @param now Current time in seconds
+     * @return Number of groups run
+     */
+    size_t tick(double now);
+
+    /**
+     * @brief Time at which the next group is due (seconds)
+     *
+     * Only meaningful after the first call to tick().
+     */
+    double next_due() const;
+
+    /**
+     * @brief Call tick() until stop is set, sleeping between due times
+     *
+     * @param stop Flag set by another thread to return
+     */
+    void run(const std::atomic<bool>& stop);
+
+    /**
+     * @brief Seconds on a monotonic clock, as used by run()
+     */
+    static double clock();
+
+    /**
+     * @brief Pin the calling thread to one CPU
+     *
+     * @param cpu CPU index
+     * @return false if pinning failed or is not supported
+     */
+    static bool pin_current_thread(size_t cpu);
+
+private:
+    // Run one due group and schedule its next run
+    void run_group(RateGroup& group, double now);
+
+    double tick_;
+    std::vector<std::unique_ptr<RateGroup> > groups_;
+
+    // Groups by due tick modulo the number of slots
+    std::vector<std::vector<RateGroup*> > wheel_;
+
+    // Time of tick zero and the last tick processed
+    double start_;
+    uint64_t current_;
+    bool started_;
+};
+
+#endif // RATE_SCHEDULER_H
@@ -0,0 +1,222 @@
+/**
+ * @file realtime_pid.cpp
+ * @brief Implementation of the bounded step time PID controller
+ */
+
+#include "realtime_pid.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+// All ones for true, zero for false
+inline uint64_t mask(bool condition) {
+    return 0 - static_cast<uint64_t>(condition);
+}
+
+// a where the mask is set, b elsewhere, without a branch
+inline double select(uint64_t m, double a, double b) {
+    uint64_t ua;
+    uint64_t ub;
+    std::memcpy(&ua, &a, sizeof(ua));
+    std::memcpy(&ub, &b, sizeof(ub));
+    uint64_t ur = (ua & m) | (ub & ~m);
+    double result;
+    std::memcpy(&result, &ur, sizeof(result));
+    return result;
+}
+
+inline double interpolate(double a, double b, double t) {
+    return a + t * (b - a);
+}
+
+} // namespace
+
+ZohTable::ZohTable(
+    double TfTs, double Tx_min, double Tx_max, size_t intervals)
+    : TfTs_(TfTs),
+      Tx_min_(Tx_min),
+      Tx_max_(Tx_max),
+      scale_(0.0),
+      max_error_(0.0) {
+    if (!(Tx_min > 0.0) || !(Tx_max >= Tx_min) || intervals == 0) {
+        throw std::invalid_argument("Invalid ZohTable period range");
+    }
+    double step = (Tx_max - Tx_min) / intervals;
+    if (Tx_max > Tx_min) {
+        scale_ = intervals / (Tx_max - Tx_min);
+    }
+
+    params_.resize(intervals + 2);
+    for (size_t k = 0; k < params_.size(); ++k) {
+        params_[k] = zoh_Fy(TfTs, Tx_min + k * step);
+    }
+
+    // Interpolation error, largest near the middle of an interval
+    for (size_t k = 0; k < intervals; ++k) {
+        double Tx = Tx_min + (k + 0.5) * step;
+        FilterParams exact = zoh_Fy(TfTs, Tx);
+        FilterParams table = lookup(Tx);
+        const double errors[] = {
+            exact.a11 - table.a11, exact.a12 - table.a12,
+            exact.a21 - table.a21, exact.a22 - table.a22,
+            exact.b1 - table.b1, exact.b2 - table.b2
+        };
+        for (size_t j = 0; j < 6; ++j) {
+            max_error_ = std::max(max_error_, std::abs(errors[j]));
+        }
+    }
+}
+
+double ZohTable::clamp(double Tx) const {
+    Tx = select(mask(Tx > Tx_min_), Tx, Tx_min_);
+    return select(mask(Tx < Tx_max_), Tx, Tx_max_);
+}
+
+FilterParams ZohTable::lookup(double Tx) const {
+    // Interval and position within it; Tx_max itself may give the last
+    // grid period with t = 0, whose neighbour is the extra entry
+    double position = (clamp(Tx) - Tx_min_) * scale_;
+    long long k = static_cast<long long>(position);
+    double t = position - static_cast<double>(k);
+    const FilterParams& p0 = params_[k];
+    const FilterParams& p1 = params_[k + 1];
+
+    FilterParams params;
+    params.a11 = interpolate(p0.a11, p1.a11, t);
+    params.a12 = interpolate(p0.a12, p1.a12, t);
+    params.a21 = interpolate(p0.a21, p1.a21, t);
+    params.a22 = interpolate(p0.a22, p1.a22, t);
+    params.b1 = interpolate(p0.b1, p1.b1, t);
+    params.b2 = interpolate(p0.b2, p1.b2, t);
+    return params;
+}
+
+RealTimePIDController::RealTimePIDController(
+    double kp,
+    double ki,
+    double kd,
+    const ZohTable& table,
+    double umin,
+    double umax,
+    double u0,
+    double b)
+    : table_(&table),
+      feedback_(0) {
+    params_.kp = kp;
+    params_.ki = ki;
+    params_.kd = kd;
+    params_.umin = umin;
+    params_.umax = umax;
+    params_.u0 = u0;
+    params_.b = b;
+    reset();
+}
+
+double RealTimePIDController::operator()(
+    double r,
+    double y,
+    double uff,
+    double uman,
+    double utrack,
+    double Tx,
+    bool track,
+    bool auto_mode,
+    WindupMode windup) {
+    return step(r, y, uff, uman, utrack, Tx, track, auto_mode, windup).u;
+}
+
+PIDStepResult RealTimePIDController::step(
+    double r,
+    double y,
+    double uff,
+    double uman,
+    double utrack,
+    double Tx,
+    bool track,
+    bool auto_mode,
+    WindupMode windup) {
+    // Filter updates
+    Tx = table_->clamp(Tx);
+    FilterParams f = table_->lookup(Tx);
+    double yf_prev = yf_;
+    yf_ = f.a11 * yf_prev + f.a12 * dyf_ + f.b1 * y;
+    dyf_ = f.a21 * yf_prev + f.a22 * dyf_ + f.b2 * y;
+    double yf = yf_;
+    double dyf = dyf_;
+
+    // Mode masks
+    unsigned windup_bits =
+        static_cast<unsigned>(windup) | (saturation_ & feedback_);
+    uint64_t automatic = mask(auto_mode);
+    uint64_t no_integral = mask(params_.ki == 0.0);
+    uint64_t reset = automatic & no_integral;
+    uint64_t tracking = automatic & mask(track);
+    uint64_t upper = mask((windup_bits & 1) != 0);
+    uint64_t lower = mask((windup_bits & 2) != 0);
+
+    // Reset state if using P or PD control (ki == 0)
+    double u_old = select(reset, params_.u0, state_.u_old);
+    double up_old = select(reset, 0.0, state_.up_old);
+    double ud_old = select(reset, 0.0, state_.ud_old);
+    double uff_old = select(reset, 0.0, state_.uff_old);
+    params_.b = select(reset, 1.0, params_.b);
+
+    // Tracking mode for bumpless transfer
+    u_old = select(tracking, utrack, u_old);
+    up_old = select(tracking, 0.0, up_old);
+    ud_old = select(tracking, 0.0, ud_old);
+    uff_old = select(tracking, 0.0, uff_old);
+
+    // Control signal increments, added in the order P, I, D, FF. Adding
+    // -0.0 for a missing integral term leaves the sum unchanged bit for
+    // bit, as if the term were skipped.
+    double up = params_.kp * (params_.b * r - yf);
+    double ud = -params_.kd * dyf;
+    double Dup = up - up_old;
+    double Dui = params_.ki * (r - yf) * Tx;
+    Dui = select(lower & mask(Dui < 0.0), 0.0, Dui);
+    Dui = select(upper & mask(0.0 < Dui), 0.0, Dui);
+    Dui = select(no_integral, -0.0, Dui);
+    double Dud = (ud - ud_old) / Tx;
+    double Duff = uff - uff_old;
+    double Du = Dup + Dui + Dud + Duff;
+
+    // Add control signal increment, or use manual control signal
+    double u = select(automatic, u_old + Du, uman);
+
+    // Saturate control signal, as saturate_with_flags
+    u = select(mask(params_.umax < u), params_.umax, u);
+    u = select(mask(u < params_.umin), params_.umin, u);
+    saturation_ = static_cast<unsigned char>(
+        (u >= params_.umax) * SATURATED_HIGH
+        | (u <= params_.umin) * SATURATED_LOW);
+
+    // Update old signal states
+    state_.u_old = u;
+    state_.up_old = up;
+    state_.ud_old = ud;
+    state_.uff_old = uff;
+
+    PIDStepResult result;
+    result.u = u;
+    result.Dup = select(automatic, Dup, 0.0);
+    result.Dui = select(automatic & ~no_integral, Dui, 0.0);
+    result.Dud = select(automatic, Dud, 0.0);
+    result.Duff = select(automatic, Duff, 0.0);
+    result.saturation = saturation_;
+    return result;
+}
+
+void RealTimePIDController::reset() {
+    state_.u_old = 0.0;
+    state_.up_old = 0.0;
+    state_.ud_old = 0.0;
+    state_.uff_old = 0.0;
+    yf_ = 0.0;
+    dyf_ = 0.0;
+    saturation_ = 0;
+}
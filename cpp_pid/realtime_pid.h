@@ -0,0 +1,291 @@
+/**
+ * @file realtime_pid.h
+ * @brief PID controller with a bounded, data-independent step time
+ *
+ * This file provides a controller for hard real-time loops.
+ * PIDController rediscretizes its measurement filter with zoh_Fy
+ * whenever Tx changes, so the step time depends on the input and
+ * includes a call to exp. Here the filter parameters are precomputed
+ * over a range of execution periods and interpolated on every step,
+ * and the step executes the same instructions whatever its inputs.
+ */
+
+#ifndef REALTIME_PID_H
+#define REALTIME_PID_H
+
+#include "basic_pid.h"
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+/**
+ * @brief Table of filter parameters over a range of execution periods
+ *
+ * Holds zoh_Fy(TfTs, Tx) at intervals + 1 evenly spaced periods from
+ * Tx_min to Tx_max. lookup() interpolates linearly between the two
+ * nearest periods, so it costs the same for every Tx and never calls
+ * exp. In between grid periods the error is bounded by max_error(). At
+ * a grid period the parameters are those of zoh_Fy, bit for bit when
+ * the spacing (Tx_max - Tx_min) / intervals is a power of two, so that
+ * the position of the period in the table is computed exactly.
+ *
+ * The table is built, and allocates, only in the constructor. Building
+ * a table for a new TfTs can therefore be done by a background thread
+ * and the result handed to RealTimePIDController::set_table().
+ */
+class ZohTable {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param TfTs Filter time constant as a multiple of nominal sample
+     *             time
+     * @param Tx_min Smallest execution period (normalized, > 0)
+     * @param Tx_max Largest execution period (normalized, >= Tx_min)
+     * @param intervals Number of intervals between Tx_min and Tx_max
+     *                  (default: 256)
+     * @throws std::invalid_argument For an empty or non-positive range
+     *         or zero intervals
+     */
+    ZohTable(double TfTs, double Tx_min, double Tx_max,
+             size_t intervals = 256);
+
+    /**
+     * @brief Get the filter parameters for an execution period
+     *
+     * Tx is clamped to [Tx_min, Tx_max] first, and NaN is taken as
+     * Tx_min.
+     *
+     * @param Tx Execution period (normalized)
+     * @return Interpolated filter parameters
+     */
+    FilterParams lookup(double Tx) const;
+
+    /**
+     * @brief Clamp an execution period to the table range
+     *
+     * @param Tx Execution period (normalized)
+     * @return Tx within [Tx_min, Tx_max], Tx_min for NaN
+     */
+    double clamp(double Tx) const;
+
+    /**
+     * @brief Filter time constant as a multiple of nominal sample time
+     */
+    double TfTs() const { return TfTs_; }
+
+    /**
+     * @brief Smallest execution period
+     */
+    double Tx_min() const { return Tx_min_; }
+
+    /**
+     * @brief Largest execution period
+     */
+    double Tx_max() const { return Tx_max_; }
+
+    /**
+     * @brief Largest interpolation error of any coefficient
+     *
+     * Measured against zoh_Fy at the midpoint of every interval when
+     * the table is built.
+     */
+    double max_error() const { return max_error_; }
+
+private:
+    double TfTs_;
+    double Tx_min_;
+    double Tx_max_;
+
+    // Intervals per unit of Tx
+    double scale_;
+
+    // Parameters at the grid periods, with one extra period past Tx_max
+    // so that interpolation never reads past the end
+    std::vector<FilterParams> params_;
+
+    double max_error_;
+};
+
+/**
+ * @brief PID controller with a bounded step time
+ *
+ * Same algorithm, arguments and results as PIDController, with the
+ * measurement filter parameters taken from a ZohTable. A step performs
+ * no allocation, calls no library function and has no branch that
+ * depends on its inputs or state: every term is computed and the mode,
+ * tracking, ki == 0 reset, anti-windup and saturation choices are made
+ * with bit mask selects. The worst-case step time is therefore the
+ * time of any step, which benchmarks/wcet_harness.cpp measures.
+ *
+ * The execution period is clamped to the table range, for the filter
+ * and for the I and D terms. Within the range, the control signal
+ * equals that of PIDController to the interpolation error of the
+ * table, and bit for bit when every Tx is an exact grid period of the
+ * table (see ZohTable).
+ *
+ * The table is not owned by the controller and must outlive it, or be
+ * replaced with set_table() first. Several controllers may share one
+ * table.
+ */
+class RealTimePIDController {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param kp Proportional gain
+     * @param ki Integral gain
+     * @param kd Derivative gain
+     * @param table Filter parameters, which also set TfTs and the range
+     *              of execution periods
+     * @param umin Minimum control signal (default: -infinity)
+     * @param umax Maximum control signal (default: +infinity)
+     * @param u0 Bias term for P or PD control (default: 0.0)
+     * @param b Setpoint weight for proportional term (default: 1.0)
+     */
+    RealTimePIDController(
+        double kp,
+        double ki,
+        double kd,
+        const ZohTable& table,
+        double umin = -std::numeric_limits<double>::infinity(),
+        double umax = std::numeric_limits<double>::infinity(),
+        double u0 = 0.0,
+        double b = 1.0);
+
+    /**
+     * @brief Compute the PID control signal
+     *
+     * Arguments as for PIDController::operator().
+     *
+     * @return Control signal u
+     */
+    double operator()(
+        double r,
+        double y,
+        double uff = 0.0,
+        double uman = 0.0,
+        double utrack = 0.0,
+        double Tx = 1.0,
+        bool track = false,
+        bool auto_mode = true,
+        WindupMode windup = WindupMode::NONE);
+
+    /**
+     * @brief Compute the PID control signal with increments and
+     *        saturation flags
+     *
+     * Arguments as for operator(), which returns the u of this result.
+     *
+     * @return Control signal, P, I, D and FF increments and saturation
+     *         flags (see pid_step)
+     */
+    PIDStepResult step(
+        double r,
+        double y,
+        double uff = 0.0,
+        double uman = 0.0,
+        double utrack = 0.0,
+        double Tx = 1.0,
+        bool track = false,
+        bool auto_mode = true,
+        WindupMode windup = WindupMode::NONE);
+
+    /**
+     * @brief Feed the saturation of each step into the next one
+     *
+     * As PIDController::set_auto_windup().
+     *
+     * @param enabled Whether to use the internal saturation (default
+     *                off)
+     */
+    void set_auto_windup(bool enabled) {
+        feedback_ = enabled ? SATURATED_HIGH | SATURATED_LOW : 0;
+    }
+
+    /**
+     * @brief Whether the internal saturation is fed back
+     */
+    bool auto_windup() const { return feedback_ != 0; }
+
+    /**
+     * @brief Saturation flags of the last step (zero after reset)
+     */
+    unsigned char saturation() const { return saturation_; }
+
+    /**
+     * @brief Reset the controller state to zero
+     */
+    void reset();
+
+    /**
+     * @brief Change the gains between steps without a bump
+     *
+     * As PIDController::set_gains().
+     *
+     * @param kp Proportional gain
+     * @param ki Integral gain
+     * @param kd Derivative gain
+     */
+    void set_gains(double kp, double ki, double kd) {
+        pid_set_gains(params_, state_, kp, ki, kd, dyf_);
+    }
+
+    /**
+     * @brief Change the saturation limits between steps
+     *
+     * @param umin Minimum control signal
+     * @param umax Maximum control signal
+     */
+    void set_limits(double umin, double umax) {
+        params_.umin = umin;
+        params_.umax = umax;
+    }
+
+    /**
+     * @brief Use another table from the next step on
+     *
+     * This is how TfTs or the range of execution periods is changed
+     * without computing filter parameters in the loop. The filter
+     * state is kept.
+     *
+     * @param table Filter parameters (not owned)
+     */
+    void set_table(const ZohTable& table) { table_ = &table; }
+
+    /**
+     * @brief Filter parameter table
+     */
+    const ZohTable& table() const { return *table_; }
+
+    /**
+     * @brief Controller parameters
+     */
+    const PIDParams& params() const { return params_; }
+
+    /**
+     * @brief Current filtered output and derivative
+     */
+    FilterOutput filter_state() const {
+        FilterOutput output = {yf_, dyf_};
+        return output;
+    }
+
+private:
+    // Controller parameters
+    PIDParams params_;
+
+    // Signal states
+    PIDState state_;
+
+    // Filter parameter table (not owned) and filter state
+    const ZohTable* table_;
+    double yf_;
+    double dyf_;
+
+    // Saturation flags of the last step and the mask of those fed back
+    unsigned char saturation_;
+    unsigned char feedback_;
+};
+
+#endif // REALTIME_PID_H
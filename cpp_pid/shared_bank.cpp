@@ -0,0 +1,303 @@
+/**
+ * @file shared_bank.cpp
+ * @brief Implementation of the shared-memory controller bank
+ */
+
+#include "shared_bank.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SHARED_BANK_SHM 1
+#endif
+
+namespace {
+
+const char MAGIC[8] = {'P', 'I', 'D', 'S', 'H', 'M', 'E', 'M'};
+
+// Header fields
+const size_t VERSION_OFFSET = 8;
+const size_t SIZE_OFFSET = 12;
+const size_t BYTES_OFFSET = 16;
+const size_t COLUMNS_OFFSET = 64;
+const size_t SEQUENCE_OFFSET = 128;
+const size_t STEPS_OFFSET = 136;
+const size_t HEADER_SIZE = 192;
+
+// Published columns, in the order of their offsets in the header
+enum Column { U, YF, DYF, SATURATION, AUTO_MODE, TRACK, NUM_COLUMNS };
+
+static_assert(sizeof(bool) == 1, "Mode columns need one-byte bool");
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t),
+              "Sequence counter must be a plain 64-bit word");
+
+size_t line_padded(size_t bytes) {
+    return (bytes + 63) / 64 * 64;
+}
+
+uint64_t header_word(const char* segment, size_t offset) {
+    uint64_t value;
+    std::memcpy(&value, segment + offset, sizeof(value));
+    return value;
+}
+
+} // namespace
+
+SharedPIDBank::SharedPIDBank(
+    const std::string& name,
+    size_t n,
+    double kp,
+    double ki,
+    double kd,
+    double TfTs,
+    double umin,
+    double umax,
+    double u0,
+    double b)
+    : bank_(n, kp, ki, kd, TfTs, umin, umax, u0, b),
+      name_(name),
+      segment_(nullptr),
+      bytes_(0),
+      sequence_(nullptr),
+      steps_(nullptr),
+      auto_mode_(nullptr),
+      track_(nullptr) {
+#ifdef SHARED_BANK_SHM
+    size_t stride = bank_.stride_;
+    size_t fields = HEADER_SIZE;
+    size_t saturation =
+        fields + PIDBank::NUM_FIELDS * stride * sizeof(double);
+    size_t auto_mode = saturation + line_padded(stride);
+    size_t track = auto_mode + line_padded(stride);
+    bytes_ = track + line_padded(stride);
+
+    // A fresh segment, so readers of an old one never see it resized
+    shm_unlink(name_.c_str());
+    int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        throw std::runtime_error(
+            "Could not create shared memory segment: " + name_);
+    }
+    if (ftruncate(fd, static_cast<off_t>(bytes_)) != 0) {
+        close(fd);
+        shm_unlink(name_.c_str());
+        throw std::runtime_error(
+            "Could not size shared memory segment: " + name_);
+    }
+    void* map =
+        mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        shm_unlink(name_.c_str());
+        throw std::runtime_error(
+            "Could not map shared memory segment: " + name_);
+    }
+    segment_ = static_cast<char*>(map);
+
+    uint16_t version = SHARED_BANK_VERSION;
+    uint32_t size = static_cast<uint32_t>(n);
+    uint64_t total = bytes_;
+    std::memcpy(segment_ + VERSION_OFFSET, &version, sizeof(version));
+    std::memcpy(segment_ + SIZE_OFFSET, &size, sizeof(size));
+    std::memcpy(segment_ + BYTES_OFFSET, &total, sizeof(total));
+    uint64_t columns[NUM_COLUMNS];
+    columns[U] = fields + PIDBank::U_OLD * stride * sizeof(double);
+    columns[YF] = fields + PIDBank::YF * stride * sizeof(double);
+    columns[DYF] = fields + PIDBank::DYF * stride * sizeof(double);
+    columns[SATURATION] = saturation;
+    columns[AUTO_MODE] = auto_mode;
+    columns[TRACK] = track;
+    std::memcpy(segment_ + COLUMNS_OFFSET, columns, sizeof(columns));
+
+    sequence_ = new (segment_ + SEQUENCE_OFFSET) std::atomic<uint64_t>(0);
+    steps_ = reinterpret_cast<uint64_t*>(segment_ + STEPS_OFFSET);
+    *steps_ = 0;
+
+    // The bank steps in the segment from here on; u_old is the control
+    // signal of the last step
+    bank_.place(reinterpret_cast<double*>(segment_ + fields),
+                reinterpret_cast<unsigned char*>(segment_ + saturation));
+    auto_mode_ = reinterpret_cast<bool*>(segment_ + auto_mode);
+    track_ = reinterpret_cast<bool*>(segment_ + track);
+    for (size_t i = 0; i < n; ++i) {
+        auto_mode_[i] = true;
+        track_[i] = false;
+    }
+
+    // Readers check the magic, so write it after everything else
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(segment_, MAGIC, sizeof(MAGIC));
+#else
+    throw std::runtime_error(
+        "Shared memory segments are not supported on this platform");
+#endif
+}
+
+SharedPIDBank::~SharedPIDBank() {
+#ifdef SHARED_BANK_SHM
+    // The bank's arrays are in the segment, which outlives it only
+    // until here; the bank does not touch them when destroyed
+    munmap(segment_, bytes_);
+    shm_unlink(name_.c_str());
+#endif
+}
+
+void SharedPIDBank::step(
+    const double* r,
+    const double* y,
+    const double* uff,
+    const double* uman,
+    const double* utrack,
+    const double* Tx,
+    const WindupMode* windup,
+    double* u) {
+    begin_write();
+    bank_.step(r, y, uff, uman, utrack, Tx, track_, auto_mode_, windup, u);
+    ++*steps_;
+    end_write();
+}
+
+void SharedPIDBank::set_mode(size_t i, bool auto_mode, bool track) {
+    begin_write();
+    auto_mode_[i] = auto_mode;
+    track_[i] = track;
+    end_write();
+}
+
+void SharedPIDBank::begin_write() {
+    uint64_t sequence = sequence_->load(std::memory_order_relaxed);
+    sequence_->store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void SharedPIDBank::end_write() {
+    uint64_t sequence = sequence_->load(std::memory_order_relaxed);
+    sequence_->store(sequence + 1, std::memory_order_release);
+}
+
+SharedBankReader::SharedBankReader(const std::string& name)
+    : segment_(nullptr),
+      bytes_(0),
+      n_(0),
+      sequence_(nullptr),
+      steps_(nullptr),
+      u_(nullptr),
+      yf_(nullptr),
+      dyf_(nullptr),
+      saturation_(nullptr),
+      auto_mode_(nullptr),
+      track_(nullptr) {
+#ifdef SHARED_BANK_SHM
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        throw std::runtime_error(
+            "Could not open shared memory segment: " + name);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0
+            || static_cast<size_t>(st.st_size) < HEADER_SIZE) {
+        close(fd);
+        throw std::runtime_error("Shared bank segment not ready: " + name);
+    }
+    bytes_ = static_cast<size_t>(st.st_size);
+    void* map = mmap(nullptr, bytes_, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        throw std::runtime_error(
+            "Could not map shared memory segment: " + name);
+    }
+    segment_ = static_cast<const char*>(map);
+
+    // The writer stores the magic last, after a release fence, so the
+    // other header fields are read only after the magic and the fence
+    bool ready = std::memcmp(segment_, MAGIC, sizeof(MAGIC)) == 0;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint16_t version;
+    uint32_t size;
+    std::memcpy(&version, segment_ + VERSION_OFFSET, sizeof(version));
+    std::memcpy(&size, segment_ + SIZE_OFFSET, sizeof(size));
+    uint64_t columns[NUM_COLUMNS];
+    std::memcpy(columns, segment_ + COLUMNS_OFFSET, sizeof(columns));
+    bool valid = ready && version == SHARED_BANK_VERSION
+        && header_word(segment_, BYTES_OFFSET) == bytes_;
+    n_ = size;
+    for (size_t k = 0; valid && k < NUM_COLUMNS; ++k) {
+        size_t width = k < SATURATION ? sizeof(double) : 1;
+        valid = columns[k] >= HEADER_SIZE && columns[k] % 64 == 0
+            && columns[k] + n_ * width <= bytes_;
+    }
+    if (!valid) {
+        munmap(const_cast<char*>(segment_), bytes_);
+        throw std::runtime_error(ready
+            ? "Unsupported shared bank segment: " + name
+            : "Shared bank segment not ready: " + name);
+    }
+
+    sequence_ = reinterpret_cast<const std::atomic<uint64_t>*>(
+        segment_ + SEQUENCE_OFFSET);
+    steps_ = reinterpret_cast<const uint64_t*>(segment_ + STEPS_OFFSET);
+    u_ = reinterpret_cast<const double*>(segment_ + columns[U]);
+    yf_ = reinterpret_cast<const double*>(segment_ + columns[YF]);
+    dyf_ = reinterpret_cast<const double*>(segment_ + columns[DYF]);
+    saturation_ = reinterpret_cast<const unsigned char*>(
+        segment_ + columns[SATURATION]);
+    auto_mode_ = reinterpret_cast<const unsigned char*>(
+        segment_ + columns[AUTO_MODE]);
+    track_ = reinterpret_cast<const unsigned char*>(
+        segment_ + columns[TRACK]);
+#else
+    (void)name;
+    throw std::runtime_error(
+        "Shared memory segments are not supported on this platform");
+#endif
+}
+
+SharedBankReader::~SharedBankReader() {
+#ifdef SHARED_BANK_SHM
+    munmap(const_cast<char*>(segment_), bytes_);
+#endif
+}
+
+bool SharedBankReader::try_read(
+    SharedBankSnapshot& snapshot, size_t begin, size_t count) const {
+    if (begin > n_ || count > n_ - begin) {
+        throw std::out_of_range("SharedBankReader range out of bounds");
+    }
+    snapshot.u.resize(count);
+    snapshot.yf.resize(count);
+    snapshot.dyf.resize(count);
+    snapshot.saturation.resize(count);
+    snapshot.auto_mode.resize(count);
+    snapshot.track.resize(count);
+
+    uint64_t sequence = sequence_->load(std::memory_order_acquire);
+    if (sequence & 1) {
+        return false;
+    }
+    snapshot.steps = *steps_;
+    std::copy(u_ + begin, u_ + begin + count, snapshot.u.begin());
+    std::copy(yf_ + begin, yf_ + begin + count, snapshot.yf.begin());
+    std::copy(dyf_ + begin, dyf_ + begin + count, snapshot.dyf.begin());
+    std::copy(saturation_ + begin, saturation_ + begin + count,
+              snapshot.saturation.begin());
+    std::copy(auto_mode_ + begin, auto_mode_ + begin + count,
+              snapshot.auto_mode.begin());
+    std::copy(track_ + begin, track_ + begin + count,
+              snapshot.track.begin());
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return sequence_->load(std::memory_order_relaxed) == sequence;
+}
+
+void SharedBankReader::read(
+    SharedBankSnapshot& snapshot, size_t begin, size_t count) const {
+    while (!try_read(snapshot, begin, count)) {
+        std::this_thread::yield();
+    }
+}
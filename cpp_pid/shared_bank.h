@@ -0,0 +1,302 @@
+/**
+ * @file shared_bank.h
+ * @brief PIDBank in a POSIX shared-memory segment (host only)
+ *
+ * This file provides a PIDBank whose state arrays live in a named
+ * shared-memory segment, so that other processes (operator displays,
+ * historians) can map the segment read-only and read the live control
+ * signals, filtered measurements and modes of every loop without the
+ * control process copying or serializing anything.
+ *
+ * A sequence counter (seqlock) is incremented before and after every
+ * step. Readers copy the columns they need and retry if the counter
+ * changed meanwhile, so they always see the states of one whole step
+ * and never delay the control process.
+ *
+ * Segment layout version 1, in native byte order:
+ *
+ * | Offset | Size | Contents                                          |
+ * |--------|------|---------------------------------------------------|
+ * | 0      | 8    | Magic "PIDSHMEM", written last                    |
+ * | 8      | 2    | uint16 layout version (1)                         |
+ * | 10     | 2    | Reserved (0)                                      |
+ * | 12     | 4    | uint32 number of controllers n                    |
+ * | 16     | 8    | uint64 segment size in bytes                      |
+ * | 24     | 40   | Reserved (0)                                      |
+ * | 64     | 48   | uint64 offsets of the u, yf, dyf, saturation,     |
+ * |        |      | auto_mode and track columns                       |
+ * | 128    | 8    | uint64 sequence counter, odd during a step        |
+ * | 136    | 8    | uint64 number of steps                            |
+ * | 192    |      | Columns, each starting on a 64-byte boundary      |
+ *
+ * The u, yf and dyf columns hold n float64 values and the saturation,
+ * auto_mode and track columns n uint8 values (saturation bits as in
+ * PIDStepResult, 0 or 1 for the modes). Readers locate the columns
+ * through the offsets only; the rest of the column area holds the
+ * other PIDBank arrays and is not part of the layout.
+ */
+
+#ifndef SHARED_BANK_H
+#define SHARED_BANK_H
+
+#include "pid_bank.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Current shared bank layout version
+ */
+const uint16_t SHARED_BANK_VERSION = 1;
+
+/**
+ * @brief PIDBank placed in a named shared-memory segment
+ *
+ * Creates the segment (replacing any segment of the same name) and
+ * removes its name on destruction; readers that have it mapped keep
+ * their mapping. Only one thread may call the non-const methods.
+ */
+class SharedPIDBank {
+public:
+    /**
+     * @brief Constructor
+     *
+     * All controllers start in automatic mode without tracking, with
+     * the parameters of PIDBank::PIDBank().
+     *
+     * @param name Segment name for shm_open, starting with '/'
+     * @param n Number of controllers in the bank
+     * @param kp Proportional gain
+     * @param ki Integral gain
+     * @param kd Derivative gain
+     * @param TfTs Filter time constant as multiple of nominal sample
+     *             time (default: 10.0)
+     * @param umin Minimum control signal (default: -infinity)
+     * @param umax Maximum control signal (default: +infinity)
+     * @param u0 Bias term for P or PD control (default: 0.0)
+     * @param b Setpoint weight for proportional term (default: 1.0)
+     * @throws std::runtime_error If the segment cannot be created
+     */
+    SharedPIDBank(
+        const std::string& name,
+        size_t n,
+        double kp,
+        double ki,
+        double kd,
+        double TfTs = 10.0,
+        double umin = -std::numeric_limits<double>::infinity(),
+        double umax = std::numeric_limits<double>::infinity(),
+        double u0 = 0.0,
+        double b = 1.0);
+
+    ~SharedPIDBank();
+
+    SharedPIDBank(const SharedPIDBank&) = delete;
+    SharedPIDBank& operator=(const SharedPIDBank&) = delete;
+
+    /**
+     * @brief Segment name
+     */
+    const std::string& name() const { return name_; }
+
+    /**
+     * @brief Number of controllers in the bank
+     */
+    size_t size() const { return bank_.size(); }
+
+    /**
+     * @brief The bank, for configuring and retuning
+     *
+     * Changes to the controller states outside step(), such as
+     * configure(), reset() and restore(), should be made between
+     * begin_write() and end_write() so that readers do not see them
+     * half done.
+     */
+    PIDBank& bank() { return bank_; }
+    const PIDBank& bank() const { return bank_; }
+
+    /**
+     * @brief Compute the control signals of all controllers
+     *
+     * PIDBank::step() with the modes of the segment, between
+     * begin_write() and end_write().
+     *
+     * @param r Reference (setpoint) signals
+     * @param y Process measurements
+     * @param uff Feedforward control signals
+     * @param uman Manual mode control signals
+     * @param utrack Tracking signals for bumpless transfer
+     * @param Tx Execution periods (normalized)
+     * @param windup Windup status of each controller
+     * @param u Output control signals
+     */
+    void step(
+        const double* r,
+        const double* y,
+        const double* uff,
+        const double* uman,
+        const double* utrack,
+        const double* Tx,
+        const WindupMode* windup,
+        double* u);
+
+    /**
+     * @brief Set the mode of one controller
+     *
+     * @param i Controller index
+     * @param auto_mode Automatic mode
+     * @param track Tracking mode
+     */
+    void set_mode(size_t i, bool auto_mode, bool track);
+
+    /**
+     * @brief Automatic mode flags, one per controller
+     */
+    const bool* auto_mode() const { return auto_mode_; }
+
+    /**
+     * @brief Tracking mode flags, one per controller
+     */
+    const bool* track() const { return track_; }
+
+    /**
+     * @brief Number of steps so far
+     */
+    uint64_t steps() const { return *steps_; }
+
+    /**
+     * @brief Start changing the shared states
+     *
+     * Readers retry until the matching end_write().
+     */
+    void begin_write();
+
+    /**
+     * @brief Finish changing the shared states
+     */
+    void end_write();
+
+private:
+    PIDBank bank_;
+    std::string name_;
+
+    // Mapped segment
+    char* segment_;
+    size_t bytes_;
+
+    // Sequence counter and step count in the segment header
+    std::atomic<uint64_t>* sequence_;
+    uint64_t* steps_;
+
+    // Mode columns in the segment
+    bool* auto_mode_;
+    bool* track_;
+};
+
+/**
+ * @brief Columns of a range of controllers from one step
+ */
+struct SharedBankSnapshot {
+    uint64_t steps;                       ///< Steps before the snapshot
+    std::vector<double> u;                ///< Control signals
+    std::vector<double> yf;               ///< Filtered measurements
+    std::vector<double> dyf;              ///< Filtered derivatives
+    std::vector<unsigned char> saturation;  ///< Saturation flags
+    std::vector<unsigned char> auto_mode;   ///< Automatic mode (0 or 1)
+    std::vector<unsigned char> track;       ///< Tracking mode (0 or 1)
+};
+
+/**
+ * @brief Read-only view of a SharedPIDBank from any process
+ *
+ * Reading never blocks the control process: a read that overlaps a
+ * step is discarded and repeated.
+ */
+class SharedBankReader {
+public:
+    /**
+     * @brief Map a shared bank segment read-only
+     *
+     * @param name Segment name given to SharedPIDBank
+     * @throws std::runtime_error If the segment does not exist, is not
+     *         fully created yet or has another layout version
+     */
+    explicit SharedBankReader(const std::string& name);
+
+    ~SharedBankReader();
+
+    SharedBankReader(const SharedBankReader&) = delete;
+    SharedBankReader& operator=(const SharedBankReader&) = delete;
+
+    /**
+     * @brief Number of controllers in the bank
+     */
+    size_t size() const { return n_; }
+
+    /**
+     * @brief Copy the columns of all controllers if no step intervenes
+     *
+     * @param snapshot Output; its columns are resized to size()
+     * @return Whether the snapshot is consistent; otherwise try again
+     */
+    bool try_read(SharedBankSnapshot& snapshot) const {
+        return try_read(snapshot, 0, n_);
+    }
+
+    /**
+     * @brief Copy the columns of controllers [begin, begin + count)
+     *        if no step intervenes
+     *
+     * @param snapshot Output; its columns are resized to count
+     * @param begin First controller
+     * @param count Number of controllers
+     * @return Whether the snapshot is consistent; otherwise try again
+     * @throws std::out_of_range If the range exceeds size()
+     */
+    bool try_read(SharedBankSnapshot& snapshot, size_t begin,
+                  size_t count) const;
+
+    /**
+     * @brief Copy a consistent snapshot of all controllers
+     *
+     * Retries until a copy falls between two steps.
+     *
+     * @param snapshot Output; its columns are resized to size()
+     */
+    void read(SharedBankSnapshot& snapshot) const {
+        read(snapshot, 0, n_);
+    }
+
+    /**
+     * @brief Copy a consistent snapshot of controllers
+     *        [begin, begin + count)
+     *
+     * @param snapshot Output; its columns are resized to count
+     * @param begin First controller
+     * @param count Number of controllers
+     * @throws std::out_of_range If the range exceeds size()
+     */
+    void read(SharedBankSnapshot& snapshot, size_t begin,
+              size_t count) const;
+
+private:
+    const char* segment_;
+    size_t bytes_;
+    size_t n_;
+
+    const std::atomic<uint64_t>* sequence_;
+    const uint64_t* steps_;
+
+    // Columns in the segment
+    const double* u_;
+    const double* yf_;
+    const double* dyf_;
+    const unsigned char* saturation_;
+    const unsigned char* auto_mode_;
+    const unsigned char* track_;
+};
+
+#endif // SHARED_BANK_H
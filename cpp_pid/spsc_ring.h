@@ -0,0 +1,161 @@
+/**
+ * @file spsc_ring.h
+ * @brief Wait-free single-producer single-consumer ring buffer
+ *
+ * This file provides a fixed-capacity queue for passing samples
+ * between one producer thread and one consumer thread without locks or
+ * allocation after construction. It requires std::atomic and is meant
+ * for hosted platforms.
+ */
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+/**
+ * @brief Assumed cache line size for separating producer and consumer
+ *        indices
+ */
+const size_t SPSC_CACHE_LINE = 64;
+
+/**
+ * @brief Bounded queue for one producer and one consumer thread
+ *
+ * push() may only be called from one thread and pop() from one other
+ * thread. Both complete in a bounded number of steps whatever the
+ * other thread does. The head and tail indices count up without
+ * wrapping the buffer and are kept on separate cache lines, and each
+ * side caches the last index it read from the other side so that the
+ * shared line is only reloaded when the ring looks full or empty.
+ *
+ * @tparam T Element type, copied in and out of the buffer
+ */
+template <class T>
+class SpscRing {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param capacity Minimum number of elements, rounded up to a power
+     *                 of two
+     */
+    explicit SpscRing(size_t capacity)
+        : capacity_(round_up(capacity)),
+          mask_(capacity_ - 1),
+          buffer_(new T[capacity_]),
+          head_(0),
+          tail_cache_(0),
+          tail_(0),
+          head_cache_(0) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    /**
+     * @brief Number of elements the ring can hold
+     */
+    size_t capacity() const { return capacity_; }
+
+    /**
+     * @brief Add an element (producer thread only)
+     *
+     * @param value Element to copy into the ring
+     * @return false if the ring is full and value was not added
+     */
+    bool push(const T& value) {
+        T* slot = claim();
+        if (!slot) {
+            return false;
+        }
+        *slot = value;
+        publish();
+        return true;
+    }
+
+    /**
+     * @brief Next free slot, to be filled in place (producer thread
+     *        only)
+     *
+     * The element becomes visible to the consumer at publish(); until
+     * then further claim() calls return the same slot.
+     *
+     * @return Slot of the next element, or nullptr if the ring is full
+     */
+    T* claim() {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_cache_ == capacity_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (head - tail_cache_ == capacity_) {
+                return nullptr;
+            }
+        }
+        return &buffer_[head & mask_];
+    }
+
+    /**
+     * @brief Add the element filled in the slot of claim() (producer
+     *        thread only)
+     */
+    void publish() {
+        head_.store(head_.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_release);
+    }
+
+    /**
+     * @brief Remove the oldest element (consumer thread only)
+     *
+     * @param value Set to the removed element
+     * @return false if the ring is empty and value is unchanged
+     */
+    bool pop(T& value) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_cache_) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (tail == head_cache_) {
+                return false;
+            }
+        }
+        value = buffer_[tail & mask_];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Number of elements in the ring
+     *
+     * Exact only when neither thread is modifying the ring.
+     */
+    size_t size() const {
+        return head_.load(std::memory_order_acquire) -
+               tail_.load(std::memory_order_acquire);
+    }
+
+private:
+    static size_t round_up(size_t capacity) {
+        size_t n = 1;
+        while (n < capacity) {
+            n *= 2;
+        }
+        return n;
+    }
+
+    const size_t capacity_;
+    const size_t mask_;
+    std::unique_ptr<T[]> buffer_;
+
+    // Producer index and its copy of the consumer index
+    char pad0_[SPSC_CACHE_LINE];
+    std::atomic<size_t> head_;
+    size_t tail_cache_;
+
+    // Consumer index and its copy of the producer index
+    char pad1_[SPSC_CACHE_LINE];
+    std::atomic<size_t> tail_;
+    size_t head_cache_;
+    char pad2_[SPSC_CACHE_LINE];
+};
+
+#endif // SPSC_RING_H
@@ -0,0 +1,377 @@
+/**
+ * @file state_checkpoint.cpp
+ * @brief Implementation of the state checkpoint encoder and decoder
+ */
+
+#include "state_checkpoint.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+const char MAGIC[8] = {'P', 'I', 'D', 'S', 'T', 'A', 'T', 'E'};
+const size_t HEADER_SIZE = 24;
+
+// Float64 columns of a state and bytes per state of a full checkpoint
+const size_t FIELDS = 7;
+const size_t STATE_SIZE = FIELDS * 8 + 1;
+
+// Slack for storing whole 8-byte words at the end of the buffer
+const size_t SLACK = 8;
+
+enum Kind {
+    FULL = 0,
+    DELTA = 1
+};
+
+uint64_t read_le(const char* p, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t k = 0; k < bytes; ++k) {
+        value |= static_cast<uint64_t>(static_cast<unsigned char>(p[k]))
+            << (8 * k);
+    }
+    return value;
+}
+
+void store_le(char* p, uint64_t value, size_t bytes) {
+    for (size_t k = 0; k < bytes; ++k) {
+        p[k] = static_cast<char>((value >> (8 * k)) & 0xff);
+    }
+}
+
+// Whole 8-byte words, copied directly on little-endian hosts
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+const bool NATIVE_LITTLE_ENDIAN = true;
+
+inline uint64_t load_word(const char* p) {
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline void store_word(char* p, uint64_t value) {
+    std::memcpy(p, &value, sizeof(value));
+}
+#else
+const bool NATIVE_LITTLE_ENDIAN = false;
+
+inline uint64_t load_word(const char* p) {
+    return read_le(p, 8);
+}
+
+inline void store_word(char* p, uint64_t value) {
+    store_le(p, value, 8);
+}
+#endif
+
+inline uint64_t double_bits(double x) {
+    uint64_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    return bits;
+}
+
+inline double bits_double(uint64_t bits) {
+    double x;
+    std::memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+// Number of low bytes holding the nonzero bits of x, for x != 0
+inline size_t byte_length(uint64_t x) {
+#if defined(__GNUC__)
+    return 8 - static_cast<size_t>(__builtin_clzll(x)) / 8;
+#else
+    size_t m = 0;
+    while (x != 0) {
+        x >>= 8;
+        ++m;
+    }
+    return m;
+#endif
+}
+
+inline size_t bitmap_bytes(size_t count) {
+    return (count + 7) / 8;
+}
+
+// Number of states in the block starting at begin
+inline size_t block_length(size_t n, size_t begin) {
+    return std::min(STATE_CHECKPOINT_BLOCK, n - begin);
+}
+
+void write_header(char* p, Kind kind, size_t n, uint64_t sequence) {
+    std::memcpy(p, MAGIC, sizeof(MAGIC));
+    store_le(p + 8, STATE_CHECKPOINT_VERSION, 2);
+    store_le(p + 10, kind, 2);
+    store_le(p + 12, n, 4);
+    store_le(p + 16, sequence, 8);
+}
+
+void invalid() {
+    throw std::runtime_error("Invalid state checkpoint");
+}
+
+void store_column(const double* values, char* column, size_t count) {
+    if (NATIVE_LITTLE_ENDIAN) {
+        std::memcpy(column, values, count * sizeof(double));
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            store_word(column + 8 * i, double_bits(values[i]));
+        }
+    }
+}
+
+// Delta of a float64 column against its base, which is updated. The
+// XOR is always stored as a whole word and the output only advanced
+// past its nonzero bytes if it changed, so the loop has no branches.
+char* encode_column(const double* values, char* base, size_t count,
+                    char* p) {
+    unsigned char* bitmap = reinterpret_cast<unsigned char*>(p);
+    std::memset(bitmap, 0, bitmap_bytes(count));
+    p += bitmap_bytes(count);
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t bits = double_bits(values[i]);
+        uint64_t x = bits ^ load_word(base + 8 * i);
+        size_t changed = x != 0;
+        size_t m = byte_length(x | 1);
+        *p = static_cast<char>(m);
+        store_word(p + 1, x);
+        p += changed * (1 + m);
+        bitmap[i / 8] |= static_cast<unsigned char>(changed << (i % 8));
+        store_word(base + 8 * i, bits);
+    }
+    return p;
+}
+
+char* encode_saturation(const unsigned char* values, char* base,
+                        size_t count, char* p) {
+    unsigned char* bitmap = reinterpret_cast<unsigned char*>(p);
+    std::memset(bitmap, 0, bitmap_bytes(count));
+    p += bitmap_bytes(count);
+    for (size_t i = 0; i < count; ++i) {
+        size_t changed = values[i] != static_cast<unsigned char>(base[i]);
+        *p = static_cast<char>(values[i]);
+        p += changed;
+        bitmap[i / 8] |= static_cast<unsigned char>(changed << (i % 8));
+        base[i] = static_cast<char>(values[i]);
+    }
+    return p;
+}
+
+const char* decode_column(const char* p, const char* end, char* base,
+                          size_t count) {
+    if (static_cast<size_t>(end - p) < bitmap_bytes(count)) {
+        invalid();
+    }
+    const unsigned char* bitmap = reinterpret_cast<const unsigned char*>(p);
+    p += bitmap_bytes(count);
+    for (size_t i = 0; i < count; ++i) {
+        if ((bitmap[i / 8] >> (i % 8)) & 1) {
+            size_t m = p < end ? static_cast<unsigned char>(*p) : 0;
+            if (m < 1 || m > 8 || static_cast<size_t>(end - p) <= m) {
+                invalid();
+            }
+            uint64_t x = read_le(p + 1, m);
+            store_word(base + 8 * i, load_word(base + 8 * i) ^ x);
+            p += 1 + m;
+        }
+    }
+    return p;
+}
+
+const char* decode_saturation(const char* p, const char* end, char* base,
+                              size_t count) {
+    if (static_cast<size_t>(end - p) < bitmap_bytes(count)) {
+        invalid();
+    }
+    const unsigned char* bitmap = reinterpret_cast<const unsigned char*>(p);
+    p += bitmap_bytes(count);
+    for (size_t i = 0; i < count; ++i) {
+        if ((bitmap[i / 8] >> (i % 8)) & 1) {
+            if (p == end) {
+                invalid();
+            }
+            base[i] = *p++;
+        }
+    }
+    return p;
+}
+
+} // namespace
+
+StateEncoder::StateEncoder(size_t n)
+    : n_(n),
+      has_base_(false),
+      sequence_(0),
+      base_(HEADER_SIZE + n * STATE_SIZE),
+      // Largest delta: per block, eight bitmaps (at most count + 8
+      // bytes) and nine bytes per float64 entry and one per saturation
+      delta_(HEADER_SIZE + 65 * n
+             + 8 * (n / STATE_CHECKPOINT_BLOCK + 1) + SLACK),
+      scratch_(FIELDS * STATE_CHECKPOINT_BLOCK),
+      scratch_saturation_(STATE_CHECKPOINT_BLOCK),
+      data_(nullptr),
+      bytes_(0) {}
+
+StateEncoder::Columns StateEncoder::columns(
+    const PIDControllerState* states, size_t begin, size_t count) {
+    double* values = scratch_.data();
+    for (size_t i = 0; i < count; ++i) {
+        const PIDControllerState& state = states[begin + i];
+        values[i] = state.u_old;
+        values[STATE_CHECKPOINT_BLOCK + i] = state.up_old;
+        values[2 * STATE_CHECKPOINT_BLOCK + i] = state.ud_old;
+        values[3 * STATE_CHECKPOINT_BLOCK + i] = state.uff_old;
+        values[4 * STATE_CHECKPOINT_BLOCK + i] = state.yf;
+        values[5 * STATE_CHECKPOINT_BLOCK + i] = state.dyf;
+        values[6 * STATE_CHECKPOINT_BLOCK + i] = state.initialized
+            ? state.Tx_old : std::numeric_limits<double>::quiet_NaN();
+        scratch_saturation_[i] = state.saturation;
+    }
+    Columns columns;
+    for (size_t k = 0; k < FIELDS; ++k) {
+        columns.values[k] = values + k * STATE_CHECKPOINT_BLOCK;
+    }
+    columns.saturation = scratch_saturation_.data();
+    return columns;
+}
+
+StateEncoder::Columns StateEncoder::columns(
+    const PIDBank& bank, size_t begin, size_t) const {
+    Columns columns;
+    columns.values[0] = bank.field(PIDBank::U_OLD) + begin;
+    columns.values[1] = bank.field(PIDBank::UP_OLD) + begin;
+    columns.values[2] = bank.field(PIDBank::UD_OLD) + begin;
+    columns.values[3] = bank.field(PIDBank::UFF_OLD) + begin;
+    columns.values[4] = bank.field(PIDBank::YF) + begin;
+    columns.values[5] = bank.field(PIDBank::DYF) + begin;
+    columns.values[6] = bank.field(PIDBank::TX_OLD) + begin;
+    columns.saturation = bank.saturation() + begin;
+    return columns;
+}
+
+template <class Source>
+size_t StateEncoder::encode(const Source& source, bool full) {
+    full = full || !has_base_;
+    char* out = full ? base_.data() : delta_.data();
+    write_header(out, full ? FULL : DELTA, n_, sequence_++);
+    char* p = out + HEADER_SIZE;
+    for (size_t begin = 0; begin < n_; begin += STATE_CHECKPOINT_BLOCK) {
+        size_t count = block_length(n_, begin);
+        Columns block = columns(source, begin, count);
+        char* base = base_.data() + HEADER_SIZE + begin * STATE_SIZE;
+        for (size_t k = 0; k < FIELDS; ++k) {
+            char* column = base + 8 * count * k;
+            if (full) {
+                store_column(block.values[k], column, count);
+            } else {
+                p = encode_column(block.values[k], column, count, p);
+            }
+        }
+        char* saturation = base + 8 * count * FIELDS;
+        if (full) {
+            std::memcpy(saturation, block.saturation, count);
+        } else {
+            p = encode_saturation(block.saturation, saturation, count, p);
+        }
+    }
+    has_base_ = true;
+    data_ = out;
+    bytes_ = full ? base_.size() : static_cast<size_t>(p - out);
+    return bytes_;
+}
+
+size_t StateEncoder::encode_full(const PIDControllerState* states) {
+    return encode(states, true);
+}
+
+size_t StateEncoder::encode_full(const PIDBank& bank) {
+    return encode(bank, true);
+}
+
+size_t StateEncoder::encode_delta(const PIDControllerState* states) {
+    return encode(states, false);
+}
+
+size_t StateEncoder::encode_delta(const PIDBank& bank) {
+    return encode(bank, false);
+}
+
+StateDecoder::StateDecoder(size_t n)
+    : n_(n),
+      states_(n * STATE_SIZE),
+      valid_(false),
+      sequence_(0) {}
+
+void StateDecoder::decode(const char* data, size_t bytes) {
+    bool continues = valid_;
+    valid_ = false;
+    if (bytes < HEADER_SIZE || std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0
+            || read_le(data + 8, 2) != STATE_CHECKPOINT_VERSION
+            || read_le(data + 12, 4) != n_) {
+        invalid();
+    }
+    uint64_t kind = read_le(data + 10, 2);
+    uint64_t sequence = read_le(data + 16, 8);
+    const char* p = data + HEADER_SIZE;
+    const char* end = data + bytes;
+
+    if (kind == FULL) {
+        if (bytes != HEADER_SIZE + states_.size()) {
+            invalid();
+        }
+        std::memcpy(states_.data(), p, states_.size());
+    } else if (kind == DELTA) {
+        if (!continues || sequence != sequence_ + 1) {
+            throw std::runtime_error("State checkpoint out of sequence");
+        }
+        for (size_t begin = 0; begin < n_;
+             begin += STATE_CHECKPOINT_BLOCK) {
+            size_t count = block_length(n_, begin);
+            char* base = states_.data() + begin * STATE_SIZE;
+            for (size_t k = 0; k < FIELDS; ++k) {
+                p = decode_column(p, end, base + 8 * count * k, count);
+            }
+            p = decode_saturation(p, end, base + 8 * count * FIELDS, count);
+        }
+        if (p != end) {
+            invalid();
+        }
+    } else {
+        invalid();
+    }
+    sequence_ = sequence;
+    valid_ = true;
+}
+
+PIDControllerState StateDecoder::state(size_t i) const {
+    size_t begin = i / STATE_CHECKPOINT_BLOCK * STATE_CHECKPOINT_BLOCK;
+    size_t count = block_length(n_, begin);
+    const char* base = states_.data() + begin * STATE_SIZE;
+    size_t j = i - begin;
+    double values[FIELDS];
+    for (size_t k = 0; k < FIELDS; ++k) {
+        values[k] = bits_double(load_word(base + 8 * (count * k + j)));
+    }
+    PIDControllerState state;
+    state.u_old = values[0];
+    state.up_old = values[1];
+    state.ud_old = values[2];
+    state.uff_old = values[3];
+    state.yf = values[4];
+    state.dyf = values[5];
+    state.Tx_old = values[6];
+    state.saturation =
+        static_cast<unsigned char>(base[8 * count * FIELDS + j]);
+    state.initialized = !std::isnan(state.Tx_old);
+    return state;
+}
+
+void StateDecoder::states(PIDControllerState* states) const {
+    for (size_t i = 0; i < n_; ++i) {
+        states[i] = state(i);
+    }
+}
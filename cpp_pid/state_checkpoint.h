@@ -0,0 +1,233 @@
+/**
+ * @file state_checkpoint.h
+ * @brief Compact binary checkpoints of controller states
+ *
+ * This file provides an encoder and decoder for streaming the states of
+ * many controllers (see PIDController::snapshot() and PIDBank) to a
+ * standby node. A full checkpoint holds every state; a delta checkpoint
+ * holds only the fields that changed since the previous checkpoint, so
+ * it can be sent every cycle.
+ *
+ * Format version 1, all values little-endian:
+ *
+ * | Offset | Size | Contents                                          |
+ * |--------|------|---------------------------------------------------|
+ * | 0      | 8    | Magic "PIDSTATE"                                  |
+ * | 8      | 2    | uint16 format version (1)                         |
+ * | 10     | 2    | uint16 kind, 0 for full and 1 for delta           |
+ * | 12     | 4    | uint32 number of controllers n                    |
+ * | 16     | 8    | uint64 sequence number of the checkpoint          |
+ * | 24     |      | Blocks of STATE_CHECKPOINT_BLOCK controllers      |
+ *
+ * A state has eight columns: the float64 values u_old, up_old, ud_old,
+ * uff_old, yf, dyf and Tx_old and the uint8 saturation flags. A
+ * filter that is not initialized is stored with a NaN Tx_old. The last
+ * block may hold fewer than STATE_CHECKPOINT_BLOCK controllers.
+ *
+ * In a full checkpoint, each block holds its eight columns in order,
+ * so a full checkpoint is 24 + 57 n bytes. In a delta checkpoint, each
+ * column of a block starts with a bitmap of the changed entries (bit j
+ * of byte i / 8 for entry 8 i + j of the block). For each changed
+ * float64 entry follow a uint8 length m (1 to 8) and the m low bytes
+ * of the XOR of its old and new bit patterns, whose high bytes are zero
+ * when sign, exponent and leading mantissa bits are unchanged. Changed
+ * saturation entries follow as their new value. An unchanged state
+ * takes one bit per column.
+ */
+
+#ifndef STATE_CHECKPOINT_H
+#define STATE_CHECKPOINT_H
+
+#include "pid.h"
+#include "pid_bank.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Current state checkpoint format version
+ */
+const uint16_t STATE_CHECKPOINT_VERSION = 1;
+
+/**
+ * @brief Number of controllers per block of a checkpoint
+ */
+const size_t STATE_CHECKPOINT_BLOCK = 512;
+
+/**
+ * @brief Encodes the states of n controllers into checkpoints
+ *
+ * The encoder keeps the states of its last checkpoint, in the layout
+ * of a full checkpoint, as the base of the next delta, and numbers its
+ * checkpoints consecutively. Buffers are allocated once, so encoding
+ * does not allocate. Encoding a PIDBank reads its state arrays
+ * directly.
+ */
+class StateEncoder {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param n Number of controllers
+     */
+    explicit StateEncoder(size_t n);
+
+    /**
+     * @brief Number of controllers
+     */
+    size_t size() const { return n_; }
+
+    /**
+     * @brief Encode a full checkpoint
+     *
+     * @param states Array of size() states
+     * @return Size in bytes of the checkpoint at data()
+     */
+    size_t encode_full(const PIDControllerState* states);
+
+    /**
+     * @brief Encode a full checkpoint of a bank
+     *
+     * @param bank Bank of size() controllers
+     * @return Size in bytes of the checkpoint at data()
+     */
+    size_t encode_full(const PIDBank& bank);
+
+    /**
+     * @brief Encode the changes since the last checkpoint
+     *
+     * Encodes a full checkpoint if there is no previous one.
+     *
+     * @param states Array of size() states
+     * @return Size in bytes of the checkpoint at data()
+     */
+    size_t encode_delta(const PIDControllerState* states);
+
+    /**
+     * @brief Encode the changes of a bank since the last checkpoint
+     *
+     * @param bank Bank of size() controllers
+     * @return Size in bytes of the checkpoint at data()
+     */
+    size_t encode_delta(const PIDBank& bank);
+
+    /**
+     * @brief Last checkpoint, valid until the next encode
+     */
+    const char* data() const { return data_; }
+
+    /**
+     * @brief Size in bytes of the last checkpoint
+     */
+    size_t bytes() const { return bytes_; }
+
+    /**
+     * @brief Sequence number of the last checkpoint
+     */
+    uint64_t sequence() const { return sequence_ - 1; }
+
+private:
+    // Columns of one block of states
+    struct Columns {
+        const double* values[7];
+        const unsigned char* saturation;
+    };
+
+    // Columns of states [begin, begin + count), transposed into
+    // scratch_ for an array of states
+    Columns columns(const PIDControllerState* states, size_t begin,
+                    size_t count);
+    Columns columns(const PIDBank& bank, size_t begin,
+                    size_t count) const;
+
+    template <class Source>
+    size_t encode(const Source& source, bool full);
+
+    size_t n_;
+    bool has_base_;
+    uint64_t sequence_;
+
+    // Last checkpoint in the layout of a full checkpoint
+    std::vector<char> base_;
+
+    // Delta checkpoint, with room for the largest one
+    std::vector<char> delta_;
+
+    // Transposed block of states
+    std::vector<double> scratch_;
+    std::vector<unsigned char> scratch_saturation_;
+
+    const char* data_;
+    size_t bytes_;
+};
+
+/**
+ * @brief Rebuilds controller states from a stream of checkpoints
+ *
+ * A full checkpoint replaces all states. A delta checkpoint is applied
+ * to the states of the checkpoint numbered one before it, so a standby
+ * that missed a checkpoint waits for the next full one.
+ */
+class StateDecoder {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param n Number of controllers
+     */
+    explicit StateDecoder(size_t n);
+
+    /**
+     * @brief Number of controllers
+     */
+    size_t size() const { return n_; }
+
+    /**
+     * @brief Apply a checkpoint
+     *
+     * After an exception, the states are invalid until the next full
+     * checkpoint.
+     *
+     * @param data Checkpoint bytes
+     * @param bytes Size of the checkpoint
+     * @throws std::runtime_error If the checkpoint is invalid, is for a
+     *         different number of controllers, or is a delta that does
+     *         not follow the last checkpoint applied
+     */
+    void decode(const char* data, size_t bytes);
+
+    /**
+     * @brief Whether the states hold a complete checkpoint
+     */
+    bool valid() const { return valid_; }
+
+    /**
+     * @brief Sequence number of the last checkpoint applied
+     */
+    uint64_t sequence() const { return sequence_; }
+
+    /**
+     * @brief Decoded state of one controller
+     *
+     * @param i Controller index
+     */
+    PIDControllerState state(size_t i) const;
+
+    /**
+     * @brief Decoded states, for PIDController::restore() or
+     *        PIDBank::restore()
+     *
+     * @param states Output array of size() states
+     */
+    void states(PIDControllerState* states) const;
+
+private:
+    size_t n_;
+
+    // States in the layout of a full checkpoint
+    std::vector<char> states_;
+    bool valid_;
+    uint64_t sequence_;
+};
+
+#endif // STATE_CHECKPOINT_H
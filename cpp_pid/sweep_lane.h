@@ -0,0 +1,106 @@
+/**
+ * @file sweep_lane.h
+ * @brief One controller of a GPU parameter sweep
+ *
+ * This file provides the controller update used by each lane of the
+ * GPU sweep kernel, as plain functions on a struct of scalars that
+ * compile both as host code and as CUDA device code. The update is
+ * PIDController::step built from the same pieces, zoh_params and
+ * pid_step, so that the kernel can be checked against the CPU
+ * reference on hosts without a GPU.
+ */
+
+#ifndef SWEEP_LANE_H
+#define SWEEP_LANE_H
+
+#include "basic_pid.h"
+#include "host_device.h"
+#include "zoh_pid.h"
+#include <math.h>
+
+/**
+ * @brief Parameters and states of one sweep controller
+ *
+ * All members are scalars or structs of scalars so that the kernel can
+ * keep the whole lane in registers.
+ */
+struct SweepLane {
+    PIDParams params;     ///< Controller parameters
+    PIDState state;       ///< Controller signal states
+    double TfTs;          ///< Filter time constant
+    FilterParams filter;  ///< Filter parameters for Tx_old
+    double yf;            ///< Filtered measurement
+    double dyf;           ///< Filtered derivative of measurement
+    double Tx_old;        ///< Last execution period
+    bool initialized;     ///< Whether filter holds the parameters
+};
+
+/**
+ * @brief Initialize a lane with zero states
+ *
+ * The parameters are those of the PIDController constructor.
+ */
+PID_HOST_DEVICE inline void sweep_lane_init(
+    SweepLane& lane, double kp, double ki, double kd, double TfTs,
+    double umin, double umax, double u0 = 0.0, double b = 1.0) {
+    lane.params.kp = kp;
+    lane.params.ki = ki;
+    lane.params.kd = kd;
+    lane.params.umin = umin;
+    lane.params.umax = umax;
+    lane.params.u0 = u0;
+    lane.params.b = b;
+    lane.state.u_old = 0.0;
+    lane.state.up_old = 0.0;
+    lane.state.ud_old = 0.0;
+    lane.state.uff_old = 0.0;
+    lane.TfTs = TfTs;
+    lane.yf = 0.0;
+    lane.dyf = 0.0;
+    lane.Tx_old = 0.0;
+    lane.initialized = false;
+}
+
+/**
+ * @brief Compute the control signal of one lane
+ *
+ * Same as PIDController::step with an exact ZOH rediscretization
+ * whenever Tx changes.
+ *
+ * @param saturated Set to whether u is at umin or umax
+ * @return Control signal u
+ */
+PID_HOST_DEVICE inline double sweep_lane_step(
+    SweepLane& lane, double r, double y, double uff, double uman,
+    double utrack, double Tx, bool track, bool auto_mode,
+    WindupMode windup, bool& saturated) {
+    // Rediscretize to match execution period (see zoh_Fy)
+    if (!lane.initialized || Tx != lane.Tx_old) {
+        double h1 = Tx / lane.TfTs;
+        lane.filter = zoh_params(lane.TfTs, h1, exp(-h1));
+        lane.initialized = true;
+    }
+    lane.Tx_old = Tx;
+
+    // Filter updates
+    const FilterParams& f = lane.filter;
+    double yf_prev = lane.yf;
+    lane.yf = f.a11 * yf_prev + f.a12 * lane.dyf + f.b1 * y;
+    lane.dyf = f.a21 * yf_prev + f.a22 * lane.dyf + f.b2 * y;
+
+    // Reset state if using P or PD control (ki == 0)
+    PIDStepResult result;
+    if (lane.params.ki == 0.0) {
+        result = pid_step<PIDStructure::PD>(
+            lane.params, lane.state, r, lane.yf, lane.dyf, uff, uman,
+            utrack, Tx, track, auto_mode, windup);
+    } else {
+        result = pid_step<PIDStructure::PID>(
+            lane.params, lane.state, r, lane.yf, lane.dyf, uff, uman,
+            utrack, Tx, track, auto_mode, windup);
+    }
+    saturated = result.saturation != 0;
+    return result.u;
+}
+
+#endif // SWEEP_LANE_H
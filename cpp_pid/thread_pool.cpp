@@ -0,0 +1,100 @@
+/**
+ * @file thread_pool.cpp
+ * @brief Implementation of the worker thread pool
+ */
+
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(size_t threads)
+    : task_(nullptr),
+      n_(0),
+      generation_(0),
+      active_(0),
+      stop_(false),
+      next_(0) {
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    for (size_t w = 1; w < threads; ++w) {
+        threads_.push_back(std::thread(&ThreadPool::worker_main, this, w));
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    start_.notify_all();
+    for (size_t w = 0; w < threads_.size(); ++w) {
+        threads_[w].join();
+    }
+}
+
+void ThreadPool::parallel_for(size_t n, const Task& fn) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task_ = &fn;
+        n_ = n;
+        next_.store(0);
+        error_ = nullptr;
+        active_ = threads_.size();
+        ++generation_;
+    }
+    start_.notify_all();
+
+    work(0);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return active_ == 0; });
+    task_ = nullptr;
+    if (error_) {
+        std::exception_ptr error = error_;
+        error_ = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::work(size_t worker) {
+    for (;;) {
+        size_t i = next_.fetch_add(1, std::memory_order_relaxed);
+        if (i >= n_) {
+            return;
+        }
+        try {
+            (*task_)(i, worker);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!error_) {
+                error_ = std::current_exception();
+            }
+            // Stop handing out indices
+            next_.store(n_);
+            return;
+        }
+    }
+}
+
+void ThreadPool::worker_main(size_t worker) {
+    size_t generation = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            start_.wait(lock, [this, generation] {
+                return stop_ || generation_ != generation;
+            });
+            if (stop_) {
+                return;
+            }
+            generation = generation_;
+        }
+
+        work(worker);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --active_;
+        }
+        done_.notify_one();
+    }
+}
@@ -0,0 +1,100 @@
+/**
+ * @file thread_pool.h
+ * @brief Persistent worker threads for parallel simulation runs
+ *
+ * This file provides a small thread pool used by the simulation tools
+ * (parameter sweeps and Monte Carlo runs) to spread independent runs
+ * across cores. It requires a hosted platform with std::thread and is
+ * not part of the embedded controller code.
+ */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Pool of worker threads running parallel loops
+ *
+ * parallel_for() calls a function for every index of a range. Idle
+ * workers claim the next unclaimed index from a shared atomic counter,
+ * so a worker that finishes its runs early keeps taking work until
+ * the range is exhausted and no thread waits on a fixed partition.
+ * The calling thread takes part as worker 0.
+ */
+class ThreadPool {
+public:
+    /**
+     * @brief Function called for each index, with the worker number
+     *        in [0, size()) for per-worker buffers
+     */
+    typedef std::function<void(size_t index, size_t worker)> Task;
+
+    /**
+     * @brief Constructor
+     *
+     * @param threads Number of workers including the calling thread
+     *                (default: 0, one per hardware thread)
+     */
+    explicit ThreadPool(size_t threads = 0);
+
+    /**
+     * @brief Stop and join the worker threads
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief Number of workers including the calling thread
+     */
+    size_t size() const { return threads_.size() + 1; }
+
+    /**
+     * @brief Call fn for every index in [0, n) and wait for completion
+     *
+     * If fn throws, no further indices are started and the first
+     * exception is rethrown in the calling thread once all workers have
+     * stopped. Must not be called concurrently or from within fn.
+     *
+     * @param n Number of indices
+     * @param fn Function called as fn(index, worker)
+     */
+    void parallel_for(size_t n, const Task& fn);
+
+private:
+    // Claim and run indices of the current loop
+    void work(size_t worker);
+
+    // Background worker main loop
+    void worker_main(size_t worker);
+
+    std::vector<std::thread> threads_;
+
+    std::mutex mutex_;
+    std::condition_variable start_;
+    std::condition_variable done_;
+
+    // Current loop, published under mutex_
+    const Task* task_;
+    size_t n_;
+    size_t generation_;
+    size_t active_;
+    bool stop_;
+
+    // Next unclaimed index of the current loop
+    std::atomic<size_t> next_;
+
+    // First exception thrown by the current loop
+    std::exception_ptr error_;
+};
+
+#endif // THREAD_POOL_H
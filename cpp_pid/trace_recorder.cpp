@@ -0,0 +1,223 @@
+/**
+ * @file trace_recorder.cpp
+ * @brief Implementation of the trace recorder
+ */
+
+#include "trace_recorder.h"
+#include <chrono>
+#include <stdexcept>
+
+namespace {
+
+// Records moved from a ring per spool write
+const size_t BATCH = 256;
+
+void write_records(std::FILE* file, const TraceRecord* records, size_t n,
+                   const std::string& path) {
+    if (n > 0 && std::fwrite(records, sizeof(TraceRecord), n, file) != n) {
+        throw std::runtime_error("Could not write file: " + path);
+    }
+}
+
+} // namespace
+
+TraceWriter::TraceWriter(const TraceOptions& options)
+    : ring_(options.capacity),
+      trigger_(options.trigger),
+      decimation_(options.decimation),
+      post_trigger_(options.post_trigger),
+      steps_(0),
+      skipped_(0),
+      post_remaining_(0),
+      history_(options.trigger == TraceTrigger::SATURATION
+                   ? options.pre_trigger : 0),
+      history_next_(0),
+      history_count_(0),
+      dropped_(0) {}
+
+void TraceWriter::flush_history() {
+    size_t size = history_.size();
+    for (size_t k = 0; k < history_count_; ++k) {
+        push(history_[(history_next_ + size - history_count_ + k) % size]);
+    }
+    history_count_ = 0;
+}
+
+TraceRecorder::TraceRecorder(
+    const std::string& path,
+    const TrajectoryConfig& config,
+    const TraceOptions& options)
+    : path_(path),
+      spool_path_(path + ".spool"),
+      config_(config),
+      options_(options),
+      spool_(std::fopen(spool_path_.c_str(), "wb")),
+      closed_(false),
+      records_(0),
+      stop_(false) {
+    if (!spool_) {
+        throw std::runtime_error(
+            "Could not open file for writing: " + spool_path_);
+    }
+    thread_ = std::thread(&TraceRecorder::run, this);
+}
+
+TraceRecorder::~TraceRecorder() {
+    try {
+        close();
+    } catch (...) {
+    }
+}
+
+TraceWriter& TraceRecorder::writer() {
+    std::lock_guard<std::mutex> lock(writers_mutex_);
+    writers_.push_back(
+        std::unique_ptr<TraceWriter>(new TraceWriter(options_)));
+    return *writers_.back();
+}
+
+size_t TraceRecorder::dropped() const {
+    std::lock_guard<std::mutex> lock(writers_mutex_);
+    size_t total = 0;
+    for (size_t k = 0; k < writers_.size(); ++k) {
+        total += writers_[k]->dropped();
+    }
+    return total;
+}
+
+void TraceRecorder::drain() {
+    TraceRecord batch[BATCH];
+    std::lock_guard<std::mutex> lock(writers_mutex_);
+    for (size_t k = 0; k < writers_.size(); ++k) {
+        SpscRing<TraceRecord>& ring = writers_[k]->ring_;
+        size_t n;
+        do {
+            n = 0;
+            while (n < BATCH && ring.pop(batch[n])) {
+                ++n;
+            }
+            write_records(spool_, batch, n, spool_path_);
+            records_.store(records_.load(std::memory_order_relaxed) + n,
+                           std::memory_order_relaxed);
+        } while (n == BATCH);
+    }
+}
+
+void TraceRecorder::run() {
+    std::chrono::duration<double> interval(options_.flush_interval);
+    std::unique_lock<std::mutex> lock(stop_mutex_);
+    while (!stop_) {
+        stop_condition_.wait_for(lock, interval);
+        lock.unlock();
+        try {
+            drain();
+        } catch (const std::runtime_error&) {
+            // Reported again by the final drain in close()
+        }
+        lock.lock();
+    }
+}
+
+void TraceRecorder::close() {
+    if (closed_) {
+        return;
+    }
+    closed_ = true;
+    {
+        std::lock_guard<std::mutex> lock(stop_mutex_);
+        stop_ = true;
+    }
+    stop_condition_.notify_one();
+    thread_.join();
+
+    // Records pushed after the last drain of the thread
+    try {
+        drain();
+    } catch (...) {
+        std::fclose(spool_);
+        throw;
+    }
+    if (std::fclose(spool_) != 0) {
+        throw std::runtime_error("Could not write file: " + spool_path_);
+    }
+    convert_spool(spool_path_, path_, config_);
+    std::remove(spool_path_.c_str());
+}
+
+size_t TraceRecorder::convert_spool(const std::string& spool_path,
+                                    const std::string& path,
+                                    const TrajectoryConfig& config) {
+    std::FILE* file = std::fopen(spool_path.c_str(), "rb");
+    if (!file) {
+        throw std::runtime_error("Could not open file: " + spool_path);
+    }
+    std::vector<TraceRecord> records;
+    TraceRecord batch[BATCH];
+    size_t n;
+    while ((n = std::fread(batch, sizeof(TraceRecord), BATCH, file)) > 0) {
+        records.insert(records.end(), batch, batch + n);
+    }
+    bool failed = std::ferror(file) != 0;
+    std::fclose(file);
+    if (failed) {
+        throw std::runtime_error("Could not read file: " + spool_path);
+    }
+
+    // Columns of the trajectory file
+    size_t rows = records.size();
+    std::vector<double> r(rows), y(rows), uff(rows), uman(rows);
+    std::vector<double> utrack(rows), Tx(rows), u(rows);
+    std::vector<double> loop(rows), step(rows), saturation(rows);
+    std::vector<double> yf(rows), dyf(rows), Dup(rows), Dui(rows);
+    std::vector<double> Dud(rows), Duff(rows);
+    std::unique_ptr<bool[]> auto_mode(new bool[rows]);
+    std::unique_ptr<bool[]> track(new bool[rows]);
+    std::vector<WindupMode> windup(rows);
+    for (size_t i = 0; i < rows; ++i) {
+        const TraceRecord& record = records[i];
+        r[i] = record.r;
+        y[i] = record.y;
+        uff[i] = record.uff;
+        uman[i] = record.uman;
+        utrack[i] = record.utrack;
+        Tx[i] = record.Tx;
+        u[i] = record.u;
+        auto_mode[i] = record.auto_mode;
+        track[i] = record.track;
+        windup[i] = record.windup;
+        loop[i] = record.loop;
+        step[i] = static_cast<double>(record.step);
+        saturation[i] = record.saturation;
+        yf[i] = record.yf;
+        dyf[i] = record.dyf;
+        Dup[i] = record.Dup;
+        Dui[i] = record.Dui;
+        Dud[i] = record.Dud;
+        Duff[i] = record.Duff;
+    }
+
+    InputSeries inputs(rows, r.data(), y.data());
+    inputs.uff = uff.data();
+    inputs.uman = uman.data();
+    inputs.utrack = utrack.data();
+    inputs.Tx = Tx.data();
+    inputs.auto_mode = auto_mode.get();
+    inputs.track = track.get();
+    inputs.windup = windup.data();
+
+    std::vector<TrajectoryColumn> extra;
+    TrajectoryColumn columns[] = {
+        {"loop", loop.data()},
+        {"step", step.data()},
+        {"saturation", saturation.data()},
+        {"yf", yf.data()},
+        {"dyf", dyf.data()},
+        {"Dup", Dup.data()},
+        {"Dui", Dui.data()},
+        {"Dud", Dud.data()},
+        {"Duff", Duff.data()}
+    };
+    extra.assign(columns, columns + sizeof(columns) / sizeof(columns[0]));
+    write_trajectory(path, config, inputs, u.data(), extra);
+    return rows;
+}
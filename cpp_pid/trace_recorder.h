@@ -0,0 +1,354 @@
+/**
+ * @file trace_recorder.h
+ * @brief Recorder of controller internals for diagnosing loops
+ *
+ * This file provides a recorder that captures the filtered measurement
+ * and the P, I, D and FF increments of controller steps without
+ * slowing the control thread down: each control thread copies
+ * fixed-size records into its own lock-free ring, and a background
+ * thread appends them to a spool file. Closing the recorder converts
+ * the spool into a trajectory file (see trajectory_file.h). It
+ * requires std::thread and is meant for hosted platforms.
+ */
+
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include "pid.h"
+#include "spsc_ring.h"
+#include "trajectory_file.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief One recorded controller step
+ *
+ * Records are written to the spool file as they are in memory, so the
+ * spool can only be read on the machine that wrote it.
+ */
+struct TraceRecord {
+    uint64_t step;             ///< Step count of the writer
+    uint32_t loop;             ///< Loop identifier given by the caller
+    unsigned char saturation;  ///< SATURATED_HIGH / SATURATED_LOW bits
+    bool track;                ///< Tracking mode flag
+    bool auto_mode;            ///< Automatic mode flag
+    WindupMode windup;         ///< Windup status
+    double r;                  ///< Reference signal
+    double y;                  ///< Process measurement
+    double uff;                ///< Feedforward control signal
+    double uman;               ///< Manual mode control signal
+    double utrack;             ///< Tracking signal
+    double Tx;                 ///< Execution period normalized
+    double yf;                 ///< Filtered measurement
+    double dyf;                ///< Filtered derivative
+    double Dup;                ///< Proportional increment
+    double Dui;                ///< Integral increment
+    double Dud;                ///< Derivative increment
+    double Duff;               ///< Feedforward increment
+    double u;                  ///< Control signal
+};
+
+/**
+ * @brief Which steps a writer records
+ */
+enum class TraceTrigger {
+    ALWAYS,     ///< Every decimation-th step
+    SATURATION  ///< Steps around saturated steps
+};
+
+/**
+ * @brief Options of a trace recorder
+ */
+struct TraceOptions {
+    size_t capacity;        ///< Minimum ring capacity of each writer
+    TraceTrigger trigger;   ///< Which steps are recorded
+    size_t decimation;      ///< Record every n-th step (ALWAYS)
+    size_t pre_trigger;     ///< Steps kept before a saturation
+    size_t post_trigger;    ///< Steps recorded after a saturation
+    double flush_interval;  ///< Seconds between spool writes
+
+    TraceOptions()
+        : capacity(4096),
+          trigger(TraceTrigger::ALWAYS),
+          decimation(1),
+          pre_trigger(16),
+          post_trigger(64),
+          flush_interval(0.01) {}
+};
+
+/**
+ * @brief Records steps of one control thread
+ *
+ * Created by TraceRecorder::writer() and used by one thread. Recording
+ * writes the record into the writer's ring and never blocks; when the
+ * ring is full the record is dropped and counted. step() fills the
+ * record in place, so steps the trigger skips are not built at all.
+ *
+ * With the SATURATION trigger, the writer keeps the last pre_trigger
+ * steps that were not recorded. A saturated step records them, itself
+ * and the next post_trigger steps. The trigger applies to all steps of
+ * the writer, so give each loop its own writer for per-loop triggers.
+ */
+class TraceWriter {
+public:
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    /**
+     * @brief Step a controller and record the step
+     *
+     * Arguments as for PIDController::step.
+     *
+     * @param controller Controller to step
+     * @param loop Loop identifier stored with the record
+     * @return Result of the step
+     */
+    PIDStepResult step(
+        PIDController& controller,
+        uint32_t loop,
+        double r,
+        double y,
+        double uff = 0.0,
+        double uman = 0.0,
+        double utrack = 0.0,
+        double Tx = 1.0,
+        bool track = false,
+        bool auto_mode = true,
+        WindupMode windup = WindupMode::NONE) {
+        PIDStepResult result = controller.step(
+            r, y, uff, uman, utrack, Tx, track, auto_mode, windup);
+        uint64_t step = steps_++;
+
+        // Written in place, so skipped steps cost only the trigger
+        bool in_ring;
+        TraceRecord* entry = begin_record(result.saturation, in_ring);
+        if (entry) {
+            FilterOutput filtered = controller.filter().state();
+            entry->step = step;
+            entry->loop = loop;
+            entry->saturation = result.saturation;
+            entry->track = track;
+            entry->auto_mode = auto_mode;
+            entry->windup = windup;
+            entry->r = r;
+            entry->y = y;
+            entry->uff = uff;
+            entry->uman = uman;
+            entry->utrack = utrack;
+            entry->Tx = Tx;
+            entry->yf = filtered.yf;
+            entry->dyf = filtered.dyf;
+            entry->Dup = result.Dup;
+            entry->Dui = result.Dui;
+            entry->Dud = result.Dud;
+            entry->Duff = result.Duff;
+            entry->u = result.u;
+            if (in_ring) {
+                ring_.publish();
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @brief Record a step, applying the trigger
+     */
+    void record(const TraceRecord& record) {
+        bool in_ring;
+        TraceRecord* entry = begin_record(record.saturation, in_ring);
+        if (entry) {
+            *entry = record;
+            if (in_ring) {
+                ring_.publish();
+            }
+        }
+    }
+
+    /**
+     * @brief Number of records dropped because the ring was full
+     */
+    size_t dropped() const {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+private:
+    friend class TraceRecorder;
+
+    TraceWriter(const TraceOptions& options);
+
+    void push(const TraceRecord& record) {
+        if (!ring_.push(record)) {
+            count_dropped();
+        }
+    }
+
+    void count_dropped() {
+        dropped_.store(dropped_.load(std::memory_order_relaxed) + 1,
+                       std::memory_order_relaxed);
+    }
+
+    // Apply the trigger to a step with the given saturation flags and
+    // return where to write its record: a claimed ring slot (in_ring
+    // set, to be published once filled), a history slot, or nullptr if
+    // the step is not recorded or the ring is full
+    TraceRecord* begin_record(unsigned char saturation, bool& in_ring) {
+        in_ring = true;
+        if (trigger_ == TraceTrigger::ALWAYS) {
+            if (++skipped_ < decimation_) {
+                return nullptr;
+            }
+            skipped_ = 0;
+        } else if (saturation != 0) {
+            flush_history();
+            post_remaining_ = post_trigger_;
+        } else if (post_remaining_ > 0) {
+            --post_remaining_;
+        } else {
+            in_ring = false;
+            if (history_.empty()) {
+                return nullptr;
+            }
+            TraceRecord* entry = &history_[history_next_];
+            if (++history_next_ == history_.size()) {
+                history_next_ = 0;
+            }
+            if (history_count_ < history_.size()) {
+                ++history_count_;
+            }
+            return entry;
+        }
+        TraceRecord* entry = ring_.claim();
+        if (!entry) {
+            count_dropped();
+        }
+        return entry;
+    }
+
+    // Record the kept steps before a saturation, oldest first
+    void flush_history();
+
+    SpscRing<TraceRecord> ring_;
+    TraceTrigger trigger_;
+    size_t decimation_;
+    size_t post_trigger_;
+    uint64_t steps_;
+    size_t skipped_;
+    size_t post_remaining_;
+    std::vector<TraceRecord> history_;
+    size_t history_next_;
+    size_t history_count_;
+    std::atomic<size_t> dropped_;
+};
+
+/**
+ * @brief Collects the records of several writers into a file
+ *
+ * A background thread moves the records of all writers into the spool
+ * file path + ".spool" every flush_interval seconds, so the control
+ * threads never write to a file. close() stops the thread and writes
+ * path as a trajectory file with one row per record, in the order the
+ * records reached the spool (per writer, in step order). Its columns
+ * are the inputs (r, y, uff, uman, utrack, Tx, auto, track, windup),
+ * u, and the float64 columns loop, step, saturation, yf, dyf, Dup,
+ * Dui, Dud and Duff. The spool is removed after the conversion.
+ */
+class TraceRecorder {
+public:
+    /**
+     * @brief Constructor, starting the background thread
+     *
+     * @param path Path of the trajectory file written by close()
+     * @param config Controller configuration stored in the file
+     * @param options Trigger and buffer options
+     * @throws std::runtime_error If the spool file cannot be created
+     */
+    TraceRecorder(
+        const std::string& path,
+        const TrajectoryConfig& config = TrajectoryConfig(),
+        const TraceOptions& options = TraceOptions());
+
+    /**
+     * @brief Destructor, calling close() if needed and ignoring errors
+     */
+    ~TraceRecorder();
+
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+    /**
+     * @brief Create a writer for one control thread
+     *
+     * @return Writer owned by the recorder, valid until close()
+     */
+    TraceWriter& writer();
+
+    /**
+     * @brief Stop recording and write the trajectory file
+     *
+     * Writers must not be used after this call.
+     *
+     * @throws std::runtime_error If the files cannot be written
+     */
+    void close();
+
+    /**
+     * @brief Number of records written to the spool so far
+     */
+    size_t records() const {
+        return records_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Number of records dropped by all writers
+     */
+    size_t dropped() const;
+
+    /**
+     * @brief Convert a spool file into a trajectory file
+     *
+     * For recovering the records of a process that did not call
+     * close().
+     *
+     * @param spool_path Path of the spool file
+     * @param path Path of the trajectory file to write
+     * @param config Controller configuration stored in the file
+     * @return Number of records converted
+     * @throws std::runtime_error If the files cannot be read or written
+     */
+    static size_t convert_spool(const std::string& spool_path,
+                                const std::string& path,
+                                const TrajectoryConfig& config);
+
+private:
+    // Move the records of all writers to the spool
+    void drain();
+
+    // Background thread: drain every flush_interval until stopped
+    void run();
+
+    std::string path_;
+    std::string spool_path_;
+    TrajectoryConfig config_;
+    TraceOptions options_;
+    std::FILE* spool_;
+    bool closed_;
+
+    mutable std::mutex writers_mutex_;
+    std::vector<std::unique_ptr<TraceWriter> > writers_;
+    std::atomic<size_t> records_;
+
+    std::mutex stop_mutex_;
+    std::condition_variable stop_condition_;
+    bool stop_;
+    std::thread thread_;
+};
+
+#endif // TRACE_RECORDER_H
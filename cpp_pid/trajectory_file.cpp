@@ -0,0 +1,338 @@
+/**
+ * @file trajectory_file.cpp
+ * @brief Implementation of the trajectory file reader and writer
+ */
+
+#include "trajectory_file.h"
+#include "io_data.h"
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+const char MAGIC[8] = {'P', 'I', 'D', 'T', 'R', 'A', 'J', '\0'};
+const size_t HEADER_SIZE = 96;
+const size_t ENTRY_SIZE = 32;
+const size_t NAME_SIZE = 16;
+const size_t ALIGNMENT = 64;
+
+enum ColumnType {
+    FLOAT64 = 1,
+    BITS = 2,
+    WINDUP = 3
+};
+
+bool little_endian() {
+    const uint16_t one = 1;
+    unsigned char byte;
+    std::memcpy(&byte, &one, 1);
+    return byte == 1;
+}
+
+uint64_t read_le(const char* p, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t k = 0; k < bytes; ++k) {
+        value |= static_cast<uint64_t>(static_cast<unsigned char>(p[k]))
+            << (8 * k);
+    }
+    return value;
+}
+
+void append_le(std::vector<char>& out, uint64_t value, size_t bytes) {
+    for (size_t k = 0; k < bytes; ++k) {
+        out.push_back(static_cast<char>((value >> (8 * k)) & 0xff));
+    }
+}
+
+uint64_t double_bits(double x) {
+    uint64_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    return bits;
+}
+
+double read_double(const char* p) {
+    uint64_t bits = read_le(p, 8);
+    double x;
+    std::memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+size_t column_bytes(uint32_t type, size_t n) {
+    switch (type) {
+    case FLOAT64:
+        return n * sizeof(double);
+    case BITS:
+        return (n + 7) / 8;
+    case WINDUP:
+        return (n + 3) / 4;
+    default:
+        return 0;
+    }
+}
+
+size_t align(size_t offset) {
+    return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+/**
+ * @brief Column to be written
+ */
+struct OutputColumn {
+    const char* name;
+    uint32_t type;
+    const void* data;
+};
+
+void write_column_data(
+    std::FILE* file, const OutputColumn& column, size_t n) {
+    std::vector<char> bytes;
+    if (column.type == FLOAT64) {
+        const double* values = static_cast<const double*>(column.data);
+        if (little_endian()) {
+            std::fwrite(values, sizeof(double), n, file);
+            return;
+        }
+        bytes.reserve(n * sizeof(double));
+        for (size_t i = 0; i < n; ++i) {
+            append_le(bytes, double_bits(values[i]), 8);
+        }
+    } else if (column.type == BITS) {
+        const bool* values = static_cast<const bool*>(column.data);
+        bytes.assign(column_bytes(BITS, n), 0);
+        for (size_t i = 0; i < n; ++i) {
+            if (values[i]) {
+                bytes[i / 8] = static_cast<char>(bytes[i / 8] | (1 << (i % 8)));
+            }
+        }
+    } else {
+        const WindupMode* values = static_cast<const WindupMode*>(column.data);
+        bytes.assign(column_bytes(WINDUP, n), 0);
+        for (size_t i = 0; i < n; ++i) {
+            int bits = static_cast<int>(values[i]) & 3;
+            bytes[i / 4] = static_cast<char>(
+                bytes[i / 4] | (bits << (2 * (i % 4))));
+        }
+    }
+    std::fwrite(bytes.data(), 1, bytes.size(), file);
+}
+
+} // namespace
+
+void write_trajectory(
+    const std::string& path,
+    const TrajectoryConfig& config,
+    const InputSeries& inputs,
+    const double* u,
+    const std::vector<TrajectoryColumn>& extra) {
+    const OutputColumn all_columns[] = {
+        {"r", FLOAT64, inputs.r},
+        {"y", FLOAT64, inputs.y},
+        {"uff", FLOAT64, inputs.uff},
+        {"uman", FLOAT64, inputs.uman},
+        {"utrack", FLOAT64, inputs.utrack},
+        {"Tx", FLOAT64, inputs.Tx},
+        {"u", FLOAT64, u},
+        {"auto", BITS, inputs.auto_mode},
+        {"track", BITS, inputs.track},
+        {"windup", WINDUP, inputs.windup}
+    };
+    std::vector<OutputColumn> columns;
+    for (size_t c = 0; c < sizeof(all_columns) / sizeof(all_columns[0]); ++c) {
+        if (all_columns[c].data) {
+            columns.push_back(all_columns[c]);
+        }
+    }
+    for (size_t e = 0; e < extra.size(); ++e) {
+        size_t length = std::strlen(extra[e].name);
+        if (length == 0 || length >= NAME_SIZE) {
+            throw std::invalid_argument(
+                std::string("Invalid trajectory column name: ")
+                + extra[e].name);
+        }
+        for (size_t c = 0; c < sizeof(all_columns) / sizeof(all_columns[0]);
+             ++c) {
+            if (std::strcmp(extra[e].name, all_columns[c].name) == 0) {
+                throw std::invalid_argument(
+                    std::string("Duplicate trajectory column: ")
+                    + extra[e].name);
+            }
+        }
+        for (size_t k = 0; k < e; ++k) {
+            if (std::strcmp(extra[e].name, extra[k].name) == 0) {
+                throw std::invalid_argument(
+                    std::string("Duplicate trajectory column: ")
+                    + extra[e].name);
+            }
+        }
+        OutputColumn column = {extra[e].name, FLOAT64, extra[e].data};
+        columns.push_back(column);
+    }
+    size_t n = inputs.n;
+
+    // Header
+    std::vector<char> header(MAGIC, MAGIC + sizeof(MAGIC));
+    append_le(header, TRAJECTORY_FORMAT_VERSION, 4);
+    append_le(header, columns.size(), 4);
+    append_le(header, n, 8);
+    const double values[] = {
+        config.kp, config.ki, config.kd, config.TfTs,
+        config.umin, config.umax, config.u0, config.b
+    };
+    for (size_t k = 0; k < 8; ++k) {
+        append_le(header, double_bits(values[k]), 8);
+    }
+    append_le(header, 0, 8);
+
+    // Column directory
+    std::vector<size_t> offsets(columns.size());
+    size_t offset = align(HEADER_SIZE + ENTRY_SIZE * columns.size());
+    for (size_t c = 0; c < columns.size(); ++c) {
+        char name[NAME_SIZE] = {};
+        std::strncpy(name, columns[c].name, NAME_SIZE - 1);
+        header.insert(header.end(), name, name + NAME_SIZE);
+        append_le(header, columns[c].type, 4);
+        append_le(header, 0, 4);
+        append_le(header, offset, 8);
+        offsets[c] = offset;
+        offset = align(offset + column_bytes(columns[c].type, n));
+    }
+
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        throw std::runtime_error("Could not open file for writing: " + path);
+    }
+    std::fwrite(header.data(), 1, header.size(), file);
+    size_t position = header.size();
+    const char zeros[ALIGNMENT] = {};
+    for (size_t c = 0; c < columns.size(); ++c) {
+        std::fwrite(zeros, 1, offsets[c] - position, file);
+        write_column_data(file, columns[c], n);
+        position = offsets[c] + column_bytes(columns[c].type, n);
+    }
+    bool failed = std::ferror(file) != 0;
+    failed = std::fclose(file) != 0 || failed;
+    if (failed) {
+        throw std::runtime_error("Could not write file: " + path);
+    }
+}
+
+void convert_io_data(
+    const std::string& csv_path,
+    const std::string& path,
+    const TrajectoryConfig& config) {
+    IOData data = load_io_data(csv_path);
+    write_trajectory(path, config, data.inputs(),
+                     data.has_u ? data.u.data() : nullptr);
+}
+
+TrajectoryFile::TrajectoryFile(const std::string& path)
+    : file_(path), n_(0), inputs_(0, nullptr, nullptr), u_(nullptr) {
+    const char* data = file_.data();
+    size_t size = file_.size();
+    if (size < HEADER_SIZE || std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0) {
+        throw std::runtime_error("Not a trajectory file: " + path);
+    }
+    uint32_t version = static_cast<uint32_t>(read_le(data + 8, 4));
+    if (version != TRAJECTORY_FORMAT_VERSION) {
+        throw std::runtime_error(
+            "Unsupported trajectory format version "
+            + std::to_string(version) + ": " + path);
+    }
+    size_t num_columns = static_cast<size_t>(read_le(data + 12, 4));
+    n_ = static_cast<size_t>(read_le(data + 16, 8));
+    double* values[] = {
+        &config_.kp, &config_.ki, &config_.kd, &config_.TfTs,
+        &config_.umin, &config_.umax, &config_.u0, &config_.b
+    };
+    for (size_t k = 0; k < 8; ++k) {
+        *values[k] = read_double(data + 24 + 8 * k);
+    }
+    if (num_columns > (size - HEADER_SIZE) / ENTRY_SIZE || n_ > size * 8) {
+        throw std::runtime_error("Truncated trajectory file: " + path);
+    }
+
+    inputs_.n = n_;
+    for (size_t c = 0; c < num_columns; ++c) {
+        const char* entry = data + HEADER_SIZE + ENTRY_SIZE * c;
+        size_t length = 0;
+        while (length < NAME_SIZE && entry[length] != '\0') {
+            ++length;
+        }
+        std::string name(entry, length);
+        uint32_t type = static_cast<uint32_t>(read_le(entry + NAME_SIZE, 4));
+        size_t offset =
+            static_cast<size_t>(read_le(entry + NAME_SIZE + 8, 8));
+        size_t bytes = column_bytes(type, n_);
+        if (offset % ALIGNMENT != 0 || offset > size
+                || bytes > size - offset
+                || (n_ > 0 && bytes == 0)) {
+            throw std::runtime_error(
+                "Invalid column '" + name + "' in trajectory file: " + path);
+        }
+        const char* column = data + offset;
+
+        if (type == FLOAT64) {
+            const double* values = float64_column(offset);
+            float64_columns_.push_back(std::make_pair(name, values));
+            if (name == "r") {
+                inputs_.r = values;
+            } else if (name == "y") {
+                inputs_.y = values;
+            } else if (name == "uff") {
+                inputs_.uff = values;
+            } else if (name == "uman") {
+                inputs_.uman = values;
+            } else if (name == "utrack") {
+                inputs_.utrack = values;
+            } else if (name == "Tx") {
+                inputs_.Tx = values;
+            } else if (name == "u") {
+                u_ = values;
+            }
+        } else if (type == BITS && (name == "auto" || name == "track")) {
+            std::unique_ptr<bool[]>& flags =
+                name == "auto" ? auto_mode_ : track_;
+            flags.reset(new bool[n_]);
+            for (size_t i = 0; i < n_; ++i) {
+                flags[i] = (column[i / 8] >> (i % 8)) & 1;
+            }
+        } else if (type == WINDUP && name == "windup") {
+            windup_.resize(n_);
+            for (size_t i = 0; i < n_; ++i) {
+                windup_[i] = static_cast<WindupMode>(
+                    (column[i / 4] >> (2 * (i % 4))) & 3);
+            }
+            inputs_.windup = windup_.data();
+        }
+    }
+    inputs_.auto_mode = auto_mode_.get();
+    inputs_.track = track_.get();
+
+    if (!inputs_.r || !inputs_.y) {
+        throw std::runtime_error(
+            "Trajectory file without r or y column: " + path);
+    }
+}
+
+const double* TrajectoryFile::float64_column(size_t offset) {
+    const char* column = file_.data() + offset;
+    if (little_endian()) {
+        return reinterpret_cast<const double*>(column);
+    }
+    swapped_.push_back(std::vector<double>(n_));
+    std::vector<double>& values = swapped_.back();
+    for (size_t i = 0; i < n_; ++i) {
+        values[i] = read_double(column + 8 * i);
+    }
+    return values.data();
+}
+
+const double* TrajectoryFile::column(const std::string& name) const {
+    for (size_t c = 0; c < float64_columns_.size(); ++c) {
+        if (float64_columns_[c].first == name) {
+            return float64_columns_[c].second;
+        }
+    }
+    return nullptr;
+}
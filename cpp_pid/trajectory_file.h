@@ -0,0 +1,183 @@
+/**
+ * @file trajectory_file.h
+ * @brief Binary columnar file format for controller trajectories
+ *
+ * This file provides a reader and writer for trajectory files, a
+ * compact binary alternative to the I/O data CSV files that can be
+ * replayed without parsing. The format is also written by the Python
+ * implementation (python_pid/trajectory.py), so both implementations
+ * can share golden data.
+ *
+ * Format version 1, all values little-endian:
+ *
+ * | Offset | Size | Contents                                          |
+ * |--------|------|---------------------------------------------------|
+ * | 0      | 8    | Magic "PIDTRAJ" followed by a zero byte           |
+ * | 8      | 4    | uint32 format version (1)                         |
+ * | 12     | 4    | uint32 number of columns                          |
+ * | 16     | 8    | uint64 number of rows                             |
+ * | 24     | 64   | float64 kp, ki, kd, TfTs, umin, umax, u0, b       |
+ * | 88     | 8    | Reserved (zero)                                   |
+ * | 96     | 32 c | Column directory, one entry per column            |
+ *
+ * Each directory entry holds the column name (16 bytes, zero padded),
+ * a uint32 type, a reserved uint32 and the uint64 file offset of the
+ * column data, which is a multiple of 64. Column types are float64
+ * (n values), bits (1 bit per row, least significant bit first) and
+ * windup (2 bits per row holding the WindupMode value, row i in bits
+ * 2 (i % 4) of byte i / 4).
+ *
+ * Columns are r, y, uff, uman, utrack, Tx and u (float64), auto and
+ * track (bits) and windup (windup). Only r and y are required. Files
+ * may have further float64 columns, such as the controller internals
+ * of a trace; readers ignore unknown columns.
+ */
+
+#ifndef TRAJECTORY_FILE_H
+#define TRAJECTORY_FILE_H
+
+#include "file_view.h"
+#include "input_series.h"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Current trajectory file format version
+ */
+const uint32_t TRAJECTORY_FORMAT_VERSION = 1;
+
+/**
+ * @brief Controller configuration stored with a trajectory
+ */
+struct TrajectoryConfig {
+    double kp;
+    double ki;
+    double kd;
+    double TfTs;
+    double umin;
+    double umax;
+    double u0;
+    double b;
+
+    TrajectoryConfig()
+        : kp(0.0),
+          ki(0.0),
+          kd(0.0),
+          TfTs(10.0),
+          umin(-std::numeric_limits<double>::infinity()),
+          umax(std::numeric_limits<double>::infinity()),
+          u0(0.0),
+          b(1.0) {}
+};
+
+/**
+ * @brief Additional float64 column of a trajectory file
+ */
+struct TrajectoryColumn {
+    const char* name;    ///< Column name, at most 15 characters
+    const double* data;  ///< Values, one per row
+};
+
+/**
+ * @brief Write a trajectory file
+ *
+ * Columns that are nullptr in inputs (and u if nullptr) are omitted.
+ *
+ * @param path Path of the file to write
+ * @param config Controller configuration
+ * @param inputs Controller inputs
+ * @param u Control signal, or nullptr (default)
+ * @param extra Additional float64 columns (default: none)
+ * @throws std::runtime_error If the file cannot be written
+ * @throws std::invalid_argument If an extra column name is empty, too
+ *         long or already used
+ */
+void write_trajectory(
+    const std::string& path,
+    const TrajectoryConfig& config,
+    const InputSeries& inputs,
+    const double* u = nullptr,
+    const std::vector<TrajectoryColumn>& extra =
+        std::vector<TrajectoryColumn>());
+
+/**
+ * @brief Convert an I/O data CSV file to a trajectory file
+ *
+ * @param csv_path Path of the CSV file (see load_io_data)
+ * @param path Path of the trajectory file to write
+ * @param config Controller configuration to store
+ */
+void convert_io_data(
+    const std::string& csv_path,
+    const std::string& path,
+    const TrajectoryConfig& config);
+
+/**
+ * @brief Trajectory file opened for replay
+ *
+ * The file is memory mapped and the float64 columns are used in place,
+ * so inputs() feeds PIDController::run without copying them. The
+ * flag columns are unpacked into arrays owned by the reader.
+ */
+class TrajectoryFile {
+public:
+    /**
+     * @brief Open a trajectory file
+     *
+     * @param path Path of the file
+     * @throws std::runtime_error If the file cannot be read, has a
+     *         different format version or is malformed
+     */
+    explicit TrajectoryFile(const std::string& path);
+
+    /**
+     * @brief Number of rows
+     */
+    size_t size() const { return n_; }
+
+    /**
+     * @brief Controller configuration
+     */
+    const TrajectoryConfig& config() const { return config_; }
+
+    /**
+     * @brief Controller inputs, with absent columns as nullptr
+     */
+    const InputSeries& inputs() const { return inputs_; }
+
+    /**
+     * @brief Recorded control signal, or nullptr if absent
+     */
+    const double* u() const { return u_; }
+
+    /**
+     * @brief Any float64 column by name, or nullptr if absent
+     */
+    const double* column(const std::string& name) const;
+
+private:
+    // Pointer to a float64 column, copied if the host is big-endian
+    const double* float64_column(size_t offset);
+
+    FileView file_;
+    size_t n_;
+    TrajectoryConfig config_;
+    InputSeries inputs_;
+    const double* u_;
+
+    // Unpacked flag columns and byte-swapped columns
+    std::unique_ptr<bool[]> auto_mode_;
+    std::unique_ptr<bool[]> track_;
+    std::vector<WindupMode> windup_;
+    std::vector<std::vector<double> > swapped_;
+
+    // All float64 columns by name
+    std::vector<std::pair<std::string, const double*> > float64_columns_;
+};
+
+#endif // TRAJECTORY_FILE_H
@@ -0,0 +1,90 @@
+/**
+ * @file zoh_cache.cpp
+ * @brief Implementation of the ZOH filter parameter cache
+ */
+
+#include "zoh_cache.h"
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+size_t next_power_of_two(size_t n) {
+    size_t p = 4;
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+uint64_t bits(double x) {
+    uint64_t u;
+    std::memcpy(&u, &x, sizeof(u));
+    return u;
+}
+
+// Mix the bit patterns of the key (splitmix64 finalizer)
+uint64_t hash_key(double TfTs, double Tx) {
+    uint64_t h = bits(TfTs) * 0x9e3779b97f4a7c15ULL ^ bits(Tx);
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+} // namespace
+
+ZohCache::ZohCache(double tolerance, size_t capacity)
+    : tolerance_(tolerance),
+      entries_(next_power_of_two(capacity)),
+      set_mask_(entries_.size() / WAYS - 1),
+      victim_(entries_.size() / WAYS),
+      hits_(0),
+      misses_(0) {
+    clear();
+}
+
+double ZohCache::quantize(double Tx) const {
+    if (tolerance_ > 0.0) {
+        return std::round(Tx / tolerance_) * tolerance_;
+    }
+    return Tx;
+}
+
+FilterParams ZohCache::lookup(double TfTs, double Tx) {
+    double Txq = quantize(Tx);
+    size_t set = hash_key(TfTs, Txq) & set_mask_;
+    Entry* ways = &entries_[set * WAYS];
+
+    for (size_t w = 0; w < WAYS; ++w) {
+        if (ways[w].valid && ways[w].TfTs == TfTs && ways[w].Tx == Txq) {
+            ++hits_;
+            return ways[w].params;
+        }
+    }
+
+    ++misses_;
+    Entry& entry = ways[victim_[set]];
+    victim_[set] = static_cast<unsigned char>((victim_[set] + 1) % WAYS);
+    entry.TfTs = TfTs;
+    entry.Tx = Txq;
+    entry.params = zoh_Fy(TfTs, Txq);
+    entry.valid = true;
+    return entry.params;
+}
+
+void ZohCache::reset_counters() {
+    hits_ = 0;
+    misses_ = 0;
+}
+
+void ZohCache::clear() {
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        entries_[i].valid = false;
+    }
+    for (size_t i = 0; i < victim_.size(); ++i) {
+        victim_[i] = 0;
+    }
+}
@@ -0,0 +1,113 @@
+/**
+ * @file zoh_cache.h
+ * @brief Cache of ZOH discretized filter parameters
+ *
+ * This file provides a bounded cache of measurement filter parameters
+ * for loops whose execution period changes on every sample, so that
+ * rediscretization does not have to call zoh_Fy (and exp) each time.
+ */
+
+#ifndef ZOH_CACHE_H
+#define ZOH_CACHE_H
+
+#include "zoh_pid.h"
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Bounded cache of zoh_Fy results keyed on (TfTs, quantized Tx)
+ *
+ * With a quantization tolerance q > 0, execution periods are rounded
+ * to the nearest multiple of q and the filter is discretized for the
+ * rounded period, so the period used by the filter is off by at most
+ * q / 2. With q = 0 only exact repeats of Tx are cached and results
+ * are identical to calling zoh_Fy directly.
+ *
+ * The cache is 4-way set associative: each key maps to a set of four
+ * slots and a miss replaces the oldest slot in the set, so lookups
+ * never allocate. One cache can be shared by any number of filters
+ * (filters with the same TfTs share entries), but it is not thread
+ * safe.
+ */
+class ZohCache {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param tolerance Quantization step for Tx (default: 0.0, exact)
+     * @param capacity Maximum number of entries, rounded up to a power
+     *                 of two of at least 4 (default: 256)
+     */
+    explicit ZohCache(double tolerance = 0.0, size_t capacity = 256);
+
+    /**
+     * @brief Get the filter parameters for an execution period
+     *
+     * @param TfTs Filter time constant as a multiple of nominal sample
+     *             time
+     * @param Tx Execution period (normalized)
+     * @return FilterParams for TfTs and the quantized Tx
+     */
+    FilterParams lookup(double TfTs, double Tx);
+
+    /**
+     * @brief Quantize an execution period to the cache tolerance
+     *
+     * @param Tx Execution period (normalized)
+     * @return Tx rounded to the nearest multiple of the tolerance
+     */
+    double quantize(double Tx) const;
+
+    /**
+     * @brief Number of lookups served from the cache
+     */
+    size_t hits() const { return hits_; }
+
+    /**
+     * @brief Number of lookups that called zoh_Fy
+     */
+    size_t misses() const { return misses_; }
+
+    /**
+     * @brief Quantization step for Tx
+     */
+    double tolerance() const { return tolerance_; }
+
+    /**
+     * @brief Maximum number of entries
+     */
+    size_t capacity() const { return entries_.size(); }
+
+    /**
+     * @brief Reset the hit and miss counters to zero
+     */
+    void reset_counters();
+
+    /**
+     * @brief Remove all entries
+     */
+    void clear();
+
+private:
+    struct Entry {
+        double TfTs;
+        double Tx;
+        FilterParams params;
+        bool valid;
+    };
+
+    static const size_t WAYS = 4;
+
+    double tolerance_;
+    std::vector<Entry> entries_;
+    size_t set_mask_;
+
+    // Slot to replace next in each set
+    std::vector<unsigned char> victim_;
+
+    // Lookup counters
+    size_t hits_;
+    size_t misses_;
+};
+
+#endif // ZOH_CACHE_H
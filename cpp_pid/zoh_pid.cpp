@@ -4,22 +4,89 @@
  */
 
 #include "zoh_pid.h"
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+// Taylor series of exp(d) for |d| <= ZOH_INCREMENTAL_RANGE
+double exp_small(double d) {
+    return 1.0 + d * (1.0 + d * (1.0 / 2 + d * (1.0 / 6 + d * (1.0 / 24
+        + d * (1.0 / 120 + d * (1.0 / 720 + d * (1.0 / 5040
+        + d * (1.0 / 40320))))))));
+}
+
+} // namespace
 
 FilterParams zoh_Fy(double TfTs, double Tx) {
     // Help variables
     double h1 = Tx / TfTs;
     double h2 = exp(-h1);
-    double h3 = h1 * h2;
-    double h4 = h3 / TfTs;
-
-    // Filter parameters
-    FilterParams params;
-    params.a11 = h2 + h3;
-    params.a12 = h2;
-    params.a21 = -h4;
-    params.a22 = h2 - h3;
-    params.b1 = 1.0 - h2 - h3;
-    params.b2 = h4;
-
-    return params;
+    return zoh_params(TfTs, h1, h2);
+}
+
+FilterParams zoh_Fy(double TfTs, double Tx, ZohMethod method) {
+    if (method == ZohMethod::EXACT) {
+        return zoh_Fy(TfTs, Tx);
+    }
+    double h1 = Tx / TfTs;
+    return zoh_params(TfTs, h1, zoh_exp(-h1));
+}
+
+FilterParams zoh_Fy_incremental(
+    double TfTs, double Tx, double Tx_ref, double h2_ref) {
+    double h1 = Tx / TfTs;
+    double h2 = h2_ref * exp_small(-(Tx - Tx_ref) / TfTs);
+    return zoh_params(TfTs, h1, h2);
+}
+
+double zoh_exp(double x) {
+    // exp(x) overflows above this and is subnormal below its negation
+    const double max_x = 709.78;
+    const double min_x = -708.39;
+    if (!(x <= max_x)) {
+        // Also propagates NaN
+        return x > max_x ? std::numeric_limits<double>::infinity() : x;
+    }
+    if (x < min_x) {
+        return 0.0;
+    }
+
+    // Range reduction x = k ln(2) + r, with ln(2) split into a part
+    // with trailing zero bits and a correction (Cody-Waite)
+    const double inv_ln2 = 1.4426950408889634;
+    const double ln2_hi = 6.93147180369123816490e-01;
+    const double ln2_lo = 1.90821492927058770002e-10;
+    double k = std::floor(x * inv_ln2 + 0.5);
+    double r = (x - k * ln2_hi) - k * ln2_lo;
+
+    // Taylor polynomial of exp(r) for |r| <= ln(2)/2
+    double p = 1.0 / 6227020800.0;
+    p = p * r + 1.0 / 479001600.0;
+    p = p * r + 1.0 / 39916800.0;
+    p = p * r + 1.0 / 3628800.0;
+    p = p * r + 1.0 / 362880.0;
+    p = p * r + 1.0 / 40320.0;
+    p = p * r + 1.0 / 5040.0;
+    p = p * r + 1.0 / 720.0;
+    p = p * r + 1.0 / 120.0;
+    p = p * r + 1.0 / 24.0;
+    p = p * r + 1.0 / 6.0;
+    p = p * r + 0.5;
+    p = p * r + 1.0;
+    p = p * r + 1.0;
+
+    // Scale by 2^k through the exponent bits, in two steps so that
+    // both factors stay normal at the ends of the range
+    int64_t ki = static_cast<int64_t>(k);
+    int64_t k1 = ki / 2;
+    int64_t k2 = ki - k1;
+    uint64_t bits1 = static_cast<uint64_t>(k1 + 1023) << 52;
+    uint64_t bits2 = static_cast<uint64_t>(k2 + 1023) << 52;
+    double scale1;
+    double scale2;
+    std::memcpy(&scale1, &bits1, sizeof(scale1));
+    std::memcpy(&scale2, &bits2, sizeof(scale2));
+    return p * scale1 * scale2;
 }
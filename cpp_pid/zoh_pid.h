@@ -10,20 +10,93 @@
 #ifndef ZOH_PID_H
 #define ZOH_PID_H
 
+#include "host_device.h"
 #include <cmath>
 
 /**
  * @brief Filter parameters structure
+ *
+ * @tparam T Scalar type of the coefficients
+ */
+template <class T>
+struct BasicFilterParams {
+    T a11;
+    T a12;
+    T a21;
+    T a22;
+    T b1;
+    T b2;
+};
+
+/**
+ * @brief Filter parameters in double precision
+ */
+typedef BasicFilterParams<double> FilterParams;
+
+/**
+ * @brief Convert filter parameters to another scalar type
+ *
+ * Parameters are always computed in double precision and rounded to
+ * the target type afterwards, so the exponential is never evaluated
+ * in reduced precision.
+ *
+ * @tparam T Target scalar type, constructible from double
+ * @param params Filter parameters in double precision
+ * @return Filter parameters rounded to T
  */
-struct FilterParams {
-    double a11;
-    double a12;
-    double a21;
-    double a22;
-    double b1;
-    double b2;
+template <class T>
+inline BasicFilterParams<T> convert_filter_params(const FilterParams& params) {
+    BasicFilterParams<T> result = {
+        T(params.a11), T(params.a12), T(params.a21),
+        T(params.a22), T(params.b1), T(params.b2)
+    };
+    return result;
+}
+
+/**
+ * @brief Method used to evaluate the exponential in zoh_Fy
+ */
+enum class ZohMethod {
+    EXACT,        ///< std::exp from the C library (default)
+    POLYNOMIAL,   ///< zoh_exp polynomial approximation
+    INCREMENTAL   ///< Rescale exp(-Tx/TfTs) from a nearby period
 };
 
+/**
+ * @brief Largest |Tx - Tx_ref| / TfTs accepted by zoh_Fy_incremental
+ */
+const double ZOH_INCREMENTAL_RANGE = 1.0 / 16.0;
+
+/**
+ * @brief Filter parameters from h1 = Tx/TfTs and h2 = exp(-h1)
+ *
+ * The coefficients behind zoh_Fy and its variants, which differ only
+ * in how h2 is evaluated. Also compiles as device code, so the GPU
+ * sweep lanes rediscretize with the same operations as zoh_Fy.
+ *
+ * @param TfTs Filter time constant as a multiple of nominal sample time
+ * @param h1 Tx / TfTs
+ * @param h2 exp(-h1)
+ * @return FilterParams Structure containing six state-space matrix
+ *         coefficients
+ */
+PID_HOST_DEVICE inline FilterParams zoh_params(
+    double TfTs, double h1, double h2) {
+    double h3 = h1 * h2;
+    double h4 = h3 / TfTs;
+
+    // Filter parameters
+    FilterParams params;
+    params.a11 = h2 + h3;
+    params.a12 = h2;
+    params.a21 = -h4;
+    params.a22 = h2 - h3;
+    params.b1 = 1.0 - h2 - h3;
+    params.b2 = h4;
+
+    return params;
+}
+
 /**
  * @brief Compute filter parameters using zero-order hold discretization
  *
@@ -34,4 +107,123 @@ struct FilterParams {
  */
 FilterParams zoh_Fy(double TfTs, double Tx = 1.0);
 
+/**
+ * @brief Compute filter parameters with a selectable exp method
+ *
+ * INCREMENTAL needs a reference period (see zoh_Fy_incremental) and is
+ * evaluated as POLYNOMIAL here.
+ *
+ * @param TfTs Filter time constant as a multiple of nominal sample time
+ * @param Tx Execution period (normalized)
+ * @param method Method used to evaluate exp(-Tx/TfTs)
+ * @return FilterParams Structure containing six state-space matrix
+ *         coefficients
+ */
+FilterParams zoh_Fy(double TfTs, double Tx, ZohMethod method);
+
+/**
+ * @brief Compute filter parameters from a nearby reference period
+ *
+ * Uses exp(-Tx/TfTs) = h2_ref * exp(-(Tx - Tx_ref)/TfTs), where the
+ * second factor is a short series in the small period change, so no
+ * full exponential is evaluated. When |Tx - Tx_ref| / TfTs does not
+ * exceed ZOH_INCREMENTAL_RANGE, exp(-Tx/TfTs) has a relative error
+ * below 1e-15 and every coefficient an absolute error below 1e-15.
+ * Because h2_ref is kept fixed rather than chained from step to step,
+ * errors do not accumulate.
+ *
+ * @param TfTs Filter time constant as a multiple of nominal sample time
+ * @param Tx Execution period (normalized)
+ * @param Tx_ref Reference execution period
+ * @param h2_ref exp(-Tx_ref/TfTs), i.e. the a12 coefficient at Tx_ref
+ * @return FilterParams Structure containing six state-space matrix
+ *         coefficients
+ */
+FilterParams zoh_Fy_incremental(
+    double TfTs, double Tx, double Tx_ref, double h2_ref);
+
+/**
+ * @brief Polynomial approximation of exp(x)
+ *
+ * Reduces x to r = x - k ln(2) with |r| <= ln(2)/2 and evaluates a
+ * degree-13 Taylor polynomial of exp(r), scaled by 2^k. It uses only
+ * multiplications, additions and integer bit operations, so it runs
+ * in constant time on targets without a fast libm. The error is at
+ * most 2 units in the last place (relative error below 5e-16) for
+ * -708 <= x <= 709. Smaller x return 0 and larger x return infinity.
+ *
+ * @param x Exponent
+ * @return Approximation of exp(x)
+ */
+double zoh_exp(double x);
+
+/**
+ * @brief Taylor series 1 + x/n (1 + x/(n+1) (1 + ...)) up to degree 22
+ *
+ * Helper for zoh_exp_constexpr, accurate to double precision for
+ * |x| <= 1/2 when called with n = 1.
+ */
+constexpr double zoh_exp_taylor_constexpr(double x, int n = 1) {
+    return n > 22 ? 1.0 : 1.0 + x / n * zoh_exp_taylor_constexpr(x, n + 1);
+}
+
+/**
+ * @brief Square a value (helper for zoh_exp_constexpr)
+ */
+constexpr double zoh_square_constexpr(double x) {
+    return x * x;
+}
+
+/**
+ * @brief Compile-time exp(x)
+ *
+ * Halves x until |x| <= 1/2, evaluates a Taylor series and squares the
+ * result back. Within a few units in the last place of std::exp for
+ * |x| <= 1, with the relative error growing roughly in proportion to
+ * |x| beyond that. Intended for constant expressions; use std::exp or
+ * zoh_exp at runtime.
+ *
+ * @param x Exponent
+ * @return Approximation of exp(x)
+ */
+constexpr double zoh_exp_constexpr(double x) {
+    return (x > 0.5 || x < -0.5)
+        ? zoh_square_constexpr(zoh_exp_constexpr(x / 2))
+        : zoh_exp_taylor_constexpr(x);
+}
+
+/**
+ * @brief Filter parameters from h1 = Tx/TfTs and h2 = exp(-h1)
+ *
+ * Helper for zoh_Fy_constexpr, using the same operations as zoh_Fy.
+ */
+constexpr FilterParams zoh_params_constexpr(
+    double TfTs, double h1, double h2) {
+    return FilterParams{
+        h2 + h1 * h2,
+        h2,
+        -(h1 * h2 / TfTs),
+        h2 - h1 * h2,
+        1.0 - h2 - h1 * h2,
+        h1 * h2 / TfTs
+    };
+}
+
+/**
+ * @brief Compute filter parameters in a constant expression
+ *
+ * Same as zoh_Fy but usable at compile time, with exp evaluated by
+ * zoh_exp_constexpr. For Tx <= TfTs the coefficients agree with zoh_Fy
+ * to within a few units in the last place.
+ *
+ * @param TfTs Filter time constant as a multiple of nominal sample time
+ * @param Tx Execution period (normalized, default: 1.0)
+ * @return FilterParams Structure containing six state-space matrix
+ *         coefficients
+ */
+constexpr FilterParams zoh_Fy_constexpr(double TfTs, double Tx = 1.0) {
+    return zoh_params_constexpr(
+        TfTs, Tx / TfTs, zoh_exp_constexpr(-(Tx / TfTs)));
+}
+
 #endif // ZOH_PID_H
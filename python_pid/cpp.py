@@ -0,0 +1,49 @@
+"""C++ PID controller with numpy batch execution.
+
+This module provides the C++ implementation in cpp_pid/ to Python, for
+studies that are too slow with the pure-Python PIDController. It
+requires the _cpp_pid extension module built from cpp_bindings.cpp
+(see cpp_pid/README.md).
+
+Signal columns are numpy arrays. C-contiguous float64 columns, bool
+mode columns and int32 windup columns (WindupMode values 0 to 3) are
+read by the C++ code in place; other arrays and sequences are
+converted first. The GIL is released while the C++ code runs, so
+several threads can run controllers at once.
+
+Example:
+    >>> from python_pid import cpp
+    >>> controller = cpp.PIDController(kp=1.0, ki=0.5, kd=0.1)
+    >>> u = controller.run(r, y, Tx=Tx)          # One call per trajectory
+    >>> bank = cpp.PIDBank(20000, 0.5, 0.1, 0.0)
+    >>> u = bank.step(r, y, out=u)               # One call per tick
+    >>> results = cpp.sweep(r, y, kp=kps, ki=kis, kd=[0.0])
+"""
+
+try:
+    from ._cpp_pid import (
+        SATURATED_HIGH,
+        SATURATED_LOW,
+        PIDBank,
+        PIDBankKernel,
+        PIDController,
+        PIDStepResult,
+        WindupMode,
+        sweep,
+    )
+except ImportError as error:
+    raise ImportError(
+        "The C++ extension python_pid._cpp_pid is not built; "
+        "see cpp_pid/README.md"
+    ) from error
+
+__all__ = [
+    "PIDController",
+    "PIDStepResult",
+    "PIDBank",
+    "PIDBankKernel",
+    "WindupMode",
+    "SATURATED_HIGH",
+    "SATURATED_LOW",
+    "sweep",
+]
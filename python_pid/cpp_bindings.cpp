@@ -0,0 +1,462 @@
+/**
+ * @file cpp_bindings.cpp
+ * @brief Python bindings of the C++ PID controller (pybind11)
+ *
+ * Builds the python_pid._cpp_pid extension module, which exposes
+ * PIDController, its batch run, PIDBank and the parameter sweep to
+ * Python, with numpy arrays as signal columns. C-contiguous float64,
+ * bool and int32 arrays are passed to the C++ code without copies;
+ * other arrays and sequences are converted first. Output arrays are
+ * allocated once and filled in place, or passed in with out=. The GIL
+ * is released while the C++ code runs.
+ *
+ * See cpp_pid/README.md for the build command.
+ */
+
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include "../cpp_pid/pid.h"
+#include "../cpp_pid/pid_bank.h"
+#include "../cpp_pid/pid_sweep.h"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace py = pybind11;
+
+namespace {
+
+typedef py::array_t<double, py::array::c_style | py::array::forcecast>
+    DoubleArray;
+typedef py::array_t<bool, py::array::c_style | py::array::forcecast>
+    BoolArray;
+typedef py::array_t<int32_t, py::array::c_style | py::array::forcecast>
+    WindupArray;
+
+// Windup columns are int32 arrays of WindupMode values
+static_assert(sizeof(WindupMode) == sizeof(int32_t),
+              "WindupMode must have the size of int32");
+static_assert(sizeof(bool) == 1, "bool must be one byte like numpy bool");
+
+/**
+ * @brief One-dimensional array of n elements
+ *
+ * @throws std::invalid_argument If values cannot be converted or have
+ *         another shape
+ */
+template <class Array>
+Array column(const py::handle& values, size_t n, const char* name) {
+    Array array = Array::ensure(values);
+    if (!array) {
+        throw std::invalid_argument(
+            std::string(name) + " cannot be converted to an array");
+    }
+    if (array.ndim() != 1 || static_cast<size_t>(array.shape(0)) != n) {
+        throw std::invalid_argument(
+            std::string(name) + " must have " + std::to_string(n)
+            + " elements");
+    }
+    return array;
+}
+
+/**
+ * @brief Data of an optional column, nullptr for None
+ *
+ * @param holder Keeps the (possibly converted) array alive
+ */
+template <class Array>
+const typename Array::value_type* optional_column(
+    const py::object& values, size_t n, const char* name, Array& holder) {
+    if (values.is_none()) {
+        return nullptr;
+    }
+    holder = column<Array>(values, n, name);
+    return holder.data();
+}
+
+/**
+ * @brief Output column: a new array, or out if given
+ *
+ * out is written in place, so it must already be a C-contiguous,
+ * writable float64 array of n elements.
+ */
+py::array_t<double> output_column(const py::object& out, size_t n) {
+    if (out.is_none()) {
+        return py::array_t<double>(static_cast<py::ssize_t>(n));
+    }
+    if (!py::isinstance<py::array_t<double, py::array::c_style>>(out)) {
+        throw std::invalid_argument(
+            "out must be a C-contiguous float64 array");
+    }
+    py::array_t<double> array = out.cast<py::array_t<double>>();
+    if (array.ndim() != 1 || static_cast<size_t>(array.shape(0)) != n) {
+        throw std::invalid_argument(
+            "out must have " + std::to_string(n) + " elements");
+    }
+    return array;
+}
+
+/**
+ * @brief Input columns of a series in numpy arrays
+ *
+ * Holds the arrays for as long as the InputSeries pointing into them
+ * is used.
+ */
+struct SeriesColumns {
+    DoubleArray r, y, uff, uman, utrack, Tx;
+    BoolArray track, auto_mode;
+    WindupArray windup;
+
+    InputSeries series(
+        const py::object& r_values,
+        const py::object& y_values,
+        const py::object& uff_values,
+        const py::object& uman_values,
+        const py::object& utrack_values,
+        const py::object& Tx_values,
+        const py::object& track_values,
+        const py::object& auto_values,
+        const py::object& windup_values) {
+        r = DoubleArray::ensure(r_values);
+        if (!r || r.ndim() != 1) {
+            throw std::invalid_argument("r must be a one-dimensional array");
+        }
+        size_t n = static_cast<size_t>(r.shape(0));
+        y = column<DoubleArray>(y_values, n, "y");
+        InputSeries inputs(n, r.data(), y.data());
+        inputs.uff = optional_column(uff_values, n, "uff", uff);
+        inputs.uman = optional_column(uman_values, n, "uman", uman);
+        inputs.utrack = optional_column(utrack_values, n, "utrack", utrack);
+        inputs.Tx = optional_column(Tx_values, n, "Tx", Tx);
+        inputs.track = optional_column(track_values, n, "track", track);
+        inputs.auto_mode =
+            optional_column(auto_values, n, "auto", auto_mode);
+        inputs.windup = reinterpret_cast<const WindupMode*>(
+            optional_column(windup_values, n, "windup", windup));
+        return inputs;
+    }
+};
+
+/**
+ * @brief PIDBank with the default columns for omitted step() inputs
+ */
+class PyPIDBank {
+public:
+    PyPIDBank(size_t n, double kp, double ki, double kd, double TfTs,
+              double umin, double umax, double u0, double b)
+        : bank(n, kp, ki, kd, TfTs, umin, umax, u0, b),
+          zeros_(n, 0.0),
+          ones_(n, 1.0),
+          falses_(new bool[n]()),
+          trues_(new bool[n]),
+          none_(n, WindupMode::NONE) {
+        for (size_t i = 0; i < n; ++i) {
+            trues_[i] = true;
+        }
+    }
+
+    py::array_t<double> step(
+        const py::object& r_values,
+        const py::object& y_values,
+        const py::object& uff_values,
+        const py::object& uman_values,
+        const py::object& utrack_values,
+        const py::object& Tx_values,
+        const py::object& track_values,
+        const py::object& auto_values,
+        const py::object& windup_values,
+        const py::object& out) {
+        size_t n = bank.size();
+        DoubleArray r = column<DoubleArray>(r_values, n, "r");
+        DoubleArray y = column<DoubleArray>(y_values, n, "y");
+        DoubleArray uff, uman, utrack, Tx;
+        BoolArray track, auto_mode;
+        WindupArray windup;
+        const double* uff_data =
+            optional_column(uff_values, n, "uff", uff);
+        const double* uman_data =
+            optional_column(uman_values, n, "uman", uman);
+        const double* utrack_data =
+            optional_column(utrack_values, n, "utrack", utrack);
+        const double* Tx_data = optional_column(Tx_values, n, "Tx", Tx);
+        const bool* track_data =
+            optional_column(track_values, n, "track", track);
+        const bool* auto_data =
+            optional_column(auto_values, n, "auto", auto_mode);
+        const WindupMode* windup_data = reinterpret_cast<const WindupMode*>(
+            optional_column(windup_values, n, "windup", windup));
+        py::array_t<double> u = output_column(out, n);
+        double* u_data = u.mutable_data();
+
+        {
+            py::gil_scoped_release release;
+            bank.step(r.data(), y.data(),
+                      uff_data ? uff_data : zeros_.data(),
+                      uman_data ? uman_data : zeros_.data(),
+                      utrack_data ? utrack_data : zeros_.data(),
+                      Tx_data ? Tx_data : ones_.data(),
+                      track_data ? track_data : falses_.get(),
+                      auto_data ? auto_data : trues_.get(),
+                      windup_data ? windup_data : none_.data(),
+                      u_data);
+        }
+        return u;
+    }
+
+    PIDBank bank;
+
+private:
+    std::vector<double> zeros_;
+    std::vector<double> ones_;
+    std::unique_ptr<bool[]> falses_;
+    std::unique_ptr<bool[]> trues_;
+    std::vector<WindupMode> none_;
+};
+
+} // namespace
+
+PYBIND11_MODULE(_cpp_pid, m) {
+    m.doc() = "C++ PID controller with numpy batch execution";
+
+    py::enum_<WindupMode>(m, "WindupMode")
+        .value("NONE", WindupMode::NONE)
+        .value("UPPER", WindupMode::UPPER)
+        .value("LOWER", WindupMode::LOWER)
+        .value("BOTH", WindupMode::BOTH);
+    py::implicitly_convertible<py::int_, WindupMode>();
+
+    m.attr("SATURATED_HIGH") = static_cast<int>(SATURATED_HIGH);
+    m.attr("SATURATED_LOW") = static_cast<int>(SATURATED_LOW);
+
+    py::class_<PIDStepResult>(m, "PIDStepResult")
+        .def_readonly("u", &PIDStepResult::u)
+        .def_readonly("Dup", &PIDStepResult::Dup)
+        .def_readonly("Dui", &PIDStepResult::Dui)
+        .def_readonly("Dud", &PIDStepResult::Dud)
+        .def_readonly("Duff", &PIDStepResult::Duff)
+        .def_readonly("saturation", &PIDStepResult::saturation)
+        .def_property_readonly("windup", &PIDStepResult::windup);
+
+    py::class_<PIDController>(m, "PIDController")
+        .def(py::init<double, double, double, double, double, double,
+                      double, double>(),
+             py::arg("kp"), py::arg("ki"), py::arg("kd"),
+             py::arg("TfTs") = 10.0,
+             py::arg("umin") = -std::numeric_limits<double>::infinity(),
+             py::arg("umax") = std::numeric_limits<double>::infinity(),
+             py::arg("u0") = 0.0, py::arg("b") = 1.0)
+        .def("__call__", &PIDController::operator(),
+             py::arg("r"), py::arg("y"), py::arg("uff") = 0.0,
+             py::arg("uman") = 0.0, py::arg("utrack") = 0.0,
+             py::arg("Tx") = 1.0, py::arg("track") = false,
+             py::arg("auto") = true, py::arg("windup") = WindupMode::NONE,
+             "Compute the control signal of one step")
+        .def("step", &PIDController::step,
+             py::arg("r"), py::arg("y"), py::arg("uff") = 0.0,
+             py::arg("uman") = 0.0, py::arg("utrack") = 0.0,
+             py::arg("Tx") = 1.0, py::arg("track") = false,
+             py::arg("auto") = true, py::arg("windup") = WindupMode::NONE,
+             "Compute one step with increments and saturation flags")
+        .def("run",
+             [](PIDController& controller,
+                const py::object& r, const py::object& y,
+                const py::object& uff, const py::object& uman,
+                const py::object& utrack, const py::object& Tx,
+                const py::object& track, const py::object& auto_mode,
+                const py::object& windup, const py::object& out) {
+                 SeriesColumns columns;
+                 InputSeries inputs = columns.series(
+                     r, y, uff, uman, utrack, Tx, track, auto_mode, windup);
+                 py::array_t<double> u = output_column(out, inputs.n);
+                 double* u_data = u.mutable_data();
+                 {
+                     py::gil_scoped_release release;
+                     controller.run(inputs, u_data);
+                 }
+                 return u;
+             },
+             py::arg("r"), py::arg("y"), py::arg("uff") = py::none(),
+             py::arg("uman") = py::none(), py::arg("utrack") = py::none(),
+             py::arg("Tx") = py::none(), py::arg("track") = py::none(),
+             py::arg("auto") = py::none(), py::arg("windup") = py::none(),
+             py::arg("out") = py::none(),
+             "Run over input columns; omitted columns take the step "
+             "defaults. Returns the control signal array.")
+        .def("reset", &PIDController::reset)
+        .def("set_gains", &PIDController::set_gains,
+             py::arg("kp"), py::arg("ki"), py::arg("kd"))
+        .def("set_limits", &PIDController::set_limits,
+             py::arg("umin"), py::arg("umax"))
+        .def("set_TfTs", &PIDController::set_TfTs, py::arg("TfTs"))
+        .def_property("auto_windup", &PIDController::auto_windup,
+                      &PIDController::set_auto_windup)
+        .def_property_readonly("saturation", &PIDController::saturation)
+        .def_property_readonly("kp", [](const PIDController& c) {
+            return c.params().kp;
+        })
+        .def_property_readonly("ki", [](const PIDController& c) {
+            return c.params().ki;
+        })
+        .def_property_readonly("kd", [](const PIDController& c) {
+            return c.params().kd;
+        })
+        .def_property_readonly("umin", [](const PIDController& c) {
+            return c.params().umin;
+        })
+        .def_property_readonly("umax", [](const PIDController& c) {
+            return c.params().umax;
+        });
+
+    py::enum_<PIDBankKernel>(m, "PIDBankKernel")
+        .value("AUTO", PIDBankKernel::AUTO)
+        .value("SCALAR", PIDBankKernel::SCALAR)
+        .value("SIMD128", PIDBankKernel::SIMD128)
+        .value("AVX2", PIDBankKernel::AVX2)
+        .value("AVX512", PIDBankKernel::AVX512);
+
+    py::class_<PyPIDBank>(m, "PIDBank")
+        .def(py::init<size_t, double, double, double, double, double,
+                      double, double, double>(),
+             py::arg("n"), py::arg("kp"), py::arg("ki"), py::arg("kd"),
+             py::arg("TfTs") = 10.0,
+             py::arg("umin") = -std::numeric_limits<double>::infinity(),
+             py::arg("umax") = std::numeric_limits<double>::infinity(),
+             py::arg("u0") = 0.0, py::arg("b") = 1.0)
+        .def("configure",
+             [](PyPIDBank& self, size_t i, double kp, double ki, double kd,
+                double TfTs, double umin, double umax, double u0,
+                double b) {
+                 if (i >= self.bank.size()) {
+                     throw py::index_error("Controller index out of range");
+                 }
+                 self.bank.configure(i, kp, ki, kd, TfTs, umin, umax, u0, b);
+             },
+             py::arg("i"), py::arg("kp"), py::arg("ki"), py::arg("kd"),
+             py::arg("TfTs") = 10.0,
+             py::arg("umin") = -std::numeric_limits<double>::infinity(),
+             py::arg("umax") = std::numeric_limits<double>::infinity(),
+             py::arg("u0") = 0.0, py::arg("b") = 1.0)
+        .def("step", &PyPIDBank::step,
+             py::arg("r"), py::arg("y"), py::arg("uff") = py::none(),
+             py::arg("uman") = py::none(), py::arg("utrack") = py::none(),
+             py::arg("Tx") = py::none(), py::arg("track") = py::none(),
+             py::arg("auto") = py::none(), py::arg("windup") = py::none(),
+             py::arg("out") = py::none(),
+             "Step every controller once; each column holds one value "
+             "per controller. Returns the control signal array.")
+        .def("__len__", [](const PyPIDBank& self) {
+            return self.bank.size();
+        })
+        .def_property_readonly("saturation", [](const PyPIDBank& self) {
+            // A copy, so that it does not change with the next step
+            size_t n = self.bank.size();
+            py::array_t<uint8_t> flags(static_cast<py::ssize_t>(n));
+            const unsigned char* saturation = self.bank.saturation();
+            std::copy(saturation, saturation + n, flags.mutable_data());
+            return flags;
+        })
+        .def_property(
+            "auto_windup",
+            [](const PyPIDBank& self) { return self.bank.auto_windup(); },
+            [](PyPIDBank& self, bool enabled) {
+                self.bank.set_auto_windup(enabled);
+            })
+        .def_property(
+            "kernel",
+            [](const PyPIDBank& self) { return self.bank.kernel(); },
+            [](PyPIDBank& self, PIDBankKernel kernel) {
+                self.bank.set_kernel(kernel);
+            })
+        .def_static("kernel_supported", &PIDBank::kernel_supported,
+                    py::arg("kernel"));
+
+    m.def("sweep",
+          [](const py::object& r, const py::object& y,
+             const std::vector<double>& kp, const std::vector<double>& ki,
+             const std::vector<double>& kd, const std::vector<double>& TfTs,
+             double umin, double umax,
+             const py::object& uff, const py::object& uman,
+             const py::object& utrack, const py::object& Tx,
+             const py::object& track, const py::object& auto_mode,
+             const py::object& windup, const py::object& u_ref_values,
+             size_t threads, bool keep_u) {
+              SweepGrid grid;
+              grid.kp = kp;
+              grid.ki = ki;
+              grid.kd = kd;
+              grid.TfTs = TfTs;
+              grid.umin = umin;
+              grid.umax = umax;
+              SeriesColumns columns;
+              InputSeries inputs = columns.series(
+                  r, y, uff, uman, utrack, Tx, track, auto_mode, windup);
+              DoubleArray u_ref;
+              const double* u_ref_data = optional_column(
+                  u_ref_values, inputs.n, "u_ref", u_ref);
+
+              // Results go straight into the output arrays, by index
+              size_t count = grid.size();
+              py::ssize_t rows = static_cast<py::ssize_t>(count);
+              py::array_t<double> configs({rows, py::ssize_t(4)});
+              py::array_t<double> u_iae(rows), u_ise(rows), saturation(rows);
+              py::array_t<double> u;
+              if (keep_u) {
+                  u = py::array_t<double>(
+                      {rows, static_cast<py::ssize_t>(inputs.n)});
+              }
+              double* configs_data = configs.mutable_data();
+              double* u_iae_data = u_iae.mutable_data();
+              double* u_ise_data = u_ise.mutable_data();
+              double* saturation_data = saturation.mutable_data();
+              double* u_data = keep_u ? u.mutable_data() : nullptr;
+              size_t n = inputs.n;
+              {
+                  py::gil_scoped_release release;
+                  ThreadPool pool(threads);
+                  pid_sweep(grid, inputs, [&](const SweepResult& result) {
+                      size_t k = result.index;
+                      configs_data[4 * k] = result.config.kp;
+                      configs_data[4 * k + 1] = result.config.ki;
+                      configs_data[4 * k + 2] = result.config.kd;
+                      configs_data[4 * k + 3] = result.config.TfTs;
+                      u_iae_data[k] = result.metrics.u_iae;
+                      u_ise_data[k] = result.metrics.u_ise;
+                      saturation_data[k] = result.metrics.saturation_time;
+                      if (u_data) {
+                          std::copy(result.u, result.u + n, u_data + k * n);
+                      }
+                  }, pool, u_ref_data);
+              }
+
+              py::dict results;
+              results["config"] = configs;
+              results["u_iae"] = u_iae;
+              results["u_ise"] = u_ise;
+              results["saturation_time"] = saturation;
+              if (keep_u) {
+                  results["u"] = u;
+              }
+              return results;
+          },
+          py::arg("r"), py::arg("y"),
+          py::arg("kp"), py::arg("ki"), py::arg("kd"),
+          py::arg("TfTs") = std::vector<double>(1, 10.0),
+          py::arg("umin") = -std::numeric_limits<double>::infinity(),
+          py::arg("umax") = std::numeric_limits<double>::infinity(),
+          py::arg("uff") = py::none(), py::arg("uman") = py::none(),
+          py::arg("utrack") = py::none(), py::arg("Tx") = py::none(),
+          py::arg("track") = py::none(), py::arg("auto") = py::none(),
+          py::arg("windup") = py::none(), py::arg("u_ref") = py::none(),
+          py::arg("threads") = 0, py::arg("keep_u") = false,
+          "Run every configuration of the kp x ki x kd x TfTs grid over "
+          "the input columns on all cores. Returns a dict of arrays: "
+          "config (rows of kp, ki, kd, TfTs in grid order), u_iae, u_ise, "
+          "saturation_time and, with keep_u, u (one row per "
+          "configuration).");
+}
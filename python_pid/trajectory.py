@@ -0,0 +1,216 @@
+"""Binary columnar trajectory files.
+
+This module reads and writes trajectory files, the binary alternative
+to the I/O data CSV files. The format is defined in
+cpp_pid/trajectory_file.h and read by the C++ TrajectoryFile class, so
+both implementations can share golden data.
+
+Requires numpy.
+"""
+
+import math
+import struct
+
+import numpy as np
+
+from .anti_windup import WindupMode
+
+MAGIC = b"PIDTRAJ\0"
+FORMAT_VERSION = 1
+
+HEADER_SIZE = 96
+ENTRY_SIZE = 32
+ALIGNMENT = 64
+
+# Column types
+FLOAT64 = 1
+BITS = 2
+WINDUP = 3
+
+# Columns in the order they are written
+COLUMNS = (
+    ("r", FLOAT64),
+    ("y", FLOAT64),
+    ("uff", FLOAT64),
+    ("uman", FLOAT64),
+    ("utrack", FLOAT64),
+    ("Tx", FLOAT64),
+    ("u", FLOAT64),
+    ("auto", BITS),
+    ("track", BITS),
+    ("windup", WINDUP),
+)
+
+CONFIG_KEYS = ("kp", "ki", "kd", "TfTs", "umin", "umax", "u0", "b")
+CONFIG_DEFAULTS = {
+    "kp": 0.0,
+    "ki": 0.0,
+    "kd": 0.0,
+    "TfTs": 10.0,
+    "umin": -math.inf,
+    "umax": math.inf,
+    "u0": 0.0,
+    "b": 1.0,
+}
+
+WINDUP_CODES = {
+    WindupMode.NONE: 0,
+    WindupMode.UPPER: 1,
+    WindupMode.LOWER: 2,
+    WindupMode.BOTH: 3,
+}
+
+HEADER_FORMAT = "<8sIIQ8dQ"
+ENTRY_FORMAT = "<16sIIQ"
+
+
+def _align(offset):
+    return (offset + ALIGNMENT - 1) // ALIGNMENT * ALIGNMENT
+
+
+def _column_bytes(column_type, n):
+    if column_type == FLOAT64:
+        return 8 * n
+    if column_type == BITS:
+        return (n + 7) // 8
+    if column_type == WINDUP:
+        return (n + 3) // 4
+    return 0
+
+
+def _align_rows(n):
+    return (n + 3) // 4 * 4
+
+
+def _windup_codes(values):
+    """Convert windup values (WindupMode or 0-3) to integer codes."""
+    return np.array(
+        [WINDUP_CODES[v] if isinstance(v, WindupMode) else int(v) & 3
+         for v in values],
+        dtype=np.uint8,
+    )
+
+
+def _encode(column_type, values, n):
+    if column_type == FLOAT64:
+        return np.asarray(values, dtype="<f8").tobytes()
+    if column_type == BITS:
+        bits = np.asarray(values, dtype=bool)
+        return np.packbits(bits, bitorder="little").tobytes()
+    codes = np.zeros(_align_rows(n), dtype=np.uint8)
+    codes[:n] = _windup_codes(values)
+    codes = codes.reshape(-1, 4)
+    packed = (codes[:, 0] | (codes[:, 1] << 2) | (codes[:, 2] << 4)
+              | (codes[:, 3] << 6))
+    return packed.astype(np.uint8).tobytes()
+
+
+def write_trajectory(path, columns, config=None):
+    """Write a trajectory file.
+
+    Args:
+        path: Path of the file to write
+        columns: Dictionary of column name to sequence of values. r and
+                 y are required; uff, uman, utrack, Tx, u, auto, track
+                 and windup are optional and omitted when absent. Other
+                 names are written as float64 columns after these, as
+                 in the trace files of cpp_pid/trace_recorder.h.
+        config: Dictionary of controller parameters (kp, ki, kd, TfTs,
+                umin, umax, u0, b); missing keys use the PIDController
+                defaults
+    """
+    if "r" not in columns or "y" not in columns:
+        raise ValueError("Trajectory requires r and y columns")
+    n = len(columns["r"])
+    params = dict(CONFIG_DEFAULTS)
+    params.update(config or {})
+
+    present = [(name, column_type) for name, column_type in COLUMNS
+               if columns.get(name) is not None]
+    known = set(name for name, _ in COLUMNS)
+    for name in columns:
+        if name in known or columns[name] is None:
+            continue
+        if not 0 < len(name.encode("ascii")) < 16:
+            raise ValueError(f"Invalid trajectory column name: {name}")
+        present.append((name, FLOAT64))
+    for name, _ in present:
+        if len(columns[name]) != n:
+            raise ValueError(f"Column {name} has {len(columns[name])} "
+                             f"values, expected {n}")
+
+    header = struct.pack(
+        HEADER_FORMAT,
+        MAGIC,
+        FORMAT_VERSION,
+        len(present),
+        n,
+        *[float(params[key]) for key in CONFIG_KEYS],
+        0,
+    )
+
+    # Column directory and data offsets
+    offset = _align(HEADER_SIZE + ENTRY_SIZE * len(present))
+    directory = b""
+    offsets = []
+    for name, column_type in present:
+        directory += struct.pack(
+            ENTRY_FORMAT, name.encode("ascii"), column_type, 0, offset)
+        offsets.append(offset)
+        offset = _align(offset + _column_bytes(column_type, n))
+
+    with open(path, "wb") as f:
+        f.write(header)
+        f.write(directory)
+        position = len(header) + len(directory)
+        for (name, column_type), offset in zip(present, offsets):
+            f.write(b"\0" * (offset - position))
+            data = _encode(column_type, columns[name], n)
+            f.write(data)
+            position = offset + len(data)
+
+
+def read_trajectory(path):
+    """Read a trajectory file.
+
+    Args:
+        path: Path of the file
+
+    Returns:
+        tuple: (columns, config), where columns is a dictionary of
+               numpy arrays (float64 for signals, bool for auto and
+               track, uint8 codes 0-3 for windup) and config is a
+               dictionary of controller parameters
+    """
+    data = np.fromfile(path, dtype=np.uint8)
+    if len(data) < HEADER_SIZE:
+        raise ValueError(f"Not a trajectory file: {path}")
+    header = struct.unpack_from(HEADER_FORMAT, data, 0)
+    magic, version, num_columns, n = header[:4]
+    if magic != MAGIC:
+        raise ValueError(f"Not a trajectory file: {path}")
+    if version != FORMAT_VERSION:
+        raise ValueError(
+            f"Unsupported trajectory format version {version}: {path}")
+    config = dict(zip(CONFIG_KEYS, header[4:12]))
+
+    columns = {}
+    for c in range(num_columns):
+        name, column_type, _, offset = struct.unpack_from(
+            ENTRY_FORMAT, data, HEADER_SIZE + ENTRY_SIZE * c)
+        name = name.rstrip(b"\0").decode("ascii")
+        size = _column_bytes(column_type, n)
+        if offset + size > len(data):
+            raise ValueError(f"Invalid column {name} in trajectory file")
+        raw = data[offset:offset + size]
+        if column_type == FLOAT64:
+            columns[name] = np.frombuffer(raw.tobytes(), dtype="<f8")
+        elif column_type == BITS:
+            bits = np.unpackbits(raw, bitorder="little")[:n]
+            columns[name] = bits.astype(bool)
+        elif column_type == WINDUP:
+            shifts = np.array([0, 2, 4, 6], dtype=np.uint8)
+            codes = (raw[:, None] >> shifts) & 3
+            columns[name] = codes.reshape(-1)[:n].astype(np.uint8)
+
+    return columns, config
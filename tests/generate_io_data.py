@@ -20,6 +20,7 @@ import yaml
 sys.path.insert(0, str(Path(__file__).parent.parent))
 
 from python_pid import PIDController
+from python_pid.trajectory import write_trajectory
 
 
 def load_test_config(tests_dir, filename="test_cases.yaml"):
@@ -291,7 +292,29 @@ def generate_io_data_files(config, data_dir, length=10):
                     f"{u_values[i]}\n"
                 )
 
+        # Write the same data as a binary trajectory file
+        trajectory_file = io_data_file.with_suffix(".pidtraj")
+        write_trajectory(
+            trajectory_file,
+            {
+                "r": r_values,
+                "y": y_values,
+                "uff": uff_values,
+                "uman": uman_values,
+                "utrack": utrack_values,
+                "Tx": Tx_values,
+                "u": u_values,
+                "auto": auto_values,
+                "track": track_values,
+            },
+            config={
+                key: ctrl_config[key]
+                for key in ("kp", "ki", "kd", "umin", "umax")
+            },
+        )
+
         print(f"Generated: {io_data_file}")
+        print(f"Generated: {trajectory_file}")
         print(f"  Test: {test_name}")
         print(f"  Controller: {controller_name}")
         print(f"  Samples: {length}\n")
@@ -0,0 +1,40 @@
+#!/bin/bash
+# Setup script for Python tests: builds the C++ extension python_pid._cpp_pid
+
+set -e  # Exit on error
+
+cd "$(dirname "$0")/.."
+PYTHON="${PYTHON:-python3}"
+
+echo "Setting up Python PID Controller Tests"
+echo "======================================"
+echo ""
+
+# Check the build dependencies (python-requirements.txt)
+for module in pybind11 numpy; do
+    if ! "$PYTHON" -c "import $module" &> /dev/null; then
+        echo "Error: $module not found. Install python-requirements.txt:"
+        echo "  $PYTHON -m pip install -r python-requirements.txt"
+        exit 1
+    fi
+done
+echo "✓ pybind11 and numpy found"
+
+# Build the extension next to python_pid/cpp.py
+CXX="${CXX:-c++}"
+SUFFIX="$("$PYTHON" -c "import sysconfig; print(sysconfig.get_config_var('EXT_SUFFIX'))")"
+echo "Building python_pid/_cpp_pid$SUFFIX..."
+"$CXX" -O2 -std=c++11 -shared -fPIC -pthread \
+    $("$PYTHON" -m pybind11 --includes) \
+    python_pid/cpp_bindings.cpp cpp_pid/*.cpp \
+    -o "python_pid/_cpp_pid$SUFFIX"
+"$PYTHON" -c "from python_pid import cpp"
+echo "✓ Built and imported python_pid._cpp_pid"
+
+echo ""
+echo "Setup complete!"
+echo ""
+echo "Run tests:  $PYTHON -m pytest tests"
+echo ""
+echo "With pybind11 installed, the C++ extension tests fail instead of"
+echo "skipping when the extension is missing."
@@ -12,12 +12,48 @@
 #define CATCH_CONFIG_MAIN
 #include "catch.hpp"
 
+#include "../cpp_pid/async_runner.h"
+#include "../cpp_pid/basic_pid.h"
+#include "../cpp_pid/closed_loop.h"
+#include "../cpp_pid/control_graph.h"
+#include "../cpp_pid/controller_arena.h"
+#include "../cpp_pid/event_driven.h"
+#include "../cpp_pid/fixed_point.h"
+#include "../cpp_pid/fixed_rate_filter.h"
+#include "../cpp_pid/gain_schedule.h"
+#include "../cpp_pid/io_data.h"
+#include "../cpp_pid/partitioned_bank.h"
 #include "../cpp_pid/pid.h"
+#include "../cpp_pid/pid_bank.h"
+#include "../cpp_pid/pid_sweep.h"
+#include "../cpp_pid/pid_sweep_gpu.h"
+#include "../cpp_pid/plant_model.h"
+#include "../cpp_pid/rate_scheduler.h"
+#include "../cpp_pid/realtime_pid.h"
+#include "../cpp_pid/shared_bank.h"
+#include "../cpp_pid/spsc_ring.h"
+#include "../cpp_pid/state_checkpoint.h"
+#include "../cpp_pid/sweep_lane.h"
+#include "../cpp_pid/thread_pool.h"
+#include "../cpp_pid/trace_recorder.h"
+#include "../cpp_pid/trajectory_file.h"
+#include "../cpp_pid/zoh_cache.h"
 #include <fstream>
-#include <sstream>
+#include <iterator>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <random>
 #include <vector>
 #include <string>
+#include <thread>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <limits>
+#include <stdexcept>
 
 /**
  * @brief Structure to hold controller configuration
@@ -32,87 +68,47 @@ struct ControllerConfig {
 };
 
 /**
- * @brief Structure to hold I/O data for one time step
- */
-struct IODataRow {
-    double r;
-    double y;
-    double uff;
-    double uman;
-    double utrack;
-    double Tx;
-    bool auto_mode;
-    bool track;
-    double u;  // Expected output
-};
-
-/**
- * @brief Parse a boolean value from CSV string
- */
-bool parse_bool(const std::string& str) {
-    std::string lower = str;
-    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
-    return (lower == "true");
-}
-
-/**
- * @brief Load complete I/O data from CSV file
+ * @brief Run a controller with I/O data and check its outputs
  *
- * Expected CSV columns: r, y, uff, uman, utrack, Tx, auto, track, u
- *
- * @param filepath Path to CSV file
- * @return Vector of IODataRow structures
+ * @param controller PIDController or BasicPID instance
+ * @param io_data_file Path to I/O data CSV file
  */
-std::vector<IODataRow> load_io_data(const std::string& filepath) {
-    std::vector<IODataRow> data;
-    std::ifstream file(filepath);
-
-    if (!file.is_open()) {
-        throw std::runtime_error("Could not open file: " + filepath);
-    }
-
-    std::string line;
-    // Skip header
-    std::getline(file, line);
-
-    // Read data rows
-    while (std::getline(file, line)) {
-        std::istringstream ss(line);
-        std::string token;
-        IODataRow row;
-
-        // Parse CSV columns
-        std::getline(ss, token, ',');
-        row.r = std::stod(token);
+template <class Controller>
+void check_controller_with_io_data(
+    Controller& controller, const std::string& io_data_file) {
 
-        std::getline(ss, token, ',');
-        row.y = std::stod(token);
-
-        std::getline(ss, token, ',');
-        row.uff = std::stod(token);
-
-        std::getline(ss, token, ',');
-        row.uman = std::stod(token);
-
-        std::getline(ss, token, ',');
-        row.utrack = std::stod(token);
+    // Load I/O data
+    IOData data = load_io_data(io_data_file);
+    REQUIRE(data.n > 0);
+    REQUIRE(data.has_u);
 
-        std::getline(ss, token, ',');
-        row.Tx = std::stod(token);
+    // Run controller with inputs from CSV
+    for (size_t i = 0; i < data.n; ++i) {
+        double u = controller(
+            data.r[i],
+            data.y[i],
+            data.uff[i],
+            data.uman[i],
+            data.utrack[i],
+            data.Tx[i],
+            data.track[i],
+            data.auto_mode[i]
+        );
 
-        std::getline(ss, token, ',');
-        row.auto_mode = parse_bool(token);
+        // Verify output matches expected value
+        // Use relative and absolute tolerance matching Python tests
+        double abs_diff = std::abs(u - data.u[i]);
+        double rel_diff = std::abs(abs_diff / data.u[i]);
 
-        std::getline(ss, token, ',');
-        row.track = parse_bool(token);
+        INFO("Step " << i << ": expected=" << data.u[i]
+             << ", actual=" << u << ", diff=" << abs_diff);
 
-        std::getline(ss, token, ',');
-        row.u = std::stod(token);
+        // Check within tolerance (rtol=1e-10, atol=1e-12)
+        bool within_tolerance =
+            (abs_diff < 1e-12) || (rel_diff < 1e-10);
 
-        data.push_back(row);
+        REQUIRE(within_tolerance);
     }
-
-    return data;
 }
 
 /**
@@ -120,14 +116,14 @@ std::vector<IODataRow> load_io_data(const std::string& filepath) {
  *
  * @param config Controller configuration
  * @param io_data_file Path to I/O data CSV file
+ * @param cache Optional discretization cache for the filter
+ * @param method Filter rediscretization method
  */
 void test_pid_with_io_data(
     const ControllerConfig& config,
-    const std::string& io_data_file) {
-
-    // Load I/O data
-    std::vector<IODataRow> data = load_io_data(io_data_file);
-    REQUIRE(data.size() > 0);
+    const std::string& io_data_file,
+    ZohCache* cache = nullptr,
+    ZohMethod method = ZohMethod::EXACT) {
 
     // Create controller
     PIDController controller(
@@ -138,35 +134,27 @@ void test_pid_with_io_data(
         config.umin,
         config.umax
     );
+    controller.filter().set_cache(cache);
+    controller.filter().set_method(method);
 
-    // Run controller with inputs from CSV
-    for (size_t i = 0; i < data.size(); ++i) {
-        const IODataRow& row = data[i];
-
-        double u = controller(
-            row.r,
-            row.y,
-            row.uff,
-            row.uman,
-            row.utrack,
-            row.Tx,
-            row.track,
-            row.auto_mode
-        );
+    check_controller_with_io_data(controller, io_data_file);
 
-        // Verify output matches expected value
-        // Use relative and absolute tolerance matching Python tests
-        double abs_diff = std::abs(u - row.u);
-        double rel_diff = std::abs(abs_diff / row.u);
+    // Same data as one batch run
+    IOData data = load_io_data(io_data_file);
+    size_t n = data.n;
 
-        INFO("Step " << i << ": expected=" << row.u
-             << ", actual=" << u << ", diff=" << abs_diff);
-
-        // Check within tolerance (rtol=1e-10, atol=1e-12)
-        bool within_tolerance =
-            (abs_diff < 1e-12) || (rel_diff < 1e-10);
-
-        REQUIRE(within_tolerance);
+    PIDController batch(config.kp, config.ki, config.kd, 10.0,
+                        config.umin, config.umax);
+    batch.filter().set_cache(cache);
+    batch.filter().set_method(method);
+    std::vector<double> u(n);
+    batch.run(data.inputs(), u.data());
+    for (size_t i = 0; i < n; ++i) {
+        double abs_diff = std::abs(u[i] - data.u[i]);
+        double rel_diff = std::abs(abs_diff / data.u[i]);
+        INFO("Batch step " << i << ": expected=" << data.u[i]
+             << ", actual=" << u[i]);
+        REQUIRE(((abs_diff < 1e-12) || (rel_diff < 1e-10)));
     }
 }
 
@@ -225,6 +213,259 @@ TEST_CASE("PID with irregular time intervals (adaptive timing)",
                           "data/PID_step_irregular_time.csv");
 }
 
+TEST_CASE("PID with irregular time intervals and exact zoh cache",
+          "[PID_step_irregular_time][zoh_cache]") {
+    ControllerConfig config = {
+        "PID controller",
+        1.0,  // kp
+        0.5,  // ki
+        0.1,  // kd
+        -10.0,  // umin
+        10.0   // umax
+    };
+
+    // Without quantization the cache must not change any output
+    ZohCache cache;
+    test_pid_with_io_data(config,
+                          "data/PID_step_irregular_time.csv", &cache);
+    test_pid_with_io_data(config,
+                          "data/PID_step_irregular_time.csv", &cache);
+
+    // Each call runs the data per step and as a batch, and every run
+    // after the first reuses all of its periods
+    REQUIRE(cache.misses() == 10);
+    REQUIRE(cache.hits() == 30);
+}
+
+TEST_CASE("Quantized zoh cache", "[zoh_cache]") {
+    const double TfTs = 10.0;
+    const double tolerance = 1e-3;
+    ZohCache cache(tolerance);
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> jitter(-0.02, 0.02);
+
+    for (int k = 0; k < 1000; ++k) {
+        double Tx = 1.0 + jitter(rng);
+        FilterParams cached = cache.lookup(TfTs, Tx);
+        double Txq = cache.quantize(Tx);
+        FilterParams exact = zoh_Fy(TfTs, Txq);
+
+        REQUIRE(std::abs(Txq - Tx) <= 0.5 * tolerance + 1e-15);
+        REQUIRE(cached.a11 == exact.a11);
+        REQUIRE(cached.a12 == exact.a12);
+        REQUIRE(cached.a21 == exact.a21);
+        REQUIRE(cached.a22 == exact.a22);
+        REQUIRE(cached.b1 == exact.b1);
+        REQUIRE(cached.b2 == exact.b2);
+    }
+
+    // 41 distinct quantized periods fit in the cache, so almost every
+    // lookup is a hit
+    REQUIRE(cache.hits() + cache.misses() == 1000);
+    REQUIRE(cache.misses() < 100);
+}
+
+TEST_CASE("Approximate zoh methods on all I/O data",
+          "[zoh_method]") {
+    const ControllerConfig P = {"P-only controller",
+                                1.0, 0.0, 0.0, -10.0, 10.0};
+    const ControllerConfig PI = {"PI controller",
+                                 1.0, 0.5, 0.0, -10.0, 10.0};
+    const ControllerConfig PID = {"PID controller",
+                                  1.0, 0.5, 0.1, -10.0, 10.0};
+    const ControllerConfig PID_saturated = {"PID with tight saturation",
+                                            2.0, 1.0, 0.2, -3.0, 3.0};
+
+    const ZohMethod methods[] = {
+        ZohMethod::POLYNOMIAL,
+        ZohMethod::INCREMENTAL
+    };
+    for (size_t m = 0; m < 2; ++m) {
+        INFO("Method " << static_cast<int>(methods[m]));
+        test_pid_with_io_data(P, "data/P_step.csv", nullptr, methods[m]);
+        test_pid_with_io_data(PI, "data/PI_step.csv", nullptr, methods[m]);
+        test_pid_with_io_data(PID, "data/PID_step.csv", nullptr,
+                              methods[m]);
+        test_pid_with_io_data(PID, "data/PID_step_irregular_time.csv",
+                              nullptr, methods[m]);
+        test_pid_with_io_data(PID_saturated, "data/PID_antiwindup_step.csv",
+                              nullptr, methods[m]);
+        test_pid_with_io_data(PI, "data/PI_switch_manual.csv", nullptr,
+                              methods[m]);
+        test_pid_with_io_data(PI, "data/PI_switch_track.csv", nullptr,
+                              methods[m]);
+    }
+}
+
+TEST_CASE("Polynomial exp approximation", "[zoh_method]") {
+    for (int k = -7000; k <= 7000; ++k) {
+        double x = 0.1 * k + 1e-3 * (k % 7);
+        double expected = std::exp(x);
+        double actual = zoh_exp(x);
+
+        INFO("x=" << x << ", expected=" << expected
+             << ", actual=" << actual);
+        REQUIRE(std::abs(actual - expected) <= 1e-15 * expected);
+    }
+    REQUIRE(zoh_exp(0.0) == 1.0);
+    REQUIRE(zoh_exp(-1000.0) == 0.0);
+    REQUIRE(std::isinf(zoh_exp(1000.0)));
+}
+
+TEST_CASE("Incremental zoh rediscretization", "[zoh_method]") {
+    const double TfTs = 10.0;
+    const double Tx_ref = 1.0;
+    const double h2_ref = std::exp(-Tx_ref / TfTs);
+
+    for (int k = -100; k <= 100; ++k) {
+        double Tx = Tx_ref + k / 100.0 * ZOH_INCREMENTAL_RANGE * TfTs;
+        FilterParams expected = zoh_Fy(TfTs, Tx);
+        FilterParams actual = zoh_Fy_incremental(TfTs, Tx, Tx_ref, h2_ref);
+
+        INFO("Tx=" << Tx);
+        REQUIRE(std::abs(actual.a11 - expected.a11)
+                <= 1e-15 * std::abs(expected.a11));
+        REQUIRE(std::abs(actual.a12 - expected.a12)
+                <= 1e-15 * std::abs(expected.a12));
+        REQUIRE(std::abs(actual.a21 - expected.a21)
+                <= 1e-15 * std::abs(expected.a21));
+        REQUIRE(std::abs(actual.a22 - expected.a22)
+                <= 1e-15 * std::abs(expected.a22));
+        // b1 = 1 - h2 - h3 cancels for small Tx, so compare absolutely
+        REQUIRE(std::abs(actual.b1 - expected.b1) <= 1e-15);
+        REQUIRE(std::abs(actual.b2 - expected.b2)
+                <= 1e-15 * std::abs(expected.b2));
+    }
+}
+
+TEST_CASE("Batch run matches per-step calls", "[run]") {
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> signal(-2.0, 2.0);
+    std::uniform_int_distribution<int> mode(0, 19);
+    const double periods[] = {1.0, 0.5, 1.25};
+
+    // Runs of constant Tx with occasional manual and tracking steps
+    const size_t n = 2000;
+    std::vector<double> r(n), y(n), uff(n), uman(n), utrack(n), Tx(n);
+    std::unique_ptr<bool[]> auto_mode(new bool[n]);
+    std::unique_ptr<bool[]> track(new bool[n]);
+    std::vector<WindupMode> windup(n);
+    size_t period = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (mode(rng) == 0) {
+            period = (period + 1) % 3;
+        }
+        r[i] = signal(rng);
+        y[i] = signal(rng);
+        uff[i] = signal(rng);
+        uman[i] = signal(rng);
+        utrack[i] = signal(rng);
+        Tx[i] = periods[period];
+        auto_mode[i] = mode(rng) != 0;
+        track[i] = mode(rng) == 0;
+        windup[i] = static_cast<WindupMode>(mode(rng) % 4);
+    }
+
+    const double gains[][3] = {
+        {1.0, 0.5, 0.1},
+        {2.0, 0.0, 0.2},
+        {0.8, 0.3, 0.0}
+    };
+    for (size_t g = 0; g < 3; ++g) {
+        PIDController expected(gains[g][0], gains[g][1], gains[g][2],
+                               5.0, -1.5, 1.5, 0.1, 0.7);
+        PIDController batch(gains[g][0], gains[g][1], gains[g][2],
+                            5.0, -1.5, 1.5, 0.1, 0.7);
+
+        SECTION("All columns " + std::to_string(g)) {
+            InputSeries inputs(n, r.data(), y.data());
+            inputs.uff = uff.data();
+            inputs.uman = uman.data();
+            inputs.utrack = utrack.data();
+            inputs.Tx = Tx.data();
+            inputs.auto_mode = auto_mode.get();
+            inputs.track = track.get();
+            inputs.windup = windup.data();
+
+            std::vector<double> u(n);
+            batch.run(inputs, u.data());
+            for (size_t i = 0; i < n; ++i) {
+                INFO("Step " << i);
+                REQUIRE(u[i] == expected(r[i], y[i], uff[i], uman[i],
+                                         utrack[i], Tx[i], track[i],
+                                         auto_mode[i], windup[i]));
+            }
+        }
+
+        SECTION("Default columns " + std::to_string(g)) {
+            // Split into two calls to check the state carries over
+            InputSeries first(n / 2, r.data(), y.data());
+            InputSeries second(n - n / 2, r.data() + n / 2,
+                               y.data() + n / 2);
+            std::vector<double> u(n);
+            batch.run(first, u.data());
+            batch.run(second, u.data() + n / 2);
+            for (size_t i = 0; i < n; ++i) {
+                INFO("Step " << i);
+                REQUIRE(u[i] == expected(r[i], y[i]));
+            }
+        }
+    }
+}
+
+TEST_CASE("Compile-time zoh discretization", "[zoh_constexpr]") {
+    // Evaluated by the compiler
+    constexpr FilterParams fixed = zoh_Fy_constexpr(10.0, 1.0);
+    static_assert(fixed.a12 > 0.9 && fixed.a12 < 1.0,
+                  "zoh_Fy_constexpr must be a constant expression");
+
+    const double TfTs_values[] = {1.0, 2.5, 10.0, 100.0};
+    const double Tx_values[] = {0.1, 0.5, 1.0, 1.5};
+    for (size_t i = 0; i < 4; ++i) {
+        for (size_t j = 0; j < 4; ++j) {
+            double TfTs = TfTs_values[i];
+            double Tx = Tx_values[j];
+            FilterParams expected = zoh_Fy(TfTs, Tx);
+            FilterParams params = zoh_Fy_constexpr(TfTs, Tx);
+            INFO("TfTs=" << TfTs << ", Tx=" << Tx);
+            REQUIRE(std::abs(params.a11 - expected.a11) < 1e-15);
+            REQUIRE(std::abs(params.a12 - expected.a12) < 1e-15);
+            REQUIRE(std::abs(params.a21 - expected.a21) < 1e-15);
+            REQUIRE(std::abs(params.a22 - expected.a22) < 1e-15);
+            REQUIRE(std::abs(params.b1 - expected.b1) < 1e-15);
+            REQUIRE(std::abs(params.b2 - expected.b2) < 1e-15);
+        }
+    }
+}
+
+TEST_CASE("Fixed-rate measurement filter", "[zoh_constexpr]") {
+    std::mt19937 rng(6);
+    std::uniform_real_distribution<double> signal(-2.0, 2.0);
+
+    MeasurementFilter filter(10.0);
+    FixedRateMeasurementFilter<std::ratio<10> > fixed;
+    MeasurementFilter fast_filter(5.0);
+    FixedRateMeasurementFilter<std::ratio<5>, std::ratio<1, 2> > fast;
+
+    for (int k = 0; k < 200; ++k) {
+        double y = signal(rng);
+        FilterOutput expected = filter(y);
+        FilterOutput output = fixed(y);
+        FilterOutput fast_expected = fast_filter(y, 0.5);
+        FilterOutput fast_output = fast(y);
+        INFO("Step " << k);
+        REQUIRE(std::abs(output.yf - expected.yf) < 1e-13);
+        REQUIRE(std::abs(output.dyf - expected.dyf) < 1e-13);
+        REQUIRE(std::abs(fast_output.yf - fast_expected.yf) < 1e-13);
+        REQUIRE(std::abs(fast_output.dyf - fast_expected.dyf) < 1e-13);
+    }
+
+    fixed.reset();
+    filter.reset();
+    REQUIRE(fixed(1.0).yf == Approx(filter(1.0).yf));
+}
+
 TEST_CASE("PID with saturation (anti-windup)", "[PID_antiwindup_step]") {
     ControllerConfig config = {
         "PID with tight saturation",
@@ -264,3 +505,2991 @@ TEST_CASE("PI controller with tracking mode", "[PI_switch_track]") {
 
     test_pid_with_io_data(config, "data/PI_switch_track.csv");
 }
+
+TEST_CASE("Specialized controllers with I/O data", "[basic_pid]") {
+    const double inf = std::numeric_limits<double>::infinity();
+
+    SECTION("P") {
+        BasicPID<PIDStructure::P> controller(1.0, 0.0, 0.0, 10.0,
+                                             -10.0, 10.0);
+        check_controller_with_io_data(controller, "data/P_step.csv");
+    }
+
+    SECTION("PI") {
+        BasicPID<PIDStructure::PI> controller(1.0, 0.5, 0.0, 10.0,
+                                              -10.0, 10.0);
+        check_controller_with_io_data(controller, "data/PI_step.csv");
+    }
+
+    SECTION("PI without feedforward or limits") {
+        // These data sets have no feedforward and never saturate
+        const char* files[] = {
+            "data/PI_step.csv",
+            "data/PI_switch_manual.csv",
+            "data/PI_switch_track.csv"
+        };
+        for (size_t f = 0; f < 3; ++f) {
+            BasicPID<PIDStructure::PI, false, false> controller(
+                1.0, 0.5, 0.0, 10.0, -inf, inf);
+            check_controller_with_io_data(controller, files[f]);
+        }
+    }
+
+    SECTION("PID") {
+        const char* files[] = {
+            "data/PID_step.csv",
+            "data/PID_step_irregular_time.csv"
+        };
+        for (size_t f = 0; f < 2; ++f) {
+            BasicPID<PIDStructure::PID> controller(1.0, 0.5, 0.1, 10.0,
+                                                   -10.0, 10.0);
+            check_controller_with_io_data(controller, files[f]);
+        }
+        BasicPID<PIDStructure::PID> saturated(2.0, 1.0, 0.2, 10.0,
+                                              -3.0, 3.0);
+        check_controller_with_io_data(saturated,
+                                      "data/PID_antiwindup_step.csv");
+    }
+}
+
+TEST_CASE("Specialized controllers match PIDController",
+          "[basic_pid]") {
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<double> signal(-2.0, 2.0);
+    std::uniform_real_distribution<double> period(0.5, 1.5);
+    std::uniform_int_distribution<int> mode(0, 9);
+
+    PIDController pid(1.2, 0.4, 0.3, 5.0, -1.5, 1.5, 0.0, 0.5);
+    PIDController pd(1.2, 0.0, 0.3, 5.0, -1.5, 1.5, 0.2);
+    BasicPID<PIDStructure::PID> basic_pid(1.2, 0.4, 0.3, 5.0, -1.5, 1.5,
+                                          0.0, 0.5);
+    BasicPID<PIDStructure::PD> basic_pd(1.2, 0.0, 0.3, 5.0, -1.5, 1.5,
+                                        0.2);
+
+    for (int k = 0; k < 500; ++k) {
+        double r = signal(rng);
+        double y = signal(rng);
+        double uff = signal(rng);
+        double uman = signal(rng);
+        double utrack = signal(rng);
+        double Tx = period(rng);
+        bool track = mode(rng) == 0;
+        bool auto_mode = mode(rng) != 0;
+        WindupMode windup = static_cast<WindupMode>(mode(rng) % 4);
+
+        INFO("Step " << k);
+        REQUIRE(basic_pid(r, y, uff, uman, utrack, Tx, track, auto_mode,
+                          windup)
+                == pid(r, y, uff, uman, utrack, Tx, track, auto_mode,
+                       windup));
+        REQUIRE(basic_pd(r, y, uff, uman, utrack, Tx, track, auto_mode,
+                         windup)
+                == pd(r, y, uff, uman, utrack, Tx, track, auto_mode,
+                      windup));
+    }
+}
+
+/**
+ * @brief Largest control signal error of a reduced-precision controller
+ *
+ * @param controller Controller with scalar type T
+ * @param io_data_file Path to I/O data CSV file with the u column
+ * @return Largest absolute difference from the recorded u
+ */
+template <class T, class Controller>
+double max_error_with_io_data(Controller& controller,
+                              const std::string& io_data_file) {
+    IOData data = load_io_data(io_data_file);
+    REQUIRE(data.has_u);
+    double max_error = 0.0;
+    for (size_t i = 0; i < data.n; ++i) {
+        T u = controller(T(data.r[i]), T(data.y[i]), T(data.uff[i]),
+                         T(data.uman[i]), T(data.utrack[i]), data.Tx[i],
+                         data.track[i], data.auto_mode[i]);
+        max_error = std::max(max_error,
+                             std::abs(static_cast<double>(u) - data.u[i]));
+    }
+    return max_error;
+}
+
+TEST_CASE("Fixed-point arithmetic", "[precision]") {
+    REQUIRE(static_cast<double>(Q16_15(1.5)) == 1.5);
+    REQUIRE(Q16_15(1.0).raw() == 1 << 15);
+    REQUIRE(static_cast<double>(Q16_15(1.5) * Q16_15(-2.0)) == -3.0);
+    REQUIRE(static_cast<double>(Q16_15(3.0) / Q16_15(-4.0)) == -0.75);
+    REQUIRE(static_cast<double>(Q16_15(0.25) - Q16_15(1.0)) == -0.75);
+    REQUIRE(Q16_15(1.0) < Q16_15(1.5));
+    REQUIRE(Q16_15(-1.0) <= Q16_15(-1.0));
+
+    // Round to nearest
+    REQUIRE(Q16_15(1.4 / 32768).raw() == 1);
+    REQUIRE(Q16_15(-1.6 / 32768).raw() == -2);
+    REQUIRE((Q16_15::epsilon() * Q16_15(0.5)).raw() == 1);
+    REQUIRE((Q16_15::from_raw(4) / Q16_15(3.0)).raw() == 1);
+    REQUIRE((Q16_15::from_raw(5) / Q16_15(-3.0)).raw() == -2);
+
+    // Saturation instead of wrapping
+    const double inf = std::numeric_limits<double>::infinity();
+    REQUIRE(Q7_24(inf) == Q7_24::max());
+    REQUIRE(Q7_24(-inf) == Q7_24::min());
+    REQUIRE(Q7_24(1000.0) == Q7_24::max());
+    REQUIRE(Q7_24(std::nan("")).raw() == 0);
+    REQUIRE(Q7_24(100.0) + Q7_24(100.0) == Q7_24::max());
+    REQUIRE(Q7_24(-100.0) * Q7_24(100.0) == Q7_24::min());
+    REQUIRE(-Q7_24::min() == Q7_24::max());
+    REQUIRE(Q7_24(1.0) / Q7_24() == Q7_24::max());
+    REQUIRE(Q7_24(-1.0) / Q7_24() == Q7_24::min());
+}
+
+TEST_CASE("Reduced-precision controllers with I/O data", "[precision]") {
+    // Bounds about ten times the errors of the precision report
+    SECTION("float") {
+        BasicPID<PIDStructure::PI, true, true, float> pi(
+            1.0, 0.5, 0.0, 10.0, -10.0, 10.0);
+        REQUIRE(max_error_with_io_data<float>(pi, "data/PI_switch_track.csv")
+                < 2e-6);
+        BasicPID<PIDStructure::PID, true, true, float> pid(
+            1.0, 0.5, 0.1, 10.0, -10.0, 10.0);
+        REQUIRE(max_error_with_io_data<float>(
+                    pid, "data/PID_step_irregular_time.csv") < 2e-6);
+        BasicPID<PIDStructure::PID, true, true, float> saturated(
+            2.0, 1.0, 0.2, 10.0, -3.0, 3.0);
+        REQUIRE(max_error_with_io_data<float>(
+                    saturated, "data/PID_antiwindup_step.csv") < 2e-6);
+    }
+
+    SECTION("Q7_24") {
+        BasicPID<PIDStructure::PI, true, true, Q7_24> pi(
+            1.0, 0.5, 0.0, 10.0, -10.0, 10.0);
+        REQUIRE(max_error_with_io_data<Q7_24>(pi, "data/PI_switch_track.csv")
+                < 2e-5);
+        BasicPID<PIDStructure::PID, true, true, Q7_24> pid(
+            1.0, 0.5, 0.1, 10.0, -10.0, 10.0);
+        REQUIRE(max_error_with_io_data<Q7_24>(
+                    pid, "data/PID_step_irregular_time.csv") < 2e-5);
+        BasicPID<PIDStructure::PID, true, true, Q7_24> saturated(
+            2.0, 1.0, 0.2, 10.0, -3.0, 3.0);
+        REQUIRE(max_error_with_io_data<Q7_24>(
+                    saturated, "data/PID_antiwindup_step.csv") < 2e-5);
+    }
+
+    SECTION("Q16_15") {
+        BasicPID<PIDStructure::PI, true, true, Q16_15> pi(
+            1.0, 0.5, 0.0, 10.0, -10.0, 10.0);
+        REQUIRE(max_error_with_io_data<Q16_15>(
+                    pi, "data/PI_switch_track.csv") < 2e-3);
+        BasicPID<PIDStructure::PID, true, true, Q16_15> pid(
+            1.0, 0.5, 0.1, 10.0, -10.0, 10.0);
+        REQUIRE(max_error_with_io_data<Q16_15>(
+                    pid, "data/PID_step_irregular_time.csv") < 2e-3);
+        BasicPID<PIDStructure::PID, true, true, Q16_15> saturated(
+            2.0, 1.0, 0.2, 10.0, -3.0, 3.0);
+        REQUIRE(max_error_with_io_data<Q16_15>(
+                    saturated, "data/PID_antiwindup_step.csv") < 2e-3);
+    }
+
+    SECTION("Saturation flags") {
+        // Limits are exact in fixed point, so saturation is detected
+        BasicPID<PIDStructure::PI, false, true, Q16_15> controller(
+            1.0, 0.5, 0.0, 10.0, -1.0, 1.0);
+        BasicPIDStepResult<Q16_15> result =
+            controller.step(Q16_15(5.0), Q16_15());
+        REQUIRE(result.u == Q16_15(1.0));
+        REQUIRE(result.saturation == SATURATED_HIGH);
+        REQUIRE(result.windup() == WindupMode::UPPER);
+    }
+}
+
+/**
+ * @brief Check a PID bank against independent controllers
+ *
+ * Steps a bank with a mix of P, PI, PID and saturated configurations
+ * under random inputs, modes and execution periods, and requires the
+ * output of every controller to equal that of a separate
+ * PIDController.
+ *
+ * @param kernel Bank update kernel to use
+ * @param method Filter rediscretization method
+ * @param auto_windup Whether saturation is fed back automatically
+ * @param retune Whether to publish new gains, limits and filter time
+ *               constants halfway
+ */
+void test_pid_bank_against_controllers(
+    PIDBankKernel kernel, ZohMethod method = ZohMethod::EXACT,
+    bool auto_windup = false, bool retune = false) {
+    // One controller for each configuration in test_cases.yaml
+    const ControllerConfig configs[] = {
+        {"P-only controller", 1.0, 0.0, 0.0, -10.0, 10.0},
+        {"PI controller", 1.0, 0.5, 0.0, -10.0, 10.0},
+        {"PID controller", 1.0, 0.5, 0.1, -10.0, 10.0},
+        {"PID with tight saturation", 2.0, 1.0, 0.2, -3.0, 3.0}
+    };
+    const size_t n_configs = sizeof(configs) / sizeof(configs[0]);
+    const size_t n = 4 * n_configs + 3;
+    const size_t n_steps = 200;
+
+    PIDBank bank(n, 0.0, 0.0, 0.0);
+    bank.set_kernel(kernel);
+    bank.set_zoh_method(method);
+    bank.set_auto_windup(auto_windup);
+    std::vector<PIDController> controllers;
+    for (size_t i = 0; i < n; ++i) {
+        const ControllerConfig& config = configs[i % n_configs];
+        double TfTs = 5.0 + i;
+        bank.configure(i, config.kp, config.ki, config.kd, TfTs,
+                       config.umin, config.umax);
+        controllers.push_back(PIDController(
+            config.kp, config.ki, config.kd, TfTs,
+            config.umin, config.umax));
+        controllers.back().filter().set_method(method);
+        controllers.back().set_auto_windup(auto_windup);
+    }
+
+    std::mt19937 rng(42);
+    std::normal_distribution<double> noise(0.0, 1.0);
+    std::lognormal_distribution<double> period(0.0, 0.5);
+    std::uniform_int_distribution<int> choice(0, 9);
+
+    std::vector<double> r(n), y(n), uff(n), uman(n), utrack(n), Tx(n);
+    std::unique_ptr<bool[]> track(new bool[n]);
+    std::unique_ptr<bool[]> auto_mode(new bool[n]);
+    std::vector<WindupMode> windup(n);
+    std::vector<double> u(n);
+
+    for (size_t k = 0; k < n_steps; ++k) {
+        if (retune && k == n_steps / 2) {
+            // Every third controller keeps its parameters
+            PIDGainTable& gains = bank.edit_gains();
+            for (size_t i = 0; i < n; ++i) {
+                if (i % 3 == 0) {
+                    continue;
+                }
+                const ControllerConfig& config = configs[i % n_configs];
+                double kp = 1.5 * config.kp;
+                double ki = i % 3 == 1 ? 0.5 * config.ki : 0.2;
+                double kd = config.kd + 0.05;
+                double TfTs = i % 2 == 0 ? 5.0 + i : 3.0;
+                gains.set(i, kp, ki, kd, TfTs, config.umin + 1.0,
+                          config.umax - 1.0);
+                controllers[i].set_gains(kp, ki, kd);
+                controllers[i].set_limits(config.umin + 1.0,
+                                          config.umax - 1.0);
+                controllers[i].set_TfTs(TfTs);
+            }
+            bank.publish_gains();
+            REQUIRE(bank.gains_pending());
+            REQUIRE_THROWS_AS(bank.edit_gains(), std::runtime_error);
+        }
+
+        for (size_t i = 0; i < n; ++i) {
+            r[i] = (k < 2) ? 0.0 : 1.0;
+            y[i] = noise(rng);
+            uff[i] = 0.1 * noise(rng);
+            uman[i] = noise(rng);
+            utrack[i] = noise(rng);
+            // Mix of fixed and irregular execution periods
+            Tx[i] = (i % 2 == 0) ? 1.0 : period(rng);
+            track[i] = (choice(rng) == 0);
+            auto_mode[i] = (choice(rng) != 0);
+            windup[i] = static_cast<WindupMode>(choice(rng) % 4);
+        }
+
+        bank.step(r.data(), y.data(), uff.data(), uman.data(),
+                  utrack.data(), Tx.data(), track.get(), auto_mode.get(),
+                  windup.data(), u.data());
+
+        for (size_t i = 0; i < n; ++i) {
+            double expected = controllers[i](
+                r[i], y[i], uff[i], uman[i], utrack[i], Tx[i],
+                track[i], auto_mode[i], windup[i]);
+
+            INFO("Step " << k << ", controller " << i
+                 << ": expected=" << expected << ", actual=" << u[i]);
+            REQUIRE(u[i] == expected);
+            REQUIRE(bank.saturation()[i] == controllers[i].saturation());
+        }
+    }
+}
+
+TEST_CASE("PID bank matches independent controllers", "[PID_bank]") {
+    const PIDBankKernel kernels[] = {
+        PIDBankKernel::SCALAR,
+        PIDBankKernel::SIMD128,
+        PIDBankKernel::AVX2,
+        PIDBankKernel::AVX512
+    };
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); ++k) {
+        if (PIDBank::kernel_supported(kernels[k])) {
+            INFO("Kernel " << static_cast<int>(kernels[k]));
+            test_pid_bank_against_controllers(kernels[k]);
+        }
+    }
+}
+
+TEST_CASE("PID bank with automatic windup", "[PID_bank][windup]") {
+    const PIDBankKernel kernels[] = {
+        PIDBankKernel::SCALAR,
+        PIDBankKernel::SIMD128,
+        PIDBankKernel::AVX2,
+        PIDBankKernel::AVX512
+    };
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); ++k) {
+        if (PIDBank::kernel_supported(kernels[k])) {
+            INFO("Kernel " << static_cast<int>(kernels[k]));
+            test_pid_bank_against_controllers(
+                kernels[k], ZohMethod::EXACT, true);
+        }
+    }
+}
+
+TEST_CASE("PID bank with incremental rediscretization",
+          "[PID_bank][zoh_method]") {
+    test_pid_bank_against_controllers(
+        PIDBankKernel::SCALAR, ZohMethod::INCREMENTAL);
+}
+
+TEST_CASE("PID bank gain tables", "[PID_bank][retune]") {
+    const PIDBankKernel kernels[] = {
+        PIDBankKernel::SCALAR,
+        PIDBankKernel::SIMD128,
+        PIDBankKernel::AVX2,
+        PIDBankKernel::AVX512
+    };
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); ++k) {
+        if (PIDBank::kernel_supported(kernels[k])) {
+            INFO("Kernel " << static_cast<int>(kernels[k]));
+            test_pid_bank_against_controllers(
+                kernels[k], ZohMethod::EXACT, false, true);
+        }
+    }
+    test_pid_bank_against_controllers(
+        PIDBankKernel::SCALAR, ZohMethod::INCREMENTAL, true, true);
+
+    SECTION("Tables published from another thread swap between steps") {
+        // Saturated P controllers output umax, the table version
+        const size_t n = 64;
+        PIDBank bank(n, 1000.0, 0.0, 0.0, 10.0, 0.0, 0.0);
+        std::atomic<bool> stop(false);
+        std::thread tuner([&]() {
+            for (double version = 1.0; !stop.load(); ) {
+                if (bank.gains_pending()) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                PIDGainTable& gains = bank.edit_gains();
+                for (size_t i = 0; i < n; ++i) {
+                    gains.umax()[i] = version;
+                }
+                bank.publish_gains();
+                version += 1.0;
+            }
+        });
+
+        std::vector<double> r(n, 1e6), zeros(n, 0.0), Tx(n, 1.0), u(n);
+        std::unique_ptr<bool[]> track(new bool[n]);
+        std::unique_ptr<bool[]> auto_mode(new bool[n]);
+        std::vector<WindupMode> windup(n, WindupMode::NONE);
+        for (size_t i = 0; i < n; ++i) {
+            track[i] = false;
+            auto_mode[i] = true;
+        }
+        double last = 0.0;
+        bool consistent = true;
+        for (int k = 0; k < 20000; ++k) {
+            bank.step(r.data(), zeros.data(), zeros.data(), zeros.data(),
+                      zeros.data(), Tx.data(), track.get(),
+                      auto_mode.get(), windup.data(), u.data());
+            for (size_t i = 1; i < n; ++i) {
+                consistent = consistent && u[i] == u[0];
+            }
+            consistent = consistent && u[0] >= last;
+            last = u[0];
+        }
+        stop.store(true);
+        tuner.join();
+        REQUIRE(consistent);
+        REQUIRE(last > 0.0);
+    }
+}
+
+TEST_CASE("Thread pool runs every index once", "[thread_pool]") {
+    ThreadPool pool(4);
+    REQUIRE(pool.size() == 4);
+
+    for (int repeat = 0; repeat < 3; ++repeat) {
+        const size_t n = 1000;
+        std::vector<std::atomic<int> > counts(n);
+        for (size_t i = 0; i < n; ++i) {
+            counts[i].store(0);
+        }
+        std::atomic<bool> worker_ok(true);
+        pool.parallel_for(n, [&](size_t i, size_t worker) {
+            counts[i].fetch_add(1);
+            if (worker >= pool.size()) {
+                worker_ok.store(false);
+            }
+        });
+        REQUIRE(worker_ok.load());
+        for (size_t i = 0; i < n; ++i) {
+            REQUIRE(counts[i].load() == 1);
+        }
+    }
+
+    // Exceptions stop the loop and are rethrown
+    REQUIRE_THROWS_AS(
+        pool.parallel_for(100, [](size_t i, size_t) {
+            if (i == 10) {
+                throw std::runtime_error("failed");
+            }
+        }),
+        std::runtime_error);
+
+    // The pool is still usable afterwards
+    std::atomic<size_t> total(0);
+    pool.parallel_for(10, [&](size_t i, size_t) { total += i; });
+    REQUIRE(total.load() == 45);
+}
+
+TEST_CASE("Parameter sweep matches serial runs", "[sweep]") {
+    IOData data = load_io_data("data/PID_step.csv");
+    size_t n = data.n;
+    const std::vector<double>& r = data.r;
+    const std::vector<double>& y = data.y;
+    const std::vector<double>& u_ref = data.u;
+    InputSeries inputs(n, r.data(), y.data());
+
+    SweepGrid grid;
+    grid.kp = {0.5, 1.0, 2.0};
+    grid.ki = {0.0, 0.5};
+    grid.kd = {0.0, 0.1};
+    grid.TfTs = {5.0, 10.0};
+    grid.umin = -10.0;
+    grid.umax = 10.0;
+    REQUIRE(grid.size() == 24);
+
+    std::map<size_t, SweepResult> results;
+    std::map<size_t, std::vector<double> > outputs;
+    ThreadPool pool(3);
+    pid_sweep(grid, inputs, [&](const SweepResult& result) {
+        results[result.index] = result;
+        outputs[result.index].assign(result.u, result.u + n);
+    }, pool, u_ref.data());
+    REQUIRE(results.size() == grid.size());
+
+    for (size_t k = 0; k < grid.size(); ++k) {
+        SweepConfig config = sweep_config(grid, k);
+        PIDController controller(config.kp, config.ki, config.kd,
+                                 config.TfTs, grid.umin, grid.umax);
+        double iae = 0.0;
+        INFO("Configuration " << k);
+        for (size_t i = 0; i < n; ++i) {
+            double u = controller(r[i], y[i]);
+            REQUIRE(outputs[k][i] == u);
+            iae += std::abs(u - u_ref[i]);
+        }
+        REQUIRE(results[k].metrics.u_iae == Approx(iae));
+    }
+
+    // The configuration that generated the data reproduces it
+    size_t match = ((1 * 2 + 1) * 2 + 1) * 2 + 1;
+    SweepConfig config = sweep_config(grid, match);
+    REQUIRE(config.kp == 1.0);
+    REQUIRE(config.ki == 0.5);
+    REQUIRE(config.kd == 0.1);
+    REQUIRE(config.TfTs == 10.0);
+    REQUIRE(results[match].metrics.u_iae < 1e-9);
+    REQUIRE(results[match].metrics.saturation_time == 0.0);
+
+    // Bias and setpoint weight reach every controller
+    grid.u0 = 0.4;
+    grid.b = 0.6;
+    pid_sweep(grid, inputs, [&](const SweepResult& result) {
+        SweepConfig config = result.config;
+        PIDController controller(config.kp, config.ki, config.kd,
+                                 config.TfTs, grid.umin, grid.umax,
+                                 grid.u0, grid.b);
+        for (size_t i = 0; i < n; ++i) {
+            REQUIRE(result.u[i] == controller(r[i], y[i]));
+        }
+    }, pool);
+}
+
+TEST_CASE("GPU sweep lanes match PIDController", "[sweep][gpu]") {
+    struct Case {
+        const char* file;
+        double kp, ki, kd, umin, umax;
+    };
+    const Case cases[] = {
+        {"data/P_step.csv", 1.0, 0.0, 0.0, -10.0, 10.0},
+        {"data/PI_switch_manual.csv", 1.0, 0.5, 0.0, -10.0, 10.0},
+        {"data/PI_switch_track.csv", 1.0, 0.5, 0.0, -10.0, 10.0},
+        {"data/PID_step_irregular_time.csv", 1.0, 0.5, 0.1, -10.0, 10.0},
+        {"data/PID_antiwindup_step.csv", 2.0, 1.0, 0.2, -3.0, 3.0}
+    };
+
+    // The lane update run on the host, with the test data tolerances
+    for (size_t c = 0; c < 5; ++c) {
+        IOData data = load_io_data(cases[c].file);
+        SweepLane lane;
+        sweep_lane_init(lane, cases[c].kp, cases[c].ki, cases[c].kd, 10.0,
+                        cases[c].umin, cases[c].umax);
+        for (size_t i = 0; i < data.n; ++i) {
+            bool saturated;
+            double u = sweep_lane_step(
+                lane, data.r[i], data.y[i], data.uff[i], data.uman[i],
+                data.utrack[i], data.Tx[i], data.track[i],
+                data.auto_mode[i], WindupMode::NONE, saturated);
+            double abs_diff = std::abs(u - data.u[i]);
+            INFO(cases[c].file << " step " << i << ": expected="
+                 << data.u[i] << ", actual=" << u);
+            REQUIRE((abs_diff < 1e-12
+                     || std::abs(abs_diff / data.u[i]) < 1e-10));
+            REQUIRE(saturated == (u <= cases[c].umin
+                                  || u >= cases[c].umax));
+        }
+    }
+
+    // Windup inputs, bias, setpoint weight and varying Tx against the
+    // CPU controller, which runs the same pid_step
+    const double lane_ki[] = {0.5, 0.0};
+    for (size_t c = 0; c < 2; ++c) {
+        PIDController controller(1.0, lane_ki[c], 0.1, 10.0, -1.0, 1.0,
+                                 0.3, 0.7);
+        SweepLane lane;
+        sweep_lane_init(lane, 1.0, lane_ki[c], 0.1, 10.0, -1.0, 1.0, 0.3,
+                        0.7);
+        std::mt19937 rng(11);
+        std::uniform_real_distribution<double> signal(-3.0, 3.0);
+        for (int k = 0; k < 1000; ++k) {
+            double r = signal(rng);
+            double y = signal(rng);
+            double Tx = k % 7 == 0 ? 0.5 : 1.0;
+            WindupMode windup = static_cast<WindupMode>(k % 4);
+            bool saturated;
+            double u = sweep_lane_step(lane, r, y, 0.0, 0.0, 0.0, Tx,
+                                       false, true, windup, saturated);
+            PIDStepResult expected_step = controller.step(
+                r, y, 0.0, 0.0, 0.0, Tx, false, true, windup);
+            INFO("ki " << lane_ki[c] << ", step " << k);
+            REQUIRE(u == expected_step.u);
+            REQUIRE(saturated == (expected_step.saturation != 0));
+        }
+    }
+
+    // The GPU sweep matches pid_sweep where a device is present
+    IOData data = load_io_data("data/PID_step.csv");
+    InputSeries inputs = data.inputs();
+    SweepGrid grid;
+    grid.kp = {0.5, 1.0};
+    grid.ki = {0.0, 0.5};
+    grid.kd = {0.1};
+    grid.umin = -10.0;
+    grid.umax = 10.0;
+    grid.u0 = 0.2;
+    grid.b = 0.8;
+    if (!pid_sweep_gpu_available()) {
+        REQUIRE_THROWS_AS(
+            pid_sweep_gpu(grid, inputs, [](const SweepResult&) {}),
+            std::runtime_error);
+        return;
+    }
+    std::map<size_t, SweepMetrics> expected;
+    ThreadPool pool(2);
+    pid_sweep(grid, inputs, [&](const SweepResult& result) {
+        expected[result.index] = result.metrics;
+    }, pool, data.u.data());
+    GpuSweepOptions options;
+    options.batch_size = 3;
+    options.keep_outputs = true;
+    size_t calls = 0;
+    pid_sweep_gpu(grid, inputs, [&](const SweepResult& result) {
+        REQUIRE(result.index == calls++);
+        REQUIRE(result.u != nullptr);
+        REQUIRE(result.metrics.u_iae
+                == Approx(expected[result.index].u_iae).epsilon(1e-10));
+        REQUIRE(result.metrics.saturation_time
+                == expected[result.index].saturation_time);
+    }, data.u.data(), options);
+    REQUIRE(calls == grid.size());
+}
+
+TEST_CASE("Plant models step responses", "[plant]") {
+    SECTION("FOPDT") {
+        PlantModel plant = PlantModel::fopdt(2.0, 5.0, 3.0, 0.5);
+        REQUIRE(plant.delay_steps() == 6);
+        for (int k = 1; k <= 40; ++k) {
+            double y = plant(1.0);
+            double t = k * 0.5 - 3.0;
+            double expected = t > 0.0 ? 2.0 * (1.0 - std::exp(-t / 5.0))
+                                      : 0.0;
+            INFO("Step " << k);
+            REQUIRE(std::abs(y - expected) < 1e-12);
+        }
+    }
+
+    SECTION("SOPDT") {
+        const double Ks = 1.5, T1 = 4.0, T2 = 2.0;
+        PlantModel plant = PlantModel::sopdt(Ks, T1, T2, 1.0);
+        PlantModel repeated = PlantModel::sopdt(Ks, 3.0, 3.0, 0.0);
+        for (int k = 1; k <= 40; ++k) {
+            double y = plant(1.0);
+            double t = k - 1.0;
+            double expected = t > 0.0
+                ? Ks * (1.0 - (T1 * std::exp(-t / T1)
+                               - T2 * std::exp(-t / T2)) / (T1 - T2))
+                : 0.0;
+            double y_rep = repeated(1.0);
+            double expected_rep =
+                Ks * (1.0 - (1.0 + k / 3.0) * std::exp(-k / 3.0));
+            INFO("Step " << k);
+            REQUIRE(std::abs(y - expected) < 1e-12);
+            REQUIRE(std::abs(y_rep - expected_rep) < 1e-12);
+        }
+    }
+
+    SECTION("Integrating") {
+        PlantModel plant = PlantModel::integrating(0.5, 2.0);
+        for (int k = 1; k <= 10; ++k) {
+            REQUIRE(plant(1.0) == Approx(0.5 * std::max(k - 2, 0)));
+        }
+    }
+
+    SECTION("Reset to steady state") {
+        PlantModel plant = PlantModel::fopdt(2.0, 5.0, 3.0);
+        plant.reset(1.5);
+        REQUIRE(plant.output() == 3.0);
+        for (int k = 0; k < 10; ++k) {
+            REQUIRE(plant(1.5) == Approx(3.0));
+        }
+    }
+}
+
+TEST_CASE("Closed-loop Monte Carlo", "[plant][monte_carlo]") {
+    PIDController controller(1.5, 0.15, 1.0, 2.0, -5.0, 5.0);
+    PlantModel plant = PlantModel::fopdt(1.0, 10.0, 2.0);
+
+    SECTION("Noise-free setpoint step settles") {
+        MonteCarloConfig config;
+        config.steps = 400;
+        PIDController c(controller);
+        PlantModel p(plant);
+        std::vector<double> y(config.steps);
+        ClosedLoopResult result =
+            simulate_closed_loop(c, p, config, 0, y.data());
+        REQUIRE(std::abs(y.back() - config.setpoint) < 1e-6);
+        REQUIRE(result.disturbance == 0.0);
+        REQUIRE(result.max_abs_error == 1.0);
+    }
+
+    SECTION("Integrals scale with the plant sample time") {
+        // Same discrete dynamics sampled every 2 time units
+        PlantModel slow = PlantModel::fopdt(1.0, 20.0, 4.0, 2.0);
+        REQUIRE(slow.Ts() == 2.0);
+        REQUIRE(plant.Ts() == 1.0);
+        MonteCarloConfig config;
+        config.steps = 300;
+        config.setpoint = 4.0;  // Saturates at first
+        config.disturbance = 0.5;
+        config.disturbance_step = 150;
+        PIDController c(controller);
+        PlantModel p(plant);
+        ClosedLoopResult unit = simulate_closed_loop(c, p, config, 0);
+        PIDController c_slow(controller);
+        ClosedLoopResult scaled =
+            simulate_closed_loop(c_slow, slow, config, 0);
+        REQUIRE(unit.iae > 0.0);
+        REQUIRE(unit.saturation_time > 0.0);
+        REQUIRE(scaled.iae == Approx(2.0 * unit.iae).epsilon(1e-12));
+        REQUIRE(scaled.ise == Approx(2.0 * unit.ise).epsilon(1e-12));
+        REQUIRE(scaled.saturation_time == 2.0 * unit.saturation_time);
+        REQUIRE(scaled.max_abs_error == unit.max_abs_error);
+    }
+
+    SECTION("Results do not depend on the number of threads") {
+        MonteCarloConfig config;
+        config.steps = 300;
+        config.scenarios = 64;
+        config.noise_std = 0.01;
+        config.disturbance = 0.5;
+        config.disturbance_step = 150;
+        config.seed = 42;
+
+        std::vector<ClosedLoopResult> serial(config.scenarios);
+        std::vector<ClosedLoopResult> parallel(config.scenarios);
+        ThreadPool one(1);
+        ThreadPool four(4);
+        monte_carlo(controller, plant, config,
+                    [&](const ClosedLoopResult& r) {
+                        serial[r.scenario] = r;
+                    }, one);
+        monte_carlo(controller, plant, config,
+                    [&](const ClosedLoopResult& r) {
+                        parallel[r.scenario] = r;
+                    }, four);
+
+        for (size_t i = 0; i < config.scenarios; ++i) {
+            INFO("Scenario " << i);
+            REQUIRE(serial[i].iae == parallel[i].iae);
+            REQUIRE(serial[i].ise == parallel[i].ise);
+            REQUIRE(serial[i].disturbance == parallel[i].disturbance);
+            REQUIRE(std::abs(serial[i].disturbance) <= 0.5);
+        }
+        REQUIRE(serial[0].disturbance != serial[1].disturbance);
+    }
+}
+
+TEST_CASE("I/O data readers", "[io_data]") {
+    const char* path = "io_data_reader_test.csv";
+
+    SECTION("Whole file and chunks agree on all data files") {
+        const char* files[] = {
+            "data/P_step.csv",
+            "data/PI_switch_track.csv",
+            "data/PID_step_irregular_time.csv"
+        };
+        for (size_t f = 0; f < 3; ++f) {
+            IOData data = load_io_data(files[f]);
+            REQUIRE(data.n == 10);
+            IODataReader reader(files[f], 3);
+            size_t row = 0;
+            while (reader.next()) {
+                const IOData& chunk = reader.chunk();
+                REQUIRE(chunk.n <= 3);
+                for (size_t i = 0; i < chunk.n; ++i, ++row) {
+                    REQUIRE(chunk.r[i] == data.r[row]);
+                    REQUIRE(chunk.y[i] == data.y[row]);
+                    REQUIRE(chunk.Tx[i] == data.Tx[row]);
+                    REQUIRE(chunk.auto_mode[i] == data.auto_mode[row]);
+                    REQUIRE(chunk.track[i] == data.track[row]);
+                    REQUIRE(chunk.u[i] == data.u[row]);
+                }
+            }
+            REQUIRE(row == data.n);
+            REQUIRE(reader.rows_read() == data.n);
+        }
+    }
+
+    SECTION("Line endings, blank lines and optional u column") {
+        {
+            std::ofstream file(path, std::ios::binary);
+            file << "r,y,uff,uman,utrack,Tx,auto,track\r\n"
+                 << "1.5,-2e-3,0,0,0,1.0,True,FALSE\r\n"
+                 << "\r\n"
+                 << "0.25,3,0.5,1,2,0.5,0,1";
+        }
+        IOData data = load_io_data(path);
+        REQUIRE(!data.has_u);
+        REQUIRE(data.n == 2);
+        REQUIRE(data.r[0] == 1.5);
+        REQUIRE(data.y[0] == -2e-3);
+        REQUIRE(data.auto_mode[0]);
+        REQUIRE(!data.track[0]);
+        REQUIRE(data.Tx[1] == 0.5);
+        REQUIRE(!data.auto_mode[1]);
+        REQUIRE(data.track[1]);
+
+        IODataReader reader(path);
+        REQUIRE(reader.next());
+        REQUIRE(reader.chunk().n == 2);
+        REQUIRE(reader.chunk().utrack[1] == 2.0);
+        REQUIRE(!reader.next());
+    }
+
+    SECTION("Malformed files") {
+        const char* contents[] = {
+            "r,y,uff,uman,utrack,Tx,auto\n",
+            "r,y,uff,uman,utrack,Tx,auto,track,u\n1,2,3,4,5,6,true,false\n",
+            "r,y,uff,uman,utrack,Tx,auto,track\n1,2,3,4,5,x,true,false\n",
+            "r,y,uff,uman,utrack,Tx,auto,track\n1,2,3,4,5,6,yes,false\n"
+        };
+        for (size_t c = 0; c < 4; ++c) {
+            {
+                std::ofstream file(path, std::ios::binary);
+                file << contents[c];
+            }
+            INFO("Contents " << c);
+            REQUIRE_THROWS_AS(load_io_data(path), std::runtime_error);
+        }
+        REQUIRE_THROWS_AS(load_io_data("data/missing.csv"),
+                          std::runtime_error);
+    }
+
+    std::remove(path);
+}
+
+TEST_CASE("Trajectory files", "[trajectory]") {
+    const char* path = "trajectory_test.pidtraj";
+
+    SECTION("Golden trajectories replay like the CSV files") {
+        const char* names[] = {
+            "P_step", "PI_step", "PID_step", "PID_step_irregular_time",
+            "PID_antiwindup_step", "PI_switch_manual", "PI_switch_track"
+        };
+        for (size_t f = 0; f < 7; ++f) {
+            INFO("Test case " << names[f]);
+            std::string base = std::string("data/") + names[f];
+            TrajectoryFile file(base + ".pidtraj");
+            IOData data = load_io_data(base + ".csv");
+            REQUIRE(file.size() == data.n);
+            REQUIRE(file.u() != nullptr);
+
+            const TrajectoryConfig& config = file.config();
+            PIDController controller(
+                config.kp, config.ki, config.kd, config.TfTs,
+                config.umin, config.umax, config.u0, config.b);
+            std::vector<double> u(file.size());
+            controller.run(file.inputs(), u.data());
+            for (size_t i = 0; i < file.size(); ++i) {
+                REQUIRE(file.inputs().r[i] == data.r[i]);
+                REQUIRE(file.inputs().auto_mode[i] == data.auto_mode[i]);
+                REQUIRE(file.inputs().track[i] == data.track[i]);
+                REQUIRE(file.u()[i] == data.u[i]);
+                REQUIRE(u[i] == Approx(data.u[i]).epsilon(1e-10));
+            }
+        }
+    }
+
+    SECTION("Round trip with flags and windup") {
+        // 13 rows so the packed columns end in a partial byte
+        const size_t n = 13;
+        std::vector<double> r(n), y(n), Tx(n), u(n);
+        std::unique_ptr<bool[]> track(new bool[n]);
+        std::vector<WindupMode> windup(n);
+        for (size_t i = 0; i < n; ++i) {
+            r[i] = 0.5 * i;
+            y[i] = -0.25 * i;
+            Tx[i] = 1.0 + 0.01 * i;
+            u[i] = 2.0 * i;
+            track[i] = i % 3 == 0;
+            windup[i] = static_cast<WindupMode>(i % 4);
+        }
+        InputSeries inputs(n, r.data(), y.data());
+        inputs.Tx = Tx.data();
+        inputs.track = track.get();
+        inputs.windup = windup.data();
+        TrajectoryConfig config;
+        config.kp = 1.5;
+        config.umax = 3.0;
+        write_trajectory(path, config, inputs, u.data());
+
+        TrajectoryFile file(path);
+        REQUIRE(file.size() == n);
+        REQUIRE(file.config().kp == 1.5);
+        REQUIRE(file.config().TfTs == 10.0);
+        REQUIRE(file.config().umax == 3.0);
+        REQUIRE(std::isinf(file.config().umin));
+        REQUIRE(file.inputs().uff == nullptr);
+        REQUIRE(file.inputs().auto_mode == nullptr);
+        for (size_t i = 0; i < n; ++i) {
+            REQUIRE(file.inputs().r[i] == r[i]);
+            REQUIRE(file.inputs().y[i] == y[i]);
+            REQUIRE(file.inputs().Tx[i] == Tx[i]);
+            REQUIRE(file.inputs().track[i] == track[i]);
+            REQUIRE(file.inputs().windup[i] == windup[i]);
+            REQUIRE(file.u()[i] == u[i]);
+        }
+    }
+
+    SECTION("Malformed files") {
+        TrajectoryConfig config;
+        std::vector<double> r(4, 1.0);
+        write_trajectory(path, config, InputSeries(4, r.data(), r.data()));
+        std::vector<char> bytes;
+        {
+            std::ifstream file(path, std::ios::binary);
+            bytes.assign(std::istreambuf_iterator<char>(file),
+                         std::istreambuf_iterator<char>());
+        }
+        REQUIRE(bytes.size() > 96);
+
+        // Wrong magic, unsupported version and truncated column data
+        std::vector<std::vector<char> > corrupted(3, bytes);
+        corrupted[0][0] = 'X';
+        corrupted[1][8] = 2;
+        corrupted[2].resize(bytes.size() - 8);
+        for (size_t c = 0; c < corrupted.size(); ++c) {
+            {
+                std::ofstream file(path, std::ios::binary);
+                file.write(corrupted[c].data(), corrupted[c].size());
+            }
+            INFO("Corruption " << c);
+            REQUIRE_THROWS_AS(TrajectoryFile(path), std::runtime_error);
+        }
+        REQUIRE_THROWS_AS(TrajectoryFile("data/missing.pidtraj"),
+                          std::runtime_error);
+    }
+
+    std::remove(path);
+}
+
+TEST_CASE("SPSC ring buffer", "[async]") {
+    SpscRing<int> ring(5);
+    REQUIRE(ring.capacity() == 8);
+
+    // Fill, drain and wrap around several times
+    int value = -1;
+    int next = 0;
+    int expected = 0;
+    for (int round = 0; round < 5; ++round) {
+        while (ring.push(next)) {
+            ++next;
+        }
+        REQUIRE(ring.size() == 8);
+        for (int k = 0; k < 5; ++k) {
+            REQUIRE(ring.pop(value));
+            REQUIRE(value == expected++);
+        }
+    }
+    while (ring.pop(value)) {
+        REQUIRE(value == expected++);
+    }
+    REQUIRE(expected == next);
+    REQUIRE(ring.size() == 0);
+    REQUIRE(!ring.pop(value));
+
+    // Elements filled in place appear only when published
+    int* slot = ring.claim();
+    REQUIRE(slot != nullptr);
+    *slot = 42;
+    REQUIRE(ring.claim() == slot);
+    REQUIRE(!ring.pop(value));
+    ring.publish();
+    REQUIRE(ring.pop(value));
+    REQUIRE(value == 42);
+    while (ring.push(0)) {
+    }
+    REQUIRE(ring.claim() == nullptr);
+}
+
+TEST_CASE("Asynchronous controller runner", "[async]") {
+    const double Ts = 0.01;
+
+    SECTION("Periods from timestamps match direct calls") {
+        PIDController controller(1.0, 0.5, 0.1, 10.0, -10.0, 10.0);
+        PIDController reference(1.0, 0.5, 0.1, 10.0, -10.0, 10.0);
+        AsyncPIDRunner runner(controller, Ts, 16);
+        runner.set_setpoint(1.0);
+
+        std::mt19937 rng(3);
+        std::uniform_real_distribution<double> jitter(-0.3, 0.3);
+        double t = 100.0;
+        double t_last = t;
+        for (int k = 0; k < 40; ++k) {
+            double y = 0.02 * k;
+            REQUIRE(runner.push_measurement(y, t));
+            // A repeated timestamp is rejected without a step
+            if (k == 20) {
+                REQUIRE(runner.push_measurement(y, t));
+            }
+            REQUIRE(runner.poll(t + 0.001) == (k == 20 ? 2u : 1u));
+
+            double Tx = k == 0 ? 1.0 : (t - t_last) / Ts;
+            double u = reference(1.0, y, 0.0, 0.0, 0.0, Tx);
+            TimedControl output;
+            REQUIRE(runner.pop_output(output));
+            REQUIRE(output.t == t);
+            REQUIRE(output.u == u);
+            REQUIRE(!runner.pop_output(output));
+
+            t_last = t;
+            t += Ts * (1.0 + jitter(rng));
+        }
+        REQUIRE(runner.rejected_measurements() == 1);
+        REQUIRE(runner.latency().count == 40);
+        REQUIRE(runner.latency().mean() == Approx(0.001));
+        REQUIRE(runner.latency().max >= runner.latency().min);
+    }
+
+    SECTION("Full rings drop samples") {
+        PIDController controller(1.0, 0.5, 0.0);
+        AsyncPIDRunner runner(controller, Ts, 4);
+        for (int k = 0; k < 6; ++k) {
+            runner.push_measurement(0.0, k * Ts);
+        }
+        REQUIRE(runner.dropped_measurements() == 2);
+        REQUIRE(runner.poll(1.0) == 4);
+        for (int k = 0; k < 6; ++k) {
+            runner.push_measurement(0.0, (k + 4) * Ts);
+        }
+        REQUIRE(runner.poll(1.0) == 4);
+        REQUIRE(runner.dropped_outputs() == 4);
+        REQUIRE(runner.latency().count == 4);
+    }
+
+    SECTION("Producer and consumer threads") {
+        const int n = 20000;
+        PIDController controller(1.0, 0.5, 0.1);
+        AsyncPIDRunner runner(controller, Ts, 64);
+        runner.set_setpoint(1.0);
+
+        std::thread producer([&]() {
+            double t = 1.0;
+            for (int k = 0; k < n; ++k) {
+                t += Ts * (1.0 + 0.1 * (k % 3));
+                while (!runner.push_measurement(std::sin(0.01 * k), t)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+        std::vector<TimedControl> outputs;
+        outputs.reserve(n);
+        while (outputs.size() < static_cast<size_t>(n)) {
+            runner.poll(AsyncPIDRunner::clock());
+            TimedControl output;
+            while (runner.pop_output(output)) {
+                outputs.push_back(output);
+            }
+        }
+        producer.join();
+
+        PIDController reference(1.0, 0.5, 0.1);
+        double t = 1.0;
+        double t_last = 0.0;
+        for (int k = 0; k < n; ++k) {
+            t += Ts * (1.0 + 0.1 * (k % 3));
+            double Tx = k == 0 ? 1.0 : (t - t_last) / Ts;
+            double u = reference(1.0, std::sin(0.01 * k), 0.0, 0.0, 0.0,
+                                 Tx);
+            REQUIRE(outputs[k].t == t);
+            REQUIRE(outputs[k].u == u);
+            t_last = t;
+        }
+        // The producer retries when the ring is full, so only outputs
+        // are guaranteed not to be dropped
+        REQUIRE(runner.dropped_outputs() == 0);
+    }
+}
+
+TEST_CASE("Multi-rate scheduler", "[scheduler]") {
+    const double tick = 0.001;
+
+    SECTION("Groups run at their own rates") {
+        PIDBank fast(3, 1.0, 0.5, 0.1);
+        PIDBank medium(2, 2.0, 0.2, 0.0);
+        PIDBank slow(1, 0.5, 0.1, 0.0);
+        MultiRateScheduler scheduler(tick, 16);
+        RateGroup& g_fast = scheduler.add_group(fast, 0.001);
+        RateGroup& g_medium = scheduler.add_group(medium, 0.010);
+        RateGroup& g_slow = scheduler.add_group(slow, 0.100);
+        REQUIRE(scheduler.size() == 3);
+
+        // Each group's measurement is the time of the run
+        RateGroup::IOFunction read = [](RateGroup& group, double now) {
+            std::fill(group.r.begin(), group.r.end(), 1.0);
+            std::fill(group.y.begin(), group.y.end(), now);
+        };
+        g_fast.read = read;
+        g_medium.read = read;
+        g_slow.read = read;
+        std::vector<double> slow_u;
+        g_slow.write = [&slow_u](RateGroup& group, double) {
+            slow_u.push_back(group.u[0]);
+        };
+
+        std::vector<double> slow_Tx;
+        for (int k = 0; k < 1000; ++k) {
+            scheduler.tick(10.0 + k * tick);
+            if (k % 100 == 0) {
+                slow_Tx.push_back(g_slow.Tx[0]);
+            }
+        }
+        REQUIRE(g_fast.stats.runs == 1000);
+        REQUIRE(g_medium.stats.runs == 100);
+        REQUIRE(g_slow.stats.runs == 10);
+        REQUIRE(g_medium.stats.deadline_misses == 0);
+        REQUIRE(slow_u.size() == 10);
+
+        // Same controller stepped directly
+        PIDController direct(0.5, 0.1, 0.0);
+        for (int k = 0; k < 10; ++k) {
+            REQUIRE(slow_Tx[k] == Approx(1.0));
+            double now = 10.0 + k * 100 * tick;
+            REQUIRE(slow_u[k] == direct(1.0, now, 0.0, 0.0, 0.0,
+                                        slow_Tx[k]));
+        }
+    }
+
+    SECTION("Overruns pass the elapsed period and count misses") {
+        PIDBank bank(1, 1.0, 0.5, 0.1);
+        MultiRateScheduler scheduler(tick, 8);
+        RateGroup& group = scheduler.add_group(bank, 0.010);
+        group.r[0] = 1.0;
+
+        PIDController reference(1.0, 0.5, 0.1);
+        const double times[] = {0.0, 0.010, 0.021, 0.055, 0.060, 0.070};
+        double last = 0.0;
+        for (size_t k = 0; k < 6; ++k) {
+            REQUIRE(scheduler.tick(times[k]) == 1);
+            double Tx = k == 0 ? 1.0 : (times[k] - last) / 0.010;
+            REQUIRE(group.Tx[0] == Approx(Tx));
+            REQUIRE(group.u[0] == reference(1.0, 0.0, 0.0, 0.0, 0.0,
+                                            group.Tx[0]));
+            last = times[k];
+        }
+        // Nothing is due between deadlines
+        REQUIRE(scheduler.tick(0.075) == 0);
+        REQUIRE(scheduler.next_due() == Approx(0.080));
+
+        // The run at 0.055 was due at 0.030, skipping 0.030 to 0.050
+        REQUIRE(group.stats.runs == 6);
+        REQUIRE(group.stats.deadline_misses == 1);
+        REQUIRE(group.stats.skipped_periods == 2);
+        REQUIRE(group.stats.max_lateness == Approx(0.025));
+    }
+
+    SECTION("Invalid periods") {
+        PIDBank bank(1, 1.0, 0.5, 0.0);
+        MultiRateScheduler scheduler(tick);
+        REQUIRE_THROWS_AS(scheduler.add_group(bank, 0.0015),
+                          std::invalid_argument);
+        REQUIRE_THROWS_AS(scheduler.add_group(bank, 0.0),
+                          std::invalid_argument);
+    }
+
+    SECTION("Run on a thread until stopped") {
+        PIDBank bank(4, 1.0, 0.5, 0.0);
+        MultiRateScheduler scheduler(tick);
+        RateGroup& group = scheduler.add_group(bank, 0.002);
+        std::atomic<bool> stop(false);
+        std::thread worker([&]() {
+            MultiRateScheduler::pin_current_thread(0);
+            scheduler.run(stop);
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        stop.store(true);
+        worker.join();
+        REQUIRE(group.stats.runs > 0);
+        REQUIRE(group.stats.runs <= 26);
+    }
+}
+
+TEST_CASE("Control graph", "[control_graph]") {
+    SECTION("Cascade with saturation propagated to the outer loop") {
+        // Outer level loop sets the flow setpoint of an inner loop
+        // whose valve saturates
+        PIDController outer(2.0, 0.5, 0.0, 10.0, -10.0, 10.0);
+        PIDController inner(1.0, 0.8, 0.0, 10.0, 0.0, 1.0);
+        ControlGraph graph;
+        size_t inner_node = graph.add(inner);
+        size_t outer_node = graph.add(outer);
+        graph.connect(outer_node, inner_node, ControlPort::R);
+        graph.compile();
+        REQUIRE(graph.levels() == 2);
+        REQUIRE(graph.level(outer_node) == 0);
+        REQUIRE(graph.level(inner_node) == 1);
+
+        // Same loops wired by hand
+        double level = 0.0;
+        double flow = 0.0;
+        WindupMode windup = WindupMode::NONE;
+        bool saturated = false;
+        for (int k = 0; k < 200; ++k) {
+            graph.inputs(outer_node).r = 5.0;
+            graph.inputs(outer_node).y = level;
+            graph.inputs(inner_node).y = flow;
+            graph.step();
+
+            double r_inner = outer(5.0, level, 0.0, 0.0, 0.0, 1.0, false,
+                                   true, windup);
+            double u = inner(r_inner, flow);
+            REQUIRE(graph.u(outer_node) == r_inner);
+            REQUIRE(graph.u(inner_node) == u);
+            REQUIRE(graph.windup(outer_node) == windup);
+            windup = u >= 1.0 ? WindupMode::UPPER
+                   : u <= 0.0 ? WindupMode::LOWER : WindupMode::NONE;
+            saturated = saturated || windup == WindupMode::UPPER;
+
+            flow += 0.5 * (u - flow);
+            level += 0.05 * (flow - 0.2);
+        }
+        REQUIRE(saturated);
+        // Without windup the outer loop would have reached its limit
+        REQUIRE(graph.u(outer_node) < 10.0);
+    }
+
+    SECTION("Ratio, previous-step connections and levels") {
+        ControlGraph graph;
+        size_t a = graph.add(PIDController(1.0, 0.1, 0.0));
+        size_t b = graph.add(PIDController(0.5, 0.2, 0.0));
+        size_t c = graph.add(PIDController(1.0, 0.3, 0.0));
+        size_t d = graph.add(PIDController(1.0, 0.3, 0.0));
+        graph.connect(a, b, ControlPort::R, 0.5, 1.0);
+        graph.connect(a, c, ControlPort::R, -2.0);
+        graph.connect(b, d, ControlPort::UFF);
+        graph.connect(c, d, ControlPort::R);
+        graph.connect_previous(d, a, ControlPort::UTRACK);
+        graph.inputs(a).r = 1.0;
+        graph.compile();
+        REQUIRE(graph.levels() == 3);
+        REQUIRE(graph.level(b) == 1);
+        REQUIRE(graph.level(c) == 1);
+        REQUIRE(graph.level(d) == 2);
+
+        PIDController pa(1.0, 0.1, 0.0);
+        PIDController pb(0.5, 0.2, 0.0);
+        PIDController pc(1.0, 0.3, 0.0);
+        PIDController pd(1.0, 0.3, 0.0);
+        double ud = 0.0;
+        for (int k = 0; k < 20; ++k) {
+            graph.inputs(a).track = k == 10;
+            graph.step();
+            double ua = pa(1.0, 0.0, 0.0, 0.0, ud, 1.0, k == 10);
+            double ub = pb(0.5 * ua + 1.0, 0.0);
+            double uc = pc(-2.0 * ua, 0.0);
+            ud = pd(uc, 0.0, ub);
+            REQUIRE(graph.u(a) == ua);
+            REQUIRE(graph.u(b) == ub);
+            REQUIRE(graph.u(c) == uc);
+            REQUIRE(graph.u(d) == ud);
+        }
+    }
+
+    SECTION("Negative gain swaps the propagated direction") {
+        ControlGraph graph;
+        size_t outer = graph.add(PIDController(1.0, 0.5, 0.0));
+        size_t inner = graph.add(PIDController(1.0, 0.5, 0.0, 10.0,
+                                               -1.0, 1.0));
+        graph.connect(outer, inner, ControlPort::R, -1.0);
+        graph.inputs(outer).r = 5.0;
+        graph.step();
+        graph.step();
+        // The outer loop drives the inner setpoint down until it
+        // saturates at umin, which blocks the outer loop upwards
+        REQUIRE(graph.u(inner) == -1.0);
+        graph.step();
+        REQUIRE(graph.windup(outer) == WindupMode::UPPER);
+    }
+
+    SECTION("Cycles are rejected") {
+        ControlGraph graph;
+        size_t a = graph.add(PIDController(1.0, 0.1, 0.0));
+        size_t b = graph.add(PIDController(1.0, 0.1, 0.0));
+        graph.connect(a, b, ControlPort::R);
+        graph.connect(b, a, ControlPort::UFF);
+        REQUIRE_THROWS_AS(graph.compile(), std::invalid_argument);
+        REQUIRE_THROWS_AS(graph.connect(a, 2, ControlPort::R),
+                          std::invalid_argument);
+    }
+
+    SECTION("Parallel levels match serial steps") {
+        const size_t cascades = 300;
+        ControlGraph serial;
+        ControlGraph parallel;
+        parallel.set_parallel_threshold(16);
+        ControlGraph* graphs[] = {&serial, &parallel};
+        for (size_t g = 0; g < 2; ++g) {
+            for (size_t i = 0; i < cascades; ++i) {
+                size_t outer = graphs[g]->add(
+                    PIDController(1.0 + 0.01 * i, 0.2, 0.1, 10.0, -5, 5));
+                size_t inner = graphs[g]->add(
+                    PIDController(0.5, 0.4, 0.0, 10.0, -1.0, 1.0));
+                graphs[g]->connect(outer, inner, ControlPort::R);
+                graphs[g]->inputs(outer).r = 1.0 + 0.1 * (i % 7);
+            }
+        }
+        ThreadPool pool(4);
+        for (int k = 0; k < 50; ++k) {
+            for (size_t i = 0; i < 2 * cascades; ++i) {
+                double y = 0.1 * std::sin(0.1 * k + i);
+                serial.inputs(i).y = y;
+                parallel.inputs(i).y = y;
+            }
+            serial.step();
+            parallel.step(&pool);
+            for (size_t i = 0; i < 2 * cascades; ++i) {
+                REQUIRE(parallel.u(i) == serial.u(i));
+                REQUIRE(parallel.windup(i) == serial.windup(i));
+            }
+        }
+    }
+}
+
+TEST_CASE("Online parameter updates", "[retune]") {
+    SECTION("Gain changes do not bump the control signal") {
+        PIDController controller(1.0, 0.5, 0.2);
+        PIDController restarted(3.0, 0.1, 0.5);
+        double u = 0.0;
+        for (int k = 0; k < 500; ++k) {
+            u = controller(1.0, 0.8);
+        }
+
+        // Constant error: only the new integral increment remains
+        controller.set_gains(3.0, 0.1, 0.5);
+        REQUIRE(controller.params().kp == 3.0);
+        REQUIRE(controller.params().ki == 0.1);
+        REQUIRE(controller.params().kd == 0.5);
+        PIDStepResult result = controller.step(1.0, 0.8);
+        REQUIRE(result.Dup == Approx(0.0).margin(1e-12));
+        REQUIRE(result.Dud == Approx(0.0).margin(1e-12));
+        REQUIRE(result.u == Approx(u + 0.1 * 0.2).margin(1e-12));
+        REQUIRE(restarted(1.0, 0.8) > 0.5);
+    }
+
+    SECTION("Unchanged parameters keep the outputs bit for bit") {
+        PIDController retuned(2.0, 1.0, 0.2, 10.0, -3.0, 3.0);
+        PIDController reference(2.0, 1.0, 0.2, 10.0, -3.0, 3.0);
+        for (int k = 0; k < 100; ++k) {
+            double r = (k / 25) % 2 == 0 ? 2.0 : -2.0;
+            double y = std::sin(0.1 * k);
+            retuned.set_gains(2.0, 1.0, 0.2);
+            retuned.set_limits(-3.0, 3.0);
+            retuned.set_TfTs(10.0);
+            if (k > 0) {
+                REQUIRE(!retuned.filter().needs_discretization(1.0));
+            }
+            REQUIRE(retuned(r, y) == reference(r, y));
+        }
+    }
+
+    SECTION("Limits and filter time constant") {
+        PIDController controller(1.0, 0.5, 0.1, 10.0, -10.0, 10.0);
+        for (int k = 0; k < 10; ++k) {
+            controller(5.0, 0.0);
+        }
+        controller.set_limits(-1.0, 1.0);
+        REQUIRE(controller(5.0, 0.0) == 1.0);
+        REQUIRE(controller.saturation() == SATURATED_HIGH);
+
+        // The filter state is kept and rediscretized once
+        FilterOutput before = controller.filter().state();
+        controller.set_TfTs(4.0);
+        REQUIRE(controller.filter().TfTs() == 4.0);
+        REQUIRE(controller.filter().needs_discretization(1.0));
+        REQUIRE(controller.filter().state().yf == before.yf);
+        controller(5.0, 0.0);
+        FilterParams expected = zoh_Fy(4.0, 1.0);
+        REQUIRE(controller.filter().params().a11 == expected.a11);
+        REQUIRE(!controller.filter().needs_discretization(1.0));
+    }
+}
+
+TEST_CASE("Gain-scheduled controllers", "[gain_schedule]") {
+    std::vector<double> x = {0.0, 1.0, 2.0, 3.0};
+    std::vector<double> kp = {1.0, 2.0, 2.0, 0.5};
+    std::vector<double> ki = {0.1, 0.3, 0.2, 0.2};
+    std::vector<double> kd = {0.0, 0.1, 0.4, 0.0};
+    GainSchedule uniform(x, kp, ki, kd);
+    std::vector<double> uneven_x = {0.0, 0.5, 2.0, 3.0};
+    GainSchedule uneven(uneven_x, kp, ki, kd);
+
+    SECTION("Interpolation between breakpoints") {
+        REQUIRE(uniform.size() == 4);
+        REQUIRE(uniform.uniform());
+        REQUIRE(!uneven.uniform());
+        const GainSchedule* schedules[] = {&uniform, &uneven};
+        const std::vector<double>* breakpoints[] = {&x, &uneven_x};
+        for (size_t s = 0; s < 2; ++s) {
+            const GainSchedule& schedule = *schedules[s];
+            const std::vector<double>& xs = *breakpoints[s];
+            double p, i, d;
+            for (size_t k = 0; k < xs.size(); ++k) {
+                schedule.lookup(xs[k], p, i, d);
+                REQUIRE(p == Approx(kp[k]).margin(1e-15));
+                REQUIRE(i == Approx(ki[k]).margin(1e-15));
+                REQUIRE(d == Approx(kd[k]).margin(1e-15));
+            }
+            for (size_t k = 0; k + 1 < xs.size(); ++k) {
+                schedule.lookup(0.75 * xs[k] + 0.25 * xs[k + 1], p, i, d);
+                REQUIRE(p == Approx(0.75 * kp[k] + 0.25 * kp[k + 1]));
+                REQUIRE(i == Approx(0.75 * ki[k] + 0.25 * ki[k + 1]));
+                REQUIRE(d == Approx(0.75 * kd[k] + 0.25 * kd[k + 1])
+                             .margin(1e-15));
+            }
+
+            // Held at the end values outside the breakpoints
+            schedule.lookup(-5.0, p, i, d);
+            REQUIRE(p == kp.front());
+            schedule.lookup(1e9, p, i, d);
+            REQUIRE(p == kp.back());
+            REQUIRE(d == kd.back());
+        }
+
+        // The batch lookup matches the single lookups, for the scaled
+        // index, the counted search of small tables and the binary
+        // search of large ones, also at breakpoints, outside the range
+        // and for NaN
+        std::mt19937 rng(3);
+        std::vector<double> many_x, many_kp;
+        for (int k = 0; k < 100; ++k) {
+            many_x.push_back(0.03 * k + 0.0001 * (k % 3));
+            many_kp.push_back(1.0 + 0.5 * std::sin(0.3 * k));
+        }
+        GainSchedule many(many_x, many_kp, many_kp, many_kp);
+        REQUIRE(!many.uniform());
+        const GainSchedule* batch_schedules[] = {&uniform, &uneven, &many};
+        std::uniform_real_distribution<double> operating(-1.0, 4.0);
+        const size_t n = 101;
+        std::vector<double> points(n), p(n), i(n), d(n);
+        for (size_t k = 0; k < n; ++k) {
+            points[k] = operating(rng);
+        }
+        points[3] = uneven_x[1];
+        points[4] = x[2];
+        points[5] = many_x[57];
+        points[6] = std::numeric_limits<double>::quiet_NaN();
+        points[7] = -std::numeric_limits<double>::infinity();
+        points[8] = std::numeric_limits<double>::infinity();
+        auto same = [](double a, double b) {
+            return a == b || (std::isnan(a) && std::isnan(b));
+        };
+        for (size_t s = 0; s < 3; ++s) {
+            const GainSchedule& schedule = *batch_schedules[s];
+            schedule.lookup(n, points.data(), p.data(), i.data(), d.data());
+            for (size_t k = 0; k < n; ++k) {
+                double pk, ik, dk;
+                schedule.lookup(points[k], pk, ik, dk);
+                INFO("Schedule " << s << ", point " << points[k]);
+                REQUIRE(same(p[k], pk));
+                REQUIRE(same(i[k], ik));
+                REQUIRE(same(d[k], dk));
+            }
+        }
+        REQUIRE(std::isnan(p[6]));
+
+        std::vector<double> single = {2.0};
+        GainSchedule constant(single, single, single, single);
+        double p0, i0, d0;
+        constant.lookup(-3.0, p0, i0, d0);
+        REQUIRE(p0 == 2.0);
+
+        std::vector<double> decreasing = {0.0, 2.0, 1.0, 3.0};
+        std::vector<double> short_kp = {1.0, 2.0};
+        REQUIRE_THROWS_AS(GainSchedule(decreasing, kp, ki, kd),
+                          std::invalid_argument);
+        REQUIRE_THROWS_AS(GainSchedule(x, short_kp, ki, kd),
+                          std::invalid_argument);
+    }
+
+    SECTION("Scheduled controller changes gains without bumps") {
+        GainScheduledPID scheduled(uneven, 10.0, -10.0, 10.0);
+        PIDController manual(1.0, 0.1, 0.0, 10.0, -10.0, 10.0);
+        double u_last = 0.0;
+        double largest_change = 0.0;
+        for (int k = 0; k < 400; ++k) {
+            double op = 3.0 * k / 399.0;
+            double r = 1.0;
+            double y = 0.9 + 0.001 * std::sin(0.2 * k);
+            double p, i, d;
+            uneven.lookup(op, p, i, d);
+            manual.set_gains(p, i, d);
+            double u = scheduled(op, r, y);
+            REQUIRE(u == manual(r, y));
+            if (k > 50) {
+                largest_change =
+                    std::max(largest_change, std::abs(u - u_last));
+            }
+            u_last = u;
+        }
+        REQUIRE(scheduled.controller().params().kp == kp.back());
+
+        // Only the integral and the small changes of y move u
+        REQUIRE(largest_change < 0.05);
+    }
+
+    SECTION("Scheduled bank matches scheduled controllers") {
+        const size_t n = 37;
+        PIDBank bank(n, 0.0, 0.0, 0.0, 10.0, -5.0, 5.0);
+        std::vector<GainScheduledPID> controllers(
+            n, GainScheduledPID(uneven, 10.0, -5.0, 5.0));
+        std::vector<double> op(n), r(n), y(n), zeros(n, 0.0), Tx(n, 1.0);
+        std::vector<double> u(n);
+        std::unique_ptr<bool[]> track(new bool[n]);
+        std::unique_ptr<bool[]> auto_mode(new bool[n]);
+        std::vector<WindupMode> windup(n, WindupMode::NONE);
+        std::mt19937 rng(7);
+        std::normal_distribution<double> noise(0.0, 1.0);
+        for (size_t i = 0; i < n; ++i) {
+            track[i] = false;
+            auto_mode[i] = true;
+        }
+        for (int k = 0; k < 200; ++k) {
+            for (size_t i = 0; i < n; ++i) {
+                op[i] = 1.5 + 1.5 * std::sin(0.03 * k + i);
+                r[i] = k < 100 ? 1.0 : -1.0;
+                y[i] = 0.1 * noise(rng);
+            }
+            schedule_bank_gains(bank, uneven, op.data());
+            bank.step(r.data(), y.data(), zeros.data(), zeros.data(),
+                      zeros.data(), Tx.data(), track.get(),
+                      auto_mode.get(), windup.data(), u.data());
+            for (size_t i = 0; i < n; ++i) {
+                REQUIRE(u[i] == controllers[i](op[i], r[i], y[i]));
+            }
+        }
+    }
+}
+
+/**
+ * @brief Compare two controller states bit for bit
+ */
+bool same_state(const PIDControllerState& a, const PIDControllerState& b) {
+    return std::memcmp(&a.u_old, &b.u_old, 7 * sizeof(double)) == 0
+        && a.saturation == b.saturation && a.initialized == b.initialized;
+}
+
+TEST_CASE("State snapshots and checkpoints", "[checkpoint]") {
+    SECTION("Restored controllers continue bit for bit") {
+        PIDController active(2.0, 1.0, 0.2, 8.0, -3.0, 3.0);
+        PIDController standby(2.0, 1.0, 0.2, 8.0, -3.0, 3.0);
+        active.set_auto_windup(true);
+        standby.set_auto_windup(true);
+        std::mt19937 rng(7);
+        std::normal_distribution<double> noise(0.0, 1.0);
+        std::lognormal_distribution<double> period(0.0, 0.5);
+        for (int k = 0; k < 100; ++k) {
+            active(2.0, noise(rng), 0.0, 0.0, 0.0, period(rng));
+        }
+        standby(-1.0, 5.0);
+        standby.restore(active.snapshot());
+        REQUIRE(same_state(standby.snapshot(), active.snapshot()));
+        REQUIRE(!standby.filter().needs_discretization(
+            active.snapshot().Tx_old));
+        for (int k = 0; k < 100; ++k) {
+            double y = noise(rng);
+            double Tx = k % 3 == 0 ? period(rng) : 1.0;
+            REQUIRE(standby(2.0, y, 0.0, 0.0, 0.0, Tx)
+                    == active(2.0, y, 0.0, 0.0, 0.0, Tx));
+            REQUIRE(standby.saturation() == active.saturation());
+        }
+
+        // A snapshot of a new controller resets the filter
+        PIDController fresh(2.0, 1.0, 0.2, 8.0, -3.0, 3.0);
+        PIDControllerState initial = fresh.snapshot();
+        REQUIRE(!initial.initialized);
+        REQUIRE(std::isnan(initial.Tx_old));
+        standby.restore(initial);
+        REQUIRE(standby.filter().needs_discretization(1.0));
+        REQUIRE(standby(1.0, 0.5) == fresh(1.0, 0.5));
+    }
+
+    SECTION("Bank failover through a checkpoint stream") {
+        const size_t n = 37;
+        PIDBank active(n, 0.0, 0.0, 0.0);
+        PIDBank standby(n, 0.0, 0.0, 0.0);
+        std::vector<PIDController> controllers;
+        for (size_t i = 0; i < n; ++i) {
+            double kp = 1.0 + 0.1 * i;
+            double ki = i % 4 == 0 ? 0.0 : 0.5;
+            double TfTs = 5.0 + i;
+            active.configure(i, kp, ki, 0.1, TfTs, -2.0, 2.0);
+            standby.configure(i, kp, ki, 0.1, TfTs, -2.0, 2.0);
+            controllers.push_back(
+                PIDController(kp, ki, 0.1, TfTs, -2.0, 2.0));
+            controllers.back().set_auto_windup(true);
+        }
+        active.set_auto_windup(true);
+        standby.set_auto_windup(true);
+
+        std::mt19937 rng(11);
+        std::normal_distribution<double> noise(0.0, 1.0);
+        std::lognormal_distribution<double> period(0.0, 0.5);
+        std::vector<double> r(n), y(n), zeros(n, 0.0), Tx(n), u(n), u2(n);
+        std::unique_ptr<bool[]> track(new bool[n]);
+        std::unique_ptr<bool[]> auto_mode(new bool[n]);
+        std::vector<WindupMode> windup(n, WindupMode::NONE);
+        for (size_t i = 0; i < n; ++i) {
+            track[i] = false;
+            auto_mode[i] = true;
+        }
+        auto inputs = [&](int k) {
+            for (size_t i = 0; i < n; ++i) {
+                r[i] = k < 10 ? 0.0 : 3.0;
+                y[i] = noise(rng);
+                Tx[i] = (i % 2 == 0) ? 1.0 : period(rng);
+            }
+        };
+
+        StateEncoder encoder(n);
+        StateDecoder decoder(n);
+        std::vector<PIDControllerState> states(n), others(n);
+        active.snapshot(states.data());
+        for (size_t i = 0; i < n; ++i) {
+            REQUIRE(!states[i].initialized);
+        }
+        for (int k = 0; k < 60; ++k) {
+            inputs(k);
+            active.step(r.data(), y.data(), zeros.data(), zeros.data(),
+                        zeros.data(), Tx.data(), track.get(),
+                        auto_mode.get(), windup.data(), u.data());
+            for (size_t i = 0; i < n; ++i) {
+                controllers[i](r[i], y[i], 0.0, 0.0, 0.0, Tx[i]);
+            }
+            active.snapshot(states.data());
+            if (k % 20 == 0) {
+                encoder.encode_full(states.data());
+            } else if (k % 2 == 0) {
+                encoder.encode_delta(states.data());
+            } else {
+                encoder.encode_delta(active);
+            }
+            decoder.decode(encoder.data(), encoder.bytes());
+            REQUIRE(decoder.sequence() == static_cast<uint64_t>(k));
+            for (size_t i = 0; i < n; ++i) {
+                REQUIRE(same_state(decoder.state(i), states[i]));
+                REQUIRE(same_state(controllers[i].snapshot(), states[i]));
+            }
+        }
+
+        // The standby bank and restored controllers take over
+        decoder.states(states.data());
+        standby.restore(states.data());
+        standby.snapshot(others.data());
+        std::vector<PIDController> restored;
+        for (size_t i = 0; i < n; ++i) {
+            REQUIRE(same_state(others[i], states[i]));
+            restored.push_back(PIDController(
+                1.0 + 0.1 * i, i % 4 == 0 ? 0.0 : 0.5, 0.1, 5.0 + i,
+                -2.0, 2.0));
+            restored.back().set_auto_windup(true);
+            restored.back().restore(states[i]);
+        }
+        for (int k = 60; k < 120; ++k) {
+            inputs(k);
+            active.step(r.data(), y.data(), zeros.data(), zeros.data(),
+                        zeros.data(), Tx.data(), track.get(),
+                        auto_mode.get(), windup.data(), u.data());
+            standby.step(r.data(), y.data(), zeros.data(), zeros.data(),
+                         zeros.data(), Tx.data(), track.get(),
+                         auto_mode.get(), windup.data(), u2.data());
+            for (size_t i = 0; i < n; ++i) {
+                REQUIRE(u2[i] == u[i]);
+                REQUIRE(restored[i](r[i], y[i], 0.0, 0.0, 0.0, Tx[i])
+                        == u[i]);
+            }
+        }
+    }
+
+    SECTION("Delta checkpoints hold only changes") {
+        const size_t n = 600;
+        std::vector<PIDControllerState> states(n);
+        for (size_t i = 0; i < n; ++i) {
+            PIDController controller(1.0, 0.5, 0.1);
+            for (size_t k = 0; k <= i % 50; ++k) {
+                controller(1.0, 0.01 * k);
+            }
+            states[i] = controller.snapshot();
+        }
+        StateEncoder encoder(n);
+        StateDecoder decoder(n);
+        REQUIRE(encoder.encode_delta(states.data()) == 24 + 57 * n);
+        decoder.decode(encoder.data(), encoder.bytes());
+
+        // Unchanged states take one bit per column, in blocks of 512
+        const size_t bitmaps = 8 * (512 / 8 + (n - 512 + 7) / 8);
+        REQUIRE(encoder.encode_delta(states.data()) == 24 + bitmaps);
+        decoder.decode(encoder.data(), encoder.bytes());
+
+        // Only the low bytes of a small change are stored
+        uint64_t bits;
+        std::memcpy(&bits, &states[5].u_old, sizeof(bits));
+        bits ^= 0x1234;
+        std::memcpy(&states[5].u_old, &bits, sizeof(bits));
+        states[599].saturation = SATURATED_LOW;
+        REQUIRE(encoder.encode_delta(states.data())
+                == 24 + bitmaps + 3 + 1);
+        std::vector<char> delta(encoder.data(),
+                                encoder.data() + encoder.bytes());
+        decoder.decode(delta.data(), delta.size());
+        for (size_t i = 0; i < n; ++i) {
+            REQUIRE(same_state(decoder.state(i), states[i]));
+        }
+
+        // Filters that are not initialized are stored with a NaN Tx_old
+        states[3].initialized = false;
+        encoder.encode_delta(states.data());
+        decoder.decode(encoder.data(), encoder.bytes());
+        REQUIRE(!decoder.state(3).initialized);
+        REQUIRE(std::isnan(decoder.state(3).Tx_old));
+        states[3].initialized = true;
+        encoder.encode_delta(states.data());
+        decoder.decode(encoder.data(), encoder.bytes());
+        REQUIRE(same_state(decoder.state(3), states[3]));
+
+        // A repeated or missed delta is rejected until the next full one
+        REQUIRE_THROWS_AS(decoder.decode(delta.data(), delta.size()),
+                          std::runtime_error);
+        REQUIRE(!decoder.valid());
+        encoder.encode_delta(states.data());
+        REQUIRE_THROWS_AS(
+            decoder.decode(encoder.data(), encoder.bytes()),
+            std::runtime_error);
+        encoder.encode_full(states.data());
+        decoder.decode(encoder.data(), encoder.bytes());
+        REQUIRE(decoder.valid());
+
+        // Truncated, corrupted or mismatched checkpoints
+        states[0].dyf += 1.0;
+        encoder.encode_delta(states.data());
+        std::vector<char> next(encoder.data(),
+                               encoder.data() + encoder.bytes());
+        REQUIRE_THROWS_AS(decoder.decode(next.data(), next.size() - 1),
+                          std::runtime_error);
+        REQUIRE(!decoder.valid());
+        encoder.encode_full(states.data());
+        std::vector<char> full(encoder.data(),
+                               encoder.data() + encoder.bytes());
+        StateDecoder smaller(n - 1);
+        REQUIRE_THROWS_AS(smaller.decode(full.data(), full.size()),
+                          std::runtime_error);
+        full[0] = 'X';
+        REQUIRE_THROWS_AS(decoder.decode(full.data(), full.size()),
+                          std::runtime_error);
+        REQUIRE_THROWS_AS(decoder.decode(full.data(), 10),
+                          std::runtime_error);
+    }
+}
+
+TEST_CASE("Controller arena", "[arena]") {
+    SECTION("Controllers are aligned and behave as on the heap") {
+        ControllerArena arena(4096);
+        std::vector<PIDController*> controllers;
+        for (int i = 0; i < 100; ++i) {
+            controllers.push_back(arena.create<PIDController>(
+                1.0 + 0.01 * i, 0.5, 0.1, 10.0, -1.0, 1.0));
+            REQUIRE(reinterpret_cast<uintptr_t>(controllers.back())
+                        % ARENA_ALIGNMENT == 0);
+        }
+        MeasurementFilter* filter = arena.create<MeasurementFilter>(5.0);
+        REQUIRE(reinterpret_cast<uintptr_t>(filter) % ARENA_ALIGNMENT == 0);
+
+        PIDController reference(1.5, 0.5, 0.1, 10.0, -1.0, 1.0);
+        MeasurementFilter reference_filter(5.0);
+        for (int k = 0; k < 20; ++k) {
+            double y = 0.05 * k;
+            REQUIRE((*controllers[50])(1.0, y) == reference(1.0, y));
+            REQUIRE((*filter)(y, 1.0).yf == reference_filter(y, 1.0).yf);
+        }
+        REQUIRE(arena.used() >= 101 * sizeof(PIDController));
+    }
+
+    SECTION("Release destroys objects and reuses the blocks") {
+        struct Counted {
+            int* count;
+            explicit Counted(int* count) : count(count) {}
+            Counted(const Counted& other) : count(other.count) {}
+            ~Counted() { ++*count; }
+        };
+        ControllerArena arena(1 << 12);
+        int destroyed = 0;
+        for (int k = 0; k < 10; ++k) {
+            arena.create<Counted>(&destroyed);
+        }
+        arena.create_array(5, Counted(&destroyed));
+        int temporaries = destroyed;
+        REQUIRE(temporaries == 1);
+
+        PIDController* array = arena.create_array(
+            1000, PIDController(1.0, 0.5, 0.0));
+        REQUIRE(array[999].params().kp == 1.0);
+        size_t reserved = arena.reserved();
+        REQUIRE(reserved >= 1000 * sizeof(PIDController));
+
+        arena.release();
+        REQUIRE(destroyed == temporaries + 15);
+        REQUIRE(arena.used() == 0);
+
+        // A reload of the same size needs no new blocks
+        arena.create_array(5, Counted(&destroyed));
+        arena.create_array(1000, PIDController(2.0, 0.5, 0.0));
+        REQUIRE(arena.reserved() == reserved);
+    }
+
+    SECTION("A throwing copy destroys the copies already made") {
+        struct Fragile {
+            int* live;
+            int* copies_left;
+            Fragile(int* live, int* copies_left)
+                : live(live), copies_left(copies_left) {
+                ++*live;
+            }
+            Fragile(const Fragile& other)
+                : live(other.live), copies_left(other.copies_left) {
+                if (--*copies_left < 0) {
+                    throw std::runtime_error("copy failed");
+                }
+                ++*live;
+            }
+            ~Fragile() { --*live; }
+        };
+        ControllerArena arena;
+        int live = 0;
+        int copies_left = 3;
+        {
+            Fragile value(&live, &copies_left);
+            REQUIRE_THROWS_AS(arena.create_array(8, value),
+                              std::runtime_error);
+            REQUIRE(live == 1);
+        }
+        REQUIRE(live == 0);
+        arena.release();
+        REQUIRE(live == 0);
+
+        REQUIRE_THROWS_AS(arena.create_array(
+                              std::numeric_limits<size_t>::max() / 2,
+                              PIDController(1.0, 0.5, 0.0)),
+                          std::bad_array_new_length);
+        REQUIRE_THROWS_AS(
+            ArenaAllocator<double>(arena).allocate(
+                std::numeric_limits<size_t>::max() / 4),
+            std::bad_array_new_length);
+        REQUIRE_THROWS_AS(
+            arena.allocate(std::numeric_limits<size_t>::max()),
+            std::bad_alloc);
+    }
+
+    SECTION("Containers with the arena allocator") {
+        ControllerArena arena;
+        typedef ArenaAllocator<PIDController> Allocator;
+        std::vector<PIDController, Allocator> controllers{Allocator(arena)};
+        controllers.reserve(64);
+        for (int i = 0; i < 64; ++i) {
+            controllers.push_back(PIDController(1.0, 0.1 * i, 0.0));
+        }
+        REQUIRE(reinterpret_cast<uintptr_t>(controllers.data())
+                    % ARENA_ALIGNMENT == 0);
+        REQUIRE(controllers.get_allocator() == Allocator(arena));
+        REQUIRE(arena.used() >= 64 * sizeof(PIDController));
+    }
+}
+
+TEST_CASE("NUMA-partitioned bank", "[partitioned_bank]") {
+    SECTION("CPU lists and nodes") {
+        REQUIRE(parse_cpu_list("0-3,8,10-11\n")
+                == std::vector<size_t>({0, 1, 2, 3, 8, 10, 11}));
+        REQUIRE(parse_cpu_list("").empty());
+        REQUIRE_THROWS_AS(parse_cpu_list("0-"), std::invalid_argument);
+        REQUIRE_THROWS_AS(parse_cpu_list("3-1"), std::invalid_argument);
+        REQUIRE_THROWS_AS(parse_cpu_list("1,"), std::invalid_argument);
+
+        std::vector<NumaNode> nodes = numa_nodes();
+        REQUIRE(!nodes.empty());
+        for (size_t k = 0; k < nodes.size(); ++k) {
+            REQUIRE(!nodes[k].cpus.empty());
+        }
+    }
+
+    SECTION("Shards step like one bank") {
+        const size_t n = 37;
+        PartitionOptions options;
+        for (size_t id = 0; id < 2; ++id) {
+            NumaNode node;
+            node.id = id;
+            node.cpus.push_back(0);
+            options.nodes.push_back(node);
+        }
+        options.shards_per_node = 2;
+        PartitionedBank partitioned(n, options, 0.0, 0.0, 0.0);
+        PIDBank bank(n, 0.0, 0.0, 0.0);
+        REQUIRE(partitioned.size() == n);
+        REQUIRE(partitioned.shards() == 4);
+        size_t total = 0;
+        for (size_t k = 0; k < partitioned.shards(); ++k) {
+            // Shards past the end are empty
+            REQUIRE((partitioned.shard_begin(k) % 8 == 0
+                     || partitioned.shard(k).size() == 0));
+            REQUIRE(partitioned.shard_node(k) == k / 2);
+            total += partitioned.shard(k).size();
+        }
+        REQUIRE(total == n);
+
+        for (size_t i = 0; i < n; ++i) {
+            double kp = 1.0 + 0.1 * i;
+            double ki = i % 5 == 0 ? 0.0 : 0.5;
+            partitioned.configure(i, kp, ki, 0.1, 5.0 + i, -2.0, 2.0);
+            bank.configure(i, kp, ki, 0.1, 5.0 + i, -2.0, 2.0);
+            REQUIRE(partitioned.shard_of(i) < partitioned.shards());
+        }
+        partitioned.set_auto_windup(true);
+        bank.set_auto_windup(true);
+
+        std::mt19937 rng(3);
+        std::normal_distribution<double> noise(0.0, 1.0);
+        std::vector<double> r(n), y(n), zeros(n, 0.0), Tx(n), u(n), u2(n);
+        std::unique_ptr<bool[]> track(new bool[n]);
+        std::unique_ptr<bool[]> auto_mode(new bool[n]);
+        std::vector<WindupMode> windup(n, WindupMode::NONE);
+        for (int k = 0; k < 200; ++k) {
+            for (size_t i = 0; i < n; ++i) {
+                r[i] = 1.0;
+                y[i] = 0.01 * k + noise(rng);
+                Tx[i] = 1.0 + 0.1 * noise(rng);
+                track[i] = k % 50 == 7;
+                auto_mode[i] = (k + i) % 30 != 0;
+            }
+            partitioned.step(r.data(), y.data(), zeros.data(), zeros.data(),
+                             zeros.data(), Tx.data(), track.get(),
+                             auto_mode.get(), windup.data(), u.data());
+            bank.step(r.data(), y.data(), zeros.data(), zeros.data(),
+                      zeros.data(), Tx.data(), track.get(), auto_mode.get(),
+                      windup.data(), u2.data());
+            REQUIRE(u == u2);
+        }
+
+        std::vector<PIDControllerState> states(n), states2(n);
+        partitioned.snapshot(states.data());
+        bank.snapshot(states2.data());
+        for (size_t i = 0; i < n; ++i) {
+            REQUIRE(states[i].u_old == states2[i].u_old);
+            REQUIRE(states[i].yf == states2[i].yf);
+        }
+    }
+
+    SECTION("More shards than cache lines") {
+        PartitionOptions options;
+        options.shards_per_node = 4;
+        options.pin = false;
+        options.spin = 0;
+        PartitionedBank partitioned(5, options, 1.0, 0.5, 0.0);
+        std::vector<double> r(5, 1.0), y(5, 0.0), zeros(5, 0.0);
+        std::vector<double> Tx(5, 1.0), u(5);
+        std::unique_ptr<bool[]> track(new bool[5]);
+        std::unique_ptr<bool[]> auto_mode(new bool[5]);
+        std::vector<WindupMode> windup(5, WindupMode::NONE);
+        for (size_t i = 0; i < 5; ++i) {
+            track[i] = false;
+            auto_mode[i] = true;
+        }
+        partitioned.step(r.data(), y.data(), zeros.data(), zeros.data(),
+                         zeros.data(), Tx.data(), track.get(),
+                         auto_mode.get(), windup.data(), u.data());
+        REQUIRE(partitioned.shard(0).size() == 5);
+        REQUIRE(u[4] == Approx(1.5));
+    }
+}
+
+TEST_CASE("Shared-memory bank", "[shared_bank]") {
+    const size_t n = 21;
+    const std::string name = "/pid_test_bank_" + std::to_string(
+        std::chrono::steady_clock::now().time_since_epoch().count());
+    std::vector<double> r(n), y(n), uff(n, 0.0), uman(n), zeros(n, 0.0);
+    std::vector<double> Tx(n, 1.0), u(n), u2(n);
+    std::vector<WindupMode> windup(n, WindupMode::NONE);
+    std::unique_ptr<bool[]> track(new bool[n]);
+    std::unique_ptr<bool[]> auto_mode(new bool[n]);
+    for (size_t i = 0; i < n; ++i) {
+        track[i] = false;
+        auto_mode[i] = true;
+    }
+
+    SECTION("Steps like a PIDBank and readers see the states") {
+        SharedPIDBank shared(name, n, 1.0, 0.5, 0.1, 10.0, -2.0, 2.0);
+        PIDBank bank(n, 1.0, 0.5, 0.1, 10.0, -2.0, 2.0);
+        SharedBankReader reader(name);
+        REQUIRE(reader.size() == n);
+
+        std::mt19937 rng(5);
+        std::normal_distribution<double> noise(0.0, 1.0);
+        SharedBankSnapshot snapshot;
+        for (int k = 0; k < 50; ++k) {
+            for (size_t i = 0; i < n; ++i) {
+                r[i] = 1.0;
+                y[i] = 0.1 * k + noise(rng);
+                uman[i] = 0.5;
+                Tx[i] = 1.0 + 0.1 * noise(rng);
+            }
+            if (k == 20) {
+                shared.set_mode(3, false, false);
+                auto_mode[3] = false;
+            }
+            shared.step(r.data(), y.data(), uff.data(), uman.data(),
+                        zeros.data(), Tx.data(), windup.data(), u.data());
+            bank.step(r.data(), y.data(), uff.data(), uman.data(),
+                      zeros.data(), Tx.data(), track.get(), auto_mode.get(),
+                      windup.data(), u2.data());
+            REQUIRE(u == u2);
+
+            reader.read(snapshot);
+            REQUIRE(snapshot.steps == static_cast<uint64_t>(k + 1));
+            REQUIRE(snapshot.u == u);
+            std::vector<PIDControllerState> states(n);
+            bank.snapshot(states.data());
+            for (size_t i = 0; i < n; ++i) {
+                REQUIRE(snapshot.yf[i] == states[i].yf);
+                REQUIRE(snapshot.dyf[i] == states[i].dyf);
+                REQUIRE(snapshot.saturation[i] == bank.saturation()[i]);
+                REQUIRE(snapshot.auto_mode[i] == (auto_mode[i] ? 1 : 0));
+                REQUIRE(snapshot.track[i] == 0);
+            }
+        }
+
+        REQUIRE(reader.try_read(snapshot, 5, 3));
+        REQUIRE(snapshot.u.size() == 3);
+        REQUIRE(snapshot.u[0] == u[5]);
+        REQUIRE_THROWS_AS(reader.try_read(snapshot, 20, 2),
+                          std::out_of_range);
+    }
+
+    SECTION("Snapshots are never torn by concurrent steps") {
+        // In manual mode every control signal is the step number
+        SharedPIDBank shared(name, n, 1.0, 0.5, 0.0);
+        for (size_t i = 0; i < n; ++i) {
+            shared.set_mode(i, false, false);
+        }
+        std::atomic<bool> done(false);
+        std::thread writer([&]() {
+            for (int k = 1; k <= 20000; ++k) {
+                std::fill(uman.begin(), uman.end(), static_cast<double>(k));
+                shared.step(r.data(), y.data(), uff.data(), uman.data(),
+                            zeros.data(), Tx.data(), windup.data(),
+                            u.data());
+            }
+            done = true;
+        });
+
+        SharedBankReader reader(name);
+        SharedBankSnapshot snapshot;
+        size_t reads = 0;
+        bool consistent = true;
+        while (!done) {
+            reader.read(snapshot);
+            for (size_t i = 0; i < n; ++i) {
+                consistent = consistent
+                    && snapshot.u[i] == static_cast<double>(snapshot.steps);
+            }
+            ++reads;
+        }
+        writer.join();
+        REQUIRE(reads > 0);
+        REQUIRE(consistent);
+        reader.read(snapshot);
+        REQUIRE(snapshot.steps == 20000);
+    }
+
+    SECTION("Missing segments") {
+        REQUIRE_THROWS_AS(SharedBankReader(name), std::runtime_error);
+        {
+            SharedPIDBank shared(name, n, 1.0, 0.0, 0.0);
+        }
+        REQUIRE_THROWS_AS(SharedBankReader(name), std::runtime_error);
+    }
+}
+
+TEST_CASE("Step results and automatic windup", "[windup]") {
+    SECTION("Increments add up to the control signal") {
+        PIDController controller(1.0, 0.5, 0.1, 10.0, -3.0, 3.0);
+        PIDController reference(1.0, 0.5, 0.1, 10.0, -3.0, 3.0);
+        double u_old = 0.0;
+        for (int k = 0; k < 40; ++k) {
+            double r = k < 20 ? 1.0 : -8.0;
+            double y = 0.1 * k;
+            double uff = 0.05 * k;
+            PIDStepResult result = controller.step(r, y, uff);
+            REQUIRE(result.u == reference(r, y, uff));
+            double sum = u_old + result.Dup + result.Dui + result.Dud
+                + result.Duff;
+            if (result.saturation == 0) {
+                REQUIRE(result.u == Approx(sum).margin(1e-12));
+            } else if (result.saturation == SATURATED_HIGH) {
+                REQUIRE(result.windup() == WindupMode::UPPER);
+                REQUIRE(result.u == 3.0);
+                REQUIRE(sum >= 3.0);
+            } else {
+                REQUIRE(result.saturation == SATURATED_LOW);
+                REQUIRE(result.windup() == WindupMode::LOWER);
+                REQUIRE(result.u == -3.0);
+                REQUIRE(sum <= -3.0);
+            }
+            REQUIRE(controller.saturation() == result.saturation);
+            u_old = result.u;
+        }
+        REQUIRE(controller.saturation() == SATURATED_LOW);
+        controller.reset();
+        REQUIRE(controller.saturation() == 0);
+
+        // Manual mode has no increments
+        PIDStepResult manual = controller.step(
+            1.0, 0.0, 0.0, 5.0, 0.0, 1.0, false, false);
+        REQUIRE(manual.u == 3.0);
+        REQUIRE(manual.Dup == 0.0);
+        REQUIRE(manual.Dui == 0.0);
+        REQUIRE(manual.saturation == SATURATED_HIGH);
+    }
+
+    SECTION("Automatic windup matches passing the flags back in") {
+        PIDController automatic(2.0, 1.0, 0.2, 10.0, -3.0, 3.0);
+        PIDController manual(2.0, 1.0, 0.2, 10.0, -3.0, 3.0);
+        automatic.set_auto_windup(true);
+        REQUIRE(automatic.auto_windup());
+        BasicPID<PIDStructure::PID> basic(2.0, 1.0, 0.2, 10.0, -3.0, 3.0);
+        basic.set_auto_windup(true);
+
+        WindupMode windup = WindupMode::NONE;
+        bool saturated = false;
+        for (int k = 0; k < 100; ++k) {
+            double r = (k / 25) % 2 == 0 ? 5.0 : -5.0;
+            double y = std::sin(0.1 * k);
+            double u = automatic(r, y);
+            PIDStepResult result = manual.step(
+                r, y, 0.0, 0.0, 0.0, 1.0, false, true, windup);
+            REQUIRE(u == result.u);
+            REQUIRE(basic(r, y) == u);
+            windup = result.windup();
+            saturated = saturated || result.saturation != 0;
+        }
+        REQUIRE(saturated);
+    }
+
+    SECTION("Batch run with automatic windup") {
+        IOData data = load_io_data("data/PID_antiwindup_step.csv");
+        PIDController stepped(2.0, 1.0, 0.2, 10.0, -3.0, 3.0);
+        PIDController batch(2.0, 1.0, 0.2, 10.0, -3.0, 3.0);
+        stepped.set_auto_windup(true);
+        batch.set_auto_windup(true);
+        std::vector<double> u(data.n);
+        batch.run(data.inputs(), u.data());
+        for (size_t i = 0; i < data.n; ++i) {
+            REQUIRE(u[i] == stepped(data.r[i], data.y[i], data.uff[i],
+                                    data.uman[i], data.utrack[i],
+                                    data.Tx[i], data.track[i],
+                                    data.auto_mode[i]));
+        }
+        REQUIRE(batch.saturation() == stepped.saturation());
+    }
+
+    SECTION("Array forms match the scalar functions bit for bit") {
+        // Odd lengths and offsets exercise the scalar tails and
+        // unaligned vectors; signed zeros, infinities and NaN the
+        // comparison semantics
+        const double inf = std::numeric_limits<double>::infinity();
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        const double special[] = {0.0, -0.0, 1.0, -1.0, 3.0, -3.0,
+                                  inf, -inf, nan, 1e-300, -1e-300};
+        const size_t num_special = sizeof(special) / sizeof(special[0]);
+        const size_t n = 101;
+        std::vector<double> values(n + 1), umin(n + 1), umax(n + 1);
+        std::vector<unsigned char> windup(n + 1);
+        for (size_t i = 0; i <= n; ++i) {
+            values[i] = i < 3 * num_special
+                ? special[i % num_special] : std::sin(0.7 * i) * 5.0;
+            umin[i] = i % 5 == 0 ? -0.0 : -3.0;
+            umax[i] = i % 7 == 0 ? 0.0 : (i % 11 == 0 ? inf : 3.0);
+            windup[i] = static_cast<unsigned char>((i / 2) % 4);
+        }
+
+        for (size_t offset = 0; offset <= 1; ++offset) {
+            for (size_t count = 0; count + offset <= n; count += 9) {
+                std::vector<double> Dui(values.begin() + offset,
+                                        values.begin() + offset + count);
+                anti_windup(Dui.data(), windup.data() + offset, count);
+                std::vector<double> u(values.begin() + offset,
+                                      values.begin() + offset + count);
+                std::vector<unsigned char> saturation(count, 0xff);
+                saturate_with_flags(u.data(), umin.data() + offset,
+                                    umax.data() + offset,
+                                    saturation.data(), count);
+                for (size_t i = 0; i < count; ++i) {
+                    size_t j = i + offset;
+                    INFO("Element " << j);
+                    double expected_Dui = anti_windup(
+                        values[j], static_cast<WindupMode>(windup[j]));
+                    REQUIRE(std::memcmp(&Dui[i], &expected_Dui,
+                                        sizeof(double)) == 0);
+                    unsigned char expected_saturation;
+                    double expected_u = saturate_with_flags(
+                        values[j], umin[j], umax[j], expected_saturation);
+                    REQUIRE(std::memcmp(&u[i], &expected_u,
+                                        sizeof(double)) == 0);
+                    REQUIRE(saturation[i] == expected_saturation);
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Trace recorder", "[trace]") {
+    const char* path = "trace_test.pidtraj";
+    TrajectoryConfig config;
+    config.kp = 2.0;
+    config.ki = 1.0;
+    config.kd = 0.2;
+    config.umin = -3.0;
+    config.umax = 3.0;
+
+    SECTION("Records every step of several threads") {
+        const size_t n = 2000;
+        std::vector<std::vector<double> > expected(2);
+        {
+            TraceRecorder recorder(path, config);
+            std::vector<std::thread> threads;
+            for (uint32_t loop = 0; loop < 2; ++loop) {
+                TraceWriter& writer = recorder.writer();
+                threads.push_back(std::thread(
+                    [&writer, &expected, loop, n]() {
+                        PIDController controller(2.0, 1.0, 0.2, 10.0,
+                                                 -3.0, 3.0);
+                        for (size_t k = 0; k < n; ++k) {
+                            double r = (k / 100) % 2 == 0 ? 1.0 : -1.0;
+                            double y = 0.5 * std::sin(0.01 * k + loop);
+                            expected[loop].push_back(
+                                writer.step(controller, loop, r, y).u);
+
+                            // Stay below the ring capacity between drains
+                            if (k % 1000 == 999) {
+                                std::this_thread::sleep_for(
+                                    std::chrono::milliseconds(30));
+                            }
+                        }
+                    }));
+            }
+            for (size_t t = 0; t < threads.size(); ++t) {
+                threads[t].join();
+            }
+            recorder.close();
+            REQUIRE(recorder.dropped() == 0);
+            REQUIRE(recorder.records() == 2 * n);
+        }
+
+        TrajectoryFile file(path);
+        REQUIRE(file.size() == 2 * n);
+        REQUIRE(file.config().kp == 2.0);
+        REQUIRE(file.column("r") == file.inputs().r);
+        REQUIRE(file.column("missing") == nullptr);
+        const double* loop = file.column("loop");
+        const double* step = file.column("step");
+        const double* Dup = file.column("Dup");
+        const double* Dui = file.column("Dui");
+        const double* Dud = file.column("Dud");
+        const double* Duff = file.column("Duff");
+        const double* yf = file.column("yf");
+        const double* saturation = file.column("saturation");
+        REQUIRE(loop != nullptr);
+        REQUIRE(file.column("dyf") != nullptr);
+
+        // Rows of each loop are in step order and match the controller
+        std::vector<size_t> next(2, 0);
+        size_t saturated = 0;
+        for (size_t i = 0; i < file.size(); ++i) {
+            size_t l = static_cast<size_t>(loop[i]);
+            REQUIRE(step[i] == next[l]);
+            REQUIRE(file.u()[i] == expected[l][next[l]]);
+            if (saturation[i] == 0.0 && next[l] > 0) {
+                REQUIRE(file.u()[i] == Approx(
+                    expected[l][next[l] - 1] + Dup[i] + Dui[i] + Dud[i]
+                    + Duff[i]).margin(1e-12));
+            } else {
+                ++saturated;
+            }
+            REQUIRE(std::abs(yf[i] - file.inputs().y[i]) < 1.0);
+            ++next[l];
+        }
+        REQUIRE(saturated > 2);
+
+        // The rows of a loop replay like a trajectory
+        PIDController replay(2.0, 1.0, 0.2, 10.0, -3.0, 3.0);
+        for (size_t i = 0; i < file.size(); ++i) {
+            if (loop[i] == 1.0) {
+                REQUIRE(replay.step(file.inputs().r[i], file.inputs().y[i])
+                        .u == file.u()[i]);
+            }
+        }
+    }
+
+    SECTION("Saturation trigger records windows around saturation") {
+        TraceOptions options;
+        options.trigger = TraceTrigger::SATURATION;
+        options.pre_trigger = 3;
+        options.post_trigger = 2;
+        const int n = 200;
+        std::vector<unsigned char> flags;
+        {
+            TraceRecorder recorder(path, config, options);
+            TraceWriter& writer = recorder.writer();
+            PIDController controller(1.0, 0.2, 0.0, 10.0, -3.0, 3.0);
+            for (int k = 0; k < n; ++k) {
+                double r = 4.0 * std::sin(0.05 * k);
+                double y = 2.0 * std::sin(0.05 * k - 0.5);
+                flags.push_back(writer.step(controller, 7, r, y)
+                                    .saturation);
+            }
+        }
+
+        // Steps within 3 before or 2 after a saturated step
+        std::vector<double> expected;
+        for (int k = 0; k < n; ++k) {
+            bool inside = false;
+            for (int s = std::max(k - 2, 0); s <= std::min(k + 3, n - 1);
+                 ++s) {
+                inside = inside || flags[s] != 0;
+            }
+            if (inside) {
+                expected.push_back(k);
+            }
+        }
+        REQUIRE(expected.size() > 0);
+        REQUIRE(expected.size() < static_cast<size_t>(n));
+
+        TrajectoryFile file(path);
+        REQUIRE(file.size() == expected.size());
+        for (size_t i = 0; i < file.size(); ++i) {
+            double k = file.column("step")[i];
+            REQUIRE(k == expected[i]);
+            REQUIRE(file.column("loop")[i] == 7.0);
+            REQUIRE(file.column("saturation")[i]
+                    == flags[static_cast<size_t>(k)]);
+        }
+    }
+
+    SECTION("Decimation and full rings") {
+        TraceOptions options;
+        options.decimation = 4;
+        options.capacity = 8;
+        options.flush_interval = 10.0;
+        TraceRecorder recorder(path, config, options);
+        TraceWriter& writer = recorder.writer();
+        PIDController controller(1.0, 0.5, 0.0);
+        for (int k = 0; k < 100; ++k) {
+            writer.step(controller, 0, 1.0, 0.0);
+        }
+
+        // 25 sampled steps, of which the ring holds 8
+        REQUIRE(writer.dropped() == 17);
+        recorder.close();
+        REQUIRE(recorder.records() == 8);
+        TrajectoryFile file(path);
+        REQUIRE(file.size() == 8);
+        for (size_t i = 0; i < file.size(); ++i) {
+            REQUIRE(file.column("step")[i] == 3.0 + 4.0 * i);
+        }
+    }
+
+    std::remove(path);
+    std::remove((std::string(path) + ".spool").c_str());
+}
+
+TEST_CASE("Event-driven execution", "[event_driven]") {
+    SECTION("Default deadband steps on every tick") {
+        IOData data = load_io_data("data/PI_switch_track.csv");
+        PIDController reference(1.0, 0.5, 0.0, 10.0, -10.0, 10.0);
+        PIDController controller(reference);
+        EventDrivenController event(controller, EventDeadband());
+        for (size_t i = 0; i < data.n; ++i) {
+            double expected = reference(
+                data.r[i], data.y[i], data.uff[i], data.uman[i],
+                data.utrack[i], 1.0, data.track[i], data.auto_mode[i]);
+            double u = event(
+                data.r[i], data.y[i], data.uff[i], data.uman[i],
+                data.utrack[i], 1.0, data.track[i], data.auto_mode[i]);
+            REQUIRE(u == expected);
+            REQUIRE(event.stepped());
+        }
+        REQUIRE(event.ticks() == data.n);
+        REQUIRE(event.steps() == data.n);
+    }
+
+    SECTION("Held output and catch-up over skipped ticks") {
+        PIDController reference(1.0, 0.5, 0.1);
+        PIDController controller(reference);
+        EventDrivenController event(
+            controller, EventDeadband(0.0, 0.1, 0.0, 0.0, 4.0));
+
+        // First tick always steps
+        REQUIRE(event(1.0, 0.0, 0.0, 0.0, 0.0, 0.5) == reference(
+                    1.0, 0.0, 0.0, 0.0, 0.0, 0.5));
+        REQUIRE(event.stepped());
+
+        // Changes within the deadband hold u until the timeout
+        double held = event(1.0, 0.05, 0.0, 0.0, 0.0, 1.5);
+        REQUIRE_FALSE(event.stepped());
+        REQUIRE(event(1.0, -0.05, 0.0, 0.0, 0.0, 1.5) == held);
+        REQUIRE_FALSE(event.stepped());
+        double u = event(1.0, 0.02, 0.0, 0.0, 0.0, 1.0);
+        REQUIRE(event.stepped());
+        reference(1.0, 0.0, 0.0, 0.0, 0.0, 3.0);
+        REQUIRE(u == reference(1.0, 0.02, 0.0, 0.0, 0.0, 1.0));
+
+        // A change beyond the deadband first catches up over the skipped
+        // tick with the inputs of the last step
+        event(1.0, 0.02, 0.0, 0.0, 0.0, 0.75);
+        REQUIRE_FALSE(event.stepped());
+        u = event(1.0, 0.2, 0.0, 0.0, 0.0, 0.75);
+        REQUIRE(event.stepped());
+        reference(1.0, 0.02, 0.0, 0.0, 0.0, 0.75);
+        REQUIRE(u == reference(1.0, 0.2, 0.0, 0.0, 0.0, 0.75));
+
+        // Mode changes and NaN step regardless of the deadband
+        event(1.0, 0.2, 0.0, 0.0, 0.0, 1.0, false, false);
+        REQUIRE(event.stepped());
+        event(1.0, 0.2, 0.0, 0.0, 0.0, 1.0, false, false);
+        REQUIRE_FALSE(event.stepped());
+        event(1.0, 0.2, 0.0, 0.0, 0.0, 1.0, false, false,
+              WindupMode::UPPER);
+        REQUIRE(event.stepped());
+        event(1.0, std::nan(""), 0.0, 0.0, 0.0, 1.0, false, false,
+              WindupMode::UPPER);
+        REQUIRE(event.stepped());
+        REQUIRE(event.steps() == 6);
+        REQUIRE(event.ticks() == 10);
+
+        // Reset steps on the next tick
+        event.reset();
+        event(1.0, 0.2, 0.0, 0.0, 0.0, 1.0, false, false,
+              WindupMode::UPPER);
+        REQUIRE(event.stepped());
+    }
+
+    SECTION("Bank steps only the due controllers") {
+        const size_t n = 37;
+        PIDBank bank(n, 1.0, 0.5, 0.1, 10.0, -2.0, 2.0);
+        std::vector<PIDController> controllers(
+            n, PIDController(1.0, 0.5, 0.1, 10.0, -2.0, 2.0));
+        std::vector<EventDrivenController> events;
+        EventDeadband deadband(0.0, 0.2, 0.0, 0.0, 8.0);
+        for (size_t i = 0; i < n; ++i) {
+            events.push_back(EventDrivenController(controllers[i],
+                                                   deadband));
+        }
+        EventDrivenBank event_bank(bank, deadband);
+        event_bank.set_deadband(5, EventDeadband());
+        events[5].set_deadband(EventDeadband());
+        REQUIRE(event_bank.deadband(5).max_interval == 1.0);
+
+        std::mt19937 rng(30);
+        std::uniform_real_distribution<double> noise(-0.15, 0.15);
+        std::uniform_int_distribution<int> event(0, 9);
+        std::vector<double> r(n, 1.0), y(n, 0.0), zero(n, 0.0);
+        std::vector<double> Tx(n, 1.0), u(n, 0.0);
+        std::unique_ptr<bool[]> track(new bool[n]());
+        std::unique_ptr<bool[]> auto_mode(new bool[n]);
+        std::fill(auto_mode.get(), auto_mode.get() + n, true);
+        std::vector<WindupMode> windup(n, WindupMode::NONE);
+        size_t steps = 0;
+        for (int k = 0; k < 300; ++k) {
+            for (size_t i = 0; i < n; ++i) {
+                y[i] = 0.5 * std::sin(0.01 * k * (i + 1)) + noise(rng);
+                r[i] = event(rng) == 0 ? -r[i] : r[i];
+                auto_mode[i] = event(rng) != 0 || auto_mode[i];
+            }
+            size_t count = event_bank.tick(
+                r.data(), y.data(), zero.data(), zero.data(), zero.data(),
+                Tx.data(), track.get(), auto_mode.get(), windup.data(),
+                u.data());
+            REQUIRE(count == event_bank.active().size());
+            steps += count;
+            size_t a = 0;
+            for (size_t i = 0; i < n; ++i) {
+                double expected = events[i](
+                    r[i], y[i], 0.0, 0.0, 0.0, Tx[i], track[i],
+                    auto_mode[i]);
+                INFO("Tick " << k << ", controller " << i);
+                REQUIRE(u[i] == expected);
+                bool active = a < count && event_bank.active()[a] == i;
+                REQUIRE(active == events[i].stepped());
+                a += active;
+            }
+        }
+        REQUIRE(event_bank.ticks() == 300);
+        REQUIRE(event_bank.steps() == steps);
+        REQUIRE(steps < 300 * n);
+        REQUIRE(events[5].steps() == 300);
+
+        // Reset steps every controller on the next tick
+        event_bank.reset();
+        REQUIRE(event_bank.tick(
+                    r.data(), y.data(), zero.data(), zero.data(),
+                    zero.data(), Tx.data(), track.get(), auto_mode.get(),
+                    windup.data(), u.data()) == n);
+    }
+
+    SECTION("Zero deadband returns to every-tick stepping") {
+        // Inputs constant over the first ticks, as in the dead time of a
+        // loop, then changing on every tick
+        const size_t n = 9;
+        const size_t ticks = 200;
+        const size_t constant = 12;
+        PIDBank bank(n, 2.0, 0.1, 5.0, 10.0, -10.0, 10.0);
+        PIDController prototype(2.0, 0.1, 5.0, 10.0, -10.0, 10.0);
+        std::vector<PIDController> references(n, prototype);
+        std::vector<PIDController> controllers(n, prototype);
+        std::vector<EventDrivenController> events;
+        EventDeadband deadband(0.0, 0.0, 0.0, 0.0, 50.0);
+        for (size_t i = 0; i < n; ++i) {
+            events.push_back(EventDrivenController(controllers[i],
+                                                   deadband));
+        }
+        EventDrivenBank event_bank(bank, deadband);
+
+        std::vector<double> r(n, 1.0), y(n, 0.0), zero(n, 0.0);
+        std::vector<double> Tx(n, 1.0), u(n, 0.0);
+        std::unique_ptr<bool[]> track(new bool[n]());
+        std::unique_ptr<bool[]> auto_mode(new bool[n]);
+        std::fill(auto_mode.get(), auto_mode.get() + n, true);
+        std::vector<WindupMode> windup(n, WindupMode::NONE);
+        for (size_t k = 0; k < ticks; ++k) {
+            for (size_t i = 0; i < n; ++i) {
+                // Controllers start changing at different ticks
+                size_t start = constant + i;
+                y[i] = k < start ? 0.0
+                    : 1.0 - std::exp(-0.05 * static_cast<double>(k - start));
+                Tx[i] = i % 2 ? 0.5 : 1.0;
+            }
+            event_bank.tick(
+                r.data(), y.data(), zero.data(), zero.data(), zero.data(),
+                Tx.data(), track.get(), auto_mode.get(), windup.data(),
+                u.data());
+            for (size_t i = 0; i < n; ++i) {
+                double expected = references[i](r[i], y[i], 0.0, 0.0, 0.0,
+                                                Tx[i]);
+                double held = events[i](r[i], y[i], 0.0, 0.0, 0.0, Tx[i]);
+                INFO("Tick " << k << ", controller " << i);
+                REQUIRE(u[i] == held);
+                if (k > constant + i) {
+                    REQUIRE(events[i].stepped());
+                    REQUIRE(held == Approx(expected).margin(1e-12));
+                } else if (k > 0) {
+                    REQUIRE_FALSE(events[i].stepped());
+                    REQUIRE(held != expected);
+                }
+            }
+        }
+
+        // The report error is that of the held ticks alone
+        std::vector<double> y_series(ticks), r_series(ticks, 1.0);
+        PIDController reference(prototype);
+        double hold_error = 0.0;
+        double u_held = 0.0;
+        for (size_t k = 0; k < ticks; ++k) {
+            y_series[k] = k <= constant ? 0.0
+                : 1.0 - std::exp(-0.05 * static_cast<double>(k - constant));
+            double u_ref = reference(1.0, y_series[k]);
+            u_held = k == 0 ? u_ref : u_held;
+            if (k <= constant) {
+                hold_error = std::max(hold_error, std::abs(u_held - u_ref));
+            }
+        }
+        EventTrackingReport report = event_tracking_report(
+            prototype, deadband,
+            InputSeries(ticks, r_series.data(), y_series.data()));
+        REQUIRE(report.steps == ticks - constant);
+        REQUIRE(hold_error > 0.0);
+        REQUIRE(report.max_error == Approx(hold_error).margin(1e-12));
+    }
+
+    SECTION("Bank checks match event_due") {
+        // Every condition, NaN and a tail shorter than a SIMD vector
+        const size_t n = 19;
+        PIDBank bank(n, 1.0, 0.5, 0.1, 10.0, -2.0, 2.0);
+        std::vector<PIDController> controllers(
+            n, PIDController(1.0, 0.5, 0.1, 10.0, -2.0, 2.0));
+        std::vector<EventDrivenController> events;
+        EventDeadband deadband(0.1, 0.1, 0.1, 0.1, 3.0);
+        for (size_t i = 0; i < n; ++i) {
+            events.push_back(EventDrivenController(controllers[i],
+                                                   deadband));
+        }
+        EventDrivenBank event_bank(bank, deadband);
+
+        std::mt19937 rng(31);
+        std::uniform_real_distribution<double> change(-0.2, 0.2);
+        std::uniform_real_distribution<double> period(0.5, 1.5);
+        std::uniform_int_distribution<int> event(0, 19);
+        std::vector<double> r(n, 0.0), y(n, 0.0), uff(n, 0.0);
+        std::vector<double> uman(n, 0.0), utrack(n, 0.0);
+        std::vector<double> Tx(n, 1.0), u(n, 0.0);
+        std::unique_ptr<bool[]> track(new bool[n]());
+        std::unique_ptr<bool[]> auto_mode(new bool[n]);
+        std::fill(auto_mode.get(), auto_mode.get() + n, true);
+        std::vector<WindupMode> windup(n, WindupMode::NONE);
+        for (int k = 0; k < 400; ++k) {
+            for (size_t i = 0; i < n; ++i) {
+                double* signals[] = {
+                    &r[i], &y[i], &uff[i], &uman[i], &utrack[i]
+                };
+                *signals[event(rng) % 5] += change(rng);
+                uff[i] = event(rng) == 0 ? std::nan("") : uff[i];
+                uff[i] = std::isnan(uff[i]) && event(rng) < 10 ? 0.0
+                                                               : uff[i];
+                track[i] = event(rng) == 0 ? !track[i] : track[i];
+                auto_mode[i] = event(rng) == 0 ? !auto_mode[i]
+                                               : auto_mode[i];
+                windup[i] = event(rng) == 0
+                    ? static_cast<WindupMode>(event(rng) % 4)
+                    : windup[i];
+                Tx[i] = period(rng);
+            }
+            event_bank.tick(
+                r.data(), y.data(), uff.data(), uman.data(), utrack.data(),
+                Tx.data(), track.get(), auto_mode.get(), windup.data(),
+                u.data());
+            size_t a = 0;
+            for (size_t i = 0; i < n; ++i) {
+                events[i](r[i], y[i], uff[i], uman[i], utrack[i], Tx[i],
+                          track[i], auto_mode[i], windup[i]);
+                INFO("Tick " << k << ", controller " << i);
+                bool active = a < event_bank.active().size()
+                    && event_bank.active()[a] == i;
+                REQUIRE(active == events[i].stepped());
+                a += active;
+            }
+        }
+    }
+
+    SECTION("Bank subsets match full steps") {
+        const size_t n = 21;
+        PIDBank full(n, 1.0, 0.5, 0.1, 10.0, -1.0, 1.0);
+        PIDBank subset(n, 1.0, 0.5, 0.1, 10.0, -1.0, 1.0);
+        std::vector<double> r(n, 1.0), y(n), zero(n, 0.0), Tx(n, 1.0);
+        std::vector<double> u_full(n), u_subset(n, -7.0);
+        std::unique_ptr<bool[]> track(new bool[n]());
+        std::unique_ptr<bool[]> auto_mode(new bool[n]);
+        std::fill(auto_mode.get(), auto_mode.get() + n, true);
+        std::vector<WindupMode> windup(n, WindupMode::NONE);
+        std::vector<size_t> all(n);
+        for (size_t i = 0; i < n; ++i) {
+            all[i] = i;
+            y[i] = 0.1 * i;
+            Tx[i] = 0.5 + 0.05 * i;
+        }
+        full.step(r.data(), y.data(), zero.data(), zero.data(), zero.data(),
+                  Tx.data(), track.get(), auto_mode.get(), windup.data(),
+                  u_full.data());
+        subset.step_active(all.data(), n, r.data(), y.data(), zero.data(),
+                           zero.data(), zero.data(), Tx.data(), track.get(),
+                           auto_mode.get(), windup.data(), u_subset.data());
+        REQUIRE(u_subset == u_full);
+
+        // Controllers not listed keep their state and output
+        const size_t some[] = {0, 1, 2, 9, 17, 18, 20};
+        std::vector<double> u_before = u_subset;
+        subset.step_active(some, 7, r.data(), y.data(), zero.data(),
+                           zero.data(), zero.data(), Tx.data(), track.get(),
+                           auto_mode.get(), windup.data(), u_subset.data());
+        full.step(r.data(), y.data(), zero.data(), zero.data(), zero.data(),
+                  Tx.data(), track.get(), auto_mode.get(), windup.data(),
+                  u_full.data());
+        std::vector<PIDControllerState> states(n);
+        std::vector<PIDControllerState> stepped(n);
+        subset.snapshot(states.data());
+        full.snapshot(stepped.data());
+        for (size_t i = 0, k = 0; i < n; ++i) {
+            if (k < 7 && some[k] == i) {
+                REQUIRE(u_subset[i] == u_full[i]);
+                REQUIRE(states[i].u_old == stepped[i].u_old);
+                ++k;
+            } else {
+                REQUIRE(u_subset[i] == u_before[i]);
+                REQUIRE(states[i].u_old == u_before[i]);
+            }
+        }
+    }
+
+    SECTION("Tracking report") {
+        IOData data = load_io_data("data/PID_step.csv");
+        PIDController controller(1.0, 0.5, 0.1, 10.0, -10.0, 10.0);
+        EventTrackingReport exact =
+            event_tracking_report(controller, EventDeadband(), data.inputs());
+        REQUIRE(exact.ticks == data.n);
+        REQUIRE(exact.steps == data.n);
+        REQUIRE(exact.max_error == 0.0);
+        REQUIRE(exact.rms_error == 0.0);
+
+        EventTrackingReport report = event_tracking_report(
+            controller, EventDeadband(0.0, 0.05, 0.0, 0.0, 5.0),
+            data.inputs());
+        REQUIRE(report.ticks == data.n);
+        REQUIRE(report.steps < data.n);
+        REQUIRE(report.max_error > 0.0);
+        REQUIRE(report.rms_error <= report.max_error);
+        REQUIRE(report.max_relative_error < 0.5);
+    }
+}
+
+// Allocations through operator new, for checking real-time steps. Every
+// form of the global operators is replaced, so that memory from any new
+// goes back through free() and sanitizers see matching pairs. Not
+// inlined, so that GCC does not pair the malloc and free across them.
+static std::atomic<size_t> allocation_count(0);
+
+#ifdef __GNUC__
+#define TEST_NOINLINE __attribute__((noinline))
+#else
+#define TEST_NOINLINE
+#endif
+
+static void* counted_malloc(std::size_t size) noexcept {
+    ++allocation_count;
+    return std::malloc(size ? size : 1);
+}
+
+TEST_NOINLINE void* operator new(std::size_t size) {
+    void* p = counted_malloc(size);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+TEST_NOINLINE void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+TEST_NOINLINE void* operator new(std::size_t size,
+                                 const std::nothrow_t&) noexcept {
+    return counted_malloc(size);
+}
+
+TEST_NOINLINE void* operator new[](std::size_t size,
+                                   const std::nothrow_t&) noexcept {
+    return counted_malloc(size);
+}
+
+TEST_NOINLINE void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+TEST_NOINLINE void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+TEST_NOINLINE void operator delete(void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+TEST_NOINLINE void operator delete[](void* p,
+                                     const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+#ifdef __cpp_sized_deallocation
+TEST_NOINLINE void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+TEST_NOINLINE void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+#endif
+
+TEST_CASE("Real-time controller", "[realtime]") {
+    // Grid spacing 1/64, so grid periods are looked up exactly
+    ZohTable table(10.0, 0.25, 4.25, 256);
+    const double step = 1.0 / 64;
+
+    SECTION("Table lookup") {
+        for (int k = 0; k <= 256; k += 7) {
+            double Tx = 0.25 + k * step;
+            FilterParams exact = zoh_Fy(10.0, Tx);
+            FilterParams p = table.lookup(Tx);
+            REQUIRE(std::memcmp(&p, &exact, sizeof(p)) == 0);
+        }
+        REQUIRE(table.max_error() > 0.0);
+        REQUIRE(table.max_error() < 1e-6);
+        for (double Tx = 0.3; Tx < 4.2; Tx += 0.0137) {
+            FilterParams exact = zoh_Fy(10.0, Tx);
+            FilterParams p = table.lookup(Tx);
+            REQUIRE(std::abs(p.a11 - exact.a11) <= table.max_error());
+            REQUIRE(std::abs(p.a21 - exact.a21) <= table.max_error());
+            REQUIRE(std::abs(p.b2 - exact.b2) <= table.max_error());
+        }
+
+        // Out of range and NaN periods are clamped
+        REQUIRE(table.clamp(0.1) == 0.25);
+        REQUIRE(table.clamp(std::nan("")) == 0.25);
+        REQUIRE(table.clamp(100.0) == 4.25);
+        REQUIRE(table.clamp(1.5) == 1.5);
+        FilterParams top = table.lookup(1e9);
+        FilterParams exact = zoh_Fy(10.0, 4.25);
+        REQUIRE(std::memcmp(&top, &exact, sizeof(top)) == 0);
+
+        ZohTable single(10.0, 1.0, 1.0, 4);
+        FilterParams one = single.lookup(2.0);
+        exact = zoh_Fy(10.0, 1.0);
+        REQUIRE(std::memcmp(&one, &exact, sizeof(one)) == 0);
+        REQUIRE(single.max_error() == 0.0);
+
+        REQUIRE_THROWS_AS(ZohTable(10.0, 0.0, 1.0), std::invalid_argument);
+        REQUIRE_THROWS_AS(ZohTable(10.0, 2.0, 1.0), std::invalid_argument);
+        REQUIRE_THROWS_AS(ZohTable(10.0, 1.0, 2.0, 0),
+                          std::invalid_argument);
+    }
+
+    SECTION("Same steps as PIDController on grid periods") {
+        std::mt19937 rng(29);
+        std::uniform_real_distribution<double> signal(-4.0, 4.0);
+        std::uniform_int_distribution<int> grid(0, 256);
+        std::uniform_int_distribution<int> event(0, 19);
+        const double gains[][3] = {
+            {1.0, 0.5, 0.1}, {2.0, 0.0, 0.2}, {1.0, 0.0, 0.0}
+        };
+        for (int g = 0; g < 3; ++g) {
+            for (int feedback = 0; feedback < 2; ++feedback) {
+                PIDController reference(
+                    gains[g][0], gains[g][1], gains[g][2], 10.0, -3.0, 3.0,
+                    0.5, 0.7);
+                RealTimePIDController controller(
+                    gains[g][0], gains[g][1], gains[g][2], table, -3.0, 3.0,
+                    0.5, 0.7);
+                reference.set_auto_windup(feedback != 0);
+                controller.set_auto_windup(feedback != 0);
+                REQUIRE(controller.auto_windup() == (feedback != 0));
+                for (int k = 0; k < 2000; ++k) {
+                    double r = signal(rng);
+                    double y = signal(rng);
+                    double uff = signal(rng);
+                    double uman = signal(rng);
+                    double utrack = signal(rng);
+                    double Tx = 0.25 + grid(rng) * step;
+                    bool track = event(rng) == 0;
+                    bool auto_mode = event(rng) != 0;
+                    WindupMode windup =
+                        static_cast<WindupMode>(event(rng) % 4);
+                    PIDStepResult expected = reference.step(
+                        r, y, uff, uman, utrack, Tx, track, auto_mode,
+                        windup);
+                    PIDStepResult result = controller.step(
+                        r, y, uff, uman, utrack, Tx, track, auto_mode,
+                        windup);
+                    INFO("Gains " << g << ", step " << k);
+                    REQUIRE(std::memcmp(&result.u, &expected.u,
+                                        sizeof(double)) == 0);
+                    REQUIRE(result.Dup == expected.Dup);
+                    REQUIRE(result.Dui == expected.Dui);
+                    REQUIRE(result.Dud == expected.Dud);
+                    REQUIRE(result.Duff == expected.Duff);
+                    REQUIRE(result.saturation == expected.saturation);
+                    REQUIRE(controller.saturation() == result.saturation);
+                }
+                REQUIRE(controller.params().b == reference.params().b);
+
+                // Retuning between steps
+                ZohTable slower(5.0, 0.25, 4.25, 256);
+                reference.set_TfTs(5.0);
+                controller.set_table(slower);
+                reference.set_gains(1.5, 0.25, 0.05);
+                controller.set_gains(1.5, 0.25, 0.05);
+                reference.set_limits(-2.0, 2.0);
+                controller.set_limits(-2.0, 2.0);
+                for (int k = 0; k < 100; ++k) {
+                    double r = signal(rng);
+                    double y = signal(rng);
+                    double Tx = 0.25 + grid(rng) * step;
+                    REQUIRE(controller(r, y, 0.0, 0.0, 0.0, Tx)
+                            == reference(r, y, 0.0, 0.0, 0.0, Tx));
+                }
+                REQUIRE(&controller.table() == &slower);
+                controller.set_table(table);
+            }
+        }
+
+        RealTimePIDController controller(1.0, 0.5, 0.1, table);
+        controller(1.0, 0.5);
+        controller.reset();
+        REQUIRE(controller.saturation() == 0);
+        REQUIRE(controller.filter_state().yf == 0.0);
+        REQUIRE(controller.filter_state().dyf == 0.0);
+        PIDController reference(1.0, 0.5, 0.1);
+        REQUIRE(controller(1.0, 0.5) == reference(1.0, 0.5));
+    }
+
+    SECTION("I/O data") {
+        RealTimePIDController p(1.0, 0.0, 0.0, table, -10.0, 10.0);
+        check_controller_with_io_data(p, "data/P_step.csv");
+        RealTimePIDController pid(1.0, 0.5, 0.1, table, -10.0, 10.0);
+        check_controller_with_io_data(pid, "data/PID_step.csv");
+        RealTimePIDController saturated(2.0, 1.0, 0.2, table, -3.0, 3.0);
+        check_controller_with_io_data(
+            saturated, "data/PID_antiwindup_step.csv");
+        RealTimePIDController manual(1.0, 0.5, 0.0, table, -10.0, 10.0);
+        check_controller_with_io_data(manual, "data/PI_switch_manual.csv");
+        RealTimePIDController track(1.0, 0.5, 0.0, table, -10.0, 10.0);
+        check_controller_with_io_data(track, "data/PI_switch_track.csv");
+
+        // Periods between grid periods, to the interpolation error
+        IOData data = load_io_data("data/PID_step_irregular_time.csv");
+        RealTimePIDController irregular(1.0, 0.5, 0.1, table, -10.0, 10.0);
+        for (size_t i = 0; i < data.n; ++i) {
+            double u = irregular(
+                data.r[i], data.y[i], data.uff[i], data.uman[i],
+                data.utrack[i], data.Tx[i], data.track[i],
+                data.auto_mode[i]);
+            REQUIRE(u == Approx(data.u[i]).margin(1e-6));
+        }
+    }
+
+    SECTION("Steps do not allocate") {
+        RealTimePIDController controller(1.0, 0.5, 0.1, table, -1.0, 1.0);
+        controller.set_auto_windup(true);
+        size_t before = allocation_count.load();
+        double u = 0.0;
+        for (int k = 0; k < 1000; ++k) {
+            u += controller.step(1.0, 0.01 * k, 0.0, 0.0, 0.0,
+                                 0.5 + 0.001 * k, k % 50 == 0,
+                                 k % 300 != 0).u;
+        }
+        REQUIRE(allocation_count.load() == before);
+        REQUIRE(std::isfinite(u));
+
+        // The counter itself works
+        std::vector<double> buffer(16);
+        REQUIRE(allocation_count.load() > before);
+    }
+}
+
+#ifdef PID_ENABLE_INSTRUMENTATION
+TEST_CASE("Controller probes count events", "[instrumentation]") {
+    PIDController controller(1.0, 0.5, 0.0, 10.0, -1.0, 1.0);
+    const PIDProbe& probe = controller.probe();
+
+    controller(0.0, 0.0);                  // First step rediscretizes
+    controller(5.0, 0.0);                  // Saturates high
+    controller(5.0, 0.0, 0.0, 0.0, 0.0, 1.0, false, true,
+               WindupMode::UPPER);         // Clamped, still high
+    controller(-5.0, 0.0, 0.0, 0.0, 0.0, 2.0);  // New Tx
+    controller(0.0, 0.0, 0.0, 0.5, 0.0, 2.0, false, false);  // Manual
+    controller(0.0, 0.0, 0.0, 0.0, 0.5, 2.0, true, true);    // Track
+    controller(0.0, 0.0, 0.0, 0.0, 0.5, 2.0, true, true);
+
+    PIDProbeStats stats = probe.stats();
+    REQUIRE(stats.count(PIDEvent::STEP) == 7);
+    REQUIRE(stats.count(PIDEvent::REDISCRETIZATION) == 2);
+    REQUIRE(stats.count(PIDEvent::SATURATION_HIGH) == 2);
+    REQUIRE(stats.count(PIDEvent::SATURATION_LOW) >= 1);
+    REQUIRE(stats.count(PIDEvent::MODE_CHANGE) == 2);
+    REQUIRE(stats.count(PIDEvent::TRACK_ENTRY) == 1);
+    REQUIRE(stats.count(PIDEvent::WINDUP_CLAMP) == 1);
+
+    uint64_t histogram = 0;
+    for (size_t k = 0; k < PID_LATENCY_BUCKETS; ++k) {
+        histogram += stats.latency[k];
+    }
+    REQUIRE(histogram == 7);
+    REQUIRE(stats.quantile_cycles(1.0) >= stats.quantile_cycles(0.5));
+    REQUIRE(stats.mean_cycles() <= stats.quantile_cycles(1.0));
+    REQUIRE(pid_cycle_seconds() > 0.0);
+
+    // Batch runs count every step
+    IOData data = load_io_data("data/PI_switch_manual.csv");
+    PIDController batch(1.0, 0.5, 0.0, 10.0, -10.0, 10.0);
+    std::vector<double> u(data.n);
+    batch.run(data.inputs(), u.data());
+    size_t changes = 0;
+    for (size_t i = 1; i < data.n; ++i) {
+        changes += data.auto_mode[i] != data.auto_mode[i - 1];
+    }
+    REQUIRE(batch.probe().stats().count(PIDEvent::STEP) == data.n);
+    REQUIRE(batch.probe().stats().count(PIDEvent::MODE_CHANGE) == changes);
+
+    // Counts from several threads are summed, including exited threads
+    PIDController shared(1.0, 0.5, 0.0);
+    for (int t = 0; t < 3; ++t) {
+        std::thread worker([&shared]() {
+            for (int k = 0; k < 100; ++k) {
+                shared(1.0, 0.0);
+            }
+        });
+        worker.join();
+    }
+    REQUIRE(shared.probe().stats().count(PIDEvent::STEP) == 300);
+
+    // Indices are reused with zero counts
+    size_t id;
+    {
+        PIDController first(1.0, 0.5, 0.0);
+        first(1.0, 0.0);
+        id = first.probe().id();
+    }
+    PIDController second(1.0, 0.5, 0.0);
+    REQUIRE(second.probe().id() == id);
+    REQUIRE(second.probe().stats().count(PIDEvent::STEP) == 0);
+}
+#endif
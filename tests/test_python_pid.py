@@ -6,6 +6,8 @@ outputs match expected values from CSV files.
 Test cases are loaded from test_cases.yaml and I/O data from CSV files.
 """
 
+import importlib.util
+import os
 import sys
 from pathlib import Path
 
@@ -17,6 +19,43 @@ import yaml
 sys.path.insert(0, str(Path(__file__).parent.parent))
 
 from python_pid import PIDController
+from python_pid.trajectory import read_trajectory, write_trajectory
+
+try:
+    from python_pid import cpp
+
+    CPP_IMPORT_ERROR = None
+except ImportError as error:
+    cpp = None
+    CPP_IMPORT_ERROR = error
+
+
+def cpp_extension_expected():
+    """Whether a missing C++ extension is an error rather than a skip.
+
+    The extension is expected wherever its build dependency pybind11
+    (python-requirements.txt) is installed, or when
+    PID_REQUIRE_CPP_EXTENSION=1 is set, as in CI.
+    """
+    if os.environ.get("PID_REQUIRE_CPP_EXTENSION", "") not in ("", "0"):
+        return True
+    return importlib.util.find_spec("pybind11") is not None
+
+
+@pytest.fixture
+def cpp_extension():
+    """Fail, or skip where it cannot be built, without the C++ extension."""
+    if cpp is None:
+        message = (
+            f"C++ extension python_pid._cpp_pid not built: {CPP_IMPORT_ERROR}"
+        )
+        if cpp_extension_expected():
+            pytest.fail(f"{message}; see tests/setup_python_tests.sh")
+        pytest.skip(message)
+    return cpp
+
+
+requires_cpp = pytest.mark.usefixtures("cpp_extension")
 
 
 def load_test_cases():
@@ -79,29 +118,16 @@ def load_io_data(csv_file):
     return data
 
 
-# Load test cases from YAML
-TEST_CASES = load_test_cases()
-
+def run_python_controller(ctrl, data):
+    """Run the Python controller over I/O data.
 
-@pytest.mark.parametrize("test_case", TEST_CASES, ids=lambda x: x["name"])
-def test_pid_controller(test_case, tests_dir="tests", data_dir="data"):
-    """Test PID controller with comprehensive input-output data.
+    Args:
+        ctrl: Controller configuration from test_cases.yaml
+        data: I/O data from load_io_data
 
-    Loads complete I/O data from CSV (r, y, uff, uman, utrack, Tx,
-    auto, track, u) and verifies controller produces expected outputs.
+    Returns:
+        list: Control signal of each step
     """
-    tests_dir = Path(tests_dir)
-
-    # Create CSV file path
-    csv_filepath = tests_dir / data_dir / test_case["io_data"]
-
-    # Load complete I/O data
-    data = load_io_data(csv_filepath)
-
-    # Get controller configuration
-    ctrl = test_case["controller"]
-
-    # Create controller with test parameters
     controller = PIDController(
         kp=ctrl["kp"],
         ki=ctrl["ki"],
@@ -110,7 +136,6 @@ def test_pid_controller(test_case, tests_dir="tests", data_dir="data"):
         umax=ctrl["umax"],
     )
 
-    # Run controller with inputs from CSV
     outputs = []
     n_steps = len(data["r"])
     for i in range(n_steps):
@@ -125,6 +150,41 @@ def test_pid_controller(test_case, tests_dir="tests", data_dir="data"):
             auto=data["auto"][i],
         )
         outputs.append(u)
+    return outputs
+
+
+def input_columns(data):
+    """Input columns of I/O data as numpy arrays for the C++ bindings."""
+    columns = {
+        name: np.asarray(data[name], dtype=np.float64)
+        for name in ("r", "y", "uff", "uman", "utrack", "Tx")
+    }
+    columns["track"] = np.asarray(data["track"], dtype=bool)
+    columns["auto"] = np.asarray(data["auto"], dtype=bool)
+    return columns
+
+
+# Load test cases from YAML
+TEST_CASES = load_test_cases()
+
+
+@pytest.mark.parametrize("test_case", TEST_CASES, ids=lambda x: x["name"])
+def test_pid_controller(test_case, tests_dir="tests", data_dir="data"):
+    """Test PID controller with comprehensive input-output data.
+
+    Loads complete I/O data from CSV (r, y, uff, uman, utrack, Tx,
+    auto, track, u) and verifies controller produces expected outputs.
+    """
+    tests_dir = Path(tests_dir)
+
+    # Create CSV file path
+    csv_filepath = tests_dir / data_dir / test_case["io_data"]
+
+    # Load complete I/O data
+    data = load_io_data(csv_filepath)
+
+    # Run controller with inputs from CSV
+    outputs = run_python_controller(test_case["controller"], data)
 
     # Verify outputs match expected values (within tolerance)
     np.testing.assert_allclose(
@@ -136,6 +196,131 @@ def test_pid_controller(test_case, tests_dir="tests", data_dir="data"):
     )
 
 
+@pytest.mark.parametrize("test_case", TEST_CASES, ids=lambda x: x["name"])
+def test_trajectory_file(test_case, tests_dir="tests", data_dir="data"):
+    """Test that golden trajectory files hold the same data as the CSV."""
+    csv_filepath = Path(tests_dir) / data_dir / test_case["io_data"]
+    data = load_io_data(csv_filepath)
+    columns, config = read_trajectory(csv_filepath.with_suffix(".pidtraj"))
+
+    for name in data:
+        np.testing.assert_array_equal(columns[name], data[name],
+                                      err_msg=f"Column {name} differs")
+    for key in ("kp", "ki", "kd", "umin", "umax"):
+        assert config[key] == test_case["controller"][key]
+
+
+@requires_cpp
+@pytest.mark.parametrize("test_case", TEST_CASES, ids=lambda x: x["name"])
+def test_cpp_run(test_case, tests_dir="tests", data_dir="data"):
+    """Test that the C++ batch run matches the data and Python."""
+    csv_filepath = Path(tests_dir) / data_dir / test_case["io_data"]
+    data = load_io_data(csv_filepath)
+    ctrl = test_case["controller"]
+    parameters = {key: ctrl[key] for key in ("kp", "ki", "kd", "umin", "umax")}
+    columns = input_columns(data)
+
+    controller = cpp.PIDController(**parameters)
+    u = controller.run(**columns)
+    np.testing.assert_allclose(u, data["u"], rtol=1e-10, atol=1e-12)
+    np.testing.assert_allclose(
+        u, run_python_controller(ctrl, data), rtol=1e-10, atol=1e-12
+    )
+
+    # Steps give the batch outputs exactly, and out is filled in place
+    stepped = cpp.PIDController(**parameters)
+    for i in range(len(u)):
+        assert u[i] == stepped(
+            r=data["r"][i],
+            y=data["y"][i],
+            uff=data["uff"][i],
+            uman=data["uman"][i],
+            utrack=data["utrack"][i],
+            Tx=data["Tx"][i],
+            track=data["track"][i],
+            auto=data["auto"][i],
+        )
+    out = np.empty(len(u))
+    controller.reset()
+    result = controller.run(**columns, out=out)
+    assert np.shares_memory(result, out)
+    np.testing.assert_array_equal(out, u)
+
+
+@requires_cpp
+def test_cpp_bank(tests_dir="tests", data_dir="data"):
+    """Test that a C++ bank steps every test case like its data."""
+    datas = [
+        load_io_data(Path(tests_dir) / data_dir / case["io_data"])
+        for case in TEST_CASES
+    ]
+    bank = cpp.PIDBank(len(TEST_CASES), 0.0, 0.0, 0.0)
+    for i, case in enumerate(TEST_CASES):
+        ctrl = case["controller"]
+        bank.configure(i, ctrl["kp"], ctrl["ki"], ctrl["kd"],
+                       umin=ctrl["umin"], umax=ctrl["umax"])
+    assert len(bank) == len(TEST_CASES)
+
+    u = np.empty(len(bank))
+    for k in range(len(datas[0]["r"])):
+        step = {name: [data[name][k] for data in datas]
+                for name in ("r", "y", "uff", "uman", "utrack", "Tx",
+                             "track", "auto")}
+        bank.step(**input_columns(step), out=u)
+        np.testing.assert_allclose(
+            u, [data["u"][k] for data in datas], rtol=1e-10, atol=1e-12
+        )
+
+
+@requires_cpp
+def test_cpp_sweep(tests_dir="tests", data_dir="data"):
+    """Test that a C++ sweep gives the runs of its configurations."""
+    data = load_io_data(Path(tests_dir) / data_dir / "PID_antiwindup_step.csv")
+    columns = input_columns(data)
+    u_ref = np.asarray(data["u"])
+    results = cpp.sweep(
+        kp=[1.0, 2.0], ki=[0.5, 1.0], kd=[0.0, 0.2], TfTs=[10.0],
+        umin=-3.0, umax=3.0, u_ref=u_ref, threads=2, keep_u=True,
+        **columns,
+    )
+
+    assert results["config"].shape == (8, 4)
+    for k, (kp, ki, kd, TfTs) in enumerate(results["config"]):
+        controller = cpp.PIDController(kp, ki, kd, TfTs, -3.0, 3.0)
+        u = controller.run(**columns)
+        np.testing.assert_array_equal(results["u"][k], u)
+        Tx = columns["Tx"]
+        assert results["u_iae"][k] == pytest.approx(
+            np.sum(np.abs(u - u_ref) * Tx))
+        assert results["u_ise"][k] == pytest.approx(
+            np.sum((u - u_ref) ** 2 * Tx))
+        saturated = (u <= -3.0) | (u >= 3.0)
+        assert results["saturation_time"][k] == pytest.approx(
+            np.sum(Tx[saturated]))
+    np.testing.assert_array_equal(results["config"][5], [2.0, 0.5, 0.2, 10.0])
+
+
+def test_trajectory_round_trip(tmp_path):
+    """Test writing and reading flag, windup and extra columns."""
+    n = 13
+    columns = {
+        "r": np.arange(n) * 0.5,
+        "y": np.arange(n) * -0.25,
+        "track": [i % 3 == 0 for i in range(n)],
+        "windup": [i % 4 for i in range(n)],
+        "Dup": np.arange(n) * 0.125,
+    }
+    path = tmp_path / "round_trip.pidtraj"
+    write_trajectory(path, columns, config={"kp": 1.5})
+    result, config = read_trajectory(path)
+
+    assert set(result) == set(columns)
+    for name, values in columns.items():
+        np.testing.assert_array_equal(result[name], values)
+    assert config["kp"] == 1.5
+    assert config["TfTs"] == 10.0
+
+
 if __name__ == "__main__":
     # Run tests with pytest
     pytest.main([__file__, "-v"])